@@ -0,0 +1,423 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "batch.h"
+#include "bmp.h"
+#include "tiled.h"
+#include "image_processing.h"
+
+#define BATCH_REQUEST_TAG 20
+#define BATCH_JOB_TAG 21
+
+#define BATCH_CHUNK_SIZE 200 // chunk size of the master/worker version
+
+long long image_pixels(const char *file_name){
+	/**
+	*	Takes in a file path to an image (a .bmp file or a tiled image) and returns its number of pixels,
+	*	read from its header, or -1 if it cannot be opened.
+	*/
+	
+	if(is_tiled_file(file_name)){
+		tiled_image_t *tiled = open_tiled(file_name);
+		if(tiled == NULL){ // error message was printed by the called function
+			return -1;
+		}
+		
+		long long pixels = (long long)tiled->width * tiled->height;
+		close_tiled(tiled);
+		return pixels;
+	}
+	
+	int height, width, channels, top_down, data_start, padding;
+	FILE *image_file = open_BMP(file_name, &height, &width, &channels, &top_down, &data_start, &padding);
+	if(image_file == NULL){ // error message was printed by the called function
+		return -1;
+	}
+	
+	fclose(image_file);
+	return (long long)width * height;
+}
+
+int check_batch_input(const char *file_name){
+	/**
+	*	Takes in a file path to an image (a .bmp file or a tiled image).
+	*	In the master/worker version, a master which fails while reading the image leaves its workers waiting for work,
+	*	so the group checks the image before editing it: it has to open and a .bmp file has to hold every row its header announces.
+	*	It returns 0 if the image can be edited and -1 otherwise.
+	*/
+	
+	if(is_tiled_file(file_name)){
+		tiled_image_t *tiled = open_tiled(file_name);
+		if(tiled == NULL){ // error message was printed by the called function
+			return -1;
+		}
+		
+		close_tiled(tiled);
+		return 0;
+	}
+	
+	int height, width, channels, top_down, data_start, padding;
+	FILE *image_file = open_BMP(file_name, &height, &width, &channels, &top_down, &data_start, &padding);
+	if(image_file == NULL){ // error message was printed by the called function
+		return -1;
+	}
+	
+	fseek(image_file, 0, SEEK_END);
+	long long file_size = ftell(image_file);
+	fclose(image_file);
+	
+	if(file_size < data_start + (long long)height * (width * channels + padding)){
+		fprintf(stderr, "Error in check_batch_input: file %s is shorter than its header says\n", file_name);
+		fflush(stderr);
+		return -1;
+	}
+	
+	return 0;
+}
+
+int read_manifest(const char *manifest_file_name, batch_job_t **jobs){
+	/**
+	*	Takes in the file path of a manifest and a place to store its jobs.
+	*	Every line of the manifest holds an input file path, an output file path and an operation, separated by spaces;
+	*	empty lines and lines starting with `#` are skipped. The size of every input is read from its header.
+	*	It returns the number of jobs, or -1 on failure.
+	*/
+	
+	FILE *manifest_file = fopen(manifest_file_name, "r");
+	if(manifest_file == NULL){
+		fprintf(stderr, "Error in read_manifest: Could not open file %s\n", manifest_file_name);
+		fflush(stderr);
+		return -1;
+	}
+	
+	int capacity = 64;
+	int num_jobs = 0;
+	int line_number = 0;
+	char line[3 * BATCH_PATH_SIZE];
+	
+	*jobs = (batch_job_t*)malloc(capacity * sizeof(batch_job_t));
+	if(*jobs == NULL){
+		fprintf(stderr, "Error in read_manifest while allocating memory\n");
+		fflush(stderr);
+		fclose(manifest_file);
+		return -1;
+	}
+	
+	while(fgets(line, sizeof(line), manifest_file) != NULL){
+		++line_number;
+		
+		char *start = line + strspn(line, " \t");
+		if(*start == '#' || *start == '\n' || *start == '\r' || *start == '\0') continue;
+		
+		if(num_jobs == capacity){
+			capacity *= 2;
+			batch_job_t *new_jobs = (batch_job_t*)realloc(*jobs, capacity * sizeof(batch_job_t));
+			if(new_jobs == NULL){
+				fprintf(stderr, "Error in read_manifest while allocating memory\n");
+				fflush(stderr);
+				free(*jobs);
+				fclose(manifest_file);
+				return -1;
+			}
+			*jobs = new_jobs;
+		}
+		
+		batch_job_t *job = &(*jobs)[num_jobs];
+		if(sscanf(start, "%255s %255s %15s", job->in_file_name, job->out_file_name, job->operation_name) != 3){
+			fprintf(stderr, "Error in read_manifest: Invalid line %d in %s\n", line_number, manifest_file_name);
+			fflush(stderr);
+			free(*jobs);
+			fclose(manifest_file);
+			return -1;
+		}
+		
+		job->operation = string_to_operation(job->operation_name);
+		if((int)job->operation == -1){
+			fprintf(stderr, "Error in read_manifest: Invalid operation %s on line %d in %s\n", job->operation_name, line_number, manifest_file_name);
+			fflush(stderr);
+			free(*jobs);
+			fclose(manifest_file);
+			return -1;
+		}
+		
+		job->pixels = image_pixels(job->in_file_name);
+		if(job->pixels == -1){ // error message was printed by the called function
+			free(*jobs);
+			fclose(manifest_file);
+			return -1;
+		}
+		
+		++num_jobs;
+	}
+	
+	fclose(manifest_file);
+	return num_jobs;
+}
+
+int compare_jobs_by_size(const void *a, const void *b){
+	/**
+	*	Takes in 2 batch_job_t and orders them from the largest image to the smallest.
+	*/
+	
+	long long pixels_a = ((const batch_job_t*)a)->pixels;
+	long long pixels_b = ((const batch_job_t*)b)->pixels;
+	return (pixels_a < pixels_b) - (pixels_a > pixels_b);
+}
+
+Image *edit_image(const batch_job_t *job, int version, int my_rank, int num_processes, MPI_Comm comm, int num_cores, int num_workstations){
+	/**
+	*	Takes in a job, the version to use (one of BATCH_VERSION_*), this process's rank, the total number of processes,
+	*	their communicator, the number of cores on a workstation and the number of workstations.
+	*	It edits the input of the job with the chosen version and returns what the version returns:
+	*	the whole edited Image on process 0 and a `dummy` Image on the others.
+	*/
+	
+	if(version == BATCH_VERSION_SFT){
+		return image_processing_parallel_sft(job->in_file_name, job->operation, my_rank, num_processes, comm, num_cores, NULL);
+	}
+	else if(version == BATCH_VERSION_NO_SFT){
+		return image_processing_parallel_no_sft(job->in_file_name, job->operation, my_rank, num_processes, comm, num_cores, num_workstations, NULL);
+	}
+	else{
+		return image_processing_master(job->in_file_name, job->operation, BATCH_CHUNK_SIZE, my_rank, num_processes, comm, num_cores, num_workstations, NULL);
+	}
+}
+
+int batch_group_size(batch_job_t *jobs, int num_jobs, int num_workers, int version){
+	/**
+	*	Takes in the jobs of a manifest, sorted from the largest image to the smallest, their number,
+	*	the number of processes available to edit images and the version used to edit them.
+	*	It returns the number of processes of a group: one per BATCH_PIXELS_PER_PROCESS pixels of the median image,
+	*	so that the images are not split in strips too thin to be edited efficiently,
+	*	at least 2 for the master/worker version without HYBRID_MASTER (a master and a worker) and at most num_workers.
+	*/
+	
+	long long median_pixels = (num_jobs > 0) ? jobs[num_jobs / 2].pixels : 0;
+	int group_size = (int)((median_pixels + BATCH_PIXELS_PER_PROCESS - 1) / BATCH_PIXELS_PER_PROCESS);
+	int min_group_size = (version == BATCH_VERSION_MASTER) ? 2 - HYBRID_MASTER : 1;
+	
+	return min(max(group_size, min_group_size), num_workers);
+}
+
+int schedule_batch(batch_job_t *jobs, int num_jobs, int num_groups){
+	/**
+	*	Takes in the jobs of a manifest, sorted from the largest image to the smallest, their number and the number of groups.
+	*	Run by process 0, it hands the next job to every group which asks for one until there are none left,
+	*	and then tells the groups to stop. It prints how long every job took and the number of images edited per second.
+	*	It returns 0 if every job succeeded and -1 otherwise.
+	*/
+	
+	double start_time = MPI_Wtime();
+	int next_job = 0;
+	int failed_jobs = 0;
+	int active_groups = num_groups;
+	MPI_Status status;
+	
+	while(active_groups > 0){
+		double report[3]; // last job of the group (-1 if none), 1 if it succeeded and 0 otherwise, time it took
+		int check = MPI_Recv(report, 3, MPI_DOUBLE, MPI_ANY_SOURCE, BATCH_REQUEST_TAG, MPI_COMM_WORLD, &status);
+		if(check != MPI_SUCCESS){
+			fprintf(stderr, "Rank 0: Error in schedule_batch while receiving a request\n");
+			fflush(stderr);
+			return -1;
+		}
+		
+		if(report[0] >= 0){
+			batch_job_t *job = &jobs[(int)report[0]];
+			if(report[1] == 1){
+				fprintf(stdout, "%s --> %s (%s): %f s by the group of process %d\n", job->in_file_name, job->out_file_name, job->operation_name, report[2], status.MPI_SOURCE);
+			}
+			else{
+				fprintf(stdout, "%s --> %s (%s): FAILED in the group of process %d\n", job->in_file_name, job->out_file_name, job->operation_name, status.MPI_SOURCE);
+				++failed_jobs;
+			}
+			fflush(stdout);
+		}
+		
+		int job = (next_job < num_jobs) ? next_job++ : -1;
+		if(job == -1) --active_groups;
+		
+		check = MPI_Send(&job, 1, MPI_INT, status.MPI_SOURCE, BATCH_JOB_TAG, MPI_COMM_WORLD);
+		if(check != MPI_SUCCESS){
+			fprintf(stderr, "Rank 0: Error in schedule_batch while sending a job\n");
+			fflush(stderr);
+			return -1;
+		}
+	}
+	
+	double batch_time = MPI_Wtime() - start_time;
+	fprintf(stdout, "\nBatch time: %f\n", batch_time);
+	fprintf(stdout, "Images edited: %d of %d\n", num_jobs - failed_jobs, num_jobs);
+	fprintf(stdout, "Images per second: %f\n\n", (num_jobs - failed_jobs) / batch_time);
+	fflush(stdout);
+	
+	return (failed_jobs == 0) ? 0 : -1;
+}
+
+int edit_batch_images(batch_job_t *jobs, MPI_Comm group_comm, int version, int num_threads){
+	/**
+	*	Takes in the jobs of a manifest, the communicator of this process's group, the version to use
+	*	and the number of threads available to each process.
+	*	Run by the processes of a group, it edits the images of the jobs process 0 hands to the group, one after the other,
+	*	with the chosen version on the communicator of the group. Process 0 of the group asks for the jobs,
+	*	reports how the previous one went and saves the edited images. It returns 0 on success and -1 on failure.
+	*/
+	
+	int check;
+	int group_rank, group_processes;
+	double report[3] = {-1, 0, 0};
+	MPI_Comm_rank(group_comm, &group_rank);
+	MPI_Comm_size(group_comm, &group_processes);
+	
+	int num_cores = num_threads * group_processes; // every version gives num_cores / group_processes threads to each process
+	
+	while(1){
+		int job;
+		
+		if(group_rank == 0){
+			check = MPI_Send(report, 3, MPI_DOUBLE, 0, BATCH_REQUEST_TAG, MPI_COMM_WORLD);
+			if(check == MPI_SUCCESS) check = MPI_Recv(&job, 1, MPI_INT, 0, BATCH_JOB_TAG, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+			if(check != MPI_SUCCESS){
+				fprintf(stderr, "Error in edit_batch_images while requesting a job\n");
+				fflush(stderr);
+				return -1;
+			}
+		}
+		
+		check = MPI_Bcast(&job, 1, MPI_INT, 0, group_comm);
+		if(check != MPI_SUCCESS){
+			fprintf(stderr, "Error in edit_batch_images while broadcasting a job\n");
+			fflush(stderr);
+			return -1;
+		}
+		
+		if(job == -1) break;
+		
+		double job_time = MPI_Wtime();
+		Image *edited_img = NULL;
+		
+		// an image which could not be edited is reported as failed, and the group takes the next job
+		int failed = 0;
+		if(group_rank == 0) failed = (check_batch_input(jobs[job].in_file_name) != 0); // error message was printed by the called function
+		check = MPI_Bcast(&failed, 1, MPI_INT, 0, group_comm);
+		if(check != MPI_SUCCESS){ // process 0 would wait for the report of the group for ever
+			fprintf(stderr, "Error in edit_batch_images while checking the image\n");
+			fflush(stderr);
+			MPI_Abort(MPI_COMM_WORLD, -1);
+		}
+		
+		if(!failed) edited_img = edit_image(&jobs[job], version, group_rank, group_processes, group_comm, num_cores, 1);
+		
+		failed = (edited_img == NULL); // error message was printed by the called function
+		check = MPI_Allreduce(MPI_IN_PLACE, &failed, 1, MPI_INT, MPI_MAX, group_comm);
+		if(check != MPI_SUCCESS){ // process 0 would wait for the report of the group for ever
+			fprintf(stderr, "Error in edit_batch_images while checking the edited image\n");
+			fflush(stderr);
+			MPI_Abort(MPI_COMM_WORLD, -1);
+		}
+		
+		if(group_rank == 0){
+			check = failed ? -1 : save_BMP(jobs[job].out_file_name, edited_img);
+			
+			report[0] = job;
+			report[1] = (check == 0) ? 1 : 0; // error message was printed by the called function
+			report[2] = MPI_Wtime() - job_time;
+			if(edited_img != NULL) free(edited_img->data);
+		}
+		free(edited_img);
+	}
+	
+	return 0;
+}
+
+int run_batch(const char *manifest_file_name, int version, int my_rank, int num_processes, int num_cores, int num_workstations){
+	/**
+	*	Takes in the file path of a manifest, the version to use (one of BATCH_VERSION_*), this process's rank,
+	*	the total number of processes, the number of cores on a workstation and the number of workstations.
+	*	Process 0 reads the manifest and splits the other processes into groups sized to the images of the manifest,
+	*	each with its own communicator. It then hands the images, largest first, to the groups: whenever a group
+	*	finishes an image, it asks for the next one, so groups that get smaller images edit more of them.
+	*	Every group edits its images with the chosen parallel version and its process 0 saves them.
+	*	It returns 0 on success and -1 on failure.
+	*/
+	
+	int check;
+	int num_jobs = 0;
+	int group_size;
+	batch_job_t *jobs = NULL;
+	int num_workers = num_processes - 1;
+	int min_workers = (version == BATCH_VERSION_MASTER) ? 2 - HYBRID_MASTER : 1;
+	
+	if(num_workers < min_workers){
+		if(my_rank == 0){
+			fprintf(stderr, "Error in run_batch: This version needs at least %d processes in batch mode\n", min_workers + 1);
+			fflush(stderr);
+		}
+		return -1;
+	}
+	
+	if(my_rank == 0){
+		num_jobs = read_manifest(manifest_file_name, &jobs);
+		if(num_jobs > 0){
+			qsort(jobs, num_jobs, sizeof(batch_job_t), compare_jobs_by_size);
+		}
+		group_size = batch_group_size(jobs, num_jobs, num_workers, version);
+	}
+	
+	check = MPI_Bcast(&num_jobs, 1, MPI_INT, 0, MPI_COMM_WORLD);
+	if(check == MPI_SUCCESS) check = MPI_Bcast(&group_size, 1, MPI_INT, 0, MPI_COMM_WORLD);
+	if(check != MPI_SUCCESS){
+		fprintf(stderr, "Rank %d: Error in run_batch while broadcasting the manifest\n", my_rank);
+		fflush(stderr);
+		free(jobs);
+		return -1;
+	}
+	
+	if(num_jobs == -1){ // error message was printed by the called function
+		return -1;
+	}
+	
+	if(my_rank != 0){
+		jobs = (batch_job_t*)malloc((num_jobs + 1) * sizeof(batch_job_t));
+		if(jobs == NULL){
+			fprintf(stderr, "Rank %d: Error in run_batch while allocating memory\n", my_rank);
+			fflush(stderr);
+			MPI_Abort(MPI_COMM_WORLD, -1);
+		}
+	}
+	
+	check = MPI_Bcast(jobs, num_jobs * sizeof(batch_job_t), MPI_BYTE, 0, MPI_COMM_WORLD);
+	if(check != MPI_SUCCESS){
+		fprintf(stderr, "Rank %d: Error in run_batch while broadcasting the manifest\n", my_rank);
+		fflush(stderr);
+		free(jobs);
+		return -1;
+	}
+	
+	// the processes left over join the last group
+	int num_groups = num_workers / group_size;
+	int group = (my_rank == 0) ? MPI_UNDEFINED : min((my_rank - 1) / group_size, num_groups - 1);
+	MPI_Comm group_comm;
+	
+	check = MPI_Comm_split(MPI_COMM_WORLD, group, my_rank, &group_comm);
+	if(check != MPI_SUCCESS){
+		fprintf(stderr, "Rank %d: Error in run_batch while creating the groups\n", my_rank);
+		fflush(stderr);
+		free(jobs);
+		return -1;
+	}
+	
+	if(my_rank == 0){
+		fprintf(stdout, "Batch of %d images edited by %d groups of %d processes\n\n", num_jobs, num_groups, group_size);
+		fflush(stdout);
+		check = schedule_batch(jobs, num_jobs, num_groups);
+	}
+	else{
+		int num_threads = max(1, num_cores * num_workstations / num_processes);
+		check = edit_batch_images(jobs, group_comm, version, num_threads);
+		MPI_Comm_free(&group_comm);
+	}
+	
+	free(jobs);
+	return check;
+}
\ No newline at end of file
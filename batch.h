@@ -0,0 +1,29 @@
+#ifndef BATCH
+
+#define BATCH
+
+#include "bmp_common.h"
+#include "convolution.h"
+
+#define BATCH_PATH_SIZE 256
+#define BATCH_PIXELS_PER_PROCESS (1024 * 1024) // a group gets one process per BATCH_PIXELS_PER_PROCESS pixels of the median image of the manifest
+
+#define BATCH_VERSION_SFT 0
+#define BATCH_VERSION_NO_SFT 1
+#define BATCH_VERSION_MASTER 2
+
+typedef struct{
+	char in_file_name[BATCH_PATH_SIZE];
+	char out_file_name[BATCH_PATH_SIZE];
+	char operation_name[16];
+	operation_t operation;
+	long long pixels; // width * height of the input, used to size the groups and to schedule the largest images first
+}batch_job_t; // an entry of a batch manifest
+
+long long image_pixels(const char *file_name);
+int read_manifest(const char *manifest_file_name, batch_job_t **jobs);
+Image *edit_image(const batch_job_t *job, int version, int my_rank, int num_processes, MPI_Comm comm, int num_cores, int num_workstations);
+int batch_group_size(batch_job_t *jobs, int num_jobs, int num_workers, int version);
+int run_batch(const char *manifest_file_name, int version, int my_rank, int num_processes, int num_cores, int num_workstations);
+
+#endif
\ No newline at end of file
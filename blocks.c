@@ -0,0 +1,348 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "blocks.h"
+#include "bmp.h"
+#include "convolution.h"
+#include "tiled.h"
+#include "verification.h"
+#include "incremental.h"
+
+#define BLOCK_DATA_TAG 8
+
+void choose_process_grid(int height, int width, int num_processes, int *dims){
+	/**
+	*	Takes in the height and width of an Image, the total number of processes and a place to store the shape of the process grid
+	*	(dims[0] rows of blocks and dims[1] columns of blocks).
+	*	The halos of a dims[0] x dims[1] grid cover about 2 * halo_dim * (dims[0] * width + dims[1] * height) pixels,
+	*	so it picks the grid which minimizes dims[0] * width + dims[1] * height, given the aspect ratio of the Image.
+	*	Strips (dims[1] = 1) win ties.
+	*/
+	
+	dims[0] = num_processes;
+	dims[1] = 1;
+	long long best_cost = (long long)num_processes * width + height;
+	
+	for(int columns = 2; columns <= num_processes; ++columns){
+		int rows = num_processes / columns;
+		if(num_processes % columns != 0 || columns > width || rows > height) continue;
+		
+		long long cost = (long long)rows * width + (long long)columns * height;
+		if(cost < best_cost){
+			best_cost = cost;
+			dims[0] = rows;
+			dims[1] = columns;
+		}
+	}
+}
+
+int choose_block_grid(const char *in_file_name, const Image *img, int shared_file_tree, int my_rank, int num_processes, MPI_Comm comm, int *image_info, int *dims){
+	/**
+	*	Takes in a file path to the file to edit, the Image read from it on process 0 (used without a SFT), 1 if the system has a SFT
+	*	and 0 otherwise, this process's rank, the total number of processes, their communicator, a place to store the height, width,
+	*	channels and top_down of the Image and a place to store the shape of the process grid.
+	*	With a SFT, every process reads the header of the file; without one, process 0 broadcasts the size of img.
+	*	It returns 0 on success and -1 on failure.
+	*/
+	
+	if(shared_file_tree){
+		int check = read_image_header(in_file_name, &image_info[0], &image_info[1], &image_info[2], &image_info[3]);
+		if(check != 0){ // error message was printed by the called function
+			return -1;
+		}
+	}
+	else{
+		if(my_rank == 0){
+			image_info[0] = img->height;
+			image_info[1] = img->width;
+			image_info[2] = img->channels;
+			image_info[3] = img->top_down;
+		}
+		
+		int check = MPI_Bcast(image_info, 4, MPI_INT, 0, comm);
+		if(check != MPI_SUCCESS){
+			fprintf(stderr, "Rank %d: Error in choose_block_grid while broadcasting the size of the Image\n", my_rank);
+			fflush(stderr);
+			return -1;
+		}
+	}
+	
+	choose_process_grid(image_info[0], image_info[1], num_processes, dims);
+	return 0;
+}
+
+void block_extent(int size, int parts, int index, int *start, int *count){
+	/**
+	*	Takes in the number of rows (or columns) of an Image, the number of blocks it is cut into along them, the index of a block
+	*	and places to store the first row (or column) of the block and their number. The blocks differ by at most one row (or column).
+	*/
+	
+	*start = (int)((long long)index * size / parts);
+	*count = (int)((long long)(index + 1) * size / parts) - *start;
+}
+
+int read_block_window(const char *in_file_name, MPI_Comm comm, int my_rank, const int *image_info, region_t window, unsigned char *data){
+	/**
+	*	Takes in a file path to the file to edit, the communicator of the process grid, this process's rank, the height, width, channels
+	*	and top_down of the Image, the window (block and halos) of this process and a buffer for it.
+	*	A tiled image is read with read_tiled_rect. A .bmp file is read collectively with MPI-IO, through a subarray file view
+	*	which selects the rows and columns of the window, so every process reads only its window.
+	*	It returns 0 on success and -1 on failure.
+	*/
+	
+	int check;
+	int channels = image_info[2];
+	
+	if(is_tiled_file(in_file_name)){
+		tiled_image_t *tiled = open_tiled(in_file_name);
+		if(tiled == NULL){ // error message was printed by the called function
+			return -1;
+		}
+		
+		check = read_tiled_rect(tiled, window.x, window.y, window.width, window.height, data);
+		close_tiled(tiled);
+		return check;
+	}
+	
+	int height, width, top_down, data_start, padding;
+	FILE *image_file = open_BMP(in_file_name, &height, &width, &channels, &top_down, &data_start, &padding);
+	if(image_file == NULL){ // error message was printed by the called function
+		return -1;
+	}
+	fclose(image_file);
+	
+	MPI_File image_file_handler;
+	check = MPI_File_open(comm, in_file_name, MPI_MODE_RDONLY, MPI_INFO_NULL, &image_file_handler);
+	if(check != MPI_SUCCESS){
+		fprintf(stderr, "Rank %d: Error in read_block_window while opening file %s\n", my_rank, in_file_name);
+		fflush(stderr);
+		return -1;
+	}
+	
+	// the collective read of a truncated file would be short, or would never complete with some MPI-IO implementations
+	MPI_Offset file_size;
+	check = MPI_File_get_size(image_file_handler, &file_size);
+	if(check != MPI_SUCCESS || file_size < data_start + (MPI_Offset)height * (width * channels + padding)){
+		fprintf(stderr, "Rank %d: Error in read_block_window, file %s is shorter than its header says\n", my_rank, in_file_name);
+		fflush(stderr);
+		MPI_File_close(&image_file_handler);
+		return -1;
+	}
+	
+	int sizes[2] = {height, width * channels + padding};
+	int subsizes[2] = {window.height, window.width * channels};
+	int starts[2] = {window.y, window.x * channels};
+	MPI_Datatype file_window;
+	MPI_Status status;
+	
+	check = MPI_Type_create_subarray(2, sizes, subsizes, starts, MPI_ORDER_C, MPI_UNSIGNED_CHAR, &file_window);
+	if(check == MPI_SUCCESS) check = MPI_Type_commit(&file_window);
+	if(check == MPI_SUCCESS) check = MPI_File_set_view(image_file_handler, data_start, MPI_UNSIGNED_CHAR, file_window, "native", MPI_INFO_NULL);
+	if(check == MPI_SUCCESS) check = MPI_File_read_all(image_file_handler, data, window.height * window.width * channels, MPI_UNSIGNED_CHAR, &status);
+	if(check == MPI_SUCCESS){ // the file may have been truncated since its size was checked
+		int read_bytes;
+		MPI_Get_count(&status, MPI_UNSIGNED_CHAR, &read_bytes);
+		if(read_bytes != window.height * window.width * channels) check = -1;
+	}
+	if(check != MPI_SUCCESS){
+		fprintf(stderr, "Rank %d: Error in read_block_window while reading from file %s\n", my_rank, in_file_name);
+		fflush(stderr);
+		MPI_File_close(&image_file_handler);
+		return -1;
+	}
+	
+	MPI_Type_free(&file_window);
+	check = MPI_File_close(&image_file_handler);
+	if(check != MPI_SUCCESS){
+		fprintf(stderr, "Rank %d: Error in read_block_window while closing file %s\n", my_rank, in_file_name);
+		fflush(stderr);
+		return -1;
+	}
+	
+	return 0;
+}
+
+region_t block_window(MPI_Comm grid, int rank, const int *dims, const int *image_info, int halo_dim, region_t *block){
+	/**
+	*	Takes in the communicator of the process grid, the rank of a process, the shape of the grid, the height, width, channels
+	*	and top_down of the Image, the size of the halo and a place to store the block of the process.
+	*	It returns the window of the process: its block and the halo_dim rows and columns around it which are inside the Image.
+	*/
+	
+	int coords[2];
+	MPI_Cart_coords(grid, rank, 2, coords);
+	block_extent(image_info[0], dims[0], coords[0], &block->y, &block->height);
+	block_extent(image_info[1], dims[1], coords[1], &block->x, &block->width);
+	
+	region_t window;
+	window.y = max(block->y - halo_dim, 0);
+	window.x = max(block->x - halo_dim, 0);
+	window.height = min(block->y + block->height + halo_dim, image_info[0]) - window.y;
+	window.width = min(block->x + block->width + halo_dim, image_info[1]) - window.x;
+	return window;
+}
+
+int scatter_block_windows(const Image *img, MPI_Comm grid, int my_rank, int num_processes, const int *dims, const int *image_info, int halo_dim, unsigned char *data){
+	/**
+	*	Takes in the Image read by process 0, the communicator of the process grid, this process's rank, the total number of processes,
+	*	the shape of the grid, the height, width, channels and top_down of the Image, the size of the halo and a buffer for the window of this process.
+	*	Process 0 sends every process its window (block and halos) straight from img with a subarray datatype,
+	*	and the other processes receive it in data.
+	*	It returns 0 on success and -1 on failure.
+	*/
+	
+	int check;
+	int channels = image_info[2];
+	region_t block;
+	
+	if(my_rank != 0){
+		region_t window = block_window(grid, my_rank, dims, image_info, halo_dim, &block);
+		check = MPI_Recv(data, window.height * window.width * channels, MPI_UNSIGNED_CHAR, 0, BLOCK_DATA_TAG, grid, MPI_STATUS_IGNORE);
+		if(check != MPI_SUCCESS){
+			fprintf(stderr, "Rank %d: Error in scatter_block_windows while receiving the window\n", my_rank);
+			fflush(stderr);
+			return -1;
+		}
+		return 0;
+	}
+	
+	MPI_Request *requests = (MPI_Request*)malloc(num_processes * sizeof(MPI_Request));
+	if(requests == NULL){
+		fprintf(stderr, "Rank 0: Error in scatter_block_windows while allocating memory\n");
+		fflush(stderr);
+		return -1;
+	}
+	
+	requests[0] = MPI_REQUEST_NULL;
+	for(int i = 1; i < num_processes; ++i){
+		region_t window = block_window(grid, i, dims, image_info, halo_dim, &block);
+		int sizes[2] = {image_info[0], image_info[1] * channels};
+		int subsizes[2] = {window.height, window.width * channels};
+		int starts[2] = {window.y, window.x * channels};
+		MPI_Datatype mpi_window;
+		
+		check = MPI_Type_create_subarray(2, sizes, subsizes, starts, MPI_ORDER_C, MPI_UNSIGNED_CHAR, &mpi_window);
+		if(check == MPI_SUCCESS) check = MPI_Type_commit(&mpi_window);
+		if(check == MPI_SUCCESS) check = MPI_Isend(img->data, 1, mpi_window, i, BLOCK_DATA_TAG, grid, &requests[i]);
+		if(check == MPI_SUCCESS) check = MPI_Type_free(&mpi_window);
+		if(check != MPI_SUCCESS){
+			fprintf(stderr, "Rank 0: Error in scatter_block_windows while sending a window\n");
+			fflush(stderr);
+			free(requests);
+			return -1;
+		}
+	}
+	
+	// process 0 copies its own window while the others are being sent
+	region_t window = block_window(grid, 0, dims, image_info, halo_dim, &block);
+	size_t window_row_size = (size_t)window.width * channels;
+	for(int row = 0; row < window.height; ++row){
+		memcpy(data + row * window_row_size, img->data + ((size_t)(window.y + row) * image_info[1] + window.x) * channels, window_row_size);
+	}
+	
+	check = MPI_Waitall(num_processes, requests, MPI_STATUSES_IGNORE);
+	free(requests);
+	if(check != MPI_SUCCESS){
+		fprintf(stderr, "Rank 0: Error in scatter_block_windows while sending the windows\n");
+		fflush(stderr);
+		return -1;
+	}
+	
+	return 0;
+}
+
+Image *image_processing_blocks(const char *in_file_name, const Image *img, operation_t operation, int shared_file_tree, const int *image_info, const int *dims, int my_rank, int num_processes, MPI_Comm comm, int num_threads, unsigned long long *hash){
+	/**
+	*	Takes in a file path to the file to edit, the Image read from it on process 0 (used without a SFT), an operation_t,
+	*	1 if the system has a SFT and 0 otherwise, the height, width, channels and top_down of the Image, the shape of the process grid
+	*	chosen by choose_block_grid, this process's rank, the total number of processes, their communicator, the number of threads
+	*	of a process and a place to store the hash of the edited Image on process 0 (NULL if it is not needed).
+	*	The processes form a dims[0] x dims[1] grid with MPI_Cart_create and each one edits a block of the Image, which it gets
+	*	with halo_dim rows and columns of halo around it: with a SFT, it reads them itself, and without one, process 0 sends them.
+	*	The edited blocks are composed on process 0 with compose_BMP_blocks.
+	*	If rank == 0, it returns the whole edited Image, and if rank != 0, it returns a `dummy` Image.
+	*/
+	
+	int check;
+	int halo_dim = get_kernel_size(operation) / 2;
+	int periods[2] = {0, 0};
+	MPI_Comm grid;
+	
+	// without reordering, rank i of comm is rank i of the grid, so process 0 stays the one composing the Image
+	check = MPI_Cart_create(comm, 2, (int*)dims, periods, 0, &grid);
+	if(check != MPI_SUCCESS){
+		fprintf(stderr, "Rank %d: Error in image_processing_blocks while creating the process grid\n", my_rank);
+		fflush(stderr);
+		return NULL;
+	}
+	
+	region_t block;
+	region_t window = block_window(grid, my_rank, dims, image_info, halo_dim, &block);
+	int channels = image_info[2];
+	
+	Image window_img = {window.width, window.height, channels, image_info[3], NULL};
+	window_img.data = (unsigned char*)malloc((size_t)window.height * window.width * channels);
+	Image *block_img = (Image*)malloc(sizeof(Image));
+	unsigned char *block_data = (unsigned char*)malloc((size_t)block.height * block.width * channels);
+	if(window_img.data == NULL || block_img == NULL || block_data == NULL){
+		fprintf(stderr, "Rank %d: Error in image_processing_blocks while allocating memory\n", my_rank);
+		fflush(stderr);
+		free(window_img.data);
+		free(block_img);
+		free(block_data);
+		MPI_Comm_free(&grid);
+		return NULL;
+	}
+	
+	if(shared_file_tree) check = read_block_window(in_file_name, grid, my_rank, image_info, window, window_img.data);
+	else check = scatter_block_windows(img, grid, my_rank, num_processes, dims, image_info, halo_dim, window_img.data);
+	if(check != 0){ // error message was printed by the called function
+		free(window_img.data);
+		free(block_img);
+		free(block_data);
+		MPI_Comm_free(&grid);
+		return NULL;
+	}
+	
+	int true_start = block.y - window.y;
+	Image *edited_img = perform_convolution_parallel(&window_img, operation, true_start, true_start + block.height - 1, num_threads);
+	free(window_img.data);
+	if(edited_img == NULL){ // error message was printed by the called function
+		free(block_img);
+		free(block_data);
+		MPI_Comm_free(&grid);
+		return NULL;
+	}
+	
+	// the edited rows still hold the columns of the halos
+	block_img->height = block.height;
+	block_img->width = block.width;
+	block_img->channels = channels;
+	block_img->top_down = image_info[3];
+	block_img->data = block_data;
+	region_t whole_block = {0, 0, block.width, block.height};
+	patch_region(block_img, edited_img, whole_block, block.x - window.x);
+	free(edited_img->data);
+	free(edited_img);
+	
+	Image *composed_img = compose_BMP_blocks(block_img, block.y, block.x, image_info[0], image_info[1], my_rank, num_processes, grid);
+	MPI_Comm_free(&grid);
+	if(composed_img == NULL){ // error message was printed by the called function
+		free(block_img->data);
+		free(block_img);
+		return NULL;
+	}
+	
+	free(block_img->data);
+	if(my_rank != 0){ // compose_BMP_blocks returned block_img, which becomes a `dummy` Image
+		block_img->data = NULL;
+		return block_img;
+	}
+	free(block_img);
+	
+	if(hash != NULL){
+		*hash = hash_image(composed_img, num_threads);
+	}
+	
+	return composed_img;
+}
\ No newline at end of file
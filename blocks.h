@@ -0,0 +1,12 @@
+#ifndef BLOCKS
+
+#define BLOCKS
+
+#include "bmp_common.h"
+#include "convolution.h"
+
+int choose_block_grid(const char *in_file_name, const Image *img, int shared_file_tree, int my_rank, int num_processes, MPI_Comm comm, int *image_info, int *dims);
+void block_extent(int size, int parts, int index, int *start, int *count);
+Image *image_processing_blocks(const char *in_file_name, const Image *img, operation_t operation, int shared_file_tree, const int *image_info, const int *dims, int my_rank, int num_processes, MPI_Comm comm, int num_threads, unsigned long long *hash);
+
+#endif
\ No newline at end of file
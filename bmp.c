@@ -1,14 +1,145 @@
+#define _GNU_SOURCE // for O_DIRECT
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <omp.h>
 #include "bmp.h"
 #include "bmp_common.h"
+#include "compression.h"
+
+#if SAVE_BLOCKS_SUPPORTED
+#include <fcntl.h>
+#include <unistd.h>
+#ifndef O_DIRECT
+#define O_DIRECT 0 // not available on this system, the blocks go through the page cache
+#endif
+#endif
+
+int parse_BMP_header(const unsigned char *header, int header_size, int *height, int *width, int *channels, int *top_down, int *data_start, int *padding, int print_errors){
+	/**
+	*	Takes in the first header_size bytes of a .bmp file (the headers and, for 8-bit images, the palette)
+	*	and sets height, width, channels, top_down, data_start and padding according to them.
+	*	Supported images are 8-bit grayscale (palette holding the gray levels in order), 24-bit and 32-bit,
+	*	stored either bottom-up or top-down (negative height), without compression.
+	*	It returns 0 if the image is supported and -1 otherwise, printing the reason if print_errors != 0.
+	*/
+	
+	if (header_size < 54){
+		if(print_errors){
+			fprintf(stderr, "Error in parse_BMP_header: Invalid BMP header\n");
+			fflush(stderr);
+		}
+		return -1;
+	}
+	
+	if (header[0] != 'B' || header[1] != 'M'){
+		if(print_errors){
+			fprintf(stderr, "Error in parse_BMP_header: Not a valid BMP file\n");
+			fflush(stderr);
+		}
+		return -1;
+	}
+	
+	int bits_per_pixel = *(short *)&header[28];
+	int compression = *(int *)&header[30];
+	
+	if (bits_per_pixel != 8 && bits_per_pixel != 24 && bits_per_pixel != 32){
+		if(print_errors){
+			fprintf(stderr, "Error in parse_BMP_header: Only 8-bit, 24-bit and 32-bit BMPs are supported\n");
+			fflush(stderr);
+		}
+		return -1;
+	}
+	
+	// 32-bit images may declare their (standard BGRA) layout through bit fields
+	if (compression != 0 && !(compression == 3 && bits_per_pixel == 32)){
+		if(print_errors){
+			fprintf(stderr, "Error in parse_BMP_header: Compressed BMPs are not supported\n");
+			fflush(stderr);
+		}
+		return -1;
+	}
+	
+	*width = *(int *)&header[18];
+	*height = *(int *)&header[22];
+	*data_start = *(int *)&header[10];
+	*channels = bits_per_pixel / 8;
+	*top_down = (*height < 0) ? 1 : 0;
+	if (*top_down) *height = -*height;
+	
+	if (*channels == 1){
+		// the palette has to map every index to the gray level with the same value
+		int palette_start = 14 + *(int *)&header[14];
+		int num_colors = *(int *)&header[46];
+		if (num_colors == 0) num_colors = 256;
+		
+		if (palette_start + num_colors * 4 > header_size){
+			if(print_errors){
+				fprintf(stderr, "Error in parse_BMP_header: Invalid BMP palette\n");
+				fflush(stderr);
+			}
+			return -1;
+		}
+		
+		for (int i = 0; i < num_colors; ++i){
+			const unsigned char *color = header + palette_start + i * 4;
+			if (color[0] != i || color[1] != i || color[2] != i){
+				if(print_errors){
+					fprintf(stderr, "Error in parse_BMP_header: Only grayscale 8-bit BMPs are supported\n");
+					fflush(stderr);
+				}
+				return -1;
+			}
+		}
+	}
+	
+	int row_padded = (*width * *channels + 3) & (~3);
+	*padding = row_padded - *width * *channels;
+	
+	return 0;
+}
+
+void remove_BMP_padding(unsigned char *data, int rows, int row_size, int padding){
+	/**
+	*	Takes in a buffer holding rows consecutive rows as they are stored in a .bmp file (each row followed by padding bytes),
+	*	the size of a row without padding and the size of the padding.
+	*	It moves the rows in place so that they become contiguous, which is the layout of an Image.
+	*	Rows are only moved as a whole, so no work is done per pixel.
+	*/
+	
+	if(padding == 0) return;
+	
+	for(int y = 1; y < rows; ++y){
+		memmove(data + (size_t)y * row_size, data + (size_t)y * (row_size + padding), row_size);
+	}
+}
+
+int read_BMP_rows(FILE *image_file, unsigned char *data, int rows, int row_size, int padding){
+	/**
+	*	Takes in a FILE* coresponding to an open .bmp file, a pixel buffer, the number of rows to read,
+	*	the size of a row without padding and the size of the padding.
+	*	It reads the next rows consecutive rows starting at the current position of the file with a single read
+	*	and stores them in data in file order. data needs room for rows padded rows.
+	*/
+	
+	size_t size = (size_t)rows * (row_size + padding);
+	
+	if(fread(data, sizeof(unsigned char), size, image_file) != size){
+		fprintf(stderr, "Error in read_BMP_rows while reading from file\n");
+		fflush(stderr);
+		return -1;
+	}
+	
+	remove_BMP_padding(data, rows, row_size, padding);
+	return 0;
+}
 
 Image *read_BMP_serial(const char *filename){
 	/**
 	*	Takes in a file path and returns the bitmap inside as an Image.
+	*	The rows and channels of the Image keep the order they have in the file.
 	*/
-	
+
     FILE *image_file = fopen(filename, "rb");
     if (image_file == NULL){
         fprintf(stderr, "Error in readBMP_serial: Could not open file %s\n", filename);
@@ -16,80 +147,48 @@ Image *read_BMP_serial(const char *filename){
         return NULL;
     }
 
-    unsigned char header[54];
-    if (fread(header, sizeof(unsigned char), 54, image_file) != 54){
-        fprintf(stderr, "Error in readBMP_serial: Invalid BMP header\n");
-		fflush(stderr);
-        fclose(image_file);
-        return NULL;
-    }
-
-    if (header[0] != 'B' || header[1] != 'M'){
-        fprintf(stderr, "Error in readBMP_serial: Not a valid BMP file\n");
-		fflush(stderr);
+    unsigned char header[BMP_MAX_HEADER_SIZE];
+	int header_size = fread(header, sizeof(unsigned char), BMP_MAX_HEADER_SIZE, image_file);
+	
+	int width, height, channels, top_down, data_offset, padding_size;
+    int check = parse_BMP_header(header, header_size, &height, &width, &channels, &top_down, &data_offset, &padding_size, 1);
+	if (check != 0){ // error message was printed by the called function
         fclose(image_file);
         return NULL;
     }
-
-    int width = *(int *)&header[18];
-    int height = *(int *)&header[22];
-    int bits_per_pixel = *(short *)&header[28];
-
-	int data_offset = *(int *)&header[10];
+	
 	fseek(image_file, data_offset, SEEK_SET);
-
-    if (bits_per_pixel != 24){
-        fprintf(stderr, "Error in readBMP_serial: Only 24-bit BMPs are supported\n");
-		fflush(stderr);
-        fclose(image_file);
-        return NULL;
-    }
-
-    int row_padded = (width * 3 + 3) & (~3);
-	int pixel_data_size = width * 3;
-	int padding_size = row_padded - pixel_data_size;
 	
-    unsigned char *row_pixels = (unsigned char*)malloc(pixel_data_size);
-	if(row_pixels == NULL){
-		fprintf(stderr, "Error in readBMP_serial while allocating memory\n");
-		fflush(stderr);
-        fclose(image_file);
-        return NULL;
-	}
+	int pixel_data_size = width * channels;
 	
-    RGB *data = (RGB*)malloc(width * height * sizeof(RGB));
+	// room for the padding as well, since the rows are read with it and compacted afterwards
+    unsigned char *data = (unsigned char*)malloc((size_t)(pixel_data_size + padding_size) * height);
     if(data == NULL){
 		fprintf(stderr, "Error in readBMP_serial while allocating memory\n");
 		fflush(stderr);
         fclose(image_file);
         return NULL;
 	}
-
-    for (int y = 0; y < height; ++y){
-        fread(row_pixels, sizeof(unsigned char), pixel_data_size, image_file);
-        for (int x = 0; x < width; ++x){
-            data[(height - 1 - y) * width + x].b = row_pixels[x * 3];
-            data[(height - 1 - y) * width + x].g = row_pixels[x * 3 + 1];
-            data[(height - 1 - y) * width + x].r = row_pixels[x * 3 + 2];
-        }
-		if (padding_size > 0){
-			fseek(image_file, padding_size, SEEK_CUR);
-		}
-    }
-
-    free(row_pixels);
-    fclose(image_file);
+	
+	check = read_BMP_rows(image_file, data, height, pixel_data_size, padding_size);
+	fclose(image_file);
+	if (check != 0){ // error message was printed by the called function
+		free(data);
+		return NULL;
+	}
 
     Image *img = (Image *)malloc(sizeof(Image));
 	if(img == NULL){
 		fprintf(stderr, "Error in readBMP_serial while allocating memory\n");
 		fflush(stderr);
-        fclose(image_file);
+		free(data);
         return NULL;
 	}
-	
+
     img->width = width;
     img->height = height;
+	img->channels = channels;
+	img->top_down = top_down;
     img->data = data;
     return img;
 }
@@ -100,6 +199,7 @@ Image *read_BMP_MPI(const char *file_name, int my_rank, int num_processes, int h
 	*	the size of the halo (depending on the size of the kernel).
 	*	It returns the chunk of the bmp coresponding to each process and sets true_start and true_end
 	*	to mark the positions at which the chunk (not including the halos) starts and ends.
+	*	Chunks are assigned in file order (rank 0 gets the first rows of the file) and read with a single read.
 	*/
 	
 	int check;
@@ -112,81 +212,48 @@ Image *read_BMP_MPI(const char *file_name, int my_rank, int num_processes, int h
 		return NULL;
 	}
 	
-	unsigned char header[54];
+	unsigned char header[BMP_MAX_HEADER_SIZE];
+	MPI_Status status;
+	int header_size;
 	
-	check = MPI_File_read_at_all(image_file_handler, 0, header, 54, MPI_UNSIGNED_CHAR, MPI_STATUS_IGNORE);
+	check = MPI_File_read_at_all(image_file_handler, 0, header, BMP_MAX_HEADER_SIZE, MPI_UNSIGNED_CHAR, &status);
 	if(check != MPI_SUCCESS){
 		fprintf(stderr, "Rank %d: Error in readBMP_MPI while reading from file file %s\n", my_rank, file_name);
 		fflush(stderr);
 		return NULL;
 	}
+	MPI_Get_count(&status, MPI_UNSIGNED_CHAR, &header_size);
 	
-	if (header[0] != 'B' || header[1] != 'M'){
-		if(my_rank == 0){
-			fprintf(stderr, "Rank %d: Error in readBMP_MPI: Not a valid BMP file\n", my_rank);
-			fflush(stderr);
-		}
-		return NULL;
-	}
-	
-	int bitsPerPixel = *(short *)&header[28];
-	if (bitsPerPixel != 24){
-		if(my_rank == 0){
-			fprintf(stderr, "Rank %d: Error in readBMP_MPI: Only 24-bit BMPs are supported\n", my_rank);
-			fflush(stderr);
-		}
-		return NULL;
-	}
-	
-	int width = *(int *)&header[18];
-	int height = *(int *)&header[22];
-	int data_offset = *(int *)&header[10];
-	
-	int row_padded = (width * 3 + 3) & (~3);
-	int pixel_data_size = width * 3;
-	int padding_size = row_padded - pixel_data_size;
-	
-	unsigned char *row_pixels = (unsigned char*)malloc(pixel_data_size);
-	if(row_pixels == NULL){
-		fprintf(stderr, "Rank %d: Error in readBMP_MPI while allocating memory\n", my_rank);
-		fflush(stderr);
-		
-		check = MPI_File_close(&image_file_handler);
-		if(check != MPI_SUCCESS){
-			fprintf(stderr, "Rank %d: Error in readBMP_MPI while closing file %s\n", my_rank, file_name);
-			fflush(stderr);
-			return NULL;
-		}
-		
+	int width, height, channels, top_down, data_offset, padding_size;
+	check = parse_BMP_header(header, header_size, &height, &width, &channels, &top_down, &data_offset, &padding_size, my_rank == 0);
+	if(check != 0){ // error message was printed by the called function
+		MPI_File_close(&image_file_handler);
 		return NULL;
 	}
 	
-	int virtual_rank = num_processes - my_rank - 1;
+	int pixel_data_size = width * channels;
 	int local_rows;
 	int true_rows = height / num_processes;
 	int remainder = height % num_processes;
 	
-	int rows_read_until_now = true_rows * virtual_rank + ((virtual_rank < remainder) ? virtual_rank : remainder);
-	MPI_Offset local_offset = data_offset + rows_read_until_now * (pixel_data_size + padding_size);
+	int rows_read_until_now = true_rows * my_rank + ((my_rank < remainder) ? my_rank : remainder);
+	MPI_Offset local_offset = data_offset + (MPI_Offset)rows_read_until_now * (pixel_data_size + padding_size);
 	
-	if(virtual_rank != 0) local_offset -= halo_dim * (pixel_data_size + padding_size); // reading the halos as well
-	if(virtual_rank < remainder) ++true_rows; // distributing remainder uniformly
+	if(my_rank != 0) local_offset -= halo_dim * (pixel_data_size + padding_size); // reading the halos as well
+	if(my_rank < remainder) ++true_rows; // distributing remainder uniformly
 	
 	// adding halo rows
-	if(virtual_rank == 0 || virtual_rank == num_processes - 1) local_rows = true_rows + halo_dim;
-	else local_rows = true_rows + 2 * halo_dim;
-
-	if(virtual_rank > 0) *true_end = local_rows - halo_dim - 1; // end is refering to the bottom of the matrix since the bottom has the highest index
-	else *true_end = local_rows - 1;
+	int halo_before = (my_rank > 0) ? halo_dim : 0;
+	int halo_after = (my_rank < num_processes - 1) ? halo_dim : 0;
+	local_rows = true_rows + halo_before + halo_after;
 	
-	if(virtual_rank < num_processes - 1) *true_start = halo_dim; // start is refering to the top of the matrix since the top has the lowest index
-	else *true_start = 0;
+	*true_start = halo_before;
+	*true_end = local_rows - halo_after - 1;
 	
-	RGB *data = (RGB *)malloc(width * local_rows * sizeof(RGB));
+	unsigned char *data = (unsigned char *)malloc((size_t)(pixel_data_size + padding_size) * local_rows);
 	if(data == NULL){
 		fprintf(stderr, "Rank %d: Error in readBMP_MPI while allocating memory\n", my_rank);
 		fflush(stderr);
-		free(row_pixels);
 		
 		check = MPI_File_close(&image_file_handler);
 		if(check != MPI_SUCCESS){
@@ -198,34 +265,24 @@ Image *read_BMP_MPI(const char *file_name, int my_rank, int num_processes, int h
 		return NULL;
 	}
 	
-	for (int y = 0; y < local_rows; y++){
-		check = MPI_File_read_at(image_file_handler, local_offset, row_pixels, pixel_data_size, MPI_UNSIGNED_CHAR, MPI_STATUS_IGNORE);
+	check = MPI_File_read_at(image_file_handler, local_offset, data, (pixel_data_size + padding_size) * local_rows, MPI_UNSIGNED_CHAR, MPI_STATUS_IGNORE);
+	if(check != MPI_SUCCESS){
+		fprintf(stderr, "Rank %d: Error in readBMP_MPI while reading from file file %s\n", my_rank, file_name);
+		fflush(stderr);
+		free(data);
+		
+		check = MPI_File_close(&image_file_handler);
 		if(check != MPI_SUCCESS){
-			fprintf(stderr, "Rank %d: Error in readBMP_MPI while reading from file file %s\n", my_rank, file_name);
+			fprintf(stderr, "Rank %d: Error in readBMP_MPI while closing file %s\n", my_rank, file_name);
 			fflush(stderr);
-			free(row_pixels);
-			free(data);
-		
-			check = MPI_File_close(&image_file_handler);
-			if(check != MPI_SUCCESS){
-				fprintf(stderr, "Rank %d: Error in readBMP_MPI while closing file %s\n", my_rank, file_name);
-				fflush(stderr);
-				return NULL;
-			}
-			
 			return NULL;
 		}
 		
-		local_offset += pixel_data_size + padding_size;
-		
-		for (int x = 0; x < width; x++){
-			data[(local_rows - 1 - y) * width + x].b = row_pixels[x * 3];
-			data[(local_rows - 1 - y) * width + x].g = row_pixels[x * 3 + 1];
-			data[(local_rows - 1 - y) * width + x].r = row_pixels[x * 3 + 2];
-		}
+		return NULL;
 	}
 	
-	free(row_pixels);
+	remove_BMP_padding(data, local_rows, pixel_data_size, padding_size);
+	
 	check = MPI_File_close(&image_file_handler);
 	if(check != MPI_SUCCESS){
 		fprintf(stderr, "Rank %d: Error in readBMP_MPI while closing file %s\n", my_rank, file_name);
@@ -243,25 +300,28 @@ Image *read_BMP_MPI(const char *file_name, int my_rank, int num_processes, int h
 	
 	img->width = width;
 	img->height = local_rows;
+	img->channels = channels;
+	img->top_down = top_down;
 	img->data = data;
 	return img;
 }
 
-Image *compose_BMP(Image *img, int my_rank, int num_processes){
+Image *compose_BMP(Image *img, int my_rank, int num_processes, MPI_Comm comm){
 	/**
-	*	Takes in each process's Image and rank, as well as the total number of processes
+	*	Takes in each process's Image and rank, as well as the total number of processes and their communicator
 	*	and, for rank 0, returns the Image resulted from concatenating the Images of
 	*	each process, and, for ranks != 0, returns the process's original Image.
 	*/
 	
 	int check;
 	int width = img->width;
+	int channels = img->channels;
 	int total_height = 0;
 	int *heights = NULL;
 	int *receives = NULL;
 	int *displacements = NULL;
 	Image *new_img = NULL;
-	RGB *data = NULL;
+	unsigned char *data = NULL;
 	
 	if(my_rank == 0){
 		heights = (int*)malloc(num_processes * sizeof(int));
@@ -272,7 +332,7 @@ Image *compose_BMP(Image *img, int my_rank, int num_processes){
 		}
 	}
 	
-	check = MPI_Gather(&(img->height), 1, MPI_INT, heights, 1, MPI_INT, 0, MPI_COMM_WORLD);
+	check = MPI_Gather(&(img->height), 1, MPI_INT, heights, 1, MPI_INT, 0, comm);
 	if(check != MPI_SUCCESS){
 		fprintf(stderr, "Rank %d: Error in compose_BMP while comunicating height\n", my_rank);
 		fflush(stderr);
@@ -306,12 +366,12 @@ Image *compose_BMP(Image *img, int my_rank, int num_processes){
 			free(displacements);
 			return NULL;
 		}
-
+		
 		for(int i = 0; i < num_processes; ++i){
 			total_height += heights[i];
 		}
 		
-		data = (RGB *)malloc(width * total_height * sizeof(RGB));
+		data = (unsigned char *)malloc((size_t)width * total_height * channels);
 		if(data == NULL){
 			fprintf(stderr, "Rank %d: Error in compose_BMP while allocating memory\n", my_rank);
 			fflush(stderr);
@@ -330,14 +390,14 @@ Image *compose_BMP(Image *img, int my_rank, int num_processes){
 		}
 	}
 	
-	MPI_Datatype mpi_rgb = create_mpi_datatype_for_RGB();
+	MPI_Datatype mpi_pixel = create_mpi_datatype_for_pixel(channels);
 	
-	check = MPI_Gatherv(
-		img->data, img->height * width, mpi_rgb,
-		data, receives, displacements, mpi_rgb,
-		0, MPI_COMM_WORLD
+	check = gatherv_pixels(
+		img->data, img->height * width,
+		data, receives, displacements, mpi_pixel,
+		width, channels, 0, comm
 	);
-	if(check != MPI_SUCCESS){
+	if(check != 0){
 		fprintf(stderr, "Rank %d: Error in compose_BMP while comunicating data\n", my_rank);
 		fflush(stderr);
 		
@@ -349,7 +409,7 @@ Image *compose_BMP(Image *img, int my_rank, int num_processes){
 			free(data);
 		}
 		
-		check = deallocate_MPI_datatype(&mpi_rgb, my_rank);
+		check = deallocate_MPI_datatype(&mpi_pixel, my_rank);
 		if(check != 0){ // error message was printed by the called function
 			return NULL;
 		}
@@ -357,7 +417,7 @@ Image *compose_BMP(Image *img, int my_rank, int num_processes){
 		return NULL;
 	}
 	
-	check = deallocate_MPI_datatype(&mpi_rgb, my_rank);
+	check = deallocate_MPI_datatype(&mpi_pixel, my_rank);
 	if(check != 0){ // error message was printed by the called function
 		if(my_rank == 0){
 			free(heights);
@@ -370,9 +430,15 @@ Image *compose_BMP(Image *img, int my_rank, int num_processes){
 	}
 	
 	if(my_rank == 0){
+		free(heights);
+		free(displacements);
+		free(receives);
+		
 		new_img->data = data;
 		new_img->width = width;
 		new_img->height = total_height;
+		new_img->channels = channels;
+		new_img->top_down = img->top_down;
 		return new_img;
 	}
 	else{
@@ -380,10 +446,116 @@ Image *compose_BMP(Image *img, int my_rank, int num_processes){
 	}
 }
 
-FILE *open_BMP(const char *filename, int *height, int *width, int *data_start, int *padding){
+Image *compose_BMP_blocks(Image *img, int first_row, int first_column, int height, int width, int my_rank, int num_processes, MPI_Comm comm){
+	/**
+	*	Takes in each process's block of an Image, the row and column of the Image at which the block starts,
+	*	the height and width of the whole Image, the process's rank, the total number of processes and their communicator.
+	*	It works like compose_BMP, but for blocks of a 2D decomposition instead of strips: process 0 receives every block
+	*	straight into its place in the whole Image, with a subarray datatype. Blocks may be empty.
+	*	For rank 0, it returns the whole Image, and for ranks != 0, it returns the process's original Image.
+	*/
+	
+	int check;
+	int channels = img->channels;
+	int block[4] = {first_row, first_column, img->height, img->width};
+	int *blocks = NULL;
+	
+	if(my_rank == 0){
+		blocks = (int*)malloc(4 * num_processes * sizeof(int));
+		if(blocks == NULL){
+			fprintf(stderr, "Rank %d: Error in compose_BMP_blocks while allocating memory\n", my_rank);
+			fflush(stderr);
+			return NULL;
+		}
+	}
+	
+	check = MPI_Gather(block, 4, MPI_INT, blocks, 4, MPI_INT, 0, comm);
+	if(check != MPI_SUCCESS){
+		fprintf(stderr, "Rank %d: Error in compose_BMP_blocks while comunicating the blocks\n", my_rank);
+		fflush(stderr);
+		free(blocks);
+		return NULL;
+	}
+	
+	if(my_rank != 0){
+		if(img->height > 0 && img->width > 0){
+			check = MPI_Send(img->data, img->height * img->width * channels, MPI_UNSIGNED_CHAR, 0, COMPOSE_BLOCK_TAG, comm);
+			if(check != MPI_SUCCESS){
+				fprintf(stderr, "Rank %d: Error in compose_BMP_blocks while comunicating data\n", my_rank);
+				fflush(stderr);
+				return NULL;
+			}
+		}
+		return img;
+	}
+	
+	Image *new_img = (Image*)malloc(sizeof(Image));
+	unsigned char *data = (unsigned char*)malloc((size_t)height * width * channels);
+	MPI_Request *requests = (MPI_Request*)malloc(num_processes * sizeof(MPI_Request));
+	if(new_img == NULL || data == NULL || requests == NULL){
+		fprintf(stderr, "Rank %d: Error in compose_BMP_blocks while allocating memory\n", my_rank);
+		fflush(stderr);
+		free(blocks);
+		free(new_img);
+		free(data);
+		free(requests);
+		return NULL;
+	}
+	
+	requests[0] = MPI_REQUEST_NULL;
+	for(int i = 1; i < num_processes; ++i){
+		int *other_block = blocks + 4 * i;
+		requests[i] = MPI_REQUEST_NULL;
+		if(other_block[2] == 0 || other_block[3] == 0) continue;
+		
+		int sizes[2] = {height, width * channels};
+		int subsizes[2] = {other_block[2], other_block[3] * channels};
+		int starts[2] = {other_block[0], other_block[1] * channels};
+		MPI_Datatype mpi_block;
+		
+		check = MPI_Type_create_subarray(2, sizes, subsizes, starts, MPI_ORDER_C, MPI_UNSIGNED_CHAR, &mpi_block);
+		if(check == MPI_SUCCESS) check = MPI_Type_commit(&mpi_block);
+		if(check == MPI_SUCCESS) check = MPI_Irecv(data, 1, mpi_block, i, COMPOSE_BLOCK_TAG, comm, &requests[i]);
+		if(check == MPI_SUCCESS) check = MPI_Type_free(&mpi_block); // freed once the receive is posted, MPI keeps it until then
+		if(check != MPI_SUCCESS){
+			fprintf(stderr, "Rank %d: Error in compose_BMP_blocks while comunicating data\n", my_rank);
+			fflush(stderr);
+			free(blocks);
+			free(new_img);
+			free(data);
+			free(requests);
+			return NULL;
+		}
+	}
+	
+	size_t block_row_size = (size_t)img->width * channels;
+	for(int row = 0; row < img->height; ++row){
+		memcpy(data + ((size_t)(first_row + row) * width + first_column) * channels, img->data + row * block_row_size, block_row_size);
+	}
+	
+	check = MPI_Waitall(num_processes, requests, MPI_STATUSES_IGNORE);
+	free(blocks);
+	free(requests);
+	if(check != MPI_SUCCESS){
+		fprintf(stderr, "Rank %d: Error in compose_BMP_blocks while comunicating data\n", my_rank);
+		fflush(stderr);
+		free(new_img);
+		free(data);
+		return NULL;
+	}
+	
+	new_img->data = data;
+	new_img->width = width;
+	new_img->height = height;
+	new_img->channels = channels;
+	new_img->top_down = img->top_down;
+	return new_img;
+}
+
+FILE *open_BMP(const char *filename, int *height, int *width, int *channels, int *top_down, int *data_start, int *padding){
 	/**
 	*	Takes in a file path and returns a FILE* associated with the opened file.
-	*	It also sets height, width, data_start and padding according to the file's header.
+	*	It also sets height, width, channels, top_down, data_start and padding according to the file's header.
 	*/
 	
 	FILE *image_file = fopen(filename, "rb");
@@ -393,54 +565,30 @@ FILE *open_BMP(const char *filename, int *height, int *width, int *data_start, i
         return NULL;
     }
 
-    unsigned char header[54];
-    if (fread(header, sizeof(unsigned char), 54, image_file) != 54){
-        fprintf(stderr, "Error in open_BMP: Invalid BMP header\n");
-		fflush(stderr);
-        fclose(image_file);
-        return NULL;
-    }
-
-    if (header[0] != 'B' || header[1] != 'M'){
-        fprintf(stderr, "Error in open_BMP: Not a valid BMP file\n");
-		fflush(stderr);
-        fclose(image_file);
-        return NULL;
-    }
+    unsigned char header[BMP_MAX_HEADER_SIZE];
+	int header_size = fread(header, sizeof(unsigned char), BMP_MAX_HEADER_SIZE, image_file);
 	
-	int bitsPerPixel = *(short *)&header[28];
-	if (bitsPerPixel != 24){
-        fprintf(stderr, "Error in open_BMP: Only 24-bit BMPs are supported\n");
-		fflush(stderr);
+	int check = parse_BMP_header(header, header_size, height, width, channels, top_down, data_start, padding, 1);
+	if (check != 0){ // error message was printed by the called function
         fclose(image_file);
         return NULL;
     }
 	
-	*height = *(int *)&header[22];
-	*width = *(int *)&header[18];
-	*data_start = *(int *)&header[10];
-	
-	int row_padded = (*width * 3 + 3) & (~3);
-	int pixel_data_size = *width * 3;
-	
-	*padding = row_padded - pixel_data_size;
-	
 	return image_file;
 }
 
-Image *read_BMP_chunk(FILE *image_file, int halo_dim, int chunk_size, int height, int width, int padding, int data_start, int *offset, int *true_start, int *true_end){
+Image *read_BMP_chunk(FILE *image_file, int halo_dim, int chunk_size, int height, int width, int channels, int top_down, int padding, int data_start, int *offset, int *true_start, int *true_end){
 	/**
 	*	Takes in a FILE* coresponding to an open .bmp file, the size of the halo, the size of a chunk,
-	*	the height, width, data_start and padding of the image and the offset at which to start reading
+	*	the height, width, channels, top_down, data_start and padding of the image and the offset at which to start reading
 	*	and returns the read chunk as an Image, setting true_start and true_end to represent the start
 	* 	and end of the image chunk (not including the halos).
+	*	The chunk, together with its halos, is read with a single read and keeps the order of the file.
 	*/
 	
-	int pixel_data_size = width * 3;
-	int offset_stride = width * 3 + padding;
+	int pixel_data_size = width * channels;
+	int offset_stride = pixel_data_size + padding;
 	int next_row = (*offset - data_start) / offset_stride;
-	int halo_available = halo_dim;
-	int rows_to_read;
 	
 	if(next_row >= height){ // no more rows to read
 		Image *dummy_image = (Image*)malloc(sizeof(Image));
@@ -448,112 +596,86 @@ Image *read_BMP_chunk(FILE *image_file, int halo_dim, int chunk_size, int height
 		return dummy_image;
 	}
 	
-	if(next_row == 0){ // first chunk doesnt have an end halo
-		if(chunk_size >= height){ // if the chunk is bigger than the image
-			rows_to_read = height;
-			*true_start = 0;
-			*true_end = rows_to_read - 1;
-		}
-		else if(chunk_size + halo_dim >= height){ // if the chunk + halo is bigger than the image
-			halo_available = halo_dim - (chunk_size + halo_dim - height);
-			rows_to_read = chunk_size + halo_available;
-			*true_start = halo_available;
-			*true_end = rows_to_read - 1;
-		}
-		else{ // chunk + halo is smaller than the image
-			rows_to_read = chunk_size + halo_dim;
-			*true_start = halo_dim;
-			*true_end = rows_to_read - 1;
-		}
-	}
-	else if(next_row + chunk_size >= height){ // last chunk doesnt have a start halo
-		rows_to_read = height - next_row + halo_dim;
-		*true_start = 0;
-		*true_end = rows_to_read - 1 - halo_dim;
-		*offset -= halo_dim * offset_stride;
-	}
-	else if(next_row + chunk_size + halo_dim >= height){ // second to last chunk may not have the entire start halo
-		halo_available = halo_dim - (next_row + chunk_size + halo_dim - height);
-		rows_to_read = chunk_size + halo_dim + halo_available;
-		*true_start = halo_available;
-		*true_end = rows_to_read - 1 - halo_dim;
-		*offset -= halo_dim * offset_stride;
-	}
-	else{ // any other chunks have both halos
-		rows_to_read = chunk_size + 2 * halo_dim;
-		*true_start = halo_dim;
-		*true_end = rows_to_read - 1 - halo_dim;
-		*offset -= halo_dim * offset_stride;
-	}
+	// the first chunk has no halo before it and the last one has no halo after it
+	int chunk_rows = min(chunk_size, height - next_row);
+	int halo_before = min(halo_dim, next_row);
+	int halo_after = min(halo_dim, height - next_row - chunk_rows);
+	int rows_to_read = halo_before + chunk_rows + halo_after;
 	
-	unsigned char *row_pixels = (unsigned char*)malloc(pixel_data_size * sizeof(unsigned char));
-	if(row_pixels == NULL){
-		fprintf(stderr, "Rank 0: Error in readBMP_chunk while allocating memory\n");
-		fflush(stderr);
-		fclose(image_file);
-		return NULL;
-	}
+	*true_start = halo_before;
+	*true_end = halo_before + chunk_rows - 1;
 	
-	RGB *data = (RGB*)malloc(rows_to_read * width * sizeof(RGB));
+	unsigned char *data = (unsigned char*)malloc((size_t)rows_to_read * offset_stride);
 	if(data == NULL){
 		fprintf(stderr, "Rank 0: Error in readBMP_chunk while allocating memory\n");
 		fflush(stderr);
-		
-		free(row_pixels);
 		fclose(image_file);
-		
 		return NULL;
 	}
 	
-	fseek(image_file, *offset, SEEK_SET); // moving file cursor to the offset
-	
-	for(int y = 0; y < rows_to_read; ++y){
-		fread(row_pixels, sizeof(unsigned char), pixel_data_size, image_file);
-		for (int x = 0; x < width; x++){
-            data[(rows_to_read - 1 - y) * width + x].b = row_pixels[x * 3];
-            data[(rows_to_read - 1 - y) * width + x].g = row_pixels[x * 3 + 1];
-            data[(rows_to_read - 1 - y) * width + x].r = row_pixels[x * 3 + 2];
-        }
-		if(padding > 0){
-			fseek(image_file, padding, SEEK_CUR);
-		}
-		
-		*offset += offset_stride;
-	}
+	fseek(image_file, *offset - halo_before * offset_stride, SEEK_SET); // moving file cursor to the start of the halo
 	
-	if(*true_start != 0){ // if true_start == 0 it means that this is the last chunk and that we didnt read a start halo
-		*offset -= halo_available * offset_stride;
+	int check = read_BMP_rows(image_file, data, rows_to_read, pixel_data_size, padding);
+	if(check != 0){ // error message was printed by the called function
+		free(data);
+		fclose(image_file);
+		return NULL;
 	}
 	
-	free(row_pixels);
+	*offset += chunk_rows * offset_stride; // the next chunk starts right after this one
 	
 	Image *image_chunk = (Image*)malloc(sizeof(Image));
 	image_chunk->width = width;
 	image_chunk->height = rows_to_read;
+	image_chunk->channels = channels;
+	image_chunk->top_down = top_down;
 	image_chunk->data = data;
 	return image_chunk;
 }
 
-int save_BMP(const char *filename, const Image *img){
+int read_BMP_rect(FILE *image_file, int x, int y, int rect_width, int rect_height, int height, int width, int channels, int padding, int data_start, unsigned char *data){
 	/**
-	*	Takes in a file path and an Image, and save the Image at the given file path.
+	*	Takes in a FILE* coresponding to an open .bmp file, the first column and row of a rectangle (rows are numbered like in an Image),
+	*	its size, the height, width, channels, padding and data_start of the image and a pixel buffer with room for rect_width * rect_height pixels.
+	*	It stores the rectangle in data, one row after the other, reading only the columns of the rectangle from every row,
+	*	so the amount read depends on the size of the rectangle and not on the size of the image.
+	*	It returns 0 on success and -1 on failure.
 	*/
 	
-    FILE *image_file = fopen(filename, "wb");
-    if (image_file == NULL){
-        fprintf(stderr, "Error in save_BMP: Could not create file %s\n", filename);
+	if(x < 0 || y < 0 || rect_width <= 0 || rect_height <= 0 || x + rect_width > width || y + rect_height > height){
+		fprintf(stderr, "Error in read_BMP_rect: Rectangle out of the image\n");
 		fflush(stderr);
-        return -1;
-    }
+		return -1;
+	}
+	
+	long long offset_stride = (long long)width * channels + padding;
+	size_t rect_row_size = (size_t)rect_width * channels;
+	
+	for(int row = 0; row < rect_height; ++row){
+		fseek(image_file, data_start + (y + row) * offset_stride + (long long)x * channels, SEEK_SET);
+		if(fread(data + row * rect_row_size, sizeof(unsigned char), rect_row_size, image_file) != rect_row_size){
+			fprintf(stderr, "Error in read_BMP_rect while reading from file\n");
+			fflush(stderr);
+			return -1;
+		}
+	}
+	
+	return 0;
+}
 
-    int width = img->width;
-    int height = img->height;
-	int pixel_data_size = width * 3;
-    int row_padded = (width * 3 + 3) & (~3);
-	int padding_size = row_padded - pixel_data_size;
-    int file_size = 54 + row_padded * height;
+int build_BMP_header(unsigned char *header, int height, int width, int channels, int top_down){
+	/**
+	*	Takes in a buffer of at least BMP_MAX_HEADER_SIZE bytes, the height, width and number of channels of an Image
+	*	and the orientation in which its rows will be written, and fills the buffer with a BMP header describing it
+	*	(followed by a grayscale palette for 1-channel Images). It returns the size of the header, which is where the pixel data starts.
+	*/
+	
+	int row_padded = (width * channels + 3) & (~3);
+	int palette_size = (channels == 1) ? 256 * 4 : 0;
+	int data_offset = 54 + palette_size;
+	long long file_size = data_offset + (long long)row_padded * height;
 
-    unsigned char header[54] = {
+    unsigned char bmp_header[54] = {
         'B', 'M',    // Signature
         0, 0, 0, 0,  // File size
         0, 0, 0, 0,  // Reserved
@@ -571,40 +693,351 @@ int save_BMP(const char *filename, const Image *img){
         0, 0, 0, 0   // Important colors
     };
 
-    // Fill in width, height, and file size
-    *(int *)&header[2] = file_size;
-    *(int *)&header[18] = width;
-    *(int *)&header[22] = height;
+    // Fill in width, height, and file size (left 0 if it does not fit in the header field)
+    *(unsigned int *)&bmp_header[2] = (file_size > 0xFFFFFFFFLL) ? 0 : (unsigned int)file_size;
+	*(int *)&bmp_header[10] = data_offset;
+    *(int *)&bmp_header[18] = width;
+    *(int *)&bmp_header[22] = top_down ? -height : height;
+	*(short *)&bmp_header[28] = channels * 8;
+	if (channels == 1) *(int *)&bmp_header[46] = 256;
+	
+	memcpy(header, bmp_header, 54);
+	
+	if (channels == 1){
+		unsigned char *palette = header + 54;
+		for (int i = 0; i < 256; ++i){
+			palette[i * 4] = i;
+			palette[i * 4 + 1] = i;
+			palette[i * 4 + 2] = i;
+			palette[i * 4 + 3] = 0;
+		}
+	}
+	
+	return data_offset;
+}
 
-    fwrite(header, sizeof(unsigned char), 54, image_file);
+int write_BMP_header(FILE *image_file, int height, int width, int channels, int top_down){
+	/**
+	*	Takes in a FILE* opened for writing, the height, width and number of channels of an Image
+	*	and the orientation in which its rows will be written, and writes a BMP header describing it
+	*	(followed by a grayscale palette for 1-channel Images) at the current position of the file.
+	*/
+	
+	unsigned char header[BMP_MAX_HEADER_SIZE];
+	int header_size = build_BMP_header(header, height, width, channels, top_down);
+	
+	if(fwrite(header, sizeof(unsigned char), header_size, image_file) != (size_t)header_size){
+		fprintf(stderr, "Error in write_BMP_header while writing to file\n");
+		fflush(stderr);
+		return -1;
+	}
+	
+	return 0;
+}
 
-	unsigned char padding[3] = {0, 0, 0};
-    unsigned char *row_pixels = (unsigned char *)malloc(pixel_data_size);
-    if (row_pixels == NULL){
-        fprintf(stderr, "Error in save_BMP while allocating memory\n");
+int save_BMP(const char *filename, const Image *img){
+	/**
+	*	Takes in a file path and an Image, and save the Image at the given file path.
+	*	The rows are padded by several threads into blocks of SAVE_BLOCK_SIZE bytes, which are written
+	*	with fwrite, or with pwrite by several threads (optionally with O_DIRECT), depending on SAVE_WRITE_MODE.
+	*/
+	
+	double save_time = omp_get_wtime();
+	long long file_size;
+	
+	if(SAVE_WRITE_MODE != 0 && SAVE_BLOCKS_SUPPORTED){
+		int check = save_BMP_blocks(filename, img, &file_size);
+		if(check != 0){ // error message was printed by the called function
+			return -1;
+		}
+	}
+	else{
+		FILE *image_file = create_BMP(filename, img->height, img->width, img->channels, img->top_down);
+		if (image_file == NULL){ // error message was printed by the called function
+			return -1;
+		}
+		
+		int check = write_BMP_rows(image_file, img);
+		if(check != 0){ // error message was printed by the called function
+			fclose(image_file);
+			return -1;
+		}
+		
+		file_size = ftell(image_file);
+#if SAVE_BLOCKS_SUPPORTED
+		if(SAVE_PRINT_BANDWIDTH){ // the data has to reach the disk for the bandwidth to be the disk's
+			fflush(image_file);
+			fsync(fileno(image_file));
+		}
+#endif
+		fclose(image_file);
+	}
+	
+	save_time = omp_get_wtime() - save_time;
+	if(SAVE_PRINT_BANDWIDTH){
+		double megabytes = file_size / (1024.0 * 1024.0);
+		fprintf(stdout, "save_BMP: %.1f MB written in %f s (%.1f MB/s, %.1f%% of the %.1f MB/s of the disk)\n",
+			megabytes, save_time, megabytes / save_time, 100.0 * megabytes / save_time / SAVE_DISK_MBPS, SAVE_DISK_MBPS);
+		fflush(stdout);
+	}
+	
+	return 0;
+}
+
+FILE *create_BMP(const char *filename, int height, int width, int channels, int top_down){
+	/**
+	*	Takes in a file path, the height, width and number of channels of the Image which will be stored in it
+	*	and the orientation in which its rows will be written.
+	*	It creates the file, writes the BMP header and returns a FILE* positioned at the start
+	*	of the pixel data, ready to receive rows through write_BMP_rows.
+	*/
+	
+	FILE *image_file = fopen(filename, "wb");
+    if (image_file == NULL){
+        fprintf(stderr, "Error in create_BMP: Could not create file %s\n", filename);
 		fflush(stderr);
-        fclose(image_file);
-        return -1;
+        return NULL;
     }
+	
+	int check = write_BMP_header(image_file, height, width, channels, top_down);
+	if(check != 0){ // error message was printed by the called function
+		fclose(image_file);
+		return NULL;
+	}
+	
+	return image_file;
+}
 
-    // Write pixel data bottom-to-top
-    for (int y = 0; y < height; y++)
-    {
-        for (int x = 0; x < width; x++)
-        {
-            RGB pixel = img->data[(height - 1 - y) * width + x];
-            row_pixels[x * 3] = pixel.b;
-            row_pixels[x * 3 + 1] = pixel.g;
-            row_pixels[x * 3 + 2] = pixel.r;
-        }
-        fwrite(row_pixels, sizeof(unsigned char), pixel_data_size, image_file);
-		if(padding_size > 0)
-		{
-			fwrite(padding, sizeof(unsigned char), padding_size, image_file);
+int write_BMP_rows(FILE *image_file, const Image *img){
+	/**
+	*	Takes in a FILE* opened for writing and an Image.
+	*	It appends the rows of the Image to the file, in the order they are stored in the Image (which is the order of the file).
+	*	Images without padding are written with a single write. The rows of the others are padded by SAVE_WRITE_THREADS threads
+	*	into a staging buffer, which is written in blocks of SAVE_BLOCK_SIZE bytes.
+	*	Calling it for consecutive bands of an image produces the same file as saving the whole image at once.
+	*/
+	
+	int width = img->width;
+    int height = img->height;
+	int pixel_data_size = width * img->channels;
+    int row_padded = (pixel_data_size + 3) & (~3);
+	int padding_size = row_padded - pixel_data_size;
+	
+	if(padding_size == 0){
+		size_t size = (size_t)pixel_data_size * height;
+		if(fwrite(img->data, sizeof(unsigned char), size, image_file) != size){
+			fprintf(stderr, "Error in write_BMP_rows while writing to file\n");
+			fflush(stderr);
+			return -1;
 		}
-    }
+		return 0;
+	}
+	
+	int block_rows = min(max(1, SAVE_BLOCK_SIZE / row_padded), height);
+	unsigned char *block = (unsigned char*)malloc((size_t)block_rows * row_padded);
+	if(block == NULL){
+		fprintf(stderr, "Error in write_BMP_rows while allocating memory\n");
+		fflush(stderr);
+		return -1;
+	}
+	
+	for(int y = 0; y < height; y += block_rows){
+		int rows = min(block_rows, height - y);
+		size_t size = (size_t)rows * row_padded;
+		
+		// the rows of the Image are the whole content of a file without a header
+		fill_BMP_block(NULL, 0, img, (long long)y * row_padded, size, block, SAVE_WRITE_THREADS);
+		
+		if(fwrite(block, sizeof(unsigned char), size, image_file) != size){
+			fprintf(stderr, "Error in write_BMP_rows while writing to file\n");
+			fflush(stderr);
+			free(block);
+			return -1;
+		}
+	}
+	
+	free(block);
+	return 0;
+}
+
+void fill_BMP_block(const unsigned char *header, int header_size, const Image *img, long long start, size_t size, unsigned char *block, int num_threads){
+	/**
+	*	Takes in the BMP header of an Image and its size, the Image, the position and size of a block of the .bmp file of the Image,
+	*	a buffer of the size of the block and the number of threads to use.
+	*	It fills the buffer with the bytes of the block (header bytes, pixels and row padding), as they are in the file.
+	*/
+	
+	long long end = start + size;
+	int row_size = img->width * img->channels;
+	int row_padded = (row_size + 3) & (~3);
+	long long data_size = (long long)row_padded * img->height;
+	
+	if(start < header_size){
+		memcpy(block, header + start, ((end < header_size) ? end : header_size) - start);
+	}
+	
+	long long first_byte = (start > header_size) ? start - header_size : 0; // first byte of the block in the pixel data
+	long long last_byte = ((end < header_size + data_size) ? end : header_size + data_size) - header_size; // one past the last one
+	if(first_byte >= last_byte) return;
+	
+	int first_row = first_byte / row_padded;
+	int last_row = (last_byte - 1) / row_padded;
+	
+	#pragma omp parallel for num_threads(num_threads)
+	for(int y = first_row; y <= last_row; ++y){
+		long long row_start = (long long)y * row_padded;
+		long long from = (row_start > first_byte) ? row_start : first_byte;
+		long long to = (row_start + row_padded < last_byte) ? row_start + row_padded : last_byte;
+		long long pixels_end = (row_start + row_size < to) ? row_start + row_size : to;
+		unsigned char *destination = block + (header_size + from - start);
+		
+		if(from < pixels_end){
+			memcpy(destination, img->data + (size_t)y * row_size + (from - row_start), pixels_end - from);
+		}
+		if(pixels_end < to){ // row padding
+			long long padding_from = (from > pixels_end) ? from : pixels_end;
+			memset(block + (header_size + padding_from - start), 0, to - padding_from);
+		}
+	}
+}
 
-    free(row_pixels);
-    fclose(image_file);
-    return 0;
+#if SAVE_BLOCKS_SUPPORTED
+int save_BMP_blocks(const char *filename, const Image *img, long long *file_size){
+	/**
+	*	Takes in a file path, an Image and a place to store the size of the file.
+	*	It saves the Image at the given file path with SAVE_WRITE_THREADS threads, each of which fills
+	*	blocks of SAVE_BLOCK_SIZE bytes of the file and writes them at their position with pwrite.
+	*	If SAVE_WRITE_MODE == 2, the file is opened with O_DIRECT, so the blocks skip the page cache
+	*	(the last block is written whole and the file truncated afterwards). It returns 0 on success and -1 on failure.
+	*/
+	
+	unsigned char header[BMP_MAX_HEADER_SIZE];
+	int header_size = build_BMP_header(header, img->height, img->width, img->channels, img->top_down);
+	int row_padded = (img->width * img->channels + 3) & (~3);
+	int direct = (SAVE_WRITE_MODE == 2);
+	*file_size = header_size + (long long)row_padded * img->height;
+	
+	int image_file = open(filename, O_WRONLY | O_CREAT | O_TRUNC | (direct ? O_DIRECT : 0), 0644);
+	if(image_file == -1 && direct){ // some file systems do not support O_DIRECT
+		direct = 0;
+		image_file = open(filename, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	}
+	if(image_file == -1){
+		fprintf(stderr, "Error in save_BMP_blocks: Could not create file %s\n", filename);
+		fflush(stderr);
+		return -1;
+	}
+	
+	long long num_blocks = (*file_size + SAVE_BLOCK_SIZE - 1) / SAVE_BLOCK_SIZE;
+	int failed = 0;
+	
+	#pragma omp parallel num_threads(SAVE_WRITE_THREADS)
+	{
+		void *block = NULL;
+		if(posix_memalign(&block, SAVE_DIRECT_ALIGNMENT, SAVE_BLOCK_SIZE) != 0){
+			block = NULL;
+			#pragma omp atomic write
+			failed = 1;
+		}
+		
+		#pragma omp for schedule(dynamic, 1)
+		for(long long k = 0; k < num_blocks; ++k){
+			int stop;
+			#pragma omp atomic read
+			stop = failed;
+			if(stop) continue;
+			
+			long long start = k * SAVE_BLOCK_SIZE;
+			size_t size = (start + SAVE_BLOCK_SIZE < *file_size) ? SAVE_BLOCK_SIZE : *file_size - start;
+			size_t write_size = size;
+			
+			fill_BMP_block(header, header_size, img, start, size, (unsigned char*)block, 1);
+			if(direct && size % SAVE_DIRECT_ALIGNMENT != 0){ // O_DIRECT only writes whole aligned blocks
+				write_size = (size + SAVE_DIRECT_ALIGNMENT - 1) / SAVE_DIRECT_ALIGNMENT * SAVE_DIRECT_ALIGNMENT;
+				memset((unsigned char*)block + size, 0, write_size - size);
+			}
+			
+			size_t written = 0;
+			while(written < write_size){
+				ssize_t result = pwrite(image_file, (unsigned char*)block + written, write_size - written, start + written);
+				if(result <= 0){
+					#pragma omp atomic write
+					failed = 1;
+					break;
+				}
+				written += result;
+			}
+		}
+		
+		free(block);
+	}
+	
+	if(!failed && direct && ftruncate(image_file, *file_size) != 0) failed = 1;
+	if(!failed && SAVE_PRINT_BANDWIDTH && fsync(image_file) != 0) failed = 1; // the data has to reach the disk for the bandwidth to be the disk's
+	
+	if(failed){
+		fprintf(stderr, "Error in save_BMP_blocks while writing to file %s\n", filename);
+		fflush(stderr);
+		close(image_file);
+		return -1;
+	}
+	
+	close(image_file);
+	return 0;
+}
+#endif
+
+int generate_BMP(const char *filename, int height, int width, int band_size){
+	/**
+	*	Takes in a file path, the height and width of the image to generate and the number of rows
+	*	to generate at once.
+	*	It writes a synthetic 24-bit .bmp file (a diagonal gradient with some deterministic noise) band by band,
+	*	so that images larger than the available memory can be created for testing the streaming mode.
+	*/
+	
+	FILE *image_file = create_BMP(filename, height, width, 3, 0);
+	if(image_file == NULL){ // error message was printed by the called function
+		return -1;
+	}
+	
+	unsigned char *data = (unsigned char*)malloc((size_t)band_size * width * 3);
+	if(data == NULL){
+		fprintf(stderr, "Error in generate_BMP while allocating memory\n");
+		fflush(stderr);
+		fclose(image_file);
+		return -1;
+	}
+	
+	Image band;
+	band.width = width;
+	band.channels = 3;
+	band.top_down = 0;
+	band.data = data;
+	
+	// bands are generated in file order, from the bottom of the image to the top
+	for(int written = 0; written < height; written += band.height){
+		band.height = min(band_size, height - written);
+		
+		for(int i = 0; i < band.height; ++i){
+			long long y = height - 1 - written - i; // row of the image (counted from the top) coresponding to row i of the band
+			for(int x = 0; x < width; ++x){
+				unsigned int noise = (unsigned int)(y * 2654435761u) ^ (unsigned int)(x * 40503u);
+				unsigned char *pixel = data + ((size_t)i * width + x) * 3;
+				pixel[0] = (unsigned char)((noise >> 13) & 0xFF);
+				pixel[1] = (unsigned char)((y - x) & 0xFF);
+				pixel[2] = (unsigned char)((x + y) & 0xFF);
+			}
+		}
+		
+		int check = write_BMP_rows(image_file, &band);
+		if(check != 0){ // error message was printed by the called function
+			free(data);
+			fclose(image_file);
+			return -1;
+		}
+	}
+	
+	free(data);
+	fclose(image_file);
+	return 0;
 }
\ No newline at end of file
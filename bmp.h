@@ -4,11 +4,41 @@
 
 #include "bmp_common.h"
 
+#define COMPOSE_BLOCK_TAG 7 // tag of the blocks sent to process 0 by compose_BMP_blocks
+#define BMP_MAX_HEADER_SIZE 2048 // large enough for every BMP header version followed by a 256 color palette
+
+#define SAVE_WRITE_MODE 0 // 0 = fwrite, 1 = pwrite by SAVE_WRITE_THREADS threads, 2 = pwrite with O_DIRECT (skips the page cache)
+#define SAVE_BLOCK_SIZE (8 * 1024 * 1024) // bytes written at once by save_BMP (a multiple of SAVE_DIRECT_ALIGNMENT)
+#define SAVE_WRITE_THREADS 4 // threads padding the rows (and writing the blocks when SAVE_WRITE_MODE != 0)
+#define SAVE_DIRECT_ALIGNMENT 4096 // alignment of the buffers, offsets and sizes required by O_DIRECT
+#define SAVE_PRINT_BANDWIDTH 0 // set to 1 to print the write bandwidth of every save_BMP (waiting for the data to reach the disk)
+#define SAVE_DISK_MBPS 500.0 // sequential write bandwidth of the disk in MB/s, which the measured bandwidth is compared with
+
+#ifdef _WIN32
+#define SAVE_BLOCKS_SUPPORTED 0 // no pwrite or O_DIRECT, save_BMP always uses fwrite
+#else
+#define SAVE_BLOCKS_SUPPORTED 1
+#endif
+
+int parse_BMP_header(const unsigned char *header, int header_size, int *height, int *width, int *channels, int *top_down, int *data_start, int *padding, int print_errors);
+void remove_BMP_padding(unsigned char *data, int rows, int row_size, int padding);
+int read_BMP_rows(FILE *image_file, unsigned char *data, int rows, int row_size, int padding);
 Image *read_BMP_serial(const char *filename);
 Image *read_BMP_MPI(const char *file_name, int my_rank, int num_processes, int halo_dim, int *true_start, int *true_end);
-Image *compose_BMP(Image *img, int my_rank, int num_processes);
-FILE *open_BMP(const char *filename, int *height, int *width, int *data_start, int *padding);
-Image *read_BMP_chunk(FILE *image_file, int halo_dim, int chunk_size, int height, int width, int padding, int data_start, int *offset, int *true_start, int *true_end);
+Image *compose_BMP(Image *img, int my_rank, int num_processes, MPI_Comm comm);
+Image *compose_BMP_blocks(Image *img, int first_row, int first_column, int height, int width, int my_rank, int num_processes, MPI_Comm comm);
+FILE *open_BMP(const char *filename, int *height, int *width, int *channels, int *top_down, int *data_start, int *padding);
+Image *read_BMP_chunk(FILE *image_file, int halo_dim, int chunk_size, int height, int width, int channels, int top_down, int padding, int data_start, int *offset, int *true_start, int *true_end);
+int read_BMP_rect(FILE *image_file, int x, int y, int rect_width, int rect_height, int height, int width, int channels, int padding, int data_start, unsigned char *data);
+int build_BMP_header(unsigned char *header, int height, int width, int channels, int top_down);
+int write_BMP_header(FILE *image_file, int height, int width, int channels, int top_down);
 int save_BMP(const char *filename, const Image *img);
+FILE *create_BMP(const char *filename, int height, int width, int channels, int top_down);
+int write_BMP_rows(FILE *image_file, const Image *img);
+void fill_BMP_block(const unsigned char *header, int header_size, const Image *img, long long start, size_t size, unsigned char *block, int num_threads);
+#if SAVE_BLOCKS_SUPPORTED
+int save_BMP_blocks(const char *filename, const Image *img, long long *file_size);
+#endif
+int generate_BMP(const char *filename, int height, int width, int band_size);
 
 #endif
\ No newline at end of file
@@ -4,29 +4,25 @@
 
 #include "mpi.h"
 
-typedef struct
-{
-    unsigned char r, g, b;
-} RGB; // one RGB point
-
 typedef struct
 {
     int width;
     int height;
-    RGB *data;
-} Image; // a BMP image as an array of RGB points
+    int channels; // 1 (grayscale), 3 (BGR) or 4 (BGRA)
+    int top_down; // 1 if the rows are stored from top to bottom, 0 if they are stored from bottom to top
+    unsigned char *data;
+} Image; // a BMP image as an array of pixels, each pixel made of `channels` bytes, kept in the order of the .bmp file
 
 typedef struct{
-	int true_start, true_end, height, width, num_threads;
+	int true_start, true_end, height, width, channels, num_threads;
 	int operation; // enum has the same size as an int
+	int top_down; // of the Image the rows belong to, which the convolution needs to add the rows of the kernel in the same order
 }send_block_t;
 
-void copy_RGB(const RGB *src, RGB *dest);
-int equal_RGB(const RGB rgb1, const RGB rgb2);
 int min(int a, int b);
 int max(int a, int b);
 
-MPI_Datatype create_mpi_datatype_for_RGB();
+MPI_Datatype create_mpi_datatype_for_pixel(int channels);
 MPI_Datatype create_mpi_datatype_for_send_block_t();
 int deallocate_MPI_datatype(MPI_Datatype *type, int my_rank);
 
@@ -0,0 +1,265 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <utime.h>
+#include "cache.h"
+#include "bmp.h"
+#include "tiled.h"
+#include "verification.h"
+
+#ifdef _WIN32
+#include <direct.h>
+#define make_directory(path) _mkdir(path)
+#else
+#define make_directory(path) mkdir(path, 0755)
+#endif
+
+typedef struct{
+	char file_name[RESULT_CACHE_PATH_SIZE];
+	long long size;
+	time_t last_used;
+}cache_entry_t;
+
+int hash_image_file(const char *file_name, unsigned long long *hash, int *top_down, int num_threads){
+	/**
+	*	Takes in a file path to an image (a .bmp file or a tiled image), a place to store the hash of its pixels,
+	*	a place to store its top_down and the number of threads to use.
+	*	The hash is the one hash_image returns for the Image read from the file, but the file is read
+	*	RESULT_CACHE_HASH_ROWS rows at a time, so the whole Image is never in memory.
+	*	It returns 0 on success and -1 on failure.
+	*/
+	
+	int height, width, channels, data_start, padding;
+	FILE *image_file = NULL;
+	tiled_image_t *tiled = NULL;
+	
+	if(is_tiled_file(file_name)){
+		tiled = open_tiled(file_name);
+		if(tiled == NULL){ // error message was printed by the called function
+			return -1;
+		}
+		
+		height = tiled->height;
+		width = tiled->width;
+		channels = tiled->channels;
+		*top_down = tiled->top_down;
+		padding = 0;
+	}
+	else{
+		image_file = open_BMP(file_name, &height, &width, &channels, top_down, &data_start, &padding);
+		if(image_file == NULL){ // error message was printed by the called function
+			return -1;
+		}
+		fseek(image_file, data_start, SEEK_SET);
+	}
+	
+	int row_size = width * channels;
+	unsigned char *buffer = (unsigned char*)malloc((size_t)RESULT_CACHE_HASH_ROWS * (row_size + padding));
+	if(buffer == NULL){
+		fprintf(stderr, "Error in hash_image_file while allocating memory\n");
+		fflush(stderr);
+		if(tiled != NULL) close_tiled(tiled);
+		else fclose(image_file);
+		return -1;
+	}
+	
+	unsigned long long rows_hash = 0;
+	int check = 0;
+	
+	for(int row = 0; row < height && check == 0; row += RESULT_CACHE_HASH_ROWS){
+		int rows = min(RESULT_CACHE_HASH_ROWS, height - row);
+		
+		if(tiled != NULL) check = read_tiled_rect(tiled, 0, row, width, rows, buffer);
+		else check = read_BMP_rows(image_file, buffer, rows, row_size, padding);
+		
+		rows_hash += hash_rows(buffer, row, rows, width, channels, num_threads);
+	}
+	
+	free(buffer);
+	if(tiled != NULL) close_tiled(tiled);
+	else fclose(image_file);
+	
+	if(check != 0){ // error message was printed by the called function
+		return -1;
+	}
+	
+	*hash = finish_image_hash(rows_hash, height, width, channels);
+	return 0;
+}
+
+void result_cache_file_name(char *file_name, unsigned long long input_hash, operation_t operation, int top_down){
+	/**
+	*	Takes in a buffer of RESULT_CACHE_PATH_SIZE chars and the key of an entry and stores the path to the entry in the buffer.
+	*/
+	
+	snprintf(file_name, RESULT_CACHE_PATH_SIZE, "%s/%016llx_%d_%d.bmp", RESULT_CACHE_DIRECTORY, input_hash, (int)operation, top_down);
+}
+
+Image *lookup_result_cache(unsigned long long input_hash, operation_t operation, int top_down){
+	/**
+	*	Takes in the hash of the pixels of an input, an operation_t and the top_down of the input.
+	*	If the cache holds the input edited with operation, it marks the entry as used and returns the edited Image.
+	*	It returns NULL otherwise.
+	*/
+	
+	char file_name[RESULT_CACHE_PATH_SIZE];
+	result_cache_file_name(file_name, input_hash, operation, top_down);
+	
+	FILE *entry = fopen(file_name, "rb");
+	if(entry == NULL){
+		return NULL;
+	}
+	fclose(entry);
+	
+	utime(file_name, NULL); // the entry becomes the most recently used one
+	return read_BMP_serial(file_name);
+}
+
+int compare_entries_by_use(const void *a, const void *b){
+	/**
+	*	Takes in two cache_entry_t and orders them from the least to the most recently used.
+	*/
+	
+	time_t first = ((const cache_entry_t*)a)->last_used, second = ((const cache_entry_t*)b)->last_used;
+	return (first > second) - (first < second);
+}
+
+int evict_result_cache(long long max_bytes){
+	/**
+	*	Takes in a size budget and removes the least recently used entries of the cache until the rest fit in it.
+	*	It returns 0 on success and -1 on failure.
+	*/
+	
+	DIR *directory = opendir(RESULT_CACHE_DIRECTORY);
+	if(directory == NULL){
+		fprintf(stderr, "Error in evict_result_cache: Could not open directory %s\n", RESULT_CACHE_DIRECTORY);
+		fflush(stderr);
+		return -1;
+	}
+	
+	int num_entries = 0, capacity = 16;
+	long long total_size = 0;
+	cache_entry_t *entries = (cache_entry_t*)malloc(capacity * sizeof(cache_entry_t));
+	struct dirent *dir_entry;
+	
+	while(entries != NULL && (dir_entry = readdir(directory)) != NULL){
+		size_t length = strlen(dir_entry->d_name);
+		if(length <= 4 || strcmp(dir_entry->d_name + length - 4, ".bmp") != 0) continue;
+		
+		if(num_entries == capacity){
+			capacity *= 2;
+			cache_entry_t *new_entries = (cache_entry_t*)realloc(entries, capacity * sizeof(cache_entry_t));
+			if(new_entries == NULL){
+				free(entries);
+				entries = NULL;
+				break;
+			}
+			entries = new_entries;
+		}
+		
+		struct stat file_stat;
+		cache_entry_t *entry = &entries[num_entries];
+		snprintf(entry->file_name, RESULT_CACHE_PATH_SIZE, "%s/%s", RESULT_CACHE_DIRECTORY, dir_entry->d_name);
+		if(stat(entry->file_name, &file_stat) != 0) continue;
+		
+		entry->size = (long long)file_stat.st_size;
+		entry->last_used = file_stat.st_mtime;
+		total_size += entry->size;
+		++num_entries;
+	}
+	closedir(directory);
+	
+	if(entries == NULL){
+		fprintf(stderr, "Error in evict_result_cache while allocating memory\n");
+		fflush(stderr);
+		return -1;
+	}
+	
+	qsort(entries, num_entries, sizeof(cache_entry_t), compare_entries_by_use);
+	
+	for(int i = 0; i < num_entries && total_size > max_bytes; ++i){
+		if(remove(entries[i].file_name) == 0){
+			total_size -= entries[i].size;
+		}
+	}
+	
+	free(entries);
+	return 0;
+}
+
+int store_result_cache(unsigned long long input_hash, operation_t operation, const Image *edited_img){
+	/**
+	*	Takes in the hash of the pixels of an input, an operation_t and the input edited with operation.
+	*	It adds the edited Image to the cache (through a .tmp file, so a half-written entry is never found)
+	*	and evicts the least recently used entries beyond RESULT_CACHE_MAX_BYTES.
+	*	It returns 0 on success and -1 on failure.
+	*/
+	
+	char file_name[RESULT_CACHE_PATH_SIZE], tmp_file_name[RESULT_CACHE_PATH_SIZE + 4];
+	result_cache_file_name(file_name, input_hash, operation, edited_img->top_down);
+	snprintf(tmp_file_name, sizeof(tmp_file_name), "%s.tmp", file_name);
+	
+	make_directory(RESULT_CACHE_DIRECTORY); // fails harmlessly if it exists
+	
+	int check = save_BMP(tmp_file_name, edited_img);
+	if(check != 0){ // error message was printed by the called function
+		remove(tmp_file_name);
+		return -1;
+	}
+	
+	remove(file_name); // rename does not replace an existing file on Windows
+	if(rename(tmp_file_name, file_name) != 0){
+		fprintf(stderr, "Error in store_result_cache: Could not rename file %s\n", tmp_file_name);
+		fflush(stderr);
+		remove(tmp_file_name);
+		return -1;
+	}
+	
+	return evict_result_cache(RESULT_CACHE_MAX_BYTES);
+}
+
+int check_result_cache(const char *in_file_name, const Image *img, operation_t operation, int my_rank, MPI_Comm comm, int num_threads, unsigned long long *input_hash, Image **cached_img){
+	/**
+	*	Takes in a file path to the file to edit, the Image read from it on process 0 (NULL if it was not read, then the file is hashed),
+	*	an operation_t, this process's rank, the communicator of the processes editing the Image (MPI_COMM_NULL if only process 0 needs to know),
+	*	the number of threads to use, a place to store the hash of the input and a place to store the cached edited Image.
+	*	Process 0 hashes the input and looks it up in the cache before any work is distributed, then broadcasts whether it was found.
+	*	If it was, process 0 gets the edited Image in cached_img and the other processes can skip the edit entirely.
+	*	An input which cannot be hashed is a miss, so the version reports the error itself.
+	*	It returns 1 on a hit, 0 on a miss and -1 on failure.
+	*/
+	
+	int hit = 0;
+	*cached_img = NULL;
+	
+	if(my_rank == 0){
+		int top_down;
+		int check = 0;
+		
+		if(img != NULL){
+			*input_hash = hash_image(img, num_threads);
+			top_down = img->top_down;
+		}
+		else{
+			check = hash_image_file(in_file_name, input_hash, &top_down, num_threads);
+		}
+		
+		if(check == 0){
+			*cached_img = lookup_result_cache(*input_hash, operation, top_down);
+			hit = (*cached_img != NULL);
+		}
+	}
+	
+	if(comm != MPI_COMM_NULL){
+		int check = MPI_Bcast(&hit, 1, MPI_INT, 0, comm);
+		if(check != MPI_SUCCESS){
+			fprintf(stderr, "Rank %d: Error in check_result_cache while broadcasting the result of the lookup\n", my_rank);
+			fflush(stderr);
+			return -1;
+		}
+	}
+	
+	return hit;
+}
\ No newline at end of file
@@ -0,0 +1,26 @@
+#ifndef CACHE
+
+#define CACHE
+
+#include "bmp_common.h"
+#include "convolution.h"
+
+#define RESULT_CACHE 0 // set to 1 to keep the edited images in an on-disk cache, so an image edited again with the same operation is read from it
+#define RESULT_CACHE_DIRECTORY "result_cache" // created on the first store
+#define RESULT_CACHE_MAX_BYTES (4LL * 1024 * 1024 * 1024) // size budget of the cache, the least recently used entries are evicted beyond it
+#define RESULT_CACHE_HASH_ROWS 256 // rows read at once while hashing an input file
+#define RESULT_CACHE_PATH_SIZE 512
+
+/**
+*	An entry is the edited image, saved as RESULT_CACHE_DIRECTORY/<input hash>_<operation>_<top_down>.bmp, where the input hash
+*	is the hash_image hash of the pixels of the input. The same pixels give the same key whether they come from a .bmp file
+*	or a tiled image, and whatever the name of the file. The modification time of an entry is the time it was last used.
+*/
+
+int hash_image_file(const char *file_name, unsigned long long *hash, int *top_down, int num_threads);
+Image *lookup_result_cache(unsigned long long input_hash, operation_t operation, int top_down);
+int evict_result_cache(long long max_bytes);
+int store_result_cache(unsigned long long input_hash, operation_t operation, const Image *edited_img);
+int check_result_cache(const char *in_file_name, const Image *img, operation_t operation, int my_rank, MPI_Comm comm, int num_threads, unsigned long long *input_hash, Image **cached_img);
+
+#endif
\ No newline at end of file
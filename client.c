@@ -0,0 +1,121 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <omp.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <process.h>
+#define sleep_ms(ms) Sleep(ms)
+#define getpid _getpid
+#else
+#include <unistd.h>
+#define sleep_ms(ms) usleep((ms) * 1000)
+#endif
+
+#define CLIENT_POLL_MS 1 // how often the client looks for the result of its job
+#define CLIENT_PATH_SIZE 512
+#define CLIENT_MPIEXEC "mpiexec -n %d feature_testing.exe" // how a fresh run of feature_testing is launched, for the comparison
+
+int submit_job(const char *spool_directory, const char *job_line, double *daemon_time){
+	/**
+	*	Takes in the spool directory of a running daemon, the line describing a job (`VERSION FILE_IN FILE_OUT OPERATION` or `stop`)
+	*	and a place to store the time the daemon took to edit the image.
+	*	It submits the job to the daemon and waits for it to be done.
+	*	It returns 0 if the job succeeded and -1 otherwise.
+	*/
+	
+	static int submitted_jobs = 0;
+	char job_id[64], tmp_file_name[CLIENT_PATH_SIZE], job_file_name[CLIENT_PATH_SIZE], done_file_name[CLIENT_PATH_SIZE];
+	
+	// ids start with the time, so the daemon takes the jobs in the order they were submitted
+	snprintf(job_id, sizeof(job_id), "%010lld_%d_%d", (long long)time(NULL), (int)getpid(), submitted_jobs++);
+	snprintf(tmp_file_name, sizeof(tmp_file_name), "%s/%s.tmp", spool_directory, job_id);
+	snprintf(job_file_name, sizeof(job_file_name), "%s/%s.job", spool_directory, job_id);
+	snprintf(done_file_name, sizeof(done_file_name), "%s/%s.done", spool_directory, job_id);
+	
+	FILE *tmp_file = fopen(tmp_file_name, "w");
+	if(tmp_file == NULL){
+		fprintf(stderr, "Error in submit_job: Could not create file %s\n", tmp_file_name);
+		fflush(stderr);
+		return -1;
+	}
+	fprintf(tmp_file, "%s\n", job_line);
+	fclose(tmp_file);
+	
+	if(rename(tmp_file_name, job_file_name) != 0){
+		fprintf(stderr, "Error in submit_job: Could not rename file %s\n", tmp_file_name);
+		fflush(stderr);
+		return -1;
+	}
+	
+	FILE *done_file;
+	while((done_file = fopen(done_file_name, "r")) == NULL){
+		sleep_ms(CLIENT_POLL_MS);
+	}
+	
+	char result[16] = "";
+	*daemon_time = 0;
+	int fields = fscanf(done_file, "%15s %lf", result, daemon_time);
+	fclose(done_file);
+	remove(done_file_name);
+	
+	return (fields >= 1 && strcmp(result, "OK") == 0) ? 0 : -1;
+}
+
+int main(int argc, char **argv){
+	if(!((argc == 3 && strcmp(argv[2], "stop") == 0) || (argc == 7 && strcmp(argv[2], "submit") == 0) || (argc == 8 && strcmp(argv[2], "compare") == 0))){
+		fprintf(stdout, "Usage: %s [spool_directory] submit [version = {`sft`, `no_sft`, `master`}] [file_in] [file_out] [operation]\n", argv[0]);
+		fprintf(stdout, "       %s [spool_directory] compare [num_processes] [version] [file_in] [file_out] [operation]\n", argv[0]);
+		fprintf(stdout, "       %s [spool_directory] stop\n", argv[0]);
+		fflush(stdout);
+		return -1;
+	}
+	
+	double daemon_time;
+	
+	if(strcmp(argv[2], "stop") == 0){
+		return submit_job(argv[1], "stop", &daemon_time);
+	}
+	
+	int first = (strcmp(argv[2], "submit") == 0) ? 3 : 4; // first argument describing the job
+	char job_line[3 * CLIENT_PATH_SIZE];
+	snprintf(job_line, sizeof(job_line), "%s %s %s %s", argv[first], argv[first + 1], argv[first + 2], argv[first + 3]);
+	
+	double latency = omp_get_wtime();
+	int check = submit_job(argv[1], job_line, &daemon_time);
+	latency = omp_get_wtime() - latency;
+	if(check != 0){
+		fprintf(stdout, "The job FAILED\n");
+		fflush(stdout);
+		return -1;
+	}
+	
+	fprintf(stdout, "Daemon latency: %f (%f editing and saving the image)\n", latency, daemon_time);
+	fflush(stdout);
+	
+	if(first == 4){
+		// the same job, with a fresh mpiexec: the launch, MPI_Init and the cold caches are paid again
+		char command[4 * CLIENT_PATH_SIZE];
+		int length = snprintf(command, sizeof(command), CLIENT_MPIEXEC, atoi(argv[3]));
+		if(strcmp(argv[4], "master") == 0) snprintf(command + length, sizeof(command) - length, " master %s %s %s", argv[5], argv[6], argv[7]);
+		else snprintf(command + length, sizeof(command) - length, " parallel %s %s %s %s", argv[5], argv[6], argv[7], (strcmp(argv[4], "sft") == 0) ? "1" : "0");
+		
+		double mpiexec_latency = omp_get_wtime();
+		check = system(command);
+		mpiexec_latency = omp_get_wtime() - mpiexec_latency;
+		if(check != 0){
+			fprintf(stdout, "The fresh run FAILED\n");
+			fflush(stdout);
+			return -1;
+		}
+		
+		fprintf(stdout, "Daemon latency: %f\n", latency);
+		fprintf(stdout, "Fresh mpiexec latency: %f (includes the verification of feature_testing)\n", mpiexec_latency);
+		fprintf(stdout, "Speedup: %f\n", mpiexec_latency / latency);
+		fflush(stdout);
+	}
+	
+	return 0;
+}
\ No newline at end of file
@@ -1,12 +1,25 @@
 @echo off
 
 gcc -c bmp_common.c -I "c:\Program Files (x86)\Microsoft SDKs\MPI\Include"
-gcc -c bmp.c -I "c:\Program Files (x86)\Microsoft SDKs\MPI\Include"
+gcc -c bmp.c -I "c:\Program Files (x86)\Microsoft SDKs\MPI\Include" -fopenmp
 gcc -c convolution.c -I "c:\Program Files (x86)\Microsoft SDKs\MPI\Include" -fopenmp
+gcc -c tiled.c -I "c:\Program Files (x86)\Microsoft SDKs\MPI\Include"
+gcc -c compression.c -I "c:\Program Files (x86)\Microsoft SDKs\MPI\Include"
+gcc -c verification.c -I "c:\Program Files (x86)\Microsoft SDKs\MPI\Include" -fopenmp
+gcc -c cache.c -I "c:\Program Files (x86)\Microsoft SDKs\MPI\Include"
+gcc -c incremental.c -I "c:\Program Files (x86)\Microsoft SDKs\MPI\Include" -fopenmp
+gcc -c blocks.c -I "c:\Program Files (x86)\Microsoft SDKs\MPI\Include"
+gcc -c master.c -I "c:\Program Files (x86)\Microsoft SDKs\MPI\Include"
+gcc -c master_sft.c -I "c:\Program Files (x86)\Microsoft SDKs\MPI\Include"
+gcc -c shared_memory.c -I "c:\Program Files (x86)\Microsoft SDKs\MPI\Include"
 gcc -c image_processing.c -I "c:\Program Files (x86)\Microsoft SDKs\MPI\Include" -fopenmp
+gcc -c batch.c -I "c:\Program Files (x86)\Microsoft SDKs\MPI\Include"
+gcc -c daemon.c -I "c:\Program Files (x86)\Microsoft SDKs\MPI\Include"
+gcc -c sequence.c -I "c:\Program Files (x86)\Microsoft SDKs\MPI\Include" -fopenmp
 
-gcc -g feature_testing.c -I "c:\Program Files (x86)\Microsoft SDKs\MPI\Include" -L "c:\Program Files (x86)\Microsoft SDKs\MPI\Lib\x64" -o feature_testing.exe bmp_common.o bmp.o convolution.o image_processing.o -lmsmpi -fopenmp
-gcc -g experiments.c -I "c:\Program Files (x86)\Microsoft SDKs\MPI\Include" -L "c:\Program Files (x86)\Microsoft SDKs\MPI\Lib\x64" -o experiments.exe bmp_common.o bmp.o convolution.o image_processing.o -lmsmpi -fopenmp
+gcc -g feature_testing.c -I "c:\Program Files (x86)\Microsoft SDKs\MPI\Include" -L "c:\Program Files (x86)\Microsoft SDKs\MPI\Lib\x64" -o feature_testing.exe bmp_common.o bmp.o tiled.o compression.o verification.o cache.o incremental.o convolution.o blocks.o master.o master_sft.o shared_memory.o image_processing.o batch.o daemon.o sequence.o -lmsmpi -fopenmp
+gcc -g experiments.c -I "c:\Program Files (x86)\Microsoft SDKs\MPI\Include" -L "c:\Program Files (x86)\Microsoft SDKs\MPI\Lib\x64" -o experiments.exe bmp_common.o bmp.o tiled.o compression.o verification.o cache.o incremental.o convolution.o blocks.o master.o master_sft.o shared_memory.o image_processing.o batch.o daemon.o sequence.o -lmsmpi -fopenmp
+gcc -g client.c -o client.exe -fopenmp
 
 
 
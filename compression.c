@@ -0,0 +1,701 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include "compression.h"
+
+#define LZ_MIN_MATCH 4
+#define LZ_MAX_OFFSET 65535
+#define LZ_HASH_BITS 14
+
+#define PACK_RAW 0
+#define PACK_LZ 1
+#define PACK_DELTA_LZ 2
+
+typedef struct{
+	long long messages, compressed_messages;
+	long long raw_bytes, packed_bytes; // sizes of the compressed messages, before and after compression
+	double compress_time;
+}transfer_stats_t;
+
+static transfer_stats_t transfer_stats; // this process's measurements, used to decide when compressing pays off
+
+int lz_compress_bound(int size){
+	/**
+	*	Takes in the size of the data to compress and returns the largest size lz_compress can produce for it.
+	*/
+	
+	return size + size / 255 + 16;
+}
+
+int lz_write_length(unsigned char *dst, int op, int length){
+	/**
+	*	Takes in the output buffer, the position to write at and the part of a length which did not fit in the token
+	*	and writes it as a sequence of bytes which are added together (255 meaning that another byte follows).
+	*	It returns the position after the written bytes.
+	*/
+	
+	while(length >= 255){
+		dst[op++] = 255;
+		length -= 255;
+	}
+	dst[op++] = (unsigned char)length;
+	return op;
+}
+
+int lz_write_sequence(unsigned char *dst, int op, const unsigned char *literals, int literal_length, int offset, int match_length){
+	/**
+	*	Takes in the output buffer, the position to write at, the literals which precede a match,
+	*	the distance to the match and its length (0 for the last sequence, which has no match)
+	*	and writes the sequence: a token holding both lengths in 4 bits each, the rest of the literal length,
+	*	the literals, the offset on 2 bytes and the rest of the match length.
+	*	It returns the position after the written sequence.
+	*/
+	
+	int token_literals = (literal_length < 15) ? literal_length : 15;
+	int token_match = 0;
+	if(match_length != 0) token_match = (match_length - LZ_MIN_MATCH < 15) ? match_length - LZ_MIN_MATCH : 15;
+	
+	dst[op++] = (unsigned char)((token_literals << 4) | token_match);
+	if(token_literals == 15) op = lz_write_length(dst, op, literal_length - 15);
+	
+	memcpy(dst + op, literals, literal_length);
+	op += literal_length;
+	
+	if(match_length == 0) return op;
+	
+	dst[op++] = (unsigned char)(offset & 255);
+	dst[op++] = (unsigned char)(offset >> 8);
+	if(token_match == 15) op = lz_write_length(dst, op, match_length - LZ_MIN_MATCH - 15);
+	return op;
+}
+
+int lz_compress(const unsigned char *src, int size, unsigned char *dst){
+	/**
+	*	Takes in the data to compress, its size and a buffer with room for lz_compress_bound(size) bytes
+	*	and compresses the data into it as a list of sequences (literals followed by a match with earlier data),
+	*	finding matches of at least 4 bytes through a hash table of the last position of every 4-byte value.
+	*	It returns the size of the compressed data.
+	*/
+	
+	int table[1 << LZ_HASH_BITS];
+	for(int i = 0; i < (1 << LZ_HASH_BITS); ++i){
+		table[i] = -1;
+	}
+	
+	int ip = 0, anchor = 0, op = 0;
+	
+	while(ip + LZ_MIN_MATCH <= size){
+		unsigned int sequence, candidate;
+		memcpy(&sequence, src + ip, LZ_MIN_MATCH);
+		unsigned int hash = (sequence * 2654435761u) >> (32 - LZ_HASH_BITS);
+		int ref = table[hash];
+		table[hash] = ip;
+		
+		int found = 0;
+		if(ref >= 0 && ip - ref <= LZ_MAX_OFFSET){
+			memcpy(&candidate, src + ref, LZ_MIN_MATCH);
+			found = (candidate == sequence);
+		}
+		
+		if(!found){
+			ip += 1 + ((ip - anchor) >> 6); // moving faster through data which does not compress
+			continue;
+		}
+		
+		int match_length = LZ_MIN_MATCH;
+		while(ip + match_length < size && src[ref + match_length] == src[ip + match_length]){
+			++match_length;
+		}
+		
+		op = lz_write_sequence(dst, op, src + anchor, ip - anchor, ip - ref, match_length);
+		ip += match_length;
+		anchor = ip;
+	}
+	
+	return lz_write_sequence(dst, op, src + anchor, size - anchor, 0, 0);
+}
+
+int lz_decompress(const unsigned char *src, int src_size, unsigned char *dst, int dst_size){
+	/**
+	*	Takes in data compressed by lz_compress, its size, a buffer and the size of the original data
+	*	and decompresses the data into the buffer.
+	*	It returns 0 on success and -1 if the compressed data is corrupted.
+	*/
+	
+	int ip = 0, op = 0;
+	
+	while(ip < src_size){
+		int token = src[ip++];
+		int byte;
+		
+		int literal_length = token >> 4;
+		if(literal_length == 15){
+			do{
+				if(ip >= src_size) return -1;
+				byte = src[ip++];
+				literal_length += byte;
+			}while(byte == 255);
+		}
+		
+		if(literal_length > src_size - ip || literal_length > dst_size - op) return -1;
+		memcpy(dst + op, src + ip, literal_length);
+		ip += literal_length;
+		op += literal_length;
+		
+		if(ip == src_size) break; // the last sequence has no match
+		
+		if(ip + 2 > src_size) return -1;
+		int offset = src[ip] | (src[ip + 1] << 8);
+		ip += 2;
+		
+		int match_length = token & 15;
+		if(match_length == 15){
+			do{
+				if(ip >= src_size) return -1;
+				byte = src[ip++];
+				match_length += byte;
+			}while(byte == 255);
+		}
+		match_length += LZ_MIN_MATCH;
+		
+		if(offset == 0 || offset > op || match_length > dst_size - op) return -1;
+		
+		// a match closer than its length repeats the bytes it is copying, so it is copied byte by byte
+		const unsigned char *match = dst + op - offset;
+		if(offset >= match_length){
+			memcpy(dst + op, match, match_length);
+		}
+		else{
+			for(int i = 0; i < match_length; ++i){
+				dst[op + i] = match[i];
+			}
+		}
+		op += match_length;
+	}
+	
+	return (op == dst_size) ? 0 : -1;
+}
+
+void delta_encode_rows(unsigned char *data, int rows, int row_size, int channels){
+	/**
+	*	Takes in rows of pixels, the number of rows, the size of a row and the number of channels
+	*	and replaces, in place, every byte with its difference from the same channel of the previous pixel in the row.
+	*	Smooth images (blurred ones especially) turn into long runs of small values, which compress much better.
+	*/
+	
+	for(int y = 0; y < rows; ++y){
+		unsigned char *row = data + (size_t)y * row_size;
+		for(int x = row_size - 1; x >= channels; --x){
+			row[x] -= row[x - channels];
+		}
+	}
+}
+
+void delta_decode_rows(unsigned char *data, int rows, int row_size, int channels){
+	/**
+	*	Takes in rows encoded by delta_encode_rows, the number of rows, the size of a row and the number of channels
+	*	and restores, in place, the original pixels.
+	*/
+	
+	for(int y = 0; y < rows; ++y){
+		unsigned char *row = data + (size_t)y * row_size;
+		for(int x = channels; x < row_size; ++x){
+			row[x] += row[x - channels];
+		}
+	}
+}
+
+int compression_pays_off(){
+	/**
+	*	It returns 1 if the next message should be compressed, according to TRANSFER_COMPRESSION and,
+	*	in automatic mode, to the ratio and throughput measured on this process's previous compressed messages:
+	*	per byte, sending raw takes 1 / bandwidth, while compressing and sending takes 1 / throughput + 1 / (ratio * bandwidth).
+	*	Every TRANSFER_PROBE_INTERVAL-th message is compressed anyway, so the measurements follow the data.
+	*/
+	
+	if(TRANSFER_COMPRESSION == 1) return 1;
+	if(transfer_stats.compressed_messages == 0 || transfer_stats.messages % TRANSFER_PROBE_INTERVAL == 0) return 1;
+	if(transfer_stats.packed_bytes == 0 || transfer_stats.compress_time <= 0) return 1;
+	
+	double ratio = (double)transfer_stats.raw_bytes / transfer_stats.packed_bytes;
+	double throughput = transfer_stats.raw_bytes / transfer_stats.compress_time / 1e6;
+	
+	return 1.0 / throughput + 1.0 / (ratio * TRANSFER_NETWORK_MBPS) < 1.0 / TRANSFER_NETWORK_MBPS;
+}
+
+unsigned char *pack_pixels(const unsigned char *data, int pixels, int width, int channels, int *packed_size){
+	/**
+	*	Takes in pixels to send, how many there are, the width of the Image they belong to and its number of channels
+	*	and returns a newly allocated message holding them, setting packed_size to its size.
+	*	The pixels are compressed (after the row delta prediction if TRANSFER_DELTA is 1) when compression_pays_off says so
+	*	and the result is smaller, otherwise they are copied as they are.
+	*/
+	
+	int raw_size = pixels * channels;
+	int payload_size = raw_size;
+	int method = PACK_RAW;
+	
+	unsigned char *packed = (unsigned char*)malloc(PACK_HEADER_SIZE + (size_t)lz_compress_bound(raw_size));
+	if(packed == NULL){
+		fprintf(stderr, "Error in pack_pixels while allocating memory\n");
+		fflush(stderr);
+		return NULL;
+	}
+	
+	if(compression_pays_off()){
+		double start_time = MPI_Wtime();
+		const unsigned char *input = data;
+		unsigned char *delta = NULL;
+		
+		// the prediction works on whole rows, which is what every message holds
+		if(TRANSFER_DELTA && width > 0 && pixels % width == 0){
+			delta = (unsigned char*)malloc(raw_size);
+			if(delta != NULL){
+				memcpy(delta, data, raw_size);
+				delta_encode_rows(delta, pixels / width, width * channels, channels);
+				input = delta;
+			}
+		}
+		
+		payload_size = lz_compress(input, raw_size, packed + PACK_HEADER_SIZE);
+		method = (delta != NULL) ? PACK_DELTA_LZ : PACK_LZ;
+		free(delta);
+		
+		double compress_time = MPI_Wtime() - start_time;
+		++transfer_stats.compressed_messages;
+		transfer_stats.raw_bytes += raw_size;
+		transfer_stats.packed_bytes += payload_size;
+		transfer_stats.compress_time += compress_time;
+		
+		if(payload_size >= raw_size){
+			method = PACK_RAW;
+		}
+		
+		if(TRANSFER_PRINT_REPORT){
+			int my_rank;
+			MPI_Comm_rank(MPI_COMM_WORLD, &my_rank);
+			fprintf(stdout, "Rank %d: message of %d bytes compressed to %d bytes (ratio %.2f) at %.1f MB/s, sent %s\n", my_rank,
+				raw_size, payload_size, (payload_size > 0) ? (double)raw_size / payload_size : 0.0,
+				(compress_time > 0) ? raw_size / compress_time / 1e6 : 0.0, (method == PACK_RAW) ? "raw" : "compressed");
+			fflush(stdout);
+		}
+	}
+	
+	if(method == PACK_RAW){
+		memcpy(packed + PACK_HEADER_SIZE, data, raw_size);
+		payload_size = raw_size;
+	}
+	++transfer_stats.messages;
+	
+	memcpy(packed, &raw_size, sizeof(int));
+	memcpy(packed + sizeof(int), &method, sizeof(int));
+	*packed_size = PACK_HEADER_SIZE + payload_size;
+	return packed;
+}
+
+int unpack_pixels(const unsigned char *packed, int packed_size, unsigned char *data, int pixels, int width, int channels){
+	/**
+	*	Takes in a message made by pack_pixels, its size, a pixel buffer, the number of pixels the message holds,
+	*	the width of the Image they belong to and its number of channels and stores the pixels in the buffer.
+	*	It returns 0 on success and -1 if the message is corrupted.
+	*/
+	
+	int raw_size = pixels * channels;
+	int header_raw_size, method;
+	
+	if(packed_size < PACK_HEADER_SIZE){
+		fprintf(stderr, "Error in unpack_pixels: Corrupted message\n");
+		fflush(stderr);
+		return -1;
+	}
+	
+	memcpy(&header_raw_size, packed, sizeof(int));
+	memcpy(&method, packed + sizeof(int), sizeof(int));
+	const unsigned char *payload = packed + PACK_HEADER_SIZE;
+	int payload_size = packed_size - PACK_HEADER_SIZE;
+	
+	int check = -1;
+	if(header_raw_size == raw_size){
+		if(method == PACK_RAW && payload_size == raw_size){
+			memcpy(data, payload, raw_size);
+			check = 0;
+		}
+		else if(method == PACK_LZ || method == PACK_DELTA_LZ){
+			check = lz_decompress(payload, payload_size, data, raw_size);
+			if(check == 0 && method == PACK_DELTA_LZ){
+				delta_decode_rows(data, pixels / width, width * channels, channels);
+			}
+		}
+	}
+	
+	if(check != 0){
+		fprintf(stderr, "Error in unpack_pixels: Corrupted message\n");
+		fflush(stderr);
+		return -1;
+	}
+	return 0;
+}
+
+int send_pixels(const unsigned char *data, int pixels, int width, int channels, int destination, int tag, MPI_Comm comm){
+	/**
+	*	Takes in pixels to send, how many there are, the width of the Image they belong to, its number of channels,
+	*	the rank to send them to, the tag of the message and the communicator.
+	*	The pixels are sent as they are if TRANSFER_COMPRESSION is 0 and packed by pack_pixels otherwise.
+	*	It returns 0 on success and -1 on failure.
+	*/
+	
+	int check;
+	
+	if(TRANSFER_COMPRESSION == 0){
+		check = MPI_Send(data, pixels * channels, MPI_UNSIGNED_CHAR, destination, tag, comm);
+		return (check == MPI_SUCCESS) ? 0 : -1;
+	}
+	
+	int packed_size;
+	unsigned char *packed = pack_pixels(data, pixels, width, channels, &packed_size);
+	if(packed == NULL){ // error message was printed by the called function
+		return -1;
+	}
+	
+	check = MPI_Send(packed, packed_size, MPI_UNSIGNED_CHAR, destination, tag, comm);
+	free(packed);
+	return (check == MPI_SUCCESS) ? 0 : -1;
+}
+
+int recv_pixels(unsigned char *data, int pixels, int width, int channels, int source, int tag, MPI_Comm comm){
+	/**
+	*	Takes in a pixel buffer, the number of pixels to receive, the width of the Image they belong to, its number of channels,
+	*	the rank to receive them from, the tag of the message and the communicator
+	*	and receives pixels sent by send_pixels into the buffer.
+	*	It returns 0 on success and -1 on failure.
+	*/
+	
+	int check;
+	
+	if(TRANSFER_COMPRESSION == 0){
+		check = MPI_Recv(data, pixels * channels, MPI_UNSIGNED_CHAR, source, tag, comm, MPI_STATUS_IGNORE);
+		return (check == MPI_SUCCESS) ? 0 : -1;
+	}
+	
+	// the size of a packed message is only known once it arrives
+	MPI_Status status;
+	int packed_size;
+	
+	check = MPI_Probe(source, tag, comm, &status);
+	if(check != MPI_SUCCESS){
+		return -1;
+	}
+	MPI_Get_count(&status, MPI_UNSIGNED_CHAR, &packed_size);
+	
+	unsigned char *packed = (unsigned char*)malloc(packed_size);
+	if(packed == NULL){
+		fprintf(stderr, "Error in recv_pixels while allocating memory\n");
+		fflush(stderr);
+		return -1;
+	}
+	
+	check = MPI_Recv(packed, packed_size, MPI_UNSIGNED_CHAR, status.MPI_SOURCE, status.MPI_TAG, comm, MPI_STATUS_IGNORE);
+	if(check != MPI_SUCCESS){
+		free(packed);
+		return -1;
+	}
+	
+	check = unpack_pixels(packed, packed_size, data, pixels, width, channels);
+	free(packed);
+	return check;
+}
+
+int isend_pixels(const unsigned char *data, int pixels, int width, int channels, int destination, int tag, MPI_Comm comm, MPI_Request *request, unsigned char **packed){
+	/**
+	*	Takes in the arguments of send_pixels, a place to store the request of the send and a place to store the packed message.
+	*	It is send_pixels with MPI_Isend: data (if TRANSFER_COMPRESSION is 0) or the packed message (set in packed, NULL otherwise)
+	*	has to stay allocated until the request completes, and the packed message has to be freed after that.
+	*	It returns 0 on success and -1 on failure.
+	*/
+	
+	int check;
+	*packed = NULL;
+	
+	if(TRANSFER_COMPRESSION == 0){
+		check = MPI_Isend(data, pixels * channels, MPI_UNSIGNED_CHAR, destination, tag, comm, request);
+		return (check == MPI_SUCCESS) ? 0 : -1;
+	}
+	
+	int packed_size;
+	*packed = pack_pixels(data, pixels, width, channels, &packed_size);
+	if(*packed == NULL){ // error message was printed by the called function
+		return -1;
+	}
+	
+	check = MPI_Isend(*packed, packed_size, MPI_UNSIGNED_CHAR, destination, tag, comm, request);
+	return (check == MPI_SUCCESS) ? 0 : -1;
+}
+
+int irecv_pixels(unsigned char *data, int pixels, int channels, int source, int tag, MPI_Comm comm, MPI_Request *request, unsigned char **packed){
+	/**
+	*	Takes in the arguments of recv_pixels (but the width), a place to store the request of the receive and a place to store the packed message.
+	*	It is recv_pixels with MPI_Irecv: if TRANSFER_COMPRESSION is 0, the pixels arrive straight in data and packed is set to NULL,
+	*	otherwise they arrive in packed, in a buffer large enough for any message of pack_pixels, and finish_irecv_pixels unpacks them.
+	*	It returns 0 on success and -1 on failure.
+	*/
+	
+	int check;
+	*packed = NULL;
+	
+	if(TRANSFER_COMPRESSION == 0){
+		check = MPI_Irecv(data, pixels * channels, MPI_UNSIGNED_CHAR, source, tag, comm, request);
+		return (check == MPI_SUCCESS) ? 0 : -1;
+	}
+	
+	// pack_pixels never sends more than the header and the raw pixels
+	*packed = (unsigned char*)malloc(PACK_HEADER_SIZE + (size_t)pixels * channels);
+	if(*packed == NULL){
+		fprintf(stderr, "Error in irecv_pixels while allocating memory\n");
+		fflush(stderr);
+		return -1;
+	}
+	
+	check = MPI_Irecv(*packed, PACK_HEADER_SIZE + pixels * channels, MPI_UNSIGNED_CHAR, source, tag, comm, request);
+	return (check == MPI_SUCCESS) ? 0 : -1;
+}
+
+int finish_irecv_pixels(unsigned char *packed, MPI_Status *status, unsigned char *data, int pixels, int width, int channels){
+	/**
+	*	Takes in the packed message set by irecv_pixels, the status of its completed receive, the pixel buffer,
+	*	the number of pixels, the width of the Image they belong to and its number of channels.
+	*	It unpacks the pixels into data (if they were packed) and frees the packed message.
+	*	It returns 0 on success and -1 on failure.
+	*/
+	
+	if(packed == NULL){
+		return 0;
+	}
+	
+	int packed_size;
+	MPI_Get_count(status, MPI_UNSIGNED_CHAR, &packed_size);
+	
+	int check = unpack_pixels(packed, packed_size, data, pixels, width, channels);
+	free(packed);
+	return check;
+}
+
+int gatherv_pixels(const unsigned char *send_data, int send_count, unsigned char *recv_data, const int *recv_counts, const int *displacements, MPI_Datatype mpi_pixel, int width, int channels, int root, MPI_Comm comm){
+	/**
+	*	Takes in the arguments of MPI_Gatherv (counts and displacements in pixels of type mpi_pixel),
+	*	together with the width and number of channels of the Image the pixels belong to.
+	*	If TRANSFER_COMPRESSION is 0 it is MPI_Gatherv, otherwise every process packs its pixels,
+	*	the root gathers the packed sizes and then the packed messages, and unpacks each of them in place.
+	*	It returns 0 on success and -1 on failure.
+	*/
+	
+	int my_rank, num_processes, check;
+	MPI_Comm_rank(comm, &my_rank);
+	MPI_Comm_size(comm, &num_processes);
+	
+	if(TRANSFER_COMPRESSION == 0){
+		check = MPI_Gatherv(send_data, send_count, mpi_pixel, recv_data, recv_counts, displacements, mpi_pixel, root, comm);
+		return (check == MPI_SUCCESS) ? 0 : -1;
+	}
+	
+	int packed_size;
+	unsigned char *packed = pack_pixels(send_data, send_count, width, channels, &packed_size);
+	if(packed == NULL){ // error message was printed by the called function
+		return -1;
+	}
+	
+	int *packed_sizes = NULL;
+	int *packed_displacements = NULL;
+	unsigned char *all_packed = NULL;
+	
+	if(my_rank == root){
+		packed_sizes = (int*)malloc(num_processes * sizeof(int));
+		packed_displacements = (int*)malloc(num_processes * sizeof(int));
+		if(packed_sizes == NULL || packed_displacements == NULL){
+			fprintf(stderr, "Rank %d: Error in gatherv_pixels while allocating memory\n", my_rank);
+			fflush(stderr);
+			free(packed);
+			free(packed_sizes);
+			free(packed_displacements);
+			return -1;
+		}
+	}
+	
+	check = MPI_Gather(&packed_size, 1, MPI_INT, packed_sizes, 1, MPI_INT, root, comm);
+	if(check != MPI_SUCCESS){
+		fprintf(stderr, "Rank %d: Error in gatherv_pixels while comunicating sizes\n", my_rank);
+		fflush(stderr);
+		free(packed);
+		free(packed_sizes);
+		free(packed_displacements);
+		return -1;
+	}
+	
+	if(my_rank == root){
+		long long total_size = 0;
+		for(int i = 0; i < num_processes; ++i){
+			packed_displacements[i] = (int)total_size;
+			total_size += packed_sizes[i];
+		}
+		
+		all_packed = (total_size <= INT_MAX) ? (unsigned char*)malloc(total_size) : NULL;
+		if(all_packed == NULL){
+			fprintf(stderr, "Rank %d: Error in gatherv_pixels while allocating memory\n", my_rank);
+			fflush(stderr);
+			free(packed);
+			free(packed_sizes);
+			free(packed_displacements);
+			return -1;
+		}
+	}
+	
+	check = MPI_Gatherv(packed, packed_size, MPI_UNSIGNED_CHAR, all_packed, packed_sizes, packed_displacements, MPI_UNSIGNED_CHAR, root, comm);
+	free(packed);
+	if(check != MPI_SUCCESS){
+		fprintf(stderr, "Rank %d: Error in gatherv_pixels while comunicating data\n", my_rank);
+		fflush(stderr);
+		free(packed_sizes);
+		free(packed_displacements);
+		free(all_packed);
+		return -1;
+	}
+	
+	if(my_rank == root){
+		for(int i = 0; i < num_processes && check == 0; ++i){
+			check = unpack_pixels(all_packed + packed_displacements[i], packed_sizes[i], recv_data + (size_t)displacements[i] * channels, recv_counts[i], width, channels);
+		}
+	}
+	
+	free(packed_sizes);
+	free(packed_displacements);
+	free(all_packed);
+	return (check == 0) ? 0 : -1;
+}
+
+int scatterv_pixels(const unsigned char *send_data, const int *send_counts, const int *displacements, unsigned char *recv_data, int recv_count, MPI_Datatype mpi_pixel, int width, int channels, int root, MPI_Comm comm){
+	/**
+	*	Takes in the arguments of MPI_Scatterv (counts and displacements in pixels of type mpi_pixel),
+	*	together with the width and number of channels of the Image the pixels belong to.
+	*	If TRANSFER_COMPRESSION is 0 it is MPI_Scatterv, otherwise the root packs the pixels of every process,
+	*	scatters the packed sizes and then the packed messages, which every process unpacks into recv_data.
+	*	It returns 0 on success and -1 on failure.
+	*/
+	
+	int my_rank, num_processes, check;
+	MPI_Comm_rank(comm, &my_rank);
+	MPI_Comm_size(comm, &num_processes);
+	
+	if(TRANSFER_COMPRESSION == 0){
+		check = MPI_Scatterv(send_data, send_counts, displacements, mpi_pixel, recv_data, recv_count, mpi_pixel, root, comm);
+		return (check == MPI_SUCCESS) ? 0 : -1;
+	}
+	
+	int *packed_sizes = NULL;
+	int *packed_displacements = NULL;
+	unsigned char *all_packed = NULL;
+	int packed_size;
+	
+	if(my_rank == root){
+		packed_sizes = (int*)malloc(num_processes * sizeof(int));
+		packed_displacements = (int*)malloc(num_processes * sizeof(int));
+		unsigned char **parts = (unsigned char**)calloc(num_processes, sizeof(unsigned char*));
+		if(packed_sizes == NULL || packed_displacements == NULL || parts == NULL){
+			fprintf(stderr, "Rank %d: Error in scatterv_pixels while allocating memory\n", my_rank);
+			fflush(stderr);
+			free(packed_sizes);
+			free(packed_displacements);
+			free(parts);
+			return -1;
+		}
+		
+		long long total_size = 0;
+		check = 0;
+		for(int i = 0; i < num_processes; ++i){
+			parts[i] = pack_pixels(send_data + (size_t)displacements[i] * channels, send_counts[i], width, channels, &packed_sizes[i]);
+			if(parts[i] == NULL){ // error message was printed by the called function
+				check = -1;
+				break;
+			}
+			packed_displacements[i] = (int)total_size;
+			total_size += packed_sizes[i];
+		}
+		
+		if(check == 0){
+			all_packed = (total_size <= INT_MAX) ? (unsigned char*)malloc(total_size) : NULL;
+			if(all_packed == NULL){
+				fprintf(stderr, "Rank %d: Error in scatterv_pixels while allocating memory\n", my_rank);
+				fflush(stderr);
+				check = -1;
+			}
+			else{
+				for(int i = 0; i < num_processes; ++i){
+					memcpy(all_packed + packed_displacements[i], parts[i], packed_sizes[i]);
+				}
+			}
+		}
+		
+		for(int i = 0; i < num_processes; ++i){
+			free(parts[i]);
+		}
+		free(parts);
+		
+		if(check != 0){
+			free(packed_sizes);
+			free(packed_displacements);
+			return -1;
+		}
+	}
+	
+	check = MPI_Scatter(packed_sizes, 1, MPI_INT, &packed_size, 1, MPI_INT, root, comm);
+	if(check != MPI_SUCCESS){
+		fprintf(stderr, "Rank %d: Error in scatterv_pixels while comunicating sizes\n", my_rank);
+		fflush(stderr);
+		free(packed_sizes);
+		free(packed_displacements);
+		free(all_packed);
+		return -1;
+	}
+	
+	unsigned char *packed = (unsigned char*)malloc(packed_size);
+	if(packed == NULL){
+		fprintf(stderr, "Rank %d: Error in scatterv_pixels while allocating memory\n", my_rank);
+		fflush(stderr);
+		free(packed_sizes);
+		free(packed_displacements);
+		free(all_packed);
+		return -1;
+	}
+	
+	check = MPI_Scatterv(all_packed, packed_sizes, packed_displacements, MPI_UNSIGNED_CHAR, packed, packed_size, MPI_UNSIGNED_CHAR, root, comm);
+	free(packed_sizes);
+	free(packed_displacements);
+	free(all_packed);
+	if(check != MPI_SUCCESS){
+		fprintf(stderr, "Rank %d: Error in scatterv_pixels while comunicating data\n", my_rank);
+		fflush(stderr);
+		free(packed);
+		return -1;
+	}
+	
+	check = unpack_pixels(packed, packed_size, recv_data, recv_count, width, channels);
+	free(packed);
+	return check;
+}
+
+void print_transfer_report(int my_rank){
+	/**
+	*	Takes in this process's rank and prints how many of its messages were compressed,
+	*	the overall compression ratio and throughput and whether, with them, compressing pays off on this network.
+	*/
+	
+	if(transfer_stats.messages == 0) return;
+	
+	double ratio = (transfer_stats.packed_bytes > 0) ? (double)transfer_stats.raw_bytes / transfer_stats.packed_bytes : 0.0;
+	double throughput = (transfer_stats.compress_time > 0) ? transfer_stats.raw_bytes / transfer_stats.compress_time / 1e6 : 0.0;
+	int pays_off = (ratio > 0 && throughput > 0) && (1.0 / throughput + 1.0 / (ratio * TRANSFER_NETWORK_MBPS) < 1.0 / TRANSFER_NETWORK_MBPS);
+	
+	fprintf(stdout, "Rank %d: %lld messages, %lld compressed, ratio %.2f, %.1f MB/s, compression %s at %.0f MB/s\n", my_rank,
+		transfer_stats.messages, transfer_stats.compressed_messages, ratio, throughput,
+		pays_off ? "pays off" : "does not pay off", TRANSFER_NETWORK_MBPS);
+	fflush(stdout);
+}
\ No newline at end of file
@@ -0,0 +1,30 @@
+#ifndef COMPRESSION
+
+#define COMPRESSION
+
+#include "mpi.h"
+
+#define TRANSFER_COMPRESSION 0 // 0 = pixels are sent as they are, 1 = always compressed, 2 = compressed while the measurements say it pays off
+#define TRANSFER_DELTA 1 // set to 1 to predict each byte from the same channel of the previous pixel of the row before compressing
+#define TRANSFER_NETWORK_MBPS 1250.0 // bandwidth of the network in MB/s (10GbE), used to decide if compressing pays off
+#define TRANSFER_PROBE_INTERVAL 16 // when compression does not pay off, every TRANSFER_PROBE_INTERVAL-th message is still compressed to measure again
+#define TRANSFER_PRINT_REPORT 0 // set to 1 to print the size, ratio and throughput of every compressed message
+#define PACK_HEADER_SIZE 8 // a packed message starts with the size of the pixels and the method used to pack them
+
+int lz_compress_bound(int size);
+int lz_compress(const unsigned char *src, int size, unsigned char *dst);
+int lz_decompress(const unsigned char *src, int src_size, unsigned char *dst, int dst_size);
+void delta_encode_rows(unsigned char *data, int rows, int row_size, int channels);
+void delta_decode_rows(unsigned char *data, int rows, int row_size, int channels);
+unsigned char *pack_pixels(const unsigned char *data, int pixels, int width, int channels, int *packed_size);
+int unpack_pixels(const unsigned char *packed, int packed_size, unsigned char *data, int pixels, int width, int channels);
+int send_pixels(const unsigned char *data, int pixels, int width, int channels, int destination, int tag, MPI_Comm comm);
+int recv_pixels(unsigned char *data, int pixels, int width, int channels, int source, int tag, MPI_Comm comm);
+int isend_pixels(const unsigned char *data, int pixels, int width, int channels, int destination, int tag, MPI_Comm comm, MPI_Request *request, unsigned char **packed);
+int irecv_pixels(unsigned char *data, int pixels, int channels, int source, int tag, MPI_Comm comm, MPI_Request *request, unsigned char **packed);
+int finish_irecv_pixels(unsigned char *packed, MPI_Status *status, unsigned char *data, int pixels, int width, int channels);
+int gatherv_pixels(const unsigned char *send_data, int send_count, unsigned char *recv_data, const int *recv_counts, const int *displacements, MPI_Datatype mpi_pixel, int width, int channels, int root, MPI_Comm comm);
+int scatterv_pixels(const unsigned char *send_data, const int *send_counts, const int *displacements, unsigned char *recv_data, int recv_count, MPI_Datatype mpi_pixel, int width, int channels, int root, MPI_Comm comm);
+void print_transfer_report(int my_rank);
+
+#endif
\ No newline at end of file
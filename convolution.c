@@ -74,7 +74,7 @@ double* generate_kernel(const operation_t operation, int *size){
 		fflush(stderr);
 		return NULL;
 	}
-			
+	
 	switch(operation){
 		case RIDGE:{
 			kernel[0] = 0;
@@ -200,6 +200,41 @@ double* generate_kernel(const operation_t operation, int *size){
 	}
 }
 
+void convolve_pixel(const unsigned char *old_data, unsigned char *result, int i, int j, int height, int width, int channels, int top_down, const double *kernel, int kernel_size){
+	/**
+	*	Takes in the pixels of an Image, a buffer for the result, the row and column of the pixel to edit,
+	*	the height, width, number of channels and top_down of the Image and the kernel with its size.
+	*	It applies the kernel to the pixel, treating the pixels outside the Image as 0,
+	*	and stores the result in result. Only the channels the Image actually has are processed.
+	*	The rows of the kernel are always added from the top of the image to the bottom (for a bottom-up Image,
+	*	the row above a pixel is the next row in memory), so the rounding of the sums does not depend on the orientation of the file.
+	*/
+	
+	double sums[4] = {0, 0, 0, 0};
+	
+	for(int k = -kernel_size / 2; k <= kernel_size / 2; ++k){
+		int m = top_down ? k : -k; // the row of the kernel k rows below the center is m rows after it in memory
+		for(int n = -kernel_size / 2; n <= kernel_size / 2; ++n){
+			if(((i + m) >= 0) && ((i + m) < height) && ((j + n) >= 0) && ((j + n) < width)){
+				// if the pixel coresponding to kernel[k][n] is not outside the image
+				double weight = kernel[(k + kernel_size / 2) * kernel_size + (n + kernel_size / 2)];
+				const unsigned char *pixel = old_data + ((size_t)(i + m) * width + (j + n)) * channels;
+				for(int c = 0; c < channels; ++c){
+					sums[c] += pixel[c] * weight;
+				}
+			}
+		}
+	}
+	
+	for(int c = 0; c < channels; ++c){
+		// keeping the results from overflowing when casting to unsigned char
+		if(sums[c] < 0) sums[c] = 0;
+		else if(sums[c] > 255) sums[c] = 255;
+		
+		result[c] = sums[c];
+	}
+}
+
 Image* perform_convolution_serial(const Image *img, const operation_t operation){
 	/**
 	*	Takes in an Image and an operation_t and applies the
@@ -215,61 +250,62 @@ Image* perform_convolution_serial(const Image *img, const operation_t operation)
 		return NULL;
 	}
 	
-	RGB *new_data = (RGB*)malloc(img->height * img->width * sizeof(RGB));
+	unsigned char *new_data = (unsigned char*)malloc((size_t)img->height * img->width * img->channels);
 	if(new_data == NULL){
 		fprintf(stderr, "Error in perform_convolution_serial while allocating memory\n");
 		fflush(stderr);
 		return NULL;
 	}
 	
-	RGB *old_data = img->data;
+	unsigned char *old_data = img->data;
 	int height = img->height;
 	int width = img->width;
+	int channels = img->channels;
 	int kernel_size;
 	double *kernel = generate_kernel(operation, &kernel_size);
 	if(kernel == NULL) return NULL; // error message was printed by the called function
 	
 	for(int i = 0; i < height; ++i){
 		for(int j = 0; j < width; ++j){
-			double r = 0, g = 0, b = 0;
-			for(int m = -kernel_size / 2; m <= kernel_size / 2; ++m){
-				for(int n = -kernel_size / 2; n <= kernel_size / 2; ++n){
-					if(i + m >= 0 && i + m < height && j + n >= 0 && j + n < width){
-						// if the pixel coresponding to kernel[m][n] is not outside the image
-						double weight = kernel[(m + kernel_size / 2) * kernel_size + (n + kernel_size / 2)];
-						RGB pixel = old_data[(i + m) * width + (j + n)];
-						r += pixel.r * weight;
-						g += pixel.g * weight;
-						b += pixel.b * weight;
-					}
-				}
-			}
-			
-			// keeping the results from overflowing when casting to unsigned char
-			if(r < 0) r = 0;
-			else if(r > 255) r = 255;
-			
-			if(g < 0) g = 0;
-			else if(g > 255) g = 255;
-			
-			if(b < 0) b = 0;
-			else if(b > 255) b = 255;
-			
-			RGB result;
-			result.r = r;
-			result.g = g;
-			result.b = b;
-			copy_RGB(&result, &new_data[i * width + j]);
+			convolve_pixel(old_data, new_data + ((size_t)i * width + j) * channels, i, j, height, width, channels, img->top_down, kernel, kernel_size);
 		}
 	}
 	
 	new_img->height = height;
 	new_img->width = width;
+	new_img->channels = channels;
+	new_img->top_down = img->top_down;
 	new_img->data = new_data;
 	free(kernel);
 	return new_img;
 }
 
+int perform_convolution_into(const Image *img, const operation_t operation, const int true_start, const int true_end, const int threads, unsigned char *new_data){
+	/**
+	*	Takes in the same arguments as perform_convolution_parallel and a buffer of (true_end - true_start + 1) rows
+	*	and writes the edited rows [true_start, true_end] of the Image into the buffer, which can be a row of a larger Image.
+	*	It returns 0 on success and -1 on failure.
+	*/
+	
+	unsigned char *old_data = img->data;
+	int height = img->height;
+	int width = img->width;
+	int channels = img->channels;
+	int kernel_size;
+	double *kernel = generate_kernel(operation, &kernel_size);
+	if(kernel == NULL) return -1; // error message was printed by the called function
+	
+	#pragma omp parallel for num_threads(threads) shared(new_data, old_data, height, width, channels, true_start, true_end, kernel_size)
+	for(int i = true_start; i <= true_end; ++i){
+		for(int j = 0; j < width; ++j){
+			convolve_pixel(old_data, new_data + ((size_t)(i - true_start) * width + j) * channels, i, j, height, width, channels, img->top_down, kernel, kernel_size);
+		}
+	}
+	
+	free(kernel);
+	return 0;
+}
+
 Image* perform_convolution_parallel(const Image *img, const operation_t operation, const int true_start, const int true_end, const int threads){
 	/**
 	*	Takes in an Image and an operation_t and applies the
@@ -294,58 +330,23 @@ Image* perform_convolution_parallel(const Image *img, const operation_t operatio
 	
 	// convolution removes the halos
 	int new_height = true_end - true_start + 1;
-	RGB *new_data = (RGB*)malloc(new_height * img->width * sizeof(RGB));
+	unsigned char *new_data = (unsigned char*)malloc((size_t)new_height * img->width * img->channels);
 	if(new_data == NULL){
 		fprintf(stderr, "Error in perform_convolution_parallel while allocating memory\n");
 		fflush(stderr);
 		return NULL;
 	}
 	
-	RGB *old_data = img->data;
-	int height = img->height;
-	int width = img->width;
-	int kernel_size;
-	double *kernel = generate_kernel(operation, &kernel_size);
-	if(kernel == NULL) return NULL; // error message was printed by the called function
-	
-	#pragma omp parallel for num_threads(threads) shared(new_data, old_data, height, width, true_start, true_end, kernel_size)
-	for(int i = true_start; i <= true_end; ++i){
-		for(int j = 0; j < width; ++j){
-			double r = 0, g = 0, b = 0;
-			for(int m = -kernel_size / 2; m <= kernel_size / 2; ++m){
-				for(int n = -kernel_size / 2; n <= kernel_size / 2; ++n){
-					if(((i + m) >= 0) && ((i + m) < height) && ((j + n) >= 0) && ((j + n) < width)){
-						// if the pixel coresponding to kernel[m][n] is not outside the image
-						double weight = kernel[(m + kernel_size / 2) * kernel_size + (n + kernel_size / 2)];
-						RGB pixel = old_data[(i + m) * width + (j + n)];
-						r += pixel.r * weight;
-						g += pixel.g * weight;
-						b += pixel.b * weight;
-					}
-				}
-			}
-			
-			// keeping the results from overflowing when casting to unsigned char
-			if(r < 0) r = 0;
-			else if(r > 255) r = 255;
-			
-			if(g < 0) g = 0;
-			else if(g > 255) g = 255;
-			
-			if(b < 0) b = 0;
-			else if(b > 255) b = 255;
-			
-			RGB result;
-			result.r = r;
-			result.g = g;
-			result.b = b;
-			copy_RGB(&result, &new_data[(i - true_start) * width + j]);
-		}
+	if(perform_convolution_into(img, operation, true_start, true_end, threads, new_data) != 0){ // error message was printed by the called function
+		free(new_data);
+		free(new_img);
+		return NULL;
 	}
 	
 	new_img->height = new_height;
-	new_img->width = width;
+	new_img->width = img->width;
+	new_img->channels = img->channels;
+	new_img->top_down = img->top_down;
 	new_img->data = new_data;
-	free(kernel);
 	return new_img;
 }
\ No newline at end of file
@@ -17,6 +17,7 @@ typedef enum{
 operation_t string_to_operation(char *string);
 int get_kernel_size(const operation_t operation);
 Image* perform_convolution_serial(const Image *img, const operation_t operation);
+int perform_convolution_into(const Image *img, const operation_t operation, const int true_start, const int true_end, const int threads, unsigned char *new_data);
 Image* perform_convolution_parallel(const Image *img, const operation_t operation, const int true_start, const int true_end, const int threads);
 
 #endif
\ No newline at end of file
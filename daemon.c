@@ -0,0 +1,245 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dirent.h>
+#include "daemon.h"
+#include "bmp.h"
+#include "image_processing.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#define sleep_ms(ms) Sleep(ms)
+#else
+#include <unistd.h>
+#define sleep_ms(ms) usleep((ms) * 1000)
+#endif
+
+int parse_daemon_job(const char *line, daemon_job_t *daemon_job){
+	/**
+	*	Takes in the line of a job file and a daemon_job_t, which it fills according to the line.
+	*	It returns 0 if the line describes a valid job and -1 otherwise.
+	*/
+	
+	char version[16];
+	batch_job_t *job = &daemon_job->job;
+	memset(daemon_job, 0, sizeof(daemon_job_t));
+	
+	if(sscanf(line, "%15s", version) != 1) return -1;
+	
+	if(stricmp(version, "stop") == 0){
+		daemon_job->version = DAEMON_STOP;
+		return 0;
+	}
+	
+	if(stricmp(version, "sft") == 0) daemon_job->version = BATCH_VERSION_SFT;
+	else if(stricmp(version, "no_sft") == 0) daemon_job->version = BATCH_VERSION_NO_SFT;
+	else if(stricmp(version, "master") == 0) daemon_job->version = BATCH_VERSION_MASTER;
+	else return -1;
+	
+	if(sscanf(line, "%*s %255s %255s %15s", job->in_file_name, job->out_file_name, job->operation_name) != 3) return -1;
+	
+	job->operation = string_to_operation(job->operation_name);
+	if((int)job->operation == -1) return -1;
+	
+	return 0;
+}
+
+int claim_daemon_job(const char *spool_directory, daemon_job_t *daemon_job, char *job_id){
+	/**
+	*	Takes in the spool directory, a daemon_job_t and a buffer of BATCH_PATH_SIZE chars for the id of the job.
+	*	It looks for the <id>.job file with the smallest id, renames it to <id>.run and fills daemon_job with it.
+	*	Jobs which are not valid, or whose input cannot be opened, are finished as failed right away.
+	*	It returns 1 if a job was claimed, 0 if there is none and -1 on failure.
+	*/
+	
+	DIR *spool = opendir(spool_directory);
+	if(spool == NULL){
+		fprintf(stderr, "Error in claim_daemon_job: Could not open directory %s\n", spool_directory);
+		fflush(stderr);
+		return -1;
+	}
+	
+	struct dirent *entry;
+	job_id[0] = '\0';
+	
+	while((entry = readdir(spool)) != NULL){
+		size_t length = strlen(entry->d_name);
+		if(length <= 4 || length - 4 >= BATCH_PATH_SIZE || strcmp(entry->d_name + length - 4, ".job") != 0) continue;
+		
+		char candidate[BATCH_PATH_SIZE];
+		memcpy(candidate, entry->d_name, length - 4);
+		candidate[length - 4] = '\0';
+		if(job_id[0] == '\0' || strcmp(candidate, job_id) < 0) strcpy(job_id, candidate);
+	}
+	closedir(spool);
+	
+	if(job_id[0] == '\0') return 0;
+	
+	char job_file_name[2 * BATCH_PATH_SIZE], run_file_name[2 * BATCH_PATH_SIZE];
+	snprintf(job_file_name, sizeof(job_file_name), "%s/%s.job", spool_directory, job_id);
+	snprintf(run_file_name, sizeof(run_file_name), "%s/%s.run", spool_directory, job_id);
+	
+	if(rename(job_file_name, run_file_name) != 0){
+		fprintf(stderr, "Error in claim_daemon_job: Could not rename file %s\n", job_file_name);
+		fflush(stderr);
+		return -1;
+	}
+	
+	char line[3 * BATCH_PATH_SIZE] = "";
+	FILE *run_file = fopen(run_file_name, "r");
+	if(run_file != NULL){
+		if(fgets(line, sizeof(line), run_file) == NULL) line[0] = '\0';
+		fclose(run_file);
+	}
+	
+	if(parse_daemon_job(line, daemon_job) != 0){
+		fprintf(stderr, "Error in claim_daemon_job: Invalid job %s\n", job_id);
+		fflush(stderr);
+		return (finish_daemon_job(spool_directory, job_id, 0, 0) == 0) ? 0 : -1;
+	}
+	
+	// the input is checked here, as the versions cannot recover on every process from an input they cannot open
+	if(daemon_job->version != DAEMON_STOP && image_pixels(daemon_job->job.in_file_name) == -1){ // error message was printed by the called function
+		return (finish_daemon_job(spool_directory, job_id, 0, 0) == 0) ? 0 : -1;
+	}
+	
+	return 1;
+}
+
+int finish_daemon_job(const char *spool_directory, const char *job_id, int succeeded, double job_time){
+	/**
+	*	Takes in the spool directory, the id of a claimed job, 1 if it succeeded and 0 otherwise and the time it took.
+	*	It writes <id>.done (through <id>.tmp, so it appears complete) and removes <id>.run.
+	*	It returns 0 on success and -1 on failure.
+	*/
+	
+	char tmp_file_name[2 * BATCH_PATH_SIZE], done_file_name[2 * BATCH_PATH_SIZE], run_file_name[2 * BATCH_PATH_SIZE];
+	snprintf(tmp_file_name, sizeof(tmp_file_name), "%s/%s.tmp", spool_directory, job_id);
+	snprintf(done_file_name, sizeof(done_file_name), "%s/%s.done", spool_directory, job_id);
+	snprintf(run_file_name, sizeof(run_file_name), "%s/%s.run", spool_directory, job_id);
+	
+	FILE *tmp_file = fopen(tmp_file_name, "w");
+	if(tmp_file == NULL){
+		fprintf(stderr, "Error in finish_daemon_job: Could not create file %s\n", tmp_file_name);
+		fflush(stderr);
+		return -1;
+	}
+	
+	if(succeeded) fprintf(tmp_file, "OK %f\n", job_time);
+	else fprintf(tmp_file, "FAILED\n");
+	fclose(tmp_file);
+	
+	remove(run_file_name);
+	if(rename(tmp_file_name, done_file_name) != 0){
+		fprintf(stderr, "Error in finish_daemon_job: Could not rename file %s\n", tmp_file_name);
+		fflush(stderr);
+		return -1;
+	}
+	
+	return 0;
+}
+
+int wait_for_request(MPI_Request *request){
+	/**
+	*	Takes in a pending MPI_Request and waits for it to complete, sleeping DAEMON_POLL_MS between checks
+	*	instead of spinning, so idle processes leave the cores to the other programs of the workstation.
+	*	It returns 0 on success and -1 on failure.
+	*/
+	
+	int completed = 0;
+	
+	while(1){
+		int check = MPI_Test(request, &completed, MPI_STATUS_IGNORE);
+		if(check != MPI_SUCCESS) return -1;
+		if(completed) return 0;
+		sleep_ms(DAEMON_POLL_MS);
+	}
+}
+
+int run_daemon(const char *spool_directory, int my_rank, int num_processes, int num_cores, int num_workstations){
+	/**
+	*	Takes in the spool directory, this process's rank, the total number of processes,
+	*	the number of cores on a workstation and the number of workstations.
+	*	The processes stay up and edit the jobs submitted to the spool directory one after the other, so MPI_Init,
+	*	the launch of the processes and the cold caches are paid once instead of once per image.
+	*	Process 0 looks for jobs in the spool directory and broadcasts them; every job is edited by all the processes
+	*	with the version it asks for, then process 0 saves the edited image and marks the job as done.
+	*	It returns 0 when a `stop` job is received and -1 on failure.
+	*/
+	
+	int check;
+	char job_id[BATCH_PATH_SIZE];
+	
+	if(my_rank == 0){
+		fprintf(stdout, "Daemon: waiting for jobs in %s\n", spool_directory);
+		fflush(stdout);
+	}
+	
+	while(1){
+		daemon_job_t daemon_job;
+		
+		if(my_rank == 0){
+			while((check = claim_daemon_job(spool_directory, &daemon_job, job_id)) == 0){
+				sleep_ms(DAEMON_POLL_MS);
+			}
+			
+			if(check == -1){ // error message was printed by the called function
+				MPI_Abort(MPI_COMM_WORLD, -1);
+			}
+			
+			if(daemon_job.version == BATCH_VERSION_MASTER && num_processes < 2 - HYBRID_MASTER){
+				fprintf(stderr, "Rank 0: Error in run_daemon: The master/worker version needs at least 2 processes\n");
+				fflush(stderr);
+				check = finish_daemon_job(spool_directory, job_id, 0, 0);
+				if(check == -1){ // error message was printed by the called function
+					MPI_Abort(MPI_COMM_WORLD, -1);
+				}
+				continue;
+			}
+		}
+		
+		MPI_Request request;
+		check = MPI_Ibcast(&daemon_job, sizeof(daemon_job_t), MPI_BYTE, 0, MPI_COMM_WORLD, &request);
+		if(check == MPI_SUCCESS) check = wait_for_request(&request);
+		if(check != 0){
+			fprintf(stderr, "Rank %d: Error in run_daemon while broadcasting a job\n", my_rank);
+			fflush(stderr);
+			return -1;
+		}
+		
+		if(daemon_job.version == DAEMON_STOP) break;
+		
+		double job_time = MPI_Wtime();
+		Image *edited_img = edit_image(&daemon_job.job, daemon_job.version, my_rank, num_processes, MPI_COMM_WORLD, num_cores, num_workstations);
+		if(edited_img == NULL){ // error message was printed by the called function
+			MPI_Abort(MPI_COMM_WORLD, -1);
+		}
+		
+		if(my_rank == 0){
+			check = save_BMP(daemon_job.job.out_file_name, edited_img);
+			job_time = MPI_Wtime() - job_time;
+			
+			fprintf(stdout, "%s: %s --> %s (%s): %s in %f s\n", job_id, daemon_job.job.in_file_name, daemon_job.job.out_file_name,
+				daemon_job.job.operation_name, (check == 0) ? "done" : "FAILED", job_time);
+			fflush(stdout);
+			
+			check = finish_daemon_job(spool_directory, job_id, check == 0, job_time);
+			if(check == -1){ // error message was printed by the called function
+				MPI_Abort(MPI_COMM_WORLD, -1);
+			}
+			free(edited_img->data);
+		}
+		free(edited_img);
+	}
+	
+	if(my_rank == 0){
+		check = finish_daemon_job(spool_directory, job_id, 1, 0);
+		fprintf(stdout, "Daemon: stopped\n");
+		fflush(stdout);
+		if(check == -1){ // error message was printed by the called function
+			return -1;
+		}
+	}
+	
+	return 0;
+}
\ No newline at end of file
@@ -0,0 +1,26 @@
+#ifndef DAEMON
+
+#define DAEMON
+
+#include "batch.h"
+
+#define DAEMON_POLL_MS 5 // how often process 0 looks for new jobs in the spool directory, and the others for a broadcast job
+#define DAEMON_STOP -1 // version of the job which stops the daemon
+
+/**
+*	A job is submitted by creating the file <id>.job in the spool directory, holding one line: `VERSION FILE_IN FILE_OUT OPERATION`
+*	(VERSION = `sft`, `no_sft` or `master`, or `stop` alone to stop the daemon). It should be written as <id>.tmp and renamed,
+*	so the daemon never sees a half-written job. The daemon renames it to <id>.run while editing the image and then
+*	writes <id>.done, holding `OK TIME` (the time the daemon took, in seconds) or `FAILED`.
+*/
+
+typedef struct{
+	int version; // one of BATCH_VERSION_* or DAEMON_STOP
+	batch_job_t job;
+}daemon_job_t;
+
+int claim_daemon_job(const char *spool_directory, daemon_job_t *daemon_job, char *job_id);
+int finish_daemon_job(const char *spool_directory, const char *job_id, int succeeded, double job_time);
+int run_daemon(const char *spool_directory, int my_rank, int num_processes, int num_cores, int num_workstations);
+
+#endif
\ No newline at end of file
@@ -10,15 +10,20 @@
 #define NUM_CORES 16
 #define NUM_WORKSTATIONS 1 
 
+#define CHUNK_SWEEP 0 // set to 1 to measure the Master/Worker version with every chunk size from CHUNK_START to CHUNK_END instead of the adaptive chunk sizing
 #define CHUNK_START 5
 #define CHUNK_STEP 5
 #define CHUNK_END 1000
 
+#define MESSAGE_RATE_SWEEP 0 // set to 1 to also measure how many chunks per second the Master/Worker version exchanges with the small chunk sizes of MESSAGE_RATE_CHUNKS
+#define MESSAGE_RATE_CHUNKS {1, 2, 4, 8, 16, 32}
+
 #define OPERATION GAUSSBLUR5
 
 int experiment_with_image(char *in_file_name, char *out_file_name, char *measurements_file, int my_rank, int num_processes){
 	Image *serial_edited_img, *parallel_sft_edited_img, *parallel_no_sft_edited_img, *master_edited_img;
-	int num_chunk_sizes = (CHUNK_END - CHUNK_START) / CHUNK_STEP + 1;
+	unsigned long long serial_hash, parallel_sft_hash, parallel_no_sft_hash, master_hash;
+	int num_chunk_sizes = CHUNK_SWEEP ? (CHUNK_END - CHUNK_START) / CHUNK_STEP + 1 : 1;
 	double serial_time, parallel_sft_time, parallel_no_sft_time, master_time[num_chunk_sizes];
 	double optimal_chunk_time = INT_MAX;
 	int optimal_chunk_size = -1;
@@ -28,7 +33,7 @@ int experiment_with_image(char *in_file_name, char *out_file_name, char *measure
 		fflush(stdout);
 		
 		serial_time = omp_get_wtime();
-		serial_edited_img = image_processing_serial(in_file_name, OPERATION);
+		serial_edited_img = image_processing_serial(in_file_name, OPERATION, &serial_hash);
 		serial_time = omp_get_wtime() - serial_time;
 		if(serial_edited_img == NULL){ // error message was printed by the called function
 			return -1;
@@ -42,13 +47,13 @@ int experiment_with_image(char *in_file_name, char *out_file_name, char *measure
 	
 	MPI_Barrier(MPI_COMM_WORLD);
 	if(my_rank == 0) parallel_sft_time = omp_get_wtime();
-	parallel_sft_edited_img = image_processing_parallel_sft(in_file_name, OPERATION, my_rank, num_processes, NUM_CORES);
+	parallel_sft_edited_img = image_processing_parallel_sft(in_file_name, OPERATION, my_rank, num_processes, MPI_COMM_WORLD, NUM_CORES, &parallel_sft_hash);
 	if(my_rank == 0) parallel_sft_time = omp_get_wtime() - parallel_sft_time;
 	if(parallel_sft_edited_img == NULL){ // error message was printed by the called function
 		return -1;
 	}
 	
-	if(my_rank == 0 && images_are_identical(serial_edited_img, parallel_sft_edited_img) == 0){
+	if(my_rank == 0 && parallel_sft_hash != serial_hash){
 		fprintf(stdout, "The serial and parallel sft edited images are NOT identical!\n");
 		fflush(stdout);
 		
@@ -71,17 +76,15 @@ int experiment_with_image(char *in_file_name, char *out_file_name, char *measure
 		
 		fprintf(stdout, "Saving the serial edited image at %s...\n", file_name);
 		fflush(stdout);
-
+		
 		exit_code = save_BMP(file_name, serial_edited_img);
 		if(exit_code == -1){ // error message was printed by the called function
 			return -1;
 		}
 	}
 	
-	if(my_rank == 0){
-		free(parallel_sft_edited_img->data);
-		free(parallel_sft_edited_img);
-	}
+	if(my_rank == 0) free(parallel_sft_edited_img->data);
+	free(parallel_sft_edited_img);
 	
 	if(my_rank == 0){
 		fprintf(stdout, "%s --> Parallel NO SFT\n", in_file_name);
@@ -90,13 +93,13 @@ int experiment_with_image(char *in_file_name, char *out_file_name, char *measure
 	
 	MPI_Barrier(MPI_COMM_WORLD);
 	if(my_rank == 0) parallel_no_sft_time = omp_get_wtime();
-	parallel_no_sft_edited_img = image_processing_parallel_no_sft(in_file_name, OPERATION, my_rank, num_processes, NUM_CORES, NUM_WORKSTATIONS);
+	parallel_no_sft_edited_img = image_processing_parallel_no_sft(in_file_name, OPERATION, my_rank, num_processes, MPI_COMM_WORLD, NUM_CORES, NUM_WORKSTATIONS, &parallel_no_sft_hash);
 	if(my_rank == 0) parallel_no_sft_time = omp_get_wtime() - parallel_no_sft_time;
 	if(parallel_no_sft_edited_img == NULL){ // error message was printed by the called function
 		return -1;
 	}
 	
-	if(my_rank == 0 && images_are_identical(serial_edited_img, parallel_no_sft_edited_img) == 0){
+	if(my_rank == 0 && parallel_no_sft_hash != serial_hash){
 		fprintf(stdout, "The serial and parallel no sft edited images are NOT identical!\n");
 		fflush(stdout);
 		
@@ -119,39 +122,37 @@ int experiment_with_image(char *in_file_name, char *out_file_name, char *measure
 		
 		fprintf(stdout, "Saving the serial edited image at %s...\n", file_name);
 		fflush(stdout);
-
+		
 		exit_code = save_BMP(file_name, serial_edited_img);
 		if(exit_code == -1){ // error message was printed by the called function
 			return -1;
 		}
 	}
 	
-	if(my_rank == 0){
-		free(parallel_no_sft_edited_img->data);
-		free(parallel_no_sft_edited_img);
-	}
+	if(my_rank == 0) free(parallel_no_sft_edited_img->data);
+	free(parallel_no_sft_edited_img);
 	
 	if(my_rank == 0){
 		fprintf(stdout, "%s --> Master/Worker\n", in_file_name);
 		fflush(stdout);
 	}
 	
-	for(int chunk = CHUNK_START; chunk <= CHUNK_END; chunk += CHUNK_STEP){
-		int index = (chunk - CHUNK_START) / CHUNK_STEP;
-		if(my_rank == 0){
+	for(int index = 0; index < num_chunk_sizes; ++index){
+		int chunk = CHUNK_SWEEP ? CHUNK_START + index * CHUNK_STEP : ADAPTIVE_CHUNK_SIZE;
+		if(my_rank == 0 && CHUNK_SWEEP){
 			fprintf(stdout, "Chunk %d\n", chunk);
 			fflush(stdout);
 		}
 		
 		MPI_Barrier(MPI_COMM_WORLD);
 		if(my_rank == 0) master_time[index] = omp_get_wtime();
-		master_edited_img = image_processing_master(in_file_name, OPERATION, chunk, my_rank, num_processes, NUM_CORES, NUM_WORKSTATIONS);
+		master_edited_img = image_processing_master(in_file_name, OPERATION, chunk, my_rank, num_processes, MPI_COMM_WORLD, NUM_CORES, NUM_WORKSTATIONS, &master_hash);
 		if(my_rank == 0) master_time[index] = omp_get_wtime() - master_time[index];
 		if(master_edited_img == NULL){ // error message was printed by the called function
 			return -1;
 		}
 		
-		if(my_rank == 0 && images_are_identical(serial_edited_img, master_edited_img) == 0){
+		if(my_rank == 0 && master_hash != serial_hash){
 			fprintf(stdout, "The serial and master/worker edited images are NOT identical!\n");
 			fflush(stdout);
 			
@@ -174,7 +175,7 @@ int experiment_with_image(char *in_file_name, char *out_file_name, char *measure
 			
 			fprintf(stdout, "Saving the serial edited image at %s...\n", file_name);
 			fflush(stdout);
-
+			
 			exit_code = save_BMP(file_name, serial_edited_img);
 			if(exit_code == -1){ // error message was printed by the called function
 				return -1;
@@ -202,12 +203,17 @@ int experiment_with_image(char *in_file_name, char *out_file_name, char *measure
 		fprintf(f, "Serial Time: %f\n", serial_time);
 		fprintf(f, "Parallel SFT Time: %f\tSpeedup: %f\n", parallel_sft_time, serial_time / parallel_sft_time);
 		fprintf(f, "Parallel NO SFT Time: %f\tSpeedup: %f\n", parallel_no_sft_time, serial_time / parallel_no_sft_time);
-		fprintf(f, "Mater/Worker Time: %f\tSpeedup: %f\tOptimal Chunk Size: %d\n\n", optimal_chunk_time, serial_time / optimal_chunk_time, optimal_chunk_size);
-		
-		fprintf(f, "Master/Worker Chunks\n");
-		for(int chunk = CHUNK_START; chunk <= CHUNK_END; chunk += CHUNK_STEP){
-			int index = (chunk - CHUNK_START) / CHUNK_STEP;
-			fprintf(f, "Chunk Size: %d\t\tTime: %f\tSpeedup: %f\n", chunk, master_time[index], serial_time / master_time[index]);
+		if(CHUNK_SWEEP){
+			fprintf(f, "Mater/Worker Time: %f\tSpeedup: %f\tOptimal Chunk Size: %d\n\n", optimal_chunk_time, serial_time / optimal_chunk_time, optimal_chunk_size);
+			
+			fprintf(f, "Master/Worker Chunks\n");
+			for(int chunk = CHUNK_START; chunk <= CHUNK_END; chunk += CHUNK_STEP){
+				int index = (chunk - CHUNK_START) / CHUNK_STEP;
+				fprintf(f, "Chunk Size: %d\t\tTime: %f\tSpeedup: %f\n", chunk, master_time[index], serial_time / master_time[index]);
+			}
+		}
+		else{
+			fprintf(f, "Mater/Worker Time: %f\tSpeedup: %f\tChunk Size: adaptive\n", optimal_chunk_time, serial_time / optimal_chunk_time);
 		}
 		fprintf(f, "\n============================================================\n");
 		
@@ -216,6 +222,58 @@ int experiment_with_image(char *in_file_name, char *out_file_name, char *measure
 	}
 }
 
+int message_rate_experiment(char *in_file_name, char *measurements_file, int my_rank, int num_processes){
+	/**
+	*	Takes in a file path to the file to edit, the file path of the measurements, this process's rank and the total number of processes.
+	*	Small chunks make the Master/Worker version bound by the rate of its messages rather than by the editing,
+	*	so it edits the image with every chunk size of MESSAGE_RATE_CHUNKS and appends the chunks per second to the measurements.
+	*	SHARED_MEMORY_WINDOWS has to be 0 in image_processing.c for the chunks to travel in messages.
+	*	It returns 0 on success and -1 on failure.
+	*/
+	
+	int chunk_sizes[] = MESSAGE_RATE_CHUNKS;
+	int num_chunk_sizes = sizeof(chunk_sizes) / sizeof(int);
+	FILE *f = NULL;
+	
+	if(my_rank == 0){
+		f = fopen(measurements_file, "a");
+		if(f == NULL){
+			fprintf(stdout, "Could not open file measurements.txt\n");
+			fflush(stdout);
+			return -1;
+		}
+		fprintf(f, "%s\n\nMaster/Worker Message Rate\n", in_file_name);
+	}
+	
+	for(int index = 0; index < num_chunk_sizes; ++index){
+		double time;
+		
+		MPI_Barrier(MPI_COMM_WORLD);
+		if(my_rank == 0) time = omp_get_wtime();
+		Image *edited_img = image_processing_master(in_file_name, OPERATION, chunk_sizes[index], my_rank, num_processes, MPI_COMM_WORLD, NUM_CORES, NUM_WORKSTATIONS, NULL);
+		if(my_rank == 0) time = omp_get_wtime() - time;
+		if(edited_img == NULL){ // error message was printed by the called function
+			if(f != NULL) fclose(f);
+			return -1;
+		}
+		
+		if(my_rank == 0){
+			int num_chunks = (edited_img->height + chunk_sizes[index] - 1) / chunk_sizes[index];
+			fprintf(f, "Chunk Size: %d\t\tTime: %f\tChunks per second: %f\n", chunk_sizes[index], time, num_chunks / time);
+			free(edited_img->data);
+		}
+		free(edited_img);
+	}
+	
+	if(my_rank == 0){
+		fprintf(f, "\n============================================================\n");
+		fflush(f);
+		fclose(f);
+	}
+	
+	return 0;
+}
+
 int main(int argc, char **argv){
 	MPI_Init(&argc, &argv);
 	int my_rank, num_processes, check;
@@ -250,16 +308,37 @@ int main(int argc, char **argv){
 		MPI_Abort(MPI_COMM_WORLD, -1);
 	}
 	
+	if(MESSAGE_RATE_SWEEP){
+		check = message_rate_experiment("Photos\\Large.bmp", argv[1], my_rank, num_processes);
+		if(check == -1){
+			MPI_Abort(MPI_COMM_WORLD, -1);
+		}
+	}
+	
 	check = experiment_with_image("Photos\\XL.bmp", "Photos\\Edited_XL.bmp", argv[1], my_rank, num_processes);
 	if(check == -1){
 		MPI_Abort(MPI_COMM_WORLD, -1);
 	}
 	
+	if(MESSAGE_RATE_SWEEP){
+		check = message_rate_experiment("Photos\\XL.bmp", argv[1], my_rank, num_processes);
+		if(check == -1){
+			MPI_Abort(MPI_COMM_WORLD, -1);
+		}
+	}
+	
 	check = experiment_with_image("Photos\\XXL.bmp", "Photos\\Edited_XXL.bmp", argv[1], my_rank, num_processes);
 	if(check == -1){
 		MPI_Abort(MPI_COMM_WORLD, -1);
 	}
 	
+	if(MESSAGE_RATE_SWEEP){
+		check = message_rate_experiment("Photos\\XXL.bmp", argv[1], my_rank, num_processes);
+		if(check == -1){
+			MPI_Abort(MPI_COMM_WORLD, -1);
+		}
+	}
+	
 	if(my_rank == 0){
 		run_time = omp_get_wtime() - run_time;
 		
@@ -6,11 +6,207 @@
 #include "convolution.h"
 #include "bmp.h"
 #include "image_processing.h"
+#include "tiled.h"
+#include "compression.h"
+#include "verification.h"
+#include "batch.h"
+#include "daemon.h"
+#include "sequence.h"
 
 #define NUM_CORES 16
 #define NUM_WORKSTATIONS 1 
 
-#define OPTIMAL_CHUNK_SIZE 200
+#define OPTIMAL_CHUNK_SIZE 200 // rows per chunk of the regions handed out by the incremental and ROI modes
+#define MASTER_CHUNK_SIZE ADAPTIVE_CHUNK_SIZE // rows per chunk of the Master/Worker version (ADAPTIVE_CHUNK_SIZE lets the master size them)
+#define STREAM_BAND_SIZE 256
+
+#define TILE_WIDTH 256
+#define TILE_HEIGHT 64
+#define TILE_COMPRESSION TILED_COMPRESSION_RLE
+
+#define VERIFY_MODE 1 // 0 = compare with the serial edited image, 1 = compare hashes with the golden hash, 2 = compare with the serial edited image within a tolerance
+#define GOLDEN_HASH_FILE "golden_hashes.txt"
+#define VERIFY_MIN_PSNR 50.0 // in dB, used when VERIFY_MODE = 2
+#define VERIFY_MAX_DIFFERENCE 2 // largest difference allowed between two corresponding bytes, used when VERIFY_MODE = 2
+
+int save_serial_image(const char *out_file_name, Image *serial_edited_image){
+	/**
+	*	Takes in the file path the parallel edited Image was saved at and the serial edited Image
+	*	and saves the serial edited Image next to it, prefixing its file name with `Serial_`.
+	*	It returns 0 on success and -1 on failure.
+	*/
+	
+	char file_name[256] = "";
+	char *aux = strrchr(out_file_name, '\\');
+	if(aux == NULL) aux = strrchr(out_file_name, '/');
+	int index = (aux == NULL) ? -1 : aux - out_file_name;
+	strncat(file_name, out_file_name, index + 1);
+	file_name[index + 1] = '\0';
+	strcat(file_name, "Serial_");
+	strcat(file_name, out_file_name + index + 1);
+	fprintf(stdout, "Saving the serial edited image at %s...\n", file_name);
+	fflush(stdout);
+	
+	return save_BMP(file_name, serial_edited_image);
+}
+
+int verify_edited_image(const char *in_file_name, const char *out_file_name, operation_t operation, const char *version_name, Image *parallel_edited_image, unsigned long long parallel_hash, double parallel_time){
+	/**
+	*	Takes in the file path of the edited file, the file path the parallel edited Image was saved at, an operation_t,
+	*	the name of the parallel version, the parallel edited Image, its hash and the time the parallel version took.
+	*	If VERIFY_MODE = 1, it compares the hash with the golden hash of the file and the operation,
+	*	which is computed once with the serial version and stored in GOLDEN_HASH_FILE.
+	*	Otherwise, it edits the file with the serial version and compares the edited Images, byte by byte or within a tolerance.
+	*	It prints the result and the times and returns 1 if the parallel edited Image is correct, 0 if it is not and -1 on failure.
+	*/
+	
+	Image *serial_edited_image = NULL;
+	double serial_time = -1;
+	unsigned long long golden_hash;
+	int correct;
+	
+	if(VERIFY_MODE != 1 || load_golden_hash(GOLDEN_HASH_FILE, in_file_name, operation, &golden_hash) == 0){
+		serial_time = omp_get_wtime();
+		serial_edited_image = image_processing_serial(in_file_name, operation, (VERIFY_MODE == 1) ? &golden_hash : NULL);
+		serial_time = omp_get_wtime() - serial_time;
+		if(serial_edited_image == NULL){ // error message was printed by the called function
+			return -1;
+		}
+		
+		if(VERIFY_MODE == 1 && store_golden_hash(GOLDEN_HASH_FILE, in_file_name, operation, golden_hash) == -1){ // error message was printed by the called function
+			free(serial_edited_image->data);
+			free(serial_edited_image);
+			return -1;
+		}
+	}
+	
+	if(VERIFY_MODE == 1){
+		correct = (parallel_hash == golden_hash);
+		if(correct) fprintf(stdout, "The hash of the %s edited image matches the golden hash %016llx.\n", version_name, golden_hash);
+		else fprintf(stdout, "The hash of the %s edited image (%016llx) does NOT match the golden hash %016llx!\n", version_name, parallel_hash, golden_hash);
+	}
+	else if(VERIFY_MODE == 2){
+		int max_difference = max_pixel_difference(serial_edited_image, parallel_edited_image);
+		double psnr = image_psnr(serial_edited_image, parallel_edited_image);
+		correct = (max_difference != -1 && max_difference <= VERIFY_MAX_DIFFERENCE && psnr >= VERIFY_MIN_PSNR);
+		if(correct) fprintf(stdout, "The serial and %s edited images match within the tolerance (PSNR: %.2f dB, max difference: %d).\n", version_name, psnr, max_difference);
+		else fprintf(stdout, "The serial and %s edited images do NOT match within the tolerance (PSNR: %.2f dB, max difference: %d)!\n", version_name, psnr, max_difference);
+	}
+	else{
+		correct = images_are_identical(serial_edited_image, parallel_edited_image);
+		if(correct) fprintf(stdout, "The serial and %s edited images are identical.\n", version_name);
+		else fprintf(stdout, "The serial and %s edited images are NOT identical!\n", version_name);
+	}
+	fflush(stdout);
+	
+	if(correct){
+		if(serial_time >= 0) fprintf(stdout, "Serial time: %f\n", serial_time);
+		fprintf(stdout, "%s time: %f\n", version_name, parallel_time);
+		if(serial_time >= 0) fprintf(stdout, "Speedup: %f\n", serial_time / parallel_time);
+		fprintf(stdout, "\n");
+		fflush(stdout);
+	}
+	else{
+		if(serial_edited_image == NULL){
+			serial_edited_image = image_processing_serial(in_file_name, operation, NULL);
+			if(serial_edited_image == NULL){ // error message was printed by the called function
+				return -1;
+			}
+		}
+		
+		if(save_serial_image(out_file_name, serial_edited_image) == -1){ // error message was printed by the called function
+			free(serial_edited_image->data);
+			free(serial_edited_image);
+			return -1;
+		}
+	}
+	
+	if(serial_edited_image != NULL){
+		free(serial_edited_image->data);
+		free(serial_edited_image);
+	}
+	return correct;
+}
+
+int edit_region_of_interest(const char *in_file_name, const char *out_file_name, operation_t operation, region_t roi, int save_whole_image, int shared_file_tree, int my_rank, int num_processes, MPI_Comm comm){
+	/**
+	*	Takes in the file path of the file to edit, the file path to save the result at, an operation_t, a region of interest
+	*	(rows counted from the top of the picture), 1 to save the whole image with only the region edited and 0 to save the edited region alone,
+	*	1 if the system has a SFT and 0 otherwise, this process's rank, the number of processes editing the region and their communicator.
+	*	It edits the region of interest with image_processing_roi and, on process 0, compares it with the same region
+	*	of the serial edited image and saves the result.
+	*	It returns 1 if the edited region is correct, 0 if it is not and -1 on failure.
+	*/
+	
+	double roi_time = omp_get_wtime();
+	Image *roi_img = image_processing_roi(in_file_name, operation, roi, shared_file_tree, OPTIMAL_CHUNK_SIZE, my_rank, num_processes, comm, NUM_CORES, NUM_WORKSTATIONS);
+	roi_time = omp_get_wtime() - roi_time;
+	if(roi_img == NULL){ // error message was printed by the called function
+		return -1;
+	}
+	
+	if(my_rank != 0){
+		free(roi_img);
+		return 1;
+	}
+	
+	region_t region;
+	int true_start, true_end, column_start;
+	int check = picture_region(in_file_name, roi, &region);
+	
+	double serial_time = omp_get_wtime();
+	Image *serial_edited_image = (check == 0) ? image_processing_serial(in_file_name, operation, NULL) : NULL;
+	serial_time = omp_get_wtime() - serial_time;
+	if(serial_edited_image == NULL){ // error message was printed by the called function
+		free(roi_img->data);
+		free(roi_img);
+		return -1;
+	}
+	
+	Image *serial_roi_img = crop_region(serial_edited_image, region, 0, &true_start, &true_end, &column_start);
+	free(serial_edited_image->data);
+	free(serial_edited_image);
+	if(serial_roi_img == NULL){ // error message was printed by the called function
+		free(roi_img->data);
+		free(roi_img);
+		return -1;
+	}
+	
+	int correct = images_are_identical(serial_roi_img, roi_img);
+	if(correct) fprintf(stdout, "The serial and ROI edited regions are identical.\n");
+	else fprintf(stdout, "The serial and ROI edited regions are NOT identical!\n");
+	fprintf(stdout, "Region of interest: %d,%d,%d,%d\n", roi.x, roi.y, roi.width, roi.height);
+	fprintf(stdout, "Serial time (whole image): %f\n", serial_time);
+	fprintf(stdout, "ROI time: %f\n\n", roi_time);
+	fflush(stdout);
+	free(serial_roi_img->data);
+	free(serial_roi_img);
+	
+	Image *saved_img = roi_img;
+	if(save_whole_image){
+		saved_img = is_tiled_file(in_file_name) ? read_tiled_serial(in_file_name) : read_BMP_serial(in_file_name);
+		if(saved_img == NULL){ // error message was printed by the called function
+			free(roi_img->data);
+			free(roi_img);
+			return -1;
+		}
+		patch_region(saved_img, roi_img, region, 0);
+	}
+	
+	check = save_BMP(out_file_name, saved_img);
+	
+	if(saved_img != roi_img){
+		free(saved_img->data);
+		free(saved_img);
+	}
+	free(roi_img->data);
+	free(roi_img);
+	
+	if(check == -1){ // error message was printed by the called function
+		return -1;
+	}
+	return correct;
+}
 
 int main(int argc, char **argv){
 	MPI_Init(&argc, &argv);
@@ -19,15 +215,163 @@ int main(int argc, char **argv){
 	MPI_Comm_rank(MPI_COMM_WORLD, &my_rank);
 	MPI_Comm_size(MPI_COMM_WORLD, &num_processes);
 	
+	if(argc == 5 && stricmp(argv[1], "generate") == 0){
+		// generating a synthetic image, used to test the streaming mode on images larger than the memory
+		if(my_rank == 0){
+			int height = atoi(argv[3]);
+			int width = atoi(argv[4]);
+			if(height <= 0 || width <= 0){
+				fprintf(stdout, "Invalid image size\n");
+				fflush(stdout);
+				MPI_Abort(MPI_COMM_WORLD, -1);
+			}
+			
+			int check = generate_BMP(argv[2], height, width, STREAM_BAND_SIZE);
+			if(check == -1){ // error message was printed by the called function
+				MPI_Abort(MPI_COMM_WORLD, -1);
+			}
+		}
+		
+		MPI_Finalize();
+		return 0;
+	}
+	
+	if(argc == 4 && stricmp(argv[1], "convert") == 0){
+		// converting a .bmp file to a tiled image, which every version can read directly in later runs
+		if(my_rank == 0){
+			int check = convert_BMP_to_tiled(argv[2], argv[3], TILE_WIDTH, TILE_HEIGHT, TILE_COMPRESSION);
+			if(check == -1){ // error message was printed by the called function
+				MPI_Abort(MPI_COMM_WORLD, -1);
+			}
+		}
+		
+		MPI_Finalize();
+		return 0;
+	}
+	
+	if(argc == 4 && stricmp(argv[1], "batch") == 0){
+		// editing all the images of a manifest, on groups of processes
+		int version = -1;
+		if(stricmp(argv[3], "sft") == 0) version = BATCH_VERSION_SFT;
+		else if(stricmp(argv[3], "no_sft") == 0) version = BATCH_VERSION_NO_SFT;
+		else if(stricmp(argv[3], "master") == 0) version = BATCH_VERSION_MASTER;
+		
+		if(version == -1){
+			if(my_rank == 0){
+				fprintf(stdout, "Invalid version\n");
+				fflush(stdout);
+			}
+			MPI_Abort(MPI_COMM_WORLD, -1);
+		}
+		
+		int check = run_batch(argv[2], version, my_rank, num_processes, NUM_CORES, NUM_WORKSTATIONS);
+		if(check == -1){ // error message was printed by the called function
+			MPI_Abort(MPI_COMM_WORLD, -1);
+		}
+		
+		MPI_Finalize();
+		return 0;
+	}
+	
+	if(argc == 3 && stricmp(argv[1], "daemon") == 0){
+		// staying up and editing the jobs submitted to a spool directory, until a `stop` job
+		int check = run_daemon(argv[2], my_rank, num_processes, NUM_CORES, NUM_WORKSTATIONS);
+		if(check == -1){ // error message was printed by the called function
+			MPI_Abort(MPI_COMM_WORLD, -1);
+		}
+		
+		MPI_Finalize();
+		return 0;
+	}
+	
+	if(argc == 7 && stricmp(argv[1], "incremental") == 0){
+		// editing again only the regions of a new input which changed since the previous input, and patching them into the previous output
+		operation = string_to_operation(argv[6]);
+		if((int)operation == -1){
+			if(my_rank == 0){
+				fprintf(stdout, "Invalid operation\n");
+				fflush(stdout);
+			}
+			MPI_Abort(MPI_COMM_WORLD, -1);
+		}
+		
+		double incremental_time = omp_get_wtime();
+		Image *edited_img = image_processing_incremental(argv[2], argv[3], argv[4], operation, OPTIMAL_CHUNK_SIZE, my_rank, num_processes, MPI_COMM_WORLD, NUM_CORES, NUM_WORKSTATIONS);
+		incremental_time = omp_get_wtime() - incremental_time;
+		if(edited_img == NULL){ // error message was printed by the called function
+			MPI_Abort(MPI_COMM_WORLD, -1);
+		}
+		
+		if(my_rank == 0){
+			int check = save_BMP(argv[5], edited_img);
+			if(check == -1){ // error message was printed by the called function
+				MPI_Abort(MPI_COMM_WORLD, -1);
+			}
+			
+			check = verify_edited_image(argv[4], argv[5], operation, "incremental", edited_img, hash_image(edited_img, NUM_CORES), incremental_time);
+			if(check == -1){ // error message was printed by the called function
+				MPI_Abort(MPI_COMM_WORLD, -1);
+			}
+			free(edited_img->data);
+		}
+		free(edited_img);
+		
+		MPI_Finalize();
+		return 0;
+	}
+	
+	if(argc == 7 && stricmp(argv[1], "sequence") == 0){
+		// editing a sequence of frames, with several frames in flight on every process
+		operation = string_to_operation(argv[4]);
+		int first_frame = atoi(argv[5]);
+		int num_frames = atoi(argv[6]);
+		if((int)operation == -1 || num_frames <= 0){
+			if(my_rank == 0){
+				fprintf(stdout, ((int)operation == -1) ? "Invalid operation\n" : "Invalid number of frames\n");
+				fflush(stdout);
+			}
+			MPI_Abort(MPI_COMM_WORLD, -1);
+		}
+		
+		int check = run_sequence(argv[2], argv[3], operation, first_frame, num_frames, my_rank, num_processes, NUM_CORES, NUM_WORKSTATIONS);
+		if(check == -1){ // error message was printed by the called function
+			MPI_Abort(MPI_COMM_WORLD, -1);
+		}
+		
+		MPI_Finalize();
+		return 0;
+	}
+	
+	// `--roi X,Y,W,H` (save the edited region) or `--roi_full X,Y,W,H` (save the whole image with only the region edited) can follow a version
+	region_t roi;
+	int roi_mode = 0; // 0 = no region of interest, 1 = `--roi`, 2 = `--roi_full`
+	if(argc >= 7 && (stricmp(argv[argc - 2], "--roi") == 0 || stricmp(argv[argc - 2], "--roi_full") == 0)){
+		roi_mode = (stricmp(argv[argc - 2], "--roi") == 0) ? 1 : 2;
+		if(sscanf(argv[argc - 1], "%d,%d,%d,%d", &roi.x, &roi.y, &roi.width, &roi.height) != 4){
+			if(my_rank == 0){
+				fprintf(stdout, "Invalid region of interest, expected X,Y,WIDTH,HEIGHT\n");
+				fflush(stdout);
+			}
+			MPI_Abort(MPI_COMM_WORLD, -1);
+		}
+		argc -= 2;
+	}
+	
 	if(argc != 5 && argc != 6){
 		if(my_rank == 0){
-			fprintf(stdout, "Usage: %s [version = {`serial`, `parallel`, `master`}] [file_in] [file_out] [operation = {`RIDGE`, `EDGE`, `SHARPEN`, `BOXBLUR`, `GAUSSBLUR3`, `GAUSSBLUR5`, `UNSHARP5`}] [shared_file_tree = {`0` = False, `1` = True}]", argv[0]);
+			fprintf(stdout, "Usage: %s [version = {`serial`, `parallel`, `master`, `stream`}] [file_in] [file_out] [operation = {`RIDGE`, `EDGE`, `SHARPEN`, `BOXBLUR`, `GAUSSBLUR3`, `GAUSSBLUR5`, `UNSHARP5`}] [shared_file_tree = {`0` = False, `1` = True}] [--roi or --roi_full X,Y,WIDTH,HEIGHT]\n", argv[0]);
+			fprintf(stdout, "       %s generate [file_out] [height] [width]\n", argv[0]);
+			fprintf(stdout, "       %s convert [file_in] [file_out]\n", argv[0]);
+			fprintf(stdout, "       %s batch [manifest] [version = {`sft`, `no_sft`, `master`}]\n", argv[0]);
+			fprintf(stdout, "       %s daemon [spool_directory]\n", argv[0]);
+			fprintf(stdout, "       %s sequence [file_in_pattern] [file_out_pattern] [operation] [first_frame] [num_frames]\n", argv[0]);
+			fprintf(stdout, "       %s incremental [previous_file_in] [previous_file_out] [file_in] [file_out] [operation]\n", argv[0]);
 			fflush(stdout);
 		}
 		MPI_Abort(MPI_COMM_WORLD, -1);
 	}
 	
-	if(((stricmp(argv[1], "serial") != 0 && stricmp(argv[1], "master") != 0) && argc == 5) || (stricmp(argv[1], "parallel") != 0 && argc == 6)){
+	if(((stricmp(argv[1], "serial") != 0 && stricmp(argv[1], "master") != 0 && stricmp(argv[1], "stream") != 0) && argc == 5) || ((stricmp(argv[1], "parallel") != 0 && stricmp(argv[1], "master") != 0) && argc == 6)){
 		if(my_rank == 0){
 			fprintf(stdout, "Invalid version\n");
 			fflush(stdout);
@@ -44,12 +388,13 @@ int main(int argc, char **argv){
 		MPI_Abort(MPI_COMM_WORLD, -1);
 	}
 	
-	int shared_file_tree;
-	if(stricmp(argv[5], "0") == 0) shared_file_tree = 0;
-	else if (stricmp(argv[5], "1") == 0) shared_file_tree = 1;
-	else shared_file_tree = -1;
+	int shared_file_tree = -1;
+	if(argc == 6){
+		if(stricmp(argv[5], "0") == 0) shared_file_tree = 0;
+		else if (stricmp(argv[5], "1") == 0) shared_file_tree = 1;
+	}
 	
-	if(stricmp(argv[1], "parallel") == 0 && shared_file_tree == -1){
+	if((stricmp(argv[1], "parallel") == 0 || argc == 6) && shared_file_tree == -1){
 		if(my_rank == 0){
 			fprintf(stdout, "Invalid shared_file_tree argument\n");
 			fflush(stdout);
@@ -57,24 +402,54 @@ int main(int argc, char **argv){
 		MPI_Abort(MPI_COMM_WORLD, -1);
 	}
 	
+	if(roi_mode != 0){
+		// editing only the region of interest: the serial version on process 0, the parallel version with or without a SFT,
+		// and the master/worker version, which hands the chunks of the region out like without a SFT
+		if(stricmp(argv[1], "stream") == 0){
+			if(my_rank == 0){
+				fprintf(stdout, "The stream version does not support a region of interest\n");
+				fflush(stdout);
+			}
+			MPI_Abort(MPI_COMM_WORLD, -1);
+		}
+		
+		int serial = (stricmp(argv[1], "serial") == 0);
+		if(!serial || my_rank == 0){
+			int check = edit_region_of_interest(argv[2], argv[3], operation, roi, roi_mode == 2, shared_file_tree == 1,
+				my_rank, serial ? 1 : num_processes, serial ? MPI_COMM_SELF : MPI_COMM_WORLD);
+			if(check == -1){ // error message was printed by the called function
+				MPI_Abort(MPI_COMM_WORLD, -1);
+			}
+		}
+		
+		MPI_Finalize();
+		return 0;
+	}
+	
 	/**
 	*	mode = 0 --> serial
 	*	mode = 1 --> master/worker
+	*	mode = 2 --> streaming
+	*	mode = 3 --> master/worker with a SFT (the workers read and write the pixels themselves)
 	*/
 	int mode;
 	if(argc == 5){
 		if(stricmp(argv[1], "serial") == 0) mode = 0;
-		else mode = 1;
+		else if(stricmp(argv[1], "master") == 0) mode = 1;
+		else mode = 2;
+	}
+	else if(stricmp(argv[1], "master") == 0){
+		mode = (shared_file_tree == 1) ? 3 : 1;
 	}
 	
-	if(argc == 5){
+	if(argc == 5 || stricmp(argv[1], "master") == 0){
 		if(mode == 0){ // serial
 			if(my_rank != 0){
 				MPI_Finalize();
 				return 0;
 			}
 			
-			Image *edited_img = image_processing_serial(argv[2], operation);
+			Image *edited_img = image_processing_serial(argv[2], operation, NULL);
 			if(edited_img == NULL){ // error message was printed by the called function
 				MPI_Abort(MPI_COMM_WORLD, -1);
 			}
@@ -87,14 +462,68 @@ int main(int argc, char **argv){
 			free(edited_img->data);
 			free(edited_img);
 		}
+		else if(mode == 2){ // streaming
+			if(my_rank != 0){
+				MPI_Finalize();
+				return 0;
+			}
+			
+			double streaming_time = omp_get_wtime();
+			int check = image_processing_streaming(argv[2], argv[3], operation, STREAM_BAND_SIZE, NUM_CORES);
+			streaming_time = omp_get_wtime() - streaming_time;
+			if(check == -1){ // error message was printed by the called function
+				MPI_Abort(MPI_COMM_WORLD, -1);
+			}
+			
+			fprintf(stdout, "Streaming time: %f\n", streaming_time);
+			fprintf(stdout, "Band size: %d rows\n\n", STREAM_BAND_SIZE);
+			fflush(stdout);
+		}
+		else if(mode == 3){ // master/worker with a SFT
+			Image *parallel_edited_image = NULL;
+			unsigned long long parallel_hash = 0;
+			double parallel_time;
+			int check;
+			
+			if(my_rank == 0) parallel_time = omp_get_wtime();
+			check = image_processing_master_sft(argv[2], argv[3], operation, MASTER_CHUNK_SIZE, my_rank, num_processes, MPI_COMM_WORLD, NUM_CORES, NUM_WORKSTATIONS, (VERIFY_MODE == 1) ? &parallel_hash : NULL);
+			if(my_rank == 0) parallel_time = omp_get_wtime() - parallel_time;
+			if(check == -1){ // error message was printed by the called function
+				MPI_Abort(MPI_COMM_WORLD, -1);
+			}
+			
+			if(my_rank != 0){
+				MPI_Finalize();
+				return 0;
+			}
+			
+			// the workers saved the edited image, which is only read back to be compared with the serial one
+			if(VERIFY_MODE != 1){
+				parallel_edited_image = read_BMP_serial(argv[3]);
+				if(parallel_edited_image == NULL){ // error message was printed by the called function
+					MPI_Abort(MPI_COMM_WORLD, -1);
+				}
+			}
+			
+			check = verify_edited_image(argv[2], argv[3], operation, "Master/Worker SFT", parallel_edited_image, parallel_hash, parallel_time);
+			if(check == -1){ // error message was printed by the called function
+				MPI_Abort(MPI_COMM_WORLD, -1);
+			}
+			
+			if(parallel_edited_image != NULL){
+				free(parallel_edited_image->data);
+				free(parallel_edited_image);
+			}
+		}
 		else{ // master/worker
 			int chunk = 100;
-			Image *parallel_edited_image, *serial_edited_image;
-			double parallel_time, serial_time;
+			Image *parallel_edited_image;
+			unsigned long long parallel_hash = 0;
+			double parallel_time;
 			int check;
 			
 			if(my_rank == 0) parallel_time = omp_get_wtime();
-			parallel_edited_image = image_processing_master(argv[2], operation, OPTIMAL_CHUNK_SIZE, my_rank, num_processes, NUM_CORES, NUM_WORKSTATIONS);
+			parallel_edited_image = image_processing_master(argv[2], operation, MASTER_CHUNK_SIZE, my_rank, num_processes, MPI_COMM_WORLD, NUM_CORES, NUM_WORKSTATIONS, (VERIFY_MODE == 1) ? &parallel_hash : NULL);
 			if(my_rank == 0) parallel_time = omp_get_wtime() - parallel_time;
 			if(parallel_edited_image == NULL){ // error message was printed by the called function
 				MPI_Abort(MPI_COMM_WORLD, -1);
@@ -111,61 +540,31 @@ int main(int argc, char **argv){
 				MPI_Abort(MPI_COMM_WORLD, -1);
 			}
 			
-			serial_time = omp_get_wtime();
-			serial_edited_image = image_processing_serial(argv[2], operation);
-			serial_time = omp_get_wtime() - serial_time;
-			if(serial_edited_image == NULL){ // error message was printed by the called function
+			check = verify_edited_image(argv[2], argv[3], operation, "Master/Worker", parallel_edited_image, parallel_hash, parallel_time);
+			if(check == -1){ // error message was printed by the called function
 				MPI_Abort(MPI_COMM_WORLD, -1);
 			}
 			
-			if(images_are_identical(serial_edited_image, parallel_edited_image) == 1){
-				fprintf(stdout, "The serial and parallel edited images are identical.\n");
-				fprintf(stdout, "Serial time: %f\n", serial_time);
-				fprintf(stdout, "Master/Worker time: %f\n", parallel_time);
-				fprintf(stdout, "Speedup: %f\n\n", serial_time / parallel_time);
-				fflush(stdout);
-			}
-			else{
-				fprintf(stdout, "The serial and master/worker edited images are NOT identical!\n");
-				fflush(stdout);
-				
-				char file_name[256] = "";
-				char *aux = strrchr(argv[3], '\\');
-				int index = aux - argv[3];
-				strncat(file_name, argv[3], index + 1);
-				file_name[index + 1] = '\0';
-				strcat(file_name, "Serial_");
-				strcat(file_name, aux + 1);
-				fprintf(stdout, "Saving the serial edited image at %s...\n", file_name);
-				fflush(stdout);
-
-				int exit_code = save_BMP(file_name, serial_edited_image);
-				if(exit_code == -1){ // error message was printed by the called function
-					MPI_Abort(MPI_COMM_WORLD, -1);
-				}
-			}
-			
 			free(parallel_edited_image->data);
 			free(parallel_edited_image);
-			free(serial_edited_image->data);
-			free(serial_edited_image);
 		}
 	}
 	else{
 		if(shared_file_tree == 1){
-			Image *parallel_edited_image, *serial_edited_image;
-			double parallel_time, serial_time;
+			Image *parallel_edited_image;
+			unsigned long long parallel_hash = 0;
+			double parallel_time;
 			int check;
 			
 			if(my_rank == 0) parallel_time = omp_get_wtime();
-			parallel_edited_image = image_processing_parallel_sft(argv[2], operation, my_rank, num_processes, NUM_CORES);
+			parallel_edited_image = image_processing_parallel_sft(argv[2], operation, my_rank, num_processes, MPI_COMM_WORLD, NUM_CORES, (VERIFY_MODE == 1) ? &parallel_hash : NULL);
 			if(my_rank == 0) parallel_time = omp_get_wtime() - parallel_time;
 			if(parallel_edited_image == NULL){ // error message was printed by the called function
 				MPI_Abort(MPI_COMM_WORLD, -1);
 			}
 			
 			if(my_rank != 0){
-				// processes already deallocated parallel_edited_image
+				free(parallel_edited_image); // a `dummy` Image
 				MPI_Finalize();
 				return 0;
 			}
@@ -175,59 +574,29 @@ int main(int argc, char **argv){
 				MPI_Abort(MPI_COMM_WORLD, -1);
 			}
 			
-			serial_time = omp_get_wtime();
-			serial_edited_image = image_processing_serial(argv[2], operation);
-			serial_time = omp_get_wtime() - serial_time;
-			if(serial_edited_image == NULL){ // error message was printed by the called function
+			check = verify_edited_image(argv[2], argv[3], operation, "Parallel SFT", parallel_edited_image, parallel_hash, parallel_time);
+			if(check == -1){ // error message was printed by the called function
 				MPI_Abort(MPI_COMM_WORLD, -1);
 			}
 			
-			if(images_are_identical(serial_edited_image, parallel_edited_image) == 1){
-				fprintf(stdout, "The serial and parallel edited images are identical.\n");
-				fprintf(stdout, "Serial time: %f\n", serial_time);
-				fprintf(stdout, "Parallel SFT time: %f\n", parallel_time);
-				fprintf(stdout, "Speedup: %f\n\n", serial_time / parallel_time);
-				fflush(stdout);
-			}
-			else{
-				fprintf(stdout, "The serial and parallel sft edited images are NOT identical!\n");
-				fflush(stdout);
-				
-				char file_name[256] = "";
-				char *aux = strrchr(argv[3], '\\');
-				int index = aux - argv[3];
-				strncat(file_name, argv[3], index + 1);
-				file_name[index + 1] = '\0';
-				strcat(file_name, "Serial_");
-				strcat(file_name, aux + 1);
-				fprintf(stdout, "Saving the serial edited image at %s...\n", file_name);
-				fflush(stdout);
-
-				int exit_code = save_BMP(file_name, serial_edited_image);
-				if(exit_code == -1){ // error message was printed by the called function
-					MPI_Abort(MPI_COMM_WORLD, -1);
-				}
-			}
-			
 			free(parallel_edited_image->data);
 			free(parallel_edited_image);
-			free(serial_edited_image->data);
-			free(serial_edited_image);
 		}
 		else{
-			Image *parallel_edited_image, *serial_edited_image;
-			double serial_time, parallel_time;
+			Image *parallel_edited_image;
+			unsigned long long parallel_hash = 0;
+			double parallel_time;
 			int check;
 			
 			if(my_rank == 0) parallel_time = omp_get_wtime();
-			parallel_edited_image = image_processing_parallel_no_sft(argv[2], operation, my_rank, num_processes, NUM_CORES, NUM_WORKSTATIONS);
+			parallel_edited_image = image_processing_parallel_no_sft(argv[2], operation, my_rank, num_processes, MPI_COMM_WORLD, NUM_CORES, NUM_WORKSTATIONS, (VERIFY_MODE == 1) ? &parallel_hash : NULL);
 			if(my_rank == 0) parallel_time = omp_get_wtime() - parallel_time;
 			if(parallel_edited_image == NULL){ // error message was printed by the called function
 				MPI_Abort(MPI_COMM_WORLD, -1);
 			}
 			
 			if(my_rank != 0){
-				// processes already deallocated parallel_edited_image
+				free(parallel_edited_image); // a `dummy` Image
 				MPI_Finalize();
 				return 0;
 			}
@@ -237,47 +606,20 @@ int main(int argc, char **argv){
 				MPI_Abort(MPI_COMM_WORLD, -1);
 			}
 			
-			serial_time = omp_get_wtime();
-			serial_edited_image = image_processing_serial(argv[2], operation);
-			serial_time = omp_get_wtime() - serial_time;
-			if(serial_edited_image == NULL){ // error message was printed by the called function
+			check = verify_edited_image(argv[2], argv[3], operation, "Parallel NO SFT", parallel_edited_image, parallel_hash, parallel_time);
+			if(check == -1){ // error message was printed by the called function
 				MPI_Abort(MPI_COMM_WORLD, -1);
 			}
 			
-			if(images_are_identical(serial_edited_image, parallel_edited_image) == 1){
-				fprintf(stdout, "The serial and parallel edited images are identical.\n");
-				fprintf(stdout, "Serial time: %f\n", serial_time);
-				fprintf(stdout, "Parallel NO SFT time: %f\n", parallel_time);
-				fprintf(stdout, "Speedup: %f\n\n", serial_time / parallel_time);
-				fflush(stdout);
-			}
-			else{
-				fprintf(stdout, "The serial and parallel no sft edited images are NOT identical!\n");
-				fflush(stdout);
-				
-				char file_name[256] = "";
-				char *aux = strrchr(argv[3], '\\');
-				int index = aux - argv[3];
-				strncat(file_name, argv[3], index + 1);
-				file_name[index + 1] = '\0';
-				strcat(file_name, "Serial_");
-				strcat(file_name, aux + 1);
-				fprintf(stdout, "Saving the serial edited image at %s...\n", file_name);
-				fflush(stdout);
-
-				int exit_code = save_BMP(file_name, serial_edited_image);
-				if(exit_code == -1){ // error message was printed by the called function
-					MPI_Abort(MPI_COMM_WORLD, -1);
-				}
-			}
-			
 			free(parallel_edited_image->data);
 			free(parallel_edited_image);
-			free(serial_edited_image->data);
-			free(serial_edited_image);
 		}
 	}
 	
+	if(TRANSFER_PRINT_REPORT){
+		print_transfer_report(my_rank);
+	}
+	
 	MPI_Finalize();
 	return 0;
 }
\ No newline at end of file
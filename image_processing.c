@@ -4,893 +4,1721 @@
 #include <omp.h>
 #include "bmp.h"
 #include "convolution.h"
+#include "tiled.h"
+#include "compression.h"
+#include "verification.h"
+#include "cache.h"
+#include "incremental.h"
+#include "image_processing.h"
+#include "blocks.h"
+#include "master.h"
+#include "master_sft.h"
+#include "shared_memory.h"
 
-#define WORK_HEADER_SEND_TAG 1
-#define WORK_DATA_SEND_TAG 2
-#define WORK_HEADER_RECEIVE_TAG 3
-#define WORK_DATA_RECEIVE_TAG 4
-#define TERMINATE_TAG 5
+#define SFT_BAND_TAG 6
+#define HALO_UP_TAG 9
+#define HALO_DOWN_TAG 10
+#define NO_SFT_BAND_TAG 11
+
+#define SFT_BAND_SIZE 64 // rows per pipelined band in the SFT version
+#define SFT_PRINT_TIMELINE 0 // set to 1 to print the per-band read/compute/send timeline of every process
+#define HIERARCHICAL_MASTER 1 // set to 0 to keep every worker of the Master/Worker version talking to process 0, even across several nodes
+#define NO_SFT_BAND_SIZE 64 // rows per band sent to process 0 while the rest of the strip is edited in the no SFT version
+#define NO_SFT_OVERLAP 1 // set to 0 to edit the whole strip after its halos arrived and compose it with compose_BMP (which can compress it)
+#define NO_SFT_PRINT_TIMELINE 0 // set to 1 to print the per-band compute/send timeline and the halo arrival of every process
+#define SHARED_MEMORY_WINDOWS 0 // set to 1 to share the Image between processes on the same node through MPI_Win_allocate_shared instead of sending its pixels (without the halo exchange, the 2D blocks, the hierarchy and the speculative copies)
+#define BLOCK_DECOMPOSITION 1 // set to 0 to always cut the image in strips in the parallel versions, instead of a grid of blocks when it has less halo
 
 /**
 *	IMAGE PROCESSING SERIAL
 */
 
-Image *image_processing_serial(const char *in_file_name, operation_t operation){
+Image *image_processing_serial(const char *in_file_name, operation_t operation, unsigned long long *hash){
 	/**
-	*	Takes in a file path to the file to edit and an operation_t.
-	*	It reads the .bmp file, edits the Image and returns the edited Image.
+	*	Takes in a file path to the file to edit (a .bmp file or a tiled image), an operation_t
+	*	and a place to store the hash of the edited Image (NULL if it is not needed).
+	*	It reads the file, edits the Image and returns the edited Image.
+	*	If RESULT_CACHE is set, an Image already edited with operation is taken from the result cache instead.
 	*/
 	
-	Image *img = read_BMP_serial(in_file_name);
+	Image *img = is_tiled_file(in_file_name) ? read_tiled_serial(in_file_name) : read_BMP_serial(in_file_name);
 	if(img == NULL){ // error message was printed by the called function
 		return NULL;
 	}
 	
-	Image *edited_img = perform_convolution_serial(img, operation);
+	unsigned long long input_hash;
+	Image *edited_img = NULL;
+	
+	if(RESULT_CACHE){
+		check_result_cache(in_file_name, img, operation, 0, MPI_COMM_NULL, 1, &input_hash, &edited_img);
+	}
+	
+	if(edited_img == NULL){
+		edited_img = perform_convolution_serial(img, operation);
+		
+		if(RESULT_CACHE && edited_img != NULL){
+			store_result_cache(input_hash, operation, edited_img); // a failed store only costs a later hit
+		}
+	}
 	free(img->data);
 	free(img);
 	
 	if(edited_img == NULL){ // error message was printed by the called function
 		return NULL;
 	}
-
+	
+	if(hash != NULL){
+		*hash = hash_image(edited_img, 1);
+	}
+	
 	return edited_img;
 }
 
 
 
 /**
-*	IMAGE PROCESSING PARALLEL SFT
+*	RESULT CACHE
 */
 
-Image *image_processing_parallel_sft(const char *in_file_name, operation_t operation, int my_rank, int num_processes, int num_cores){
+Image *cached_result(Image *cached_img, int my_rank, int num_threads, unsigned long long *hash){
 	/**
-	*	Takes in a file path to the file to edit, an operation_t, 
-	*	this process's rank, the total number of processes and the number of cores on this workstation.
-	*	It reads the process's associated chunk of the .bmp file, edits the Image chunk
-	*	and, if rank != 0, sends the edited Image chunk to process 0 and returns the edited Image chunk,
-	*	and if rank == 0, returns the whole edited Image.
+	*	Takes in the edited Image found in the result cache by process 0 (NULL on the other processes), this process's rank,
+	*	the number of threads to use and a place to store the hash of the edited Image on process 0 (NULL if it is not needed).
+	*	It returns the cached Image on process 0 and a `dummy` Image on the other processes, like the versions do.
 	*/
 	
-	int kernel_size = get_kernel_size(operation);
-	int halo_dim = kernel_size / 2;
-	int true_start, true_end;
-	
-	Image *img = read_BMP_MPI(in_file_name, my_rank, num_processes, halo_dim, &true_start, &true_end);
-	if(img == NULL){ // error message was printed by the called function
-		return NULL;
-	}
-	
-	int num_threads = max(1, num_cores / num_processes);
-	Image *edited_img = perform_convolution_parallel(img, operation, true_start, true_end, num_threads);
-	if(edited_img == NULL){ // error message was printed by the called function
-		return NULL;
+	if(my_rank == 0){
+		if(hash != NULL){
+			*hash = hash_image(cached_img, num_threads);
+		}
+		return cached_img;
 	}
 	
-	free(img->data);
-	free(img);
-	
-	Image *composed_img = compose_BMP(edited_img, my_rank, num_processes);
-	if(composed_img == NULL){ // error message was printed by the called function
+	Image *dummy = (Image*)malloc(sizeof(Image));
+	if(dummy == NULL){
+		fprintf(stderr, "Rank %d: Error in cached_result while allocating memory\n", my_rank);
+		fflush(stderr);
 		return NULL;
 	}
 	
-	free(edited_img->data);
-	free(edited_img);
-	
-	return composed_img;
+	dummy->data = NULL;
+	return dummy;
 }
 
 
 
 /**
-*	IMAGE PROCESSING NO PARALLEL SFT
+*	IMAGE PROCESSING PARALLEL SFT
 */
 
-int scatter_data(Image *img, RGB **data, int my_rank, int num_processes, int width, int *local_height, int halo_dim){
+typedef struct{
+	double read_posted, read_done, compute_start, compute_end, send_posted;
+}band_timeline_t; // moments (relative to the start of the function) at which each phase of a band happened
+
+void sft_strip_rows(int height, int num_processes, int rank, int *first_row, int *num_rows){
 	/**
-	*	Takes in an Image, a RGB data buffer, this process's rank, the total number of processes,
-	*	the width of the Image and the size of the halo.
-	*	If rank == 0, the process calculates how many rows (local_height) of the image each process gets,
-	*	informs each process about their height and sends them (including process 0) local_height rows of the Image.
-	*	If rank != 0, the process receives their respective number of rows (local_height) and their respective rows.
+	*	Takes in the height of the image, the total number of processes and a rank
+	*	and sets first_row and num_rows to the rows (in file order, without halos)
+	*	assigned to that rank. Rank 0 gets the first rows of the file, just like in read_BMP_MPI.
 	*/
 	
-	int check = 0;
-	int *heights = NULL;
-	int *displacements = NULL;
-	int *sends = NULL;
-	RGB *old_data = (img != NULL) ? img->data : NULL;
+	int true_rows = height / num_processes;
+	int remainder = height % num_processes;
 	
-	if(my_rank == 0){
-		int individual_height = img->height / num_processes;
-		int remainder = img->height % num_processes;
-		
-		heights = (int*)malloc(num_processes * sizeof(int));
-		if(heights == NULL){
-			fprintf(stderr, "Rank %d: Error in main while distributing height\n", my_rank);
-			fflush(stderr);
-			return -1;
-		}
-		
-		displacements = (int*)malloc(num_processes * sizeof(int));
-		if(displacements == NULL){
-			fprintf(stderr, "Rank %d: Error in main while distributing height\n", my_rank);
-			fflush(stderr);
-			return -1;
-		}
-		
-		for(int i = 0; i < num_processes; ++i){
-			heights[i] = individual_height + ((i < remainder) ? 1 : 0);
-			if(i == 0 || i == num_processes - 1) heights[i] += halo_dim;
-			else heights[i] += 2 * halo_dim;
-		}
-	}
+	*first_row = true_rows * rank + ((rank < remainder) ? rank : remainder);
+	*num_rows = true_rows + ((rank < remainder) ? 1 : 0);
+}
+
+int sft_check_file_size(MPI_File image_file_handler, int data_offset, int offset_stride, int height){
+	/**
+	*	Takes in the input file (opened with MPI-IO), the offset of its pixel data, the size of a row in the file and its number of rows.
+	*	The reads of the last rows of a truncated file would be short, or would never complete with some MPI-IO implementations,
+	*	so the size of the file is checked before any row is read.
+	*	It returns 0 if the file holds every row and -1 otherwise.
+	*/
 	
-	// sending local_height to every process
-	check = MPI_Scatter(
-		heights, 1, MPI_INT,
-		local_height, 1, MPI_INT,
-		0, MPI_COMM_WORLD
-	);
+	MPI_Offset file_size;
+	int check = MPI_File_get_size(image_file_handler, &file_size);
+	return (check == MPI_SUCCESS && file_size >= data_offset + (MPI_Offset)height * offset_stride) ? 0 : -1;
+}
+
+int sft_read_rows(MPI_File image_file_handler, tiled_image_t *tiled, int data_offset, int offset_stride, int first_row, int end_row, unsigned char *buffer, MPI_Request *request){
+	/**
+	*	Takes in the input file (opened with MPI-IO, or a tiled image if tiled != NULL), the offset of its pixel data,
+	*	the size of a row in the file, the rows [first_row, end_row) to read and the buffer to read them into.
+	*	Rows of a .bmp file are read with MPI_File_iread_at and request has to be waited for,
+	*	while rows of a tiled image are read right away and request is set to MPI_REQUEST_NULL.
+	*	It returns 0 on success and -1 on failure.
+	*/
 	
-	if(check != MPI_SUCCESS){
-		fprintf(stderr, "Rank %d: Error in main while distributing height\n", my_rank);
-		fflush(stderr);
-		return -1;
+	if(tiled != NULL){
+		*request = MPI_REQUEST_NULL;
+		if(end_row <= first_row) return 0;
+		return read_tiled_rect(tiled, 0, first_row, tiled->width, end_row - first_row, buffer);
 	}
 	
-	if(my_rank == 0){
-		sends = (int*)malloc(num_processes * sizeof(int));
-		if(sends == NULL){
-			fprintf(stderr, "Rank %d: Error in main while distributing height\n", my_rank);
-			fflush(stderr);
-			return -1;
-		}
-		
-		int offset = 0;
-		for(int i = 0; i < num_processes; ++i){
-			displacements[i] = offset;
-			offset += (heights[i] - 2 * halo_dim) * width;
-			sends[i] = heights[i] * width;
-		}
-	}
+	int check = MPI_File_iread_at(image_file_handler, data_offset + (MPI_Offset)first_row * offset_stride,
+		buffer, (end_row - first_row) * offset_stride, MPI_UNSIGNED_CHAR, request);
+	return (check == MPI_SUCCESS) ? 0 : -1;
+}
+
+void print_sft_timeline(band_timeline_t *timeline, int num_bands, double sends_done, int my_rank){
+	/**
+	*	Takes in the timeline of each band of this process, the number of bands,
+	*	the moment all the sends completed and this process's rank and prints them.
+	*	A band's read overlapping the previous band's compute shows the phases running concurrently.
+	*/
 	
-	// allocating data
-	*data = (RGB *)malloc(width * (*local_height) * sizeof(RGB));
-	if(data == NULL){
-		fprintf(stderr, "Rank %d: Error in main while allocating memory\n", my_rank);
-		fflush(stderr);
-		return -1;
+	for(int k = 0; k < num_bands; ++k){
+		fprintf(stdout, "Rank %d band %d: read [%f, %f] compute [%f, %f] send posted %f\n", my_rank, k,
+			timeline[k].read_posted, timeline[k].read_done,
+			timeline[k].compute_start, timeline[k].compute_end,
+			timeline[k].send_posted);
 	}
+	fprintf(stdout, "Rank %d: all sends completed at %f\n", my_rank, sends_done);
+	fflush(stdout);
+}
 
-	MPI_Datatype mpi_rgb = create_mpi_datatype_for_RGB();
+void release_sft_strip(MPI_File *image_file_handler, tiled_image_t *tiled, MPI_Request *read_request, Image **edited_bands, int num_bands, MPI_Request *send_requests, MPI_Request *receive_requests, int num_receives, band_timeline_t *timeline, unsigned char *raw, unsigned char *data, unsigned char *new_data, MPI_Datatype *mpi_pixel, int my_rank){
+	/**
+	*	Takes in what image_processing_parallel_sft set up before it failed: the input file (or tiled image), the pending read,
+	*	the edited bands (NULL for the bands not edited yet) and their sends, the receives posted by process 0 (NULL on the other processes),
+	*	the timeline, the buffers of the strip and of the edited Image, the datatype of a pixel and this process's rank.
+	*	It waits for the read and the sends to complete, cancels the receives and frees everything.
+	*/
 	
-	check = MPI_Scatterv(
-		old_data, sends, displacements, mpi_rgb,
-		*data, (*local_height) * width, mpi_rgb,
-		0, MPI_COMM_WORLD
-	);
+	MPI_Wait(read_request, MPI_STATUS_IGNORE);
+	MPI_Waitall(num_bands, send_requests, MPI_STATUSES_IGNORE);
 	
-	if(check != MPI_SUCCESS){
-		fprintf(stderr, "Rank %d: Error in main while comunicating data\n", my_rank);
-		fflush(stderr);
-		return -1;
+	for(int i = 0; i < num_receives; ++i){
+		if(receive_requests[i] != MPI_REQUEST_NULL){
+			MPI_Cancel(&receive_requests[i]);
+			MPI_Wait(&receive_requests[i], MPI_STATUS_IGNORE);
+		}
 	}
 	
-	check = MPI_Type_free(&mpi_rgb);
-	if(check != MPI_SUCCESS){
-		fprintf(stderr, "Rank %d: Error in compose_BMP while de-allocating data type\n", my_rank);
-		fflush(stderr);
-		return -1;
+	for(int k = 0; k < num_bands; ++k){
+		if(edited_bands[k] != NULL){
+			free(edited_bands[k]->data);
+			free(edited_bands[k]);
+		}
 	}
-	return 0;
+	free(edited_bands);
+	free(send_requests);
+	free(receive_requests);
+	free(timeline);
+	if(raw != data) free(raw);
+	free(data);
+	free(new_data);
+	
+	deallocate_MPI_datatype(mpi_pixel, my_rank);
+	if(tiled != NULL) close_tiled(tiled);
+	else MPI_File_close(image_file_handler);
 }
 
-Image *image_processing_parallel_no_sft(const char *in_file_name, operation_t operation, int my_rank, int num_processes, int num_cores, int num_workstations){
+Image *image_processing_parallel_sft(const char *in_file_name, operation_t operation, int my_rank, int num_processes, MPI_Comm comm, int num_cores, unsigned long long *hash){
 	/**
-	*	Takes in a file path to the file to edit, an operation_t, this process's rank,
-	*	the total number of processes, the number of cores on this workstation
-	*	and the total number of workstations.
-	*	If rank == 0, the process reads the whole .bmp file, distributes chunks of the Image to each process (including process 0),
-	*	edits its respective chunk, composes the whole edited Image and returns it.
-	*	If rank != 0, the process receives its respective chunk, edits it, sends the edited chunk to process 0
-	*	and returns the edited Image chunk.
+	*	Takes in a file path to the file to edit (a .bmp file or a tiled image), an operation_t, 
+	*	this process's rank, the total number of processes, the communicator of the processes editing the Image
+	*	(MPI_COMM_WORLD or the communicator of a batch group), the number of cores on this workstation
+	*	and a place to store the hash of the edited Image on process 0 (NULL if it is not needed).
+	*	Each process splits its associated strip of the file into bands of SFT_BAND_SIZE rows and pipelines them:
+	*	while band k is edited, band k + 1 is being read with MPI_File_iread_at and band k - 1 is being sent
+	*	to process 0 with MPI_Isend, so reading, computing and communicating overlap.
+	*	The bands of a tiled image are read directly, a few large reads each, before band k is edited.
+	*	While band k is being sent, its process hashes it, and the hashes of all the processes are added on process 0.
+	*	If RESULT_CACHE is set, process 0 first hashes the file and looks it up in the result cache;
+	*	on a hit, no process reads or edits anything.
+	*	If rank == 0, it returns the whole edited Image, and if rank != 0, it returns a `dummy` Image.
 	*/
 	
+	double start_time = MPI_Wtime();
 	int kernel_size = get_kernel_size(operation);
 	int halo_dim = kernel_size / 2;
 	int check;
-	int height, width;
-	int local_height;
-	RGB *data = NULL;
-	Image *img = NULL;
+	int width, height, channels, top_down, data_offset, padding;
+	MPI_File image_file_handler = MPI_FILE_NULL;
+	tiled_image_t *tiled = NULL;
+	unsigned long long input_hash;
 	
-	if(my_rank == 0){
-		img = read_BMP_serial(in_file_name);
-		if(img == NULL){ // error message was printed by the called function
+	if(RESULT_CACHE){
+		Image *cached_img;
+		check = check_result_cache(in_file_name, NULL, operation, my_rank, comm, max(1, num_cores / num_processes), &input_hash, &cached_img);
+		if(check == -1){ // error message was printed by the called function
+			return NULL;
+		}
+		if(check == 1){
+			return cached_result(cached_img, my_rank, max(1, num_cores / num_processes), hash);
+		}
+	}
+	
+	if(BLOCK_DECOMPOSITION){
+		int image_info[4], dims[2];
+		check = choose_block_grid(in_file_name, NULL, 1, my_rank, num_processes, comm, image_info, dims);
+		if(check != 0){ // error message was printed by the called function
 			return NULL;
 		}
 		
-		width = img->width;
-		height = img->height;
+		if(dims[1] > 1){ // a grid of blocks has less halo than the strips
+			Image *img = image_processing_blocks(in_file_name, NULL, operation, 1, image_info, dims, my_rank, num_processes, comm, max(1, num_cores / num_processes), hash);
+			if(RESULT_CACHE && my_rank == 0 && img != NULL){
+				store_result_cache(input_hash, operation, img); // a failed store only costs a later hit
+			}
+			return img;
+		}
 	}
 	
-	check = MPI_Bcast(&width, 1, MPI_INT, 0, MPI_COMM_WORLD);
-	if(check != MPI_SUCCESS){
-		fprintf(stderr, "Rank %d: Error in main while broadcasting width\n", my_rank);
+	if(is_tiled_file(in_file_name)){
+		tiled = open_tiled(in_file_name);
+		if(tiled == NULL){ // error message was printed by the called function
+			return NULL;
+		}
+		
+		width = tiled->width;
+		height = tiled->height;
+		channels = tiled->channels;
+		top_down = tiled->top_down;
+		data_offset = 0;
+		padding = 0;
+	}
+	else{
+		check = MPI_File_open(comm, in_file_name, MPI_MODE_RDONLY, MPI_INFO_NULL, &image_file_handler);
+		if(check != MPI_SUCCESS){
+			fprintf(stderr, "Rank %d: Error in image_processing_parallel_sft while opening file %s\n", my_rank, in_file_name);
+			fflush(stderr);
+			return NULL;
+		}
+		
+		unsigned char header[BMP_MAX_HEADER_SIZE];
+		MPI_Status status;
+		int header_size;
+		
+		check = MPI_File_read_at_all(image_file_handler, 0, header, BMP_MAX_HEADER_SIZE, MPI_UNSIGNED_CHAR, &status);
+		if(check != MPI_SUCCESS){
+			fprintf(stderr, "Rank %d: Error in image_processing_parallel_sft while reading from file %s\n", my_rank, in_file_name);
+			fflush(stderr);
+			MPI_File_close(&image_file_handler);
+			return NULL;
+		}
+		MPI_Get_count(&status, MPI_UNSIGNED_CHAR, &header_size);
+		
+		check = parse_BMP_header(header, header_size, &height, &width, &channels, &top_down, &data_offset, &padding, my_rank == 0);
+		if(check != 0){ // error message was printed by the called function
+			MPI_File_close(&image_file_handler);
+			return NULL;
+		}
+		
+		check = sft_check_file_size(image_file_handler, data_offset, width * channels + padding, height);
+		if(check != 0){
+			fprintf(stderr, "Rank %d: Error in image_processing_parallel_sft, file %s is shorter than its header says\n", my_rank, in_file_name);
+			fflush(stderr);
+			MPI_File_close(&image_file_handler);
+			return NULL;
+		}
+	}
+	
+	int row_size = width * channels;
+	int offset_stride = row_size + padding;
+	
+	// this process's strip (file order) and the rows it has to read, halos included
+	int first_row, num_rows;
+	sft_strip_rows(height, num_processes, my_rank, &first_row, &num_rows);
+	int window_start = max(first_row - halo_dim, 0);
+	int window_end = min(first_row + num_rows + halo_dim, height);
+	int window_rows = window_end - window_start;
+	int num_bands = (num_rows + SFT_BAND_SIZE - 1) / SFT_BAND_SIZE;
+	int num_threads = max(1, num_cores / num_processes);
+	
+	// rows without padding are read straight into data, the others go through raw to drop the padding
+	unsigned char *data = (unsigned char*)malloc((size_t)window_rows * row_size);
+	unsigned char *raw = (padding == 0) ? data : (unsigned char*)malloc((size_t)window_rows * offset_stride);
+	unsigned long long rows_hash = 0;
+	Image **edited_bands = (Image**)calloc(num_bands + 1, sizeof(Image*));
+	MPI_Request *send_requests = (MPI_Request*)malloc((num_bands + 1) * sizeof(MPI_Request));
+	band_timeline_t *timeline = (band_timeline_t*)malloc((num_bands + 1) * sizeof(band_timeline_t));
+	if(raw == NULL || data == NULL || edited_bands == NULL || send_requests == NULL || timeline == NULL){
+		fprintf(stderr, "Rank %d: Error in image_processing_parallel_sft while allocating memory\n", my_rank);
 		fflush(stderr);
+		if(raw != data) free(raw);
+		free(data);
+		free(edited_bands);
+		free(send_requests);
+		free(timeline);
+		if(tiled != NULL) close_tiled(tiled);
+		else MPI_File_close(&image_file_handler);
 		return NULL;
 	}
 	
-	check = scatter_data(img, &data, my_rank, num_processes, width, &local_height, halo_dim);
-	if(check != 0){ // error message was printed by the called function
-		return NULL;;
+	for(int k = 0; k <= num_bands; ++k){
+		send_requests[k] = MPI_REQUEST_NULL;
 	}
 	
+	MPI_Datatype mpi_pixel = create_mpi_datatype_for_pixel(channels);
+	unsigned char *new_data = NULL;
+	MPI_Request *receive_requests = NULL;
+	int num_receives = 0;
+	MPI_Request read_request = MPI_REQUEST_NULL;
+	
 	if(my_rank == 0){
-		free(img->data);
-		free(img);
+		// posting the receives for every band of every other process, in the order they will be sent
+		int total_bands = 0;
+		for(int rank = 1; rank < num_processes; ++rank){
+			int rank_first_row, rank_num_rows;
+			sft_strip_rows(height, num_processes, rank, &rank_first_row, &rank_num_rows);
+			total_bands += (rank_num_rows + SFT_BAND_SIZE - 1) / SFT_BAND_SIZE;
+		}
+		
+		new_data = (unsigned char*)malloc((size_t)height * row_size);
+		receive_requests = (MPI_Request*)malloc((total_bands + 1) * sizeof(MPI_Request));
+		if(new_data == NULL || receive_requests == NULL){
+			fprintf(stderr, "Rank %d: Error in image_processing_parallel_sft while allocating memory\n", my_rank);
+			fflush(stderr);
+			release_sft_strip(&image_file_handler, tiled, &read_request, edited_bands, num_bands, send_requests, receive_requests, num_receives, timeline, raw, data, new_data, &mpi_pixel, my_rank);
+			return NULL;
+		}
+		
+		for(int rank = 1; rank < num_processes; ++rank){
+			int rank_first_row, rank_num_rows;
+			sft_strip_rows(height, num_processes, rank, &rank_first_row, &rank_num_rows);
+			
+			for(int band_start = rank_first_row; band_start < rank_first_row + rank_num_rows; band_start += SFT_BAND_SIZE){
+				int band_end = min(band_start + SFT_BAND_SIZE, rank_first_row + rank_num_rows);
+				
+				check = MPI_Irecv(new_data + (size_t)band_start * row_size, (band_end - band_start) * width, mpi_pixel,
+					rank, SFT_BAND_TAG, comm, &receive_requests[num_receives]);
+				if(check != MPI_SUCCESS){
+					fprintf(stderr, "Rank %d: Error in image_processing_parallel_sft while posting receives\n", my_rank);
+					fflush(stderr);
+					release_sft_strip(&image_file_handler, tiled, &read_request, edited_bands, num_bands, send_requests, receive_requests, num_receives, timeline, raw, data, new_data, &mpi_pixel, my_rank);
+					return NULL;
+				}
+				++num_receives;
+			}
+		}
 	}
 	
-	Image *new_image = (Image*)malloc(sizeof(Image));
-	if(new_image == NULL){
-		fprintf(stderr, "Rank %d: Error in main while allocating memory\n", my_rank);
+	/**
+	*	Read unit k holds the rows needed by band k which were not needed by band k - 1.
+	*	data holds the whole window in file order, so file row r is row r - window_start of data.
+	*/
+	int read_start = window_start;
+	int read_end = min(first_row + min(SFT_BAND_SIZE, num_rows) + halo_dim, window_end);
+	
+	if(num_bands > 0){
+		timeline[0].read_posted = MPI_Wtime() - start_time;
+		check = sft_read_rows(image_file_handler, tiled, data_offset, offset_stride, read_start, read_end,
+			raw + (size_t)(read_start - window_start) * offset_stride, &read_request);
+		if(check != 0){
+			fprintf(stderr, "Rank %d: Error in image_processing_parallel_sft while reading from file %s\n", my_rank, in_file_name);
+			fflush(stderr);
+			release_sft_strip(&image_file_handler, tiled, &read_request, edited_bands, num_bands, send_requests, receive_requests, num_receives, timeline, raw, data, new_data, &mpi_pixel, my_rank);
+			return NULL;
+		}
+	}
+	
+	for(int k = 0; k < num_bands; ++k){
+		int band_start = first_row + k * SFT_BAND_SIZE;
+		int band_end = min(band_start + SFT_BAND_SIZE, first_row + num_rows);
+		
+		// a read of a .bmp file truncated since its size was checked is short, so the bytes which arrived are checked too
+		MPI_Status read_status;
+		int read_bytes;
+		check = MPI_Wait(&read_request, &read_status);
+		if(check == MPI_SUCCESS && tiled == NULL){
+			MPI_Get_count(&read_status, MPI_UNSIGNED_CHAR, &read_bytes);
+			if(read_bytes != (read_end - read_start) * offset_stride) check = -1;
+		}
+		if(check != MPI_SUCCESS){
+			fprintf(stderr, "Rank %d: Error in image_processing_parallel_sft while reading from file %s\n", my_rank, in_file_name);
+			fflush(stderr);
+			release_sft_strip(&image_file_handler, tiled, &read_request, edited_bands, num_bands, send_requests, receive_requests, num_receives, timeline, raw, data, new_data, &mpi_pixel, my_rank);
+			return NULL;
+		}
+		timeline[k].read_done = MPI_Wtime() - start_time;
+		
+		int ready_start = read_start;
+		int ready_end = read_end;
+		
+		// starting to read the next band before editing this one
+		if(k + 1 < num_bands){
+			read_start = read_end;
+			read_end = min(band_end + SFT_BAND_SIZE + halo_dim, window_end);
+			
+			timeline[k + 1].read_posted = MPI_Wtime() - start_time;
+			check = sft_read_rows(image_file_handler, tiled, data_offset, offset_stride, read_start, read_end,
+				raw + (size_t)(read_start - window_start) * offset_stride, &read_request);
+			if(check != 0){
+				fprintf(stderr, "Rank %d: Error in image_processing_parallel_sft while reading from file %s\n", my_rank, in_file_name);
+				fflush(stderr);
+				release_sft_strip(&image_file_handler, tiled, &read_request, edited_bands, num_bands, send_requests, receive_requests, num_receives, timeline, raw, data, new_data, &mpi_pixel, my_rank);
+				return NULL;
+			}
+		}
+		
+		timeline[k].compute_start = MPI_Wtime() - start_time;
+		
+		if(raw != data){
+			for(int r = ready_start - window_start; r < ready_end - window_start; ++r){
+				memcpy(data + (size_t)r * row_size, raw + (size_t)r * offset_stride, row_size);
+			}
+		}
+		
+		// the band's window is a view into data, holding the band and its halos
+		int band_window_start = max(band_start - halo_dim, 0);
+		int band_window_end = min(band_end + halo_dim, height);
+		Image band_window;
+		band_window.width = width;
+		band_window.height = band_window_end - band_window_start;
+		band_window.channels = channels;
+		band_window.top_down = top_down;
+		band_window.data = data + (size_t)(band_window_start - window_start) * row_size;
+		
+		edited_bands[k] = perform_convolution_parallel(&band_window, operation, band_start - band_window_start, band_end - 1 - band_window_start, num_threads);
+		if(edited_bands[k] == NULL){ // error message was printed by the called function
+			release_sft_strip(&image_file_handler, tiled, &read_request, edited_bands, num_bands, send_requests, receive_requests, num_receives, timeline, raw, data, new_data, &mpi_pixel, my_rank);
+			return NULL;
+		}
+		
+		timeline[k].compute_end = MPI_Wtime() - start_time;
+		timeline[k].send_posted = timeline[k].compute_end;
+		
+		if(my_rank == 0){
+			memcpy(new_data + (size_t)band_start * row_size, edited_bands[k]->data, (size_t)(band_end - band_start) * row_size);
+			send_requests[k] = MPI_REQUEST_NULL;
+		}
+		else{
+			check = MPI_Isend(edited_bands[k]->data, (band_end - band_start) * width, mpi_pixel, 0, SFT_BAND_TAG, comm, &send_requests[k]);
+			if(check != MPI_SUCCESS){
+				fprintf(stderr, "Rank %d: Error in image_processing_parallel_sft while sending band\n", my_rank);
+				fflush(stderr);
+				release_sft_strip(&image_file_handler, tiled, &read_request, edited_bands, num_bands, send_requests, receive_requests, num_receives, timeline, raw, data, new_data, &mpi_pixel, my_rank);
+				return NULL;
+			}
+		}
+		
+		if(hash != NULL){
+			rows_hash += hash_rows(edited_bands[k]->data, band_start, band_end - band_start, width, channels, num_threads);
+		}
+	}
+	
+	check = MPI_Waitall(num_bands, send_requests, MPI_STATUSES_IGNORE);
+	if(check != MPI_SUCCESS){
+		fprintf(stderr, "Rank %d: Error in image_processing_parallel_sft while sending bands\n", my_rank);
 		fflush(stderr);
+		release_sft_strip(&image_file_handler, tiled, &read_request, edited_bands, num_bands, send_requests, receive_requests, num_receives, timeline, raw, data, new_data, &mpi_pixel, my_rank);
 		return NULL;
 	}
+	double sends_done = MPI_Wtime() - start_time;
 	
-	new_image->height = local_height;
-	new_image->width = width;
-	new_image->data = data;
-	
-	int true_start, true_end;
+	if(my_rank == 0){
+		check = MPI_Waitall(num_receives, receive_requests, MPI_STATUSES_IGNORE);
+		if(check != MPI_SUCCESS){
+			fprintf(stderr, "Rank %d: Error in image_processing_parallel_sft while receiving bands\n", my_rank);
+			fflush(stderr);
+			release_sft_strip(&image_file_handler, tiled, &read_request, edited_bands, num_bands, send_requests, receive_requests, num_receives, timeline, raw, data, new_data, &mpi_pixel, my_rank);
+			return NULL;
+		}
+		free(receive_requests);
+		receive_requests = NULL;
+		num_receives = 0;
+	}
 	
-	if(my_rank > 0) true_start = halo_dim;
-	else true_start = 0;
+	if(SFT_PRINT_TIMELINE){
+		print_sft_timeline(timeline, num_bands, sends_done, my_rank);
+	}
 	
-	if(my_rank < num_processes - 1) true_end = local_height - halo_dim - 1;
-	else true_end = local_height - 1;
+	if(hash != NULL){
+		check = reduce_image_hash(rows_hash, height, width, channels, hash, my_rank, comm);
+		if(check != 0){ // error message was printed by the called function
+			release_sft_strip(&image_file_handler, tiled, &read_request, edited_bands, num_bands, send_requests, receive_requests, num_receives, timeline, raw, data, new_data, &mpi_pixel, my_rank);
+			return NULL;
+		}
+	}
 	
-	int num_threads = max(1, num_cores / (num_processes / num_workstations));
+	for(int k = 0; k < num_bands; ++k){
+		free(edited_bands[k]->data);
+		free(edited_bands[k]);
+	}
+	free(edited_bands);
+	free(send_requests);
+	free(timeline);
+	if(raw != data) free(raw);
+	free(data);
 	
-	Image *edited_img = perform_convolution_parallel(new_image, operation, true_start, true_end, num_threads);
-	if(edited_img == NULL){ // error message was printed by the called function
+	check = deallocate_MPI_datatype(&mpi_pixel, my_rank);
+	if(check != 0){ // error message was printed by the called function
 		return NULL;
 	}
 	
-	Image *composed_img = compose_BMP(edited_img, my_rank, num_processes);
-	if(composed_img == NULL){ // error message was printed by the called function
+	if(tiled != NULL){
+		close_tiled(tiled);
+	}
+	else{
+		check = MPI_File_close(&image_file_handler);
+		if(check != MPI_SUCCESS){
+			fprintf(stderr, "Rank %d: Error in image_processing_parallel_sft while closing file %s\n", my_rank, in_file_name);
+			fflush(stderr);
+			return NULL;
+		}
+	}
+	
+	Image *img = (Image*)malloc(sizeof(Image));
+	if(img == NULL){
+		fprintf(stderr, "Rank %d: Error in image_processing_parallel_sft while allocating memory\n", my_rank);
+		fflush(stderr);
+		free(new_data);
 		return NULL;
 	}
 	
-	free(edited_img->data);
-	free(edited_img);
+	img->width = width;
+	img->height = height;
+	img->channels = channels;
+	img->top_down = top_down;
+	img->data = new_data; // NULL for ranks != 0
 	
-	return composed_img;
+	if(RESULT_CACHE && my_rank == 0){
+		store_result_cache(input_hash, operation, img); // a failed store only costs a later hit
+	}
+	
+	return img;
 }
 
 
 
 /**
-*	IMAGE PROCESSING MASTER/WORKER
+*	IMAGE PROCESSING NO PARALLEL SFT
 */
 
-int send_work(int worker_process, operation_t operation, int *work_done, FILE *image_file, int halo_dim, int chunk_size, int height, int width, int padding, int data_start, int *offset, int num_threads){
+int neighbour_rows(int height, int num_processes, int rank, int direction, int rounds, int halo_dim){
 	/**
-	*	Takes in the rank of the procees which needs to receive work, an operation_t,
-	*	a FILE* coresponding to the open .bmp file, the size of the halo, the size of a chunk,
-	*	the height, width, data_start and padding of the Image, the offset at which to read
-	* 	and the number of threads the worker process can use.
-	*	It reads a chunk of the Image and sends it, along with the required data, to the worker process.
-	*	If there is no more work to be done, it sets work_done to 1 and returns without sending any work to the worker process.
+	*	Takes in the height of the Image, the total number of processes, a rank, a direction (1 for the strips below it in the file,
+	*	-1 for the strips above it), a number of halo exchange rounds and the size of the halo.
+	*	It returns how many rows of halo the rank has on that side after that many rounds of exchange_halos:
+	*	the rows of the next rounds strips on that side, capped at halo_dim.
 	*/
 	
-	int true_start, true_end, check;
-	Image *chunk_image = NULL;
-	MPI_Datatype mpi_send_block = create_mpi_datatype_for_send_block_t();
-	MPI_Datatype mpi_rgb = create_mpi_datatype_for_RGB();
+	int rows = 0;
 	
-	chunk_image = read_BMP_chunk(image_file, halo_dim, chunk_size, height, width, padding, data_start, offset, &true_start, &true_end);
-	if(chunk_image == NULL){ // error message was printed by the called function
-		return -1;
-	}
-
-	if(chunk_image->data == NULL){
-		*work_done = 1;
-		fclose(image_file);
-		free(chunk_image);
-		return 0;
+	for(int k = 1; k <= rounds && rows < halo_dim; ++k){
+		int neighbour = rank + direction * k;
+		if(neighbour < 0 || neighbour >= num_processes) break;
+		
+		int first_row, num_rows;
+		sft_strip_rows(height, num_processes, neighbour, &first_row, &num_rows);
+		rows += num_rows;
 	}
+	
+	return min(rows, halo_dim);
+}
 
-	send_block_t block;
-	block.true_start = true_start;
-	block.true_end = true_end;
-	block.height = chunk_image->height;
-	block.width = width;
-	block.operation = operation;
-	block.num_threads = num_threads;
-
-	check = MPI_Send(&block, 1, mpi_send_block, worker_process, WORK_HEADER_SEND_TAG, MPI_COMM_WORLD);
-	if(check != MPI_SUCCESS){
-		fprintf(stderr, "Rank 0: Error in master_process while sending work header\n");
-		fflush(stderr);
-		
-		check = deallocate_MPI_datatype(&mpi_send_block, 0);
-		if(check == -1){ // error message was printed by the called function
-			return -1;
-		}
+int exchange_halos(unsigned char *data, int num_rows, int top_halo, int height, int width, int channels, int halo_dim, int my_rank, int num_processes, MPI_Comm strips){
+	/**
+	*	Takes in the rows of a strip with room for its halos (top_halo rows above it and the rows of the bottom halo below it),
+	*	the number of rows of the strip, the height, width and number of channels of the Image, the size of the halo, this process's rank,
+	*	the total number of processes and their 1D process topology (one strip per process, in file order).
+	*	Every process sends its first rows to the process above it and its last rows to the process below it with MPI_Sendrecv,
+	*	so the halos travel between neighbours instead of from process 0. When the strips are thinner than the halo,
+	*	the exchange is repeated and every round forwards the rows received in the previous one.
+	*	It can be called again on the same buffer after every pass of a multi-pass operation.
+	*	It returns 0 on success and -1 on failure.
+	*/
+	
+	int check;
+	int above, below;
+	size_t row_size = (size_t)width * channels;
+	
+	check = MPI_Cart_shift(strips, 0, 1, &above, &below); // MPI_PROC_NULL past the first and the last strip
+	if(check != MPI_SUCCESS){
+		fprintf(stderr, "Rank %d: Error in exchange_halos while finding the neighbouring strips\n", my_rank);
+		fflush(stderr);
+		return -1;
+	}
+	
+	int rounds = 1;
+	while(rounds < num_processes - 1 && rounds * (height / num_processes) < halo_dim) ++rounds;
+	
+	for(int round = 1; round <= rounds; ++round){
+		int have_above = neighbour_rows(height, num_processes, my_rank, -1, round - 1, halo_dim);
+		int have_below = neighbour_rows(height, num_processes, my_rank, 1, round - 1, halo_dim);
+		int send_up = min(halo_dim, num_rows + have_below);
+		int send_down = min(halo_dim, num_rows + have_above);
+		int receive_above = neighbour_rows(height, num_processes, my_rank, -1, round, halo_dim);
+		int receive_below = neighbour_rows(height, num_processes, my_rank, 1, round, halo_dim);
 		
-		check = deallocate_MPI_datatype(&mpi_rgb, 0);
-		if(check == -1){ // error message was printed by the called function
+		unsigned char *strip = data + top_halo * row_size;
+		
+		// the first rows go up and the bottom halo comes from below
+		check = MPI_Sendrecv(
+			strip, (above != MPI_PROC_NULL) ? send_up * row_size : 0, MPI_UNSIGNED_CHAR, above, HALO_UP_TAG,
+			strip + num_rows * row_size, receive_below * row_size, MPI_UNSIGNED_CHAR, below, HALO_UP_TAG,
+			strips, MPI_STATUS_IGNORE
+		);
+		
+		// the last rows go down and the top halo comes from above
+		if(check == MPI_SUCCESS) check = MPI_Sendrecv(
+			strip + ((size_t)num_rows - send_down) * row_size, (below != MPI_PROC_NULL) ? send_down * row_size : 0, MPI_UNSIGNED_CHAR, below, HALO_DOWN_TAG,
+			strip - receive_above * row_size, receive_above * row_size, MPI_UNSIGNED_CHAR, above, HALO_DOWN_TAG,
+			strips, MPI_STATUS_IGNORE
+		);
+		
+		if(check != MPI_SUCCESS){
+			fprintf(stderr, "Rank %d: Error in exchange_halos while exchanging the halos\n", my_rank);
+			fflush(stderr);
 			return -1;
 		}
-		
-		return -1;
 	}
+	
+	return 0;
+}
 
-	check = MPI_Send(chunk_image->data, chunk_image->height * chunk_image->width, mpi_rgb, worker_process, WORK_DATA_SEND_TAG, MPI_COMM_WORLD);
-	if(check != MPI_SUCCESS){
-		fprintf(stderr, "Rank 0: Error in master_process while sending work data\n");
-		fflush(stderr);
-		
-		check = deallocate_MPI_datatype(&mpi_send_block, 0);
-		if(check == -1){ // error message was printed by the called function
+int scatter_data(Image *img, unsigned char **data, int my_rank, int num_processes, MPI_Comm comm, int height, int width, int channels, int *local_height, int *true_start, int halo_dim){
+	/**
+	*	Takes in an Image, a place to store a pixel data buffer, this process's rank, the total number of processes,
+	*	the communicator of the processes, the height, width and number of channels of the Image, a place to store
+	*	the number of rows of the buffer, a place to store the first row of the buffer which is not a halo row and the size of the halo.
+	*	Every process gets a strip of the Image (sft_strip_rows) in its buffer, with room for its halos around it.
+	*	Process 0 scatters only the rows of the strips, without any halo: the processes get their halos
+	*	from their neighbours afterwards (exchange_halos or post_halo_exchange).
+	*	It returns 0 on success and -1 on failure.
+	*/
+	
+	int check = 0;
+	int *sends = NULL;
+	int *displacements = NULL;
+	unsigned char *old_data = (img != NULL) ? img->data : NULL;
+	
+	if(my_rank == 0){
+		sends = (int*)malloc(num_processes * sizeof(int));
+		displacements = (int*)malloc(num_processes * sizeof(int));
+		if(sends == NULL || displacements == NULL){
+			fprintf(stderr, "Rank %d: Error in scatter_data while allocating memory\n", my_rank);
+			fflush(stderr);
+			free(sends);
+			free(displacements);
 			return -1;
 		}
 		
-		check = deallocate_MPI_datatype(&mpi_rgb, 0);
-		if(check == -1){ // error message was printed by the called function
-			return -1;
+		for(int i = 0; i < num_processes; ++i){
+			int first_row, num_rows;
+			sft_strip_rows(height, num_processes, i, &first_row, &num_rows);
+			displacements[i] = first_row * width;
+			sends[i] = num_rows * width;
 		}
-		
+	}
+	
+	int first_row, num_rows;
+	sft_strip_rows(height, num_processes, my_rank, &first_row, &num_rows);
+	*true_start = neighbour_rows(height, num_processes, my_rank, -1, num_processes, halo_dim);
+	*local_height = *true_start + num_rows + neighbour_rows(height, num_processes, my_rank, 1, num_processes, halo_dim);
+	size_t row_size = (size_t)width * channels;
+	
+	// allocating data
+	*data = (unsigned char *)malloc(row_size * (*local_height));
+	if(*data == NULL){
+		fprintf(stderr, "Rank %d: Error in scatter_data while allocating memory\n", my_rank);
+		fflush(stderr);
+		free(sends);
+		free(displacements);
 		return -1;
 	}
 	
-	check = deallocate_MPI_datatype(&mpi_send_block, 0);
-	if(check == -1){ // error message was printed by the called function
+	MPI_Datatype mpi_pixel = create_mpi_datatype_for_pixel(channels);
+	
+	check = scatterv_pixels(
+		old_data, sends, displacements,
+		*data + (*true_start) * row_size, num_rows * width, mpi_pixel,
+		width, channels, 0, comm
+	);
+	free(sends);
+	free(displacements);
+	
+	if(check != 0){
+		fprintf(stderr, "Rank %d: Error in scatter_data while comunicating data\n", my_rank);
+		fflush(stderr);
+		MPI_Type_free(&mpi_pixel);
+		free(*data);
+		*data = NULL;
 		return -1;
 	}
 	
-	check = deallocate_MPI_datatype(&mpi_rgb, 0);
-	if(check == -1){ // error message was printed by the called function
+	check = MPI_Type_free(&mpi_pixel);
+	if(check != MPI_SUCCESS){
+		fprintf(stderr, "Rank %d: Error in scatter_data while de-allocating data type\n", my_rank);
+		fflush(stderr);
+		free(*data);
+		*data = NULL;
 		return -1;
 	}
 	
-	free(chunk_image->data);
-	free(chunk_image);
 	return 0;
 }
 
-Image *master_process(const char *in_file_name, operation_t operation, int chunk, int num_processes, int num_threads){
+int post_halo_exchange(unsigned char *data, int num_rows, int top_halo, int bottom_halo, int width, int channels, int my_rank, MPI_Comm strips, MPI_Request *requests){
 	/**
-	*	Takes in a file path to the file to edit, an operation_t, the size of a chunk,
-	*	the total number of processes and the number of threads on available to each process.
-	*	It opens the .bmp file and reads and sends a chunk to each worker process. After that, to each worker process
-	*	that finishes its work, it collects the edited chunk and sends another chunk to the worker process
-	*	until there are no more chunks to process. At that point, it waits for all the worker processes to finish their work,
-	*	collects their edited chunks and terminates the process. It then returns the whole edited Image.
+	*	Takes in the rows of a strip with room for its halos, the number of rows of the strip, the number of rows of its top and bottom halos,
+	*	the width and number of channels of the Image, this process's rank, the 1D process topology and a place to store 4 requests.
+	*	It posts the same exchange as one round of exchange_halos with MPI_Isend and MPI_Irecv and returns without waiting for it,
+	*	so it only fills the halos when every strip has at least halo_dim rows. The requests complete once the halos arrived
+	*	and the rows sent to the neighbours left the strip.
+	*	It returns 0 on success and -1 on failure.
 	*/
 	
-	int kernel_size = get_kernel_size(operation);
-	int halo_dim = kernel_size / 2;
-	
 	int check;
-	int active_workers = 0;
-	int height, width, data_start, padding;
-	int offset;
-	int work_from_rows[num_processes];
-	MPI_Datatype mpi_send_block = create_mpi_datatype_for_send_block_t();
-	MPI_Datatype mpi_rgb = create_mpi_datatype_for_RGB();
-	
-	FILE *image_file = open_BMP(in_file_name, &height, &width, &data_start, &padding);
-	if(image_file == NULL){ // error message was printed by the called function
-		return NULL;
+	int above, below;
+	size_t row_size = (size_t)width * channels;
+	unsigned char *strip = data + top_halo * row_size;
+	
+	check = MPI_Cart_shift(strips, 0, 1, &above, &below);
+	if(check == MPI_SUCCESS) check = MPI_Irecv(strip - top_halo * row_size, top_halo * row_size, MPI_UNSIGNED_CHAR, above, HALO_DOWN_TAG, strips, &requests[0]);
+	if(check == MPI_SUCCESS) check = MPI_Irecv(strip + num_rows * row_size, bottom_halo * row_size, MPI_UNSIGNED_CHAR, below, HALO_UP_TAG, strips, &requests[1]);
+	if(check == MPI_SUCCESS) check = MPI_Isend(strip, top_halo * row_size, MPI_UNSIGNED_CHAR, above, HALO_UP_TAG, strips, &requests[2]);
+	if(check == MPI_SUCCESS) check = MPI_Isend(strip + ((size_t)num_rows - bottom_halo) * row_size, bottom_halo * row_size, MPI_UNSIGNED_CHAR, below, HALO_DOWN_TAG, strips, &requests[3]);
+	if(check != MPI_SUCCESS){
+		fprintf(stderr, "Rank %d: Error in post_halo_exchange while posting the halo exchange\n", my_rank);
+		fflush(stderr);
+		return -1;
 	}
 	
-	offset = data_start;
+	return 0;
+}
+
+int strip_bands(int height, int num_processes, int rank, int halo_dim, int *bands){
+	/**
+	*	Takes in the height of the Image, the total number of processes, a rank, the size of the halo and a place to store
+	*	num_rows / NO_SFT_BAND_SIZE + 3 bands.
+	*	It splits the strip of the rank into bands, in the order they are edited and sent: first the interior rows,
+	*	which need no halo, in bands of NO_SFT_BAND_SIZE rows, then the rows next to the strip above and the rows next to the strip below.
+	*	Band k covers the rows bands[2k] to bands[2k + 1] - 1 of the strip.
+	*	It returns the number of bands.
+	*/
 	
-	RGB *new_data = (RGB*)malloc(width * height * sizeof(RGB));
-	if(new_data == NULL){
-		fprintf(stderr, "Rank 0: Error in master_process while allocating memory\n");
-		fflush(stderr);
-		fclose(image_file);
-		
-		check = deallocate_MPI_datatype(&mpi_send_block, 0);
-		if(check == -1){ // error message was printed by the called function
-			return NULL;
+	int first_row, num_rows;
+	sft_strip_rows(height, num_processes, rank, &first_row, &num_rows);
+	
+	int interior_start = (rank > 0) ? min(halo_dim, num_rows) : 0;
+	int interior_end = (rank < num_processes - 1) ? max(num_rows - halo_dim, interior_start) : num_rows;
+	int num_bands = 0;
+	
+	for(int band_start = interior_start; band_start < interior_end; band_start += NO_SFT_BAND_SIZE){
+		bands[2 * num_bands] = band_start;
+		bands[2 * num_bands + 1] = min(band_start + NO_SFT_BAND_SIZE, interior_end);
+		++num_bands;
+	}
+	
+	if(interior_start > 0){
+		bands[2 * num_bands] = 0;
+		bands[2 * num_bands + 1] = interior_start;
+		++num_bands;
+	}
+	
+	if(interior_end < num_rows){
+		bands[2 * num_bands] = interior_end;
+		bands[2 * num_bands + 1] = num_rows;
+		++num_bands;
+	}
+	
+	return num_bands;
+}
+
+void release_overlapped_strip(MPI_Request *halo_requests, Image **edited_bands, int num_bands, MPI_Request *send_requests, MPI_Request *receive_requests, int num_receives, band_timeline_t *timeline, int *bands, unsigned char *new_data, Image *img, MPI_Datatype *mpi_pixel, int my_rank){
+	/**
+	*	Takes in what edit_strip_overlapped set up before it failed: the halo requests, the edited bands (NULL for the bands not edited yet)
+	*	and their sends, the receives posted by process 0 (NULL on the other processes), the timeline, the bands of the strip,
+	*	the edited Image and its data, the datatype of a pixel and this process's rank.
+	*	It waits for the halos and the sends to complete, cancels the receives and frees everything but the strip itself.
+	*/
+	
+	MPI_Waitall(4, halo_requests, MPI_STATUSES_IGNORE);
+	MPI_Waitall(num_bands, send_requests, MPI_STATUSES_IGNORE);
+	
+	for(int i = 0; i < num_receives; ++i){
+		if(receive_requests[i] != MPI_REQUEST_NULL){
+			MPI_Cancel(&receive_requests[i]);
+			MPI_Wait(&receive_requests[i], MPI_STATUS_IGNORE);
 		}
-		
-		check = deallocate_MPI_datatype(&mpi_rgb, 0);
-		if(check == -1){ // error message was printed by the called function
-			return NULL;
+	}
+	
+	for(int k = 0; k < num_bands; ++k){
+		if(edited_bands[k] != NULL){
+			free(edited_bands[k]->data);
+			free(edited_bands[k]);
 		}
-		
-		return NULL;
 	}
+	free(edited_bands);
+	free(send_requests);
+	free(receive_requests);
+	free(timeline);
+	free(bands);
+	free(new_data);
+	free(img);
 	
-	Image *new_image = (Image*)malloc(sizeof(Image));
-	if(new_image == NULL){
-		fprintf(stderr, "Rank 0: Error in master_process while allocating memory\n");
+	deallocate_MPI_datatype(mpi_pixel, my_rank);
+}
+
+Image *edit_strip_overlapped(unsigned char *data, int true_start, int height, int width, int channels, int top_down, operation_t operation, int halo_dim, int my_rank, int num_processes, MPI_Comm strips, int num_threads, unsigned long long *hash){
+	/**
+	*	Takes in the rows of this process's strip with room for its halos (true_start rows above it), the height, width, channels
+	*	and top_down of the Image, an operation_t, the size of the halo, this process's rank, the total number of processes,
+	*	their 1D process topology, the number of threads of a process and a place to store the hash of the edited Image on process 0.
+	*	The halos are requested with post_halo_exchange and, while they travel, the interior rows of the strip are edited band by band;
+	*	every edited band is sent to process 0 with MPI_Isend while the next one is edited. The rows next to the other strips
+	*	are edited last, once their halos arrived. Process 0 posts the receives of all the bands of the other processes first,
+	*	straight into their place in the edited Image. When the strips are thinner than the halo, the halos are exchanged
+	*	with exchange_halos before anything is edited.
+	*	If rank == 0, it returns the whole edited Image, and if rank != 0, it returns a `dummy` Image.
+	*/
+	
+	double start_time = MPI_Wtime();
+	int check;
+	size_t row_size = (size_t)width * channels;
+	int first_row, num_rows;
+	sft_strip_rows(height, num_processes, my_rank, &first_row, &num_rows);
+	int bottom_halo = neighbour_rows(height, num_processes, my_rank, 1, num_processes, halo_dim);
+	int overlapped = (height / num_processes >= halo_dim);
+	
+	int *bands = (int*)malloc((num_rows / NO_SFT_BAND_SIZE + 3) * 2 * sizeof(int));
+	Image **edited_bands = (Image**)calloc(num_rows / NO_SFT_BAND_SIZE + 3, sizeof(Image*));
+	MPI_Request *send_requests = (MPI_Request*)malloc((num_rows / NO_SFT_BAND_SIZE + 3) * sizeof(MPI_Request));
+	band_timeline_t *timeline = (band_timeline_t*)malloc((num_rows / NO_SFT_BAND_SIZE + 3) * sizeof(band_timeline_t));
+	Image *img = (Image*)malloc(sizeof(Image));
+	if(bands == NULL || edited_bands == NULL || send_requests == NULL || timeline == NULL || img == NULL){
+		fprintf(stderr, "Rank %d: Error in edit_strip_overlapped while allocating memory\n", my_rank);
 		fflush(stderr);
-		free(new_data);
-		fclose(image_file);
-		
-		check = deallocate_MPI_datatype(&mpi_send_block, 0);
-		if(check == -1){ // error message was printed by the called function
-			return NULL;
-		}
-		
-		check = deallocate_MPI_datatype(&mpi_rgb, 0);
-		if(check == -1){ // error message was printed by the called function
-			return NULL;
-		}
-		
+		free(bands);
+		free(edited_bands);
+		free(send_requests);
+		free(timeline);
+		free(img);
 		return NULL;
 	}
+	int num_bands = strip_bands(height, num_processes, my_rank, halo_dim, bands);
+	for(int k = 0; k < num_bands; ++k){
+		send_requests[k] = MPI_REQUEST_NULL;
+	}
 	
-	// distributing initial work to all the processes
-	int work_done = 0;
-	for(int i = 1; i < num_processes; ++i){
-		if(work_done == 0){
-			++active_workers;
-			work_from_rows[i] = (offset - data_start) / (3 * width + padding);
-			
-			check = send_work(i, operation, &work_done, image_file, halo_dim, chunk, height, width, padding, data_start, &offset, num_threads);
-			if(check == -1){ // error message was printed by the called function
-				free(new_data);
-				free(new_image);
-				fclose(image_file);
-				
-				check = deallocate_MPI_datatype(&mpi_send_block, 0);
-				if(check == -1){ // error message was printed by the called function
-					return NULL;
-				}
-				
-				check = deallocate_MPI_datatype(&mpi_rgb, 0);
-				if(check == -1){ // error message was printed by the called function
-					return NULL;
-				}
-				
-				return NULL;
-			}
+	MPI_Datatype mpi_pixel = create_mpi_datatype_for_pixel(channels);
+	unsigned char *new_data = NULL;
+	MPI_Request *receive_requests = NULL;
+	int num_receives = 0;
+	MPI_Request halo_requests[4] = {MPI_REQUEST_NULL, MPI_REQUEST_NULL, MPI_REQUEST_NULL, MPI_REQUEST_NULL};
+	
+	if(my_rank == 0){
+		// posting the receives for every band of every other process, in the order they will be sent
+		new_data = (unsigned char*)malloc((size_t)height * row_size);
+		receive_requests = (MPI_Request*)malloc(((height / NO_SFT_BAND_SIZE) + 3 * num_processes) * sizeof(MPI_Request));
+		int *rank_bands = (int*)malloc((height / NO_SFT_BAND_SIZE + 3) * 2 * sizeof(int));
+		if(new_data == NULL || receive_requests == NULL || rank_bands == NULL){
+			fprintf(stderr, "Rank %d: Error in edit_strip_overlapped while allocating memory\n", my_rank);
+			fflush(stderr);
+			free(rank_bands);
+			release_overlapped_strip(halo_requests, edited_bands, num_bands, send_requests, receive_requests, num_receives, timeline, bands, new_data, img, &mpi_pixel, my_rank);
+			return NULL;
+		}
+		
+		for(int rank = 1; rank < num_processes; ++rank){
+			int rank_first_row, rank_num_rows;
+			sft_strip_rows(height, num_processes, rank, &rank_first_row, &rank_num_rows);
+			int rank_num_bands = strip_bands(height, num_processes, rank, halo_dim, rank_bands);
 			
-			if(work_done == 1){ // remove and terminate the current worker
-				--active_workers;
-				check = MPI_Send(NULL, 0, MPI_BYTE, i, TERMINATE_TAG, MPI_COMM_WORLD);
+			for(int k = 0; k < rank_num_bands; ++k){
+				check = MPI_Irecv(new_data + (size_t)(rank_first_row + rank_bands[2 * k]) * row_size, (rank_bands[2 * k + 1] - rank_bands[2 * k]) * width, mpi_pixel,
+					rank, NO_SFT_BAND_TAG, strips, &receive_requests[num_receives]);
 				if(check != MPI_SUCCESS){
-					fprintf(stderr, "Rank 0: Error in master_process while sending terminate order\n");
+					fprintf(stderr, "Rank %d: Error in edit_strip_overlapped while posting receives\n", my_rank);
 					fflush(stderr);
-					free(new_data);
-					free(new_image);
-					fclose(image_file);
-					
-					check = deallocate_MPI_datatype(&mpi_send_block, 0);
-					if(check == -1){ // error message was printed by the called function
-						return NULL;
-					}
-					
-					check = deallocate_MPI_datatype(&mpi_rgb, 0);
-					if(check == -1){ // error message was printed by the called function
-						return NULL;
-					}
-					
+					free(rank_bands);
+					release_overlapped_strip(halo_requests, edited_bands, num_bands, send_requests, receive_requests, num_receives, timeline, bands, new_data, img, &mpi_pixel, my_rank);
 					return NULL;
 				}
+				++num_receives;
 			}
 		}
-		else{
-			check = MPI_Send(NULL, 0, MPI_BYTE, i, TERMINATE_TAG, MPI_COMM_WORLD);
-			if(check != MPI_SUCCESS){
-					fprintf(stderr, "Rank 0: Error in master_process while sending terminate order\n");
-					fflush(stderr);
-					free(new_data);
-					free(new_image);
-					fclose(image_file);
-					
-					check = deallocate_MPI_datatype(&mpi_send_block, 0);
-					if(check == -1){ // error message was printed by the called function
-						return NULL;
-					}
-					
-					check = deallocate_MPI_datatype(&mpi_rgb, 0);
-					if(check == -1){ // error message was printed by the called function
-						return NULL;
-					}
-					
-					return NULL;
-				}
-		}
+		free(rank_bands);
 	}
 	
-	while(active_workers != 0 || work_done == 0){
-		int worker_rank;
-		int chunk_size;
-		int data_offset;
-		send_block_t header;
-		MPI_Status status;
+	int halos_pending = 0;
+	double halos_arrived = 0;
+	
+	if(overlapped){
+		check = post_halo_exchange(data, num_rows, true_start, bottom_halo, width, channels, my_rank, strips, halo_requests);
+		halos_pending = 1;
+	}
+	else{
+		check = exchange_halos(data, num_rows, true_start, height, width, channels, halo_dim, my_rank, num_processes, strips);
+		halos_arrived = MPI_Wtime() - start_time;
+	}
+	if(check != 0){ // error message was printed by the called function
+		release_overlapped_strip(halo_requests, edited_bands, num_bands, send_requests, receive_requests, num_receives, timeline, bands, new_data, img, &mpi_pixel, my_rank);
+		return NULL;
+	}
+	
+	unsigned long long rows_hash = 0;
+	
+	for(int k = 0; k < num_bands; ++k){
+		int band_start = bands[2 * k];
+		int band_end = bands[2 * k + 1];
 		
-		check = MPI_Recv(&header, 1, mpi_send_block, MPI_ANY_SOURCE, WORK_HEADER_RECEIVE_TAG, MPI_COMM_WORLD, &status);
-		if(check != MPI_SUCCESS){
-			fprintf(stderr, "Rank 0: Error in master_process while receiving work header\n");
-			fflush(stderr);
-			free(new_data);
-			free(new_image);
-			fclose(image_file);
-			
-			check = deallocate_MPI_datatype(&mpi_send_block, 0);
-			if(check == -1){ // error message was printed by the called function
-				return NULL;
-			}
-			
-			check = deallocate_MPI_datatype(&mpi_rgb, 0);
-			if(check == -1){ // error message was printed by the called function
+		// the rows next to the other strips wait for the halos
+		if(halos_pending && ((my_rank > 0 && band_start < halo_dim) || (my_rank < num_processes - 1 && band_end > num_rows - halo_dim))){
+			check = MPI_Waitall(4, halo_requests, MPI_STATUSES_IGNORE);
+			if(check != MPI_SUCCESS){
+				fprintf(stderr, "Rank %d: Error in edit_strip_overlapped while exchanging the halos\n", my_rank);
+				fflush(stderr);
+				release_overlapped_strip(halo_requests, edited_bands, num_bands, send_requests, receive_requests, num_receives, timeline, bands, new_data, img, &mpi_pixel, my_rank);
 				return NULL;
 			}
-			
-			return NULL;
+			halos_pending = 0;
+			halos_arrived = MPI_Wtime() - start_time;
 		}
 		
-		worker_rank = status.MPI_SOURCE;
-		chunk_size = header.height;
+		timeline[k].compute_start = MPI_Wtime() - start_time;
 		
-		data_offset = height - work_from_rows[worker_rank] - chunk_size;
+		// the band's window is a view into data, holding the band and its halos (band rows are relative to the strip)
+		int band_window_start = max(band_start - halo_dim, -true_start);
+		int band_window_end = min(band_end + halo_dim, num_rows + bottom_halo);
+		Image band_window;
+		band_window.width = width;
+		band_window.height = band_window_end - band_window_start;
+		band_window.channels = channels;
+		band_window.top_down = top_down;
+		band_window.data = data + (size_t)(true_start + band_window_start) * row_size;
 		
-		check = MPI_Recv(new_data + data_offset * width, chunk_size * width, mpi_rgb, worker_rank, WORK_DATA_RECEIVE_TAG, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
-		if(check != MPI_SUCCESS){
-			fprintf(stderr, "Rank 0: Error in master_process while receiving work data\n");
-			fflush(stderr);
-			free(new_data);
-			free(new_image);
-			fclose(image_file);
-			
-			check = deallocate_MPI_datatype(&mpi_send_block, 0);
-			if(check == -1){ // error message was printed by the called function
-				return NULL;
-			}
-			
-			check = deallocate_MPI_datatype(&mpi_rgb, 0);
-			if(check == -1){ // error message was printed by the called function
-				return NULL;
-			}
-			
+		edited_bands[k] = perform_convolution_parallel(&band_window, operation, band_start - band_window_start, band_end - 1 - band_window_start, num_threads);
+		if(edited_bands[k] == NULL){ // error message was printed by the called function
+			release_overlapped_strip(halo_requests, edited_bands, num_bands, send_requests, receive_requests, num_receives, timeline, bands, new_data, img, &mpi_pixel, my_rank);
 			return NULL;
 		}
 		
-		if(work_done == 1){
-			check = MPI_Send(NULL, 0, MPI_BYTE, worker_rank, TERMINATE_TAG, MPI_COMM_WORLD);
+		timeline[k].compute_end = MPI_Wtime() - start_time;
+		timeline[k].send_posted = timeline[k].compute_end;
+		
+		if(my_rank == 0){
+			memcpy(new_data + (size_t)(first_row + band_start) * row_size, edited_bands[k]->data, (size_t)(band_end - band_start) * row_size);
+			send_requests[k] = MPI_REQUEST_NULL;
+		}
+		else{
+			check = MPI_Isend(edited_bands[k]->data, (band_end - band_start) * width, mpi_pixel, 0, NO_SFT_BAND_TAG, strips, &send_requests[k]);
 			if(check != MPI_SUCCESS){
-				fprintf(stderr, "Rank 0: Error in master_process while sending terminate order\n");
+				fprintf(stderr, "Rank %d: Error in edit_strip_overlapped while sending band\n", my_rank);
 				fflush(stderr);
-				free(new_data);
-				free(new_image);
-				fclose(image_file);
-				
-				check = deallocate_MPI_datatype(&mpi_send_block, 0);
-				if(check == -1){ // error message was printed by the called function
-					return NULL;
-				}
-				
-				check = deallocate_MPI_datatype(&mpi_rgb, 0);
-				if(check == -1){ // error message was printed by the called function
-					return NULL;
-				}
-				
+				release_overlapped_strip(halo_requests, edited_bands, num_bands, send_requests, receive_requests, num_receives, timeline, bands, new_data, img, &mpi_pixel, my_rank);
 				return NULL;
 			}
-			--active_workers;
 		}
-		else{
-			work_from_rows[worker_rank] = (offset - data_start) / (3 * width + padding);
-			
-			check = send_work(worker_rank, operation, &work_done, image_file, halo_dim, chunk, height, width, padding, data_start, &offset, num_threads);
-			if(check == -1){ // error message was printed by the called function
-				free(new_data);
-				free(new_image);
-				fclose(image_file);
-				
-				check = deallocate_MPI_datatype(&mpi_send_block, 0);
-				if(check == -1){ // error message was printed by the called function
-					return NULL;
-				}
-				
-				check = deallocate_MPI_datatype(&mpi_rgb, 0);
-				if(check == -1){ // error message was printed by the called function
-					return NULL;
-				}
-				
-				return NULL;
-			}
-			
-			if(work_done == 1){ // remove and terminate the current worker
-				--active_workers;
-				
-				check = MPI_Send(NULL, 0, MPI_BYTE, worker_rank, TERMINATE_TAG, MPI_COMM_WORLD);
-				if(check != MPI_SUCCESS){
-					fprintf(stderr, "Rank 0: Error in master_process while sending terminate order\n");
-					fflush(stderr);
-					free(new_data);
-					free(new_image);
-					fclose(image_file);
-					
-					check = deallocate_MPI_datatype(&mpi_send_block, 0);
-					if(check == -1){ // error message was printed by the called function
-						return NULL;
-					}
-					
-					check = deallocate_MPI_datatype(&mpi_rgb, 0);
-					if(check == -1){ // error message was printed by the called function
-						return NULL;
-					}
-					
-					return NULL;
-				}
-			}
+		
+		if(hash != NULL){
+			rows_hash += hash_rows(edited_bands[k]->data, first_row + band_start, band_end - band_start, width, channels, num_threads);
 		}
 	}
 	
-	fclose(image_file);
-	check = deallocate_MPI_datatype(&mpi_send_block, 0);
-	if(check == -1){ // error message was printed by the called function
+	// the rows sent to the neighbours have to leave the strip before it is freed
+	check = MPI_Waitall(4, halo_requests, MPI_STATUSES_IGNORE);
+	if(check == MPI_SUCCESS) check = MPI_Waitall(num_bands, send_requests, MPI_STATUSES_IGNORE);
+	if(check != MPI_SUCCESS){
+		fprintf(stderr, "Rank %d: Error in edit_strip_overlapped while sending bands\n", my_rank);
+		fflush(stderr);
+		release_overlapped_strip(halo_requests, edited_bands, num_bands, send_requests, receive_requests, num_receives, timeline, bands, new_data, img, &mpi_pixel, my_rank);
 		return NULL;
 	}
+	double sends_done = MPI_Wtime() - start_time;
+	
+	if(my_rank == 0){
+		check = MPI_Waitall(num_receives, receive_requests, MPI_STATUSES_IGNORE);
+		if(check != MPI_SUCCESS){
+			fprintf(stderr, "Rank %d: Error in edit_strip_overlapped while receiving bands\n", my_rank);
+			fflush(stderr);
+			release_overlapped_strip(halo_requests, edited_bands, num_bands, send_requests, receive_requests, num_receives, timeline, bands, new_data, img, &mpi_pixel, my_rank);
+			return NULL;
+		}
+		free(receive_requests);
+		receive_requests = NULL;
+		num_receives = 0;
+	}
+	
+	if(NO_SFT_PRINT_TIMELINE){
+		for(int k = 0; k < num_bands; ++k){
+			fprintf(stdout, "Rank %d band %d (rows %d - %d): compute [%f, %f] send posted %f\n", my_rank, k,
+				first_row + bands[2 * k], first_row + bands[2 * k + 1] - 1,
+				timeline[k].compute_start, timeline[k].compute_end, timeline[k].send_posted);
+		}
+		fprintf(stdout, "Rank %d: halos arrived at %f, all sends completed at %f\n", my_rank, halos_arrived, sends_done);
+		fflush(stdout);
+	}
+	
+	if(hash != NULL){
+		check = reduce_image_hash(rows_hash, height, width, channels, hash, my_rank, strips);
+		if(check != 0){ // error message was printed by the called function
+			release_overlapped_strip(halo_requests, edited_bands, num_bands, send_requests, receive_requests, num_receives, timeline, bands, new_data, img, &mpi_pixel, my_rank);
+			return NULL;
+		}
+	}
 	
-	check = deallocate_MPI_datatype(&mpi_rgb, 0);
-	if(check == -1){ // error message was printed by the called function
+	for(int k = 0; k < num_bands; ++k){
+		free(edited_bands[k]->data);
+		free(edited_bands[k]);
+	}
+	free(edited_bands);
+	free(send_requests);
+	free(timeline);
+	free(bands);
+	
+	check = deallocate_MPI_datatype(&mpi_pixel, my_rank);
+	if(check != 0){ // error message was printed by the called function
+		free(new_data);
+		free(img);
 		return NULL;
 	}
 	
-	new_image->height = height;
-	new_image->width = width;
-	new_image->data = new_data;
-	return new_image;
+	img->width = width;
+	img->height = height;
+	img->channels = channels;
+	img->top_down = top_down;
+	img->data = new_data; // NULL for ranks != 0
+	return img;
 }
 
-int worker_process(int my_rank){
+Image *image_processing_parallel_no_sft(const char *in_file_name, operation_t operation, int my_rank, int num_processes, MPI_Comm comm, int num_cores, int num_workstations, unsigned long long *hash){
 	/**
-	*	Takes in this process's rank.
-	*	It receives a chunk of an Image from process 0, which it edits and sends back to process 0.
+	*	Takes in a file path to the file to edit, an operation_t, this process's rank,
+	*	the total number of processes, the communicator of the processes editing the Image, the number of cores on this workstation,
+	*	the total number of workstations and a place to store the hash of the edited Image on process 0 (NULL if it is not needed).
+	*	If rank == 0, the process reads the whole file (a .bmp file or a tiled image), distributes chunks of the Image to each process (including process 0),
+	*	edits its respective chunk, composes the whole edited Image and returns it.
+	*	If rank != 0, the process receives its respective chunk, edits it, sends the edited chunk to process 0
+	*	and returns a `dummy` Image.
+	*	With NO_SFT_OVERLAP set, each process edits the interior of its chunk while its halos arrive and sends it
+	*	to process 0 band by band while it edits the rest (edit_strip_overlapped).
+	*	Each process hashes its edited chunk before it is sent, and the hashes are added on process 0.
+	*	If RESULT_CACHE is set, process 0 looks the Image it read up in the result cache before distributing it.
 	*/
 	
-	MPI_Status status;
-	MPI_Datatype mpi_send_block = create_mpi_datatype_for_send_block_t();
-	MPI_Datatype mpi_rgb = create_mpi_datatype_for_RGB();
-	send_block_t header;
-	int working = 1;
+	int kernel_size = get_kernel_size(operation);
+	int halo_dim = kernel_size / 2;
 	int check;
+	int height, width, channels, top_down;
+	int local_height;
+	unsigned char *data = NULL;
+	Image *img = NULL;
+	unsigned long long input_hash;
 	
-	while(working){
-		check = MPI_Probe(0, MPI_ANY_TAG, MPI_COMM_WORLD, &status);
-		if(check != MPI_SUCCESS){
-			fprintf(stderr, "Rank %d: Error in worker_process while probing for incoming messages\n", my_rank);
-			fflush(stderr);
-			
-			check = deallocate_MPI_datatype(&mpi_send_block, my_rank);
-			if(check == -1){ // error message was printed by the called function
-				return -1;
-			}
-			
-			check = deallocate_MPI_datatype(&mpi_rgb, my_rank);
-			if(check == -1){ // error message was printed by the called function
-				return -1;
-			}
-			
-			return -1;
+	if(SHARED_MEMORY_WINDOWS){
+		return edit_shared_image(in_file_name, operation, my_rank, num_processes, comm, max(1, num_cores / (num_processes / num_workstations)), hash);
+	}
+	
+	if(my_rank == 0){
+		img = is_tiled_file(in_file_name) ? read_tiled_serial(in_file_name) : read_BMP_serial(in_file_name);
+		if(img == NULL){ // error message was printed by the called function
+			return NULL;
 		}
 		
-		if(status.MPI_TAG == TERMINATE_TAG){
-			working = 0;
-			check = MPI_Recv(NULL, 0, MPI_BYTE, 0, TERMINATE_TAG, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
-			if(check != MPI_SUCCESS){
-				fprintf(stderr, "Rank %d: Error in worker_process while consuming termination message\n", my_rank);
-				fflush(stderr);
-				
-				check = deallocate_MPI_datatype(&mpi_send_block, my_rank);
-				if(check == -1){ // error message was printed by the called function
-					return -1;
-				}
-				
-				check = deallocate_MPI_datatype(&mpi_rgb, my_rank);
-				if(check == -1){ // error message was printed by the called function
-					return -1;
-				}
-				
-				return -1;
-			}
+		width = img->width;
+		height = img->height;
+		channels = img->channels;
+		top_down = img->top_down;
+	}
+	
+	if(RESULT_CACHE){
+		Image *cached_img;
+		check = check_result_cache(in_file_name, img, operation, my_rank, comm, num_cores, &input_hash, &cached_img);
+		if(check == -1){ // error message was printed by the called function
+			return NULL;
 		}
-		else if(status.MPI_TAG == WORK_HEADER_SEND_TAG){
-			check = MPI_Recv(&header, 1, mpi_send_block, 0, WORK_HEADER_SEND_TAG, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
-			if(check != MPI_SUCCESS){
-				fprintf(stderr, "Rank %d: Error in worker_process while receiving work header\n", my_rank);
-				fflush(stderr);
-				
-				check = deallocate_MPI_datatype(&mpi_send_block, my_rank);
-				if(check == -1){ // error message was printed by the called function
-					return -1;
-				}
-				
-				check = deallocate_MPI_datatype(&mpi_rgb, my_rank);
-				if(check == -1){ // error message was printed by the called function
-					return -1;
-				}
-				
-				return -1;
-			}
-			
-			RGB *data = (RGB*)malloc(header.height * header.width * sizeof(RGB));
-			if(data == NULL){
-				fprintf(stderr, "Rank %d: Error in worker_process while allocating memory\n", my_rank);
-				fflush(stderr);
-				
-				check = deallocate_MPI_datatype(&mpi_send_block, my_rank);
-				if(check == -1){ // error message was printed by the called function
-					return -1;
-				}
-				
-				check = deallocate_MPI_datatype(&mpi_rgb, my_rank);
-				if(check == -1){ // error message was printed by the called function
-					return -1;
-				}
-				
-				return -1;
-			}
-			
-			Image *img = (Image*)malloc(sizeof(Image));
-			if(img == NULL){
-				fprintf(stderr, "Rank %d: Error in worker_process while allocating memory\n", my_rank);
-				fflush(stderr);
-				free(data);
-				
-				check = deallocate_MPI_datatype(&mpi_send_block, my_rank);
-				if(check == -1){ // error message was printed by the called function
-					return -1;
-				}
-				
-				check = deallocate_MPI_datatype(&mpi_rgb, my_rank);
-				if(check == -1){ // error message was printed by the called function
-					return -1;
-				}
-				
-				return -1;
-			}
-			
-			check = MPI_Recv(data, header.height * header.width, mpi_rgb, 0, WORK_DATA_SEND_TAG, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
-			if(check != MPI_SUCCESS){
-				fprintf(stderr, "Rank %d: Error in worker_process while receiving work data\n", my_rank);
-				fflush(stderr);
-				free(data);
+		if(check == 1){
+			if(my_rank == 0){
+				free(img->data);
 				free(img);
-				
-				check = deallocate_MPI_datatype(&mpi_send_block, my_rank);
-				if(check == -1){ // error message was printed by the called function
-					return -1;
-				}
-				
-				check = deallocate_MPI_datatype(&mpi_rgb, my_rank);
-				if(check == -1){ // error message was printed by the called function
-					return -1;
-				}
-				
-				return -1;
 			}
-			
-			img->height = header.height;
-			img->width = header.width;
-			img->data = data;
-			
-			Image *new_image = perform_convolution_parallel(img, header.operation, header.true_start, header.true_end, header.num_threads);
-			if(new_image == NULL){ // error message was printed by the called function
+			return cached_result(cached_img, my_rank, num_cores, hash);
+		}
+	}
+	
+	if(BLOCK_DECOMPOSITION){
+		int image_info[4], dims[2];
+		check = choose_block_grid(in_file_name, img, 0, my_rank, num_processes, comm, image_info, dims);
+		if(check != 0){ // error message was printed by the called function
+			return NULL;
+		}
+		
+		if(dims[1] > 1){ // a grid of blocks has less halo than the strips
+			int num_threads = max(1, num_cores / (num_processes / num_workstations));
+			Image *edited_img = image_processing_blocks(in_file_name, img, operation, 0, image_info, dims, my_rank, num_processes, comm, num_threads, hash);
+			if(my_rank == 0){
 				free(img->data);
 				free(img);
-				
-				check = deallocate_MPI_datatype(&mpi_send_block, my_rank);
-				if(check == -1){ // error message was printed by the called function
-					return -1;
-				}
-				
-				check = deallocate_MPI_datatype(&mpi_rgb, my_rank);
-				if(check == -1){ // error message was printed by the called function
-					return -1;
+			}
+			if(RESULT_CACHE && my_rank == 0 && edited_img != NULL){
+				store_result_cache(input_hash, operation, edited_img); // a failed store only costs a later hit
+			}
+			return edited_img;
+		}
+	}
+	
+	check = MPI_Bcast(&width, 1, MPI_INT, 0, comm);
+	if(check != MPI_SUCCESS){
+		fprintf(stderr, "Rank %d: Error in main while broadcasting width\n", my_rank);
+		fflush(stderr);
+		return NULL;
+	}
+	
+	check = MPI_Bcast(&height, 1, MPI_INT, 0, comm);
+	if(check != MPI_SUCCESS){
+		fprintf(stderr, "Rank %d: Error in main while broadcasting height\n", my_rank);
+		fflush(stderr);
+		return NULL;
+	}
+	
+	check = MPI_Bcast(&channels, 1, MPI_INT, 0, comm);
+	if(check != MPI_SUCCESS){
+		fprintf(stderr, "Rank %d: Error in main while broadcasting channels\n", my_rank);
+		fflush(stderr);
+		return NULL;
+	}
+	
+	check = MPI_Bcast(&top_down, 1, MPI_INT, 0, comm);
+	if(check != MPI_SUCCESS){
+		fprintf(stderr, "Rank %d: Error in main while broadcasting top_down\n", my_rank);
+		fflush(stderr);
+		return NULL;
+	}
+	
+	int true_start, true_end;
+	
+	check = scatter_data(img, &data, my_rank, num_processes, comm, height, width, channels, &local_height, &true_start, halo_dim);
+	if(check != 0){ // error message was printed by the called function
+		return NULL;
+	}
+	
+	if(my_rank == 0){
+		free(img->data);
+		free(img);
+	}
+	
+	int first_row, num_rows;
+	sft_strip_rows(height, num_processes, my_rank, &first_row, &num_rows);
+	int num_threads = max(1, num_cores / (num_processes / num_workstations));
+	
+	MPI_Comm strips;
+	int periods = 0;
+	check = MPI_Cart_create(comm, 1, &num_processes, &periods, 0, &strips);
+	if(check != MPI_SUCCESS){
+		fprintf(stderr, "Rank %d: Error in image_processing_parallel_no_sft while creating the 1D process topology\n", my_rank);
+		fflush(stderr);
+		free(data);
+		return NULL;
+	}
+	
+	if(NO_SFT_OVERLAP){
+		Image *edited_img = edit_strip_overlapped(data, true_start, height, width, channels, top_down, operation, halo_dim, my_rank, num_processes, strips, num_threads, hash);
+		MPI_Comm_free(&strips);
+		free(data);
+		if(RESULT_CACHE && my_rank == 0 && edited_img != NULL){
+			store_result_cache(input_hash, operation, edited_img); // a failed store only costs a later hit
+		}
+		return edited_img;
+	}
+	
+	check = exchange_halos(data, num_rows, true_start, height, width, channels, halo_dim, my_rank, num_processes, strips);
+	MPI_Comm_free(&strips);
+	if(check != 0){ // error message was printed by the called function
+		free(data);
+		return NULL;
+	}
+	
+	Image *new_image = (Image*)malloc(sizeof(Image));
+	if(new_image == NULL){
+		fprintf(stderr, "Rank %d: Error in main while allocating memory\n", my_rank);
+		fflush(stderr);
+		return NULL;
+	}
+	
+	new_image->height = local_height;
+	new_image->width = width;
+	new_image->channels = channels;
+	new_image->top_down = top_down;
+	new_image->data = data;
+	
+	true_end = true_start + num_rows - 1;
+	
+	Image *edited_img = perform_convolution_parallel(new_image, operation, true_start, true_end, num_threads);
+	free(new_image->data);
+	free(new_image);
+	if(edited_img == NULL){ // error message was printed by the called function
+		return NULL;
+	}
+	
+	if(hash != NULL){
+		unsigned long long rows_hash = hash_rows(edited_img->data, first_row, edited_img->height, width, channels, num_threads);
+		check = reduce_image_hash(rows_hash, height, width, channels, hash, my_rank, comm);
+		if(check != 0){ // error message was printed by the called function
+			return NULL;
+		}
+	}
+	
+	Image *composed_img = compose_BMP(edited_img, my_rank, num_processes, comm);
+	if(composed_img == NULL){ // error message was printed by the called function
+		return NULL;
+	}
+	
+	free(edited_img->data);
+	if(my_rank != 0){ // compose_BMP returned edited_img, which becomes a `dummy` Image
+		edited_img->data = NULL;
+		return edited_img;
+	}
+	free(edited_img);
+	
+	if(RESULT_CACHE){
+		store_result_cache(input_hash, operation, composed_img); // a failed store only costs a later hit
+	}
+	
+	return composed_img;
+}
+
+
+
+/**
+*	IMAGE PROCESSING MASTER/WORKER
+*/
+
+Image *image_processing_master(const char *in_file_name, operation_t operation, int chunk_size, int my_rank, int num_processes, MPI_Comm comm, int num_cores, int num_workstations, unsigned long long *hash){
+	/**
+	*	Takes in a file path to the file to edit, an operation_t, the size of a chunk (or ADAPTIVE_CHUNK_SIZE),
+	*	this process's rank, the total number of processes, the communicator of the processes editing the Image,
+	*	the number of available cores on this workstation, the number of workstations
+	*	and a place to store the hash of the edited Image on process 0 (NULL if it is not needed).
+	*	If rank == 0, it calls master_process with the appropriate arguments and returns the whole edited Image.
+	*	If rank != 0, it calls worker_process with the appropriate arguments and returns a `dummy` Image.
+	*	With SHARED_MEMORY_WINDOWS, the Image is shared on every node instead (master_shared_image).
+	*	Otherwise, with HIERARCHICAL_MASTER and several nodes, process 0 only talks to one sub-master per node (split_master_hierarchy):
+	*	it hands them super-chunks like chunks to workers, and every sub-master splits its super-chunks among the workers of its node.
+	*	If RESULT_CACHE is set, the master first hashes the file and looks it up in the result cache;
+	*	on a hit, the workers are terminated before they get any work.
+	*	Without HYBRID_MASTER, process 0 edits no chunk, so it needs at least 2 processes.
+	*/
+	
+	MPI_Comm leaders = comm, local = MPI_COMM_NULL;
+	int num_leaders = num_processes, leader_rank = my_rank, local_rank = 0;
+	int check;
+	
+	if(num_processes < 2 - HYBRID_MASTER){
+		if(my_rank == 0){
+			fprintf(stderr, "Rank 0: Error in image_processing_master: The Master/Worker version needs at least 2 processes without HYBRID_MASTER\n");
+			fflush(stderr);
+		}
+		return NULL;
+	}
+	
+	if(SHARED_MEMORY_WINDOWS){
+		return master_shared_image(in_file_name, operation, chunk_size, my_rank, num_processes, comm, max(1, num_cores / (num_processes / num_workstations)), hash);
+	}
+	
+	if(HIERARCHICAL_MASTER){
+		check = split_master_hierarchy(comm, my_rank, &leaders, &local);
+		if(check != 0){ // error message was printed by the called function
+			return NULL;
+		}
+		
+		if(leaders != MPI_COMM_NULL){
+			MPI_Comm_size(leaders, &num_leaders);
+			MPI_Comm_rank(leaders, &leader_rank);
+		}
+		if(local != MPI_COMM_NULL) MPI_Comm_rank(local, &local_rank);
+	}
+	
+	Image *img = NULL;
+	
+	if(my_rank == 0){ // MASTER
+		int num_threads = max(1, num_cores / (num_processes / num_workstations));
+		unsigned long long input_hash;
+		
+		if(RESULT_CACHE && check_result_cache(in_file_name, NULL, operation, 0, MPI_COMM_NULL, num_threads, &input_hash, &img) == 1){
+			for(int i = 1; i < num_leaders; ++i){
+				check = MPI_Send(NULL, 0, MPI_BYTE, i, TERMINATE_TAG, leaders);
+				if(check != MPI_SUCCESS){
+					fprintf(stderr, "Rank 0: Error in image_processing_master while sending terminate order\n");
+					fflush(stderr);
+					free(img->data);
+					free(img);
+					img = NULL;
+					break;
 				}
-				
-				return -1;
 			}
 			
-			free(img->data);
-			free(img);
+			if(img != NULL) img = cached_result(img, 0, num_threads, hash);
+		}
+		else{
+			// a fixed chunk size becomes a super-chunk of one chunk per worker of a node
+			if(chunk_size > 0 && leaders != comm) chunk_size = chunk_size * (num_processes - 1) / (num_leaders - 1);
 			
-			header.true_start = 0;
-			header.true_end = new_image->height - 1;
-			header.height = new_image->height;
-			header.width = new_image->width;
+			img = master_process(in_file_name, operation, chunk_size, num_leaders, leaders, num_threads, hash);
 			
-			check = MPI_Send(&header, 1, mpi_send_block, 0, WORK_HEADER_RECEIVE_TAG, MPI_COMM_WORLD);
-			if(check != MPI_SUCCESS){
-				fprintf(stderr, "Rank %d: Error in worker_process while sending work header\n", my_rank);
-				fflush(stderr);
-				free(new_image->data);
-				free(new_image);
-				
-				check = deallocate_MPI_datatype(&mpi_send_block, my_rank);
-				if(check == -1){ // error message was printed by the called function
-					return -1;
-				}
-				
-				check = deallocate_MPI_datatype(&mpi_rgb, my_rank);
-				if(check == -1){ // error message was printed by the called function
-					return -1;
+			if(RESULT_CACHE && img != NULL){
+				store_result_cache(input_hash, operation, img); // a failed store only costs a later hit
+			}
+		}
+	}
+	else{ // WORKER, or the sub-master of a node and then its workers
+		check = (local_rank == 0) ? worker_process(leader_rank, leaders, local) : worker_process(local_rank, local, MPI_COMM_NULL);
+		
+		// once process 0 terminated a sub-master, the sub-master terminates the workers of its node
+		if(check == 0 && local != MPI_COMM_NULL && local_rank == 0){
+			int local_size;
+			MPI_Comm_size(local, &local_size);
+			for(int i = 1; i < local_size && check == 0; ++i){
+				check = MPI_Send(NULL, 0, MPI_BYTE, i, TERMINATE_TAG, local);
+				if(check != MPI_SUCCESS){
+					fprintf(stderr, "Rank %d: Error in image_processing_master while sending terminate order\n", my_rank);
+					fflush(stderr);
+					check = -1;
 				}
-				
-				return -1;
 			}
-			
-			check = MPI_Send(new_image->data, header.height * header.width, mpi_rgb, 0, WORK_DATA_RECEIVE_TAG, MPI_COMM_WORLD);
-			if(check != MPI_SUCCESS){
-				fprintf(stderr, "Rank %d: Error in worker_process while sending work data\n", my_rank);
+		}
+		
+		if(check == 0){
+			img = (Image*)malloc(sizeof(Image));
+			if(img == NULL){
+				fprintf(stderr, "Rank %d: Error in image_processing_master while allocating memory\n", my_rank);
 				fflush(stderr);
-				free(new_image->data);
-				free(new_image);
-				
-				check = deallocate_MPI_datatype(&mpi_send_block, my_rank);
-				if(check == -1){ // error message was printed by the called function
-					return -1;
-				}
-				
-				check = deallocate_MPI_datatype(&mpi_rgb, my_rank);
-				if(check == -1){ // error message was printed by the called function
-					return -1;
-				}
-				
-				return -1;
 			}
-			
-			free(new_image->data);
-			free(new_image);
+			else{
+				img->data = NULL;
+			}
 		}
 	}
 	
-	check = deallocate_MPI_datatype(&mpi_send_block, my_rank);
-	if(check == -1){ // error message was printed by the called function
+	if(leaders != comm && leaders != MPI_COMM_NULL) MPI_Comm_free(&leaders);
+	if(local != MPI_COMM_NULL) MPI_Comm_free(&local);
+	
+	return img; // NULL on failure, the error message was printed by the called function
+}
+
+
+
+/**
+*	IMAGE PROCESSING MASTER/WORKER SFT
+*/
+
+int image_processing_master_sft(const char *in_file_name, const char *out_file_name, operation_t operation, int chunk_size, int my_rank, int num_processes, MPI_Comm comm, int num_cores, int num_workstations, unsigned long long *hash){
+	/**
+	*	Takes in a file path to the file to edit (a .bmp file or a tiled image), a file path to save the edited Image at, an operation_t,
+	*	the size of a chunk (or ADAPTIVE_CHUNK_SIZE), this process's rank, the total number of processes, the communicator of the processes editing the Image,
+	*	the number of available cores on this workstation, the number of workstations
+	*	and a place to store the hash of the edited Image on process 0 (NULL if it is not needed).
+	*	It is the Master/Worker version for a SFT: process 0 (sft_master_process) only schedules the chunks and sends their rows to the workers
+	*	(sft_worker_process), which read the chunks with their halos from the input file and write the edited rows into the output file with MPI-IO.
+	*	The hashes of the edited rows are added on process 0. It needs at least 2 processes.
+	*	It returns 0 on success and -1 on failure.
+	*/
+	
+	if(num_processes < 2){
+		if(my_rank == 0){
+			fprintf(stderr, "Rank 0: Error in image_processing_master_sft: The SFT Master/Worker version needs at least 2 processes\n");
+			fflush(stderr);
+		}
 		return -1;
 	}
 	
-	check = deallocate_MPI_datatype(&mpi_rgb, my_rank);
-	if(check == -1){ // error message was printed by the called function
+	shared_files_t files;
+	int check = open_shared_files(in_file_name, out_file_name, &files, my_rank, comm);
+	if(check != 0){ // error message was printed by the called function
 		return -1;
 	}
-
+	
+	int num_threads = max(1, num_cores / (num_processes / num_workstations));
+	unsigned long long rows_hash = 0;
+	
+	if(my_rank == 0){
+		check = sft_master_process(&files, operation, chunk_size, num_processes, comm, num_threads, NULL);
+	}
+	else{
+		check = sft_worker_process(&files, get_kernel_size(operation) / 2, my_rank, comm, (hash != NULL) ? &rows_hash : NULL);
+	}
+	
+	close_shared_files(&files); // collective, so every row is in the output file once it returns
+	if(check != 0){ // error message was printed by the called function
+		return -1;
+	}
+	
+	if(hash != NULL){
+		check = reduce_image_hash(rows_hash, files.height, files.width, files.channels, hash, my_rank, comm);
+		if(check != 0){ // error message was printed by the called function
+			return -1;
+		}
+	}
+	
 	return 0;
 }
 
-Image *image_processing_master(const char *in_file_name, operation_t operation, int chunk_size, int my_rank, int num_processes, int num_cores, int num_workstations){
+
+
+/**
+*	IMAGE PROCESSING INCREMENTAL
+*/
+
+Image *image_processing_incremental(const char *prev_in_file_name, const char *prev_out_file_name, const char *in_file_name, operation_t operation, int chunk_size, int my_rank, int num_processes, MPI_Comm comm, int num_cores, int num_workstations){
 	/**
-	*	Takes in a file path to the file to edit, an operation_t, the size of a chunk,
-	*	this process's rank, the total number of processes,
-	*	the number of available cores on this workstation and the number of workstations.
-	*	If rank == 0, it calls master_process with the appropriate arguments and returns the whole edited Image.
-	*	If rank != 0, it calls worker_process with the appropriate arguments and returns a `dummy` Image.
+	*	Takes in the file path of the previous input, the file path of the previous output (the previous input edited with operation),
+	*	the file path of the new input, an operation_t, the size of a chunk, this process's rank, the total number of processes,
+	*	the communicator of the processes editing the Image, the number of cores on this workstation and the number of workstations.
+	*	Process 0 reads the three images and finds the regions of the new input which differ from the previous input (find_dirty_regions).
+	*	Only those regions, with their halos, are edited again and patched into the previous output; the rest of it is kept.
+	*	With more than one process, the regions are cut into chunks of at most chunk_size rows and only those dirty chunks
+	*	are dispatched to the workers of the master/worker version. With a single process, process 0 edits them itself.
+	*	If rank == 0, it returns the edited new input, and if rank != 0, it returns a `dummy` Image.
 	*/
 	
-	if(my_rank == 0){ // MASTER
-		Image *img = NULL;
-		int num_threads = max(1, num_cores / (num_processes / num_workstations));
+	if(my_rank != 0){ // WORKER
+		int check = worker_process(my_rank, comm, MPI_COMM_NULL);
+		if(check == -1){ // error message was printed by the called function
+			return NULL;
+		}
+		
+		Image *dummy = (Image*)malloc(sizeof(Image));
+		if(dummy == NULL){
+			fprintf(stderr, "Rank %d: Error in image_processing_incremental while allocating memory\n", my_rank);
+			fflush(stderr);
+			return NULL;
+		}
+		
+		dummy->data = NULL;
+		return dummy;
+	}
+	
+	int halo_dim = get_kernel_size(operation) / 2;
+	int num_threads = (num_processes == 1) ? num_cores : max(1, num_cores / (num_processes / num_workstations));
+	
+	Image *prev_img = is_tiled_file(prev_in_file_name) ? read_tiled_serial(prev_in_file_name) : read_BMP_serial(prev_in_file_name);
+	Image *img = is_tiled_file(in_file_name) ? read_tiled_serial(in_file_name) : read_BMP_serial(in_file_name);
+	Image *output = read_BMP_serial(prev_out_file_name);
+	region_t *regions = NULL, *chunks = NULL;
+	int num_regions = -1, num_chunks = 0;
+	
+	if(prev_img != NULL && img != NULL && output != NULL){ // otherwise, the error message was printed by the called function
+		if(prev_img->height != img->height || prev_img->width != img->width || prev_img->channels != img->channels
+			|| output->height != img->height || output->width != img->width || output->channels != img->channels){
+			fprintf(stderr, "Rank 0: Error in image_processing_incremental: The previous input, the previous output and the new input differ in size\n");
+			fflush(stderr);
+		}
+		else{
+			num_regions = find_dirty_regions(prev_img, img, halo_dim, num_threads, &regions);
+		}
+	}
+	
+	if(num_regions > 0){
+		// a region is cut into chunks of at most chunk_size rows, so a large region keeps all the workers busy
+		chunk_size = min(chunk_size, chunk_message_rows(img->width, img->channels, halo_dim));
+		for(int i = 0; i < num_regions; ++i){
+			num_chunks += (regions[i].height + chunk_size - 1) / chunk_size;
+		}
+		
+		chunks = (region_t*)malloc(num_chunks * sizeof(region_t));
+		if(chunks == NULL){
+			fprintf(stderr, "Rank 0: Error in image_processing_incremental while allocating memory\n");
+			fflush(stderr);
+			num_regions = -1;
+		}
+		else{
+			num_chunks = 0;
+			for(int i = 0; i < num_regions; ++i){
+				for(int row = 0; row < regions[i].height; row += chunk_size){
+					chunks[num_chunks] = regions[i];
+					chunks[num_chunks].y += row;
+					chunks[num_chunks].height = min(chunk_size, regions[i].height - row);
+					++num_chunks;
+				}
+			}
+		}
+	}
+	
+	if(INCREMENTAL_PRINT_REGIONS && num_regions >= 0){
+		long long dirty_pixels = 0;
+		for(int i = 0; i < num_regions; ++i){
+			fprintf(stdout, "Dirty region %d: columns [%d, %d), rows [%d, %d)\n", i, regions[i].x, regions[i].x + regions[i].width, regions[i].y, regions[i].y + regions[i].height);
+			dirty_pixels += (long long)regions[i].width * regions[i].height;
+		}
+		fprintf(stdout, "%d dirty regions (%d chunks), %.2f%% of the pixels edited again\n", num_regions, num_chunks, 100.0 * dirty_pixels / ((long long)img->height * img->width));
+		fflush(stdout);
+	}
+	
+	int check = -1;
+	if(num_regions >= 0){
+		if(num_processes == 1){
+			check = 0;
+			for(int i = 0; i < num_chunks && check == 0; ++i){
+				check = update_region(output, img, chunks[i], operation, num_threads);
+			}
+		}
+		else{
+			chunk_protocol_t protocol;
+			check = open_chunk_protocol(&protocol, comm);
+			if(check == 0){ // otherwise, the error message was printed by the called function
+				check = dispatch_regions(output, img, chunks, num_chunks, operation, &protocol, num_threads, 1);
+				close_chunk_protocol(&protocol);
+			}
+		}
+	}
+	else{
+		// the workers are waiting for work
+		for(int i = 1; i < num_processes; ++i){
+			MPI_Send(NULL, 0, MPI_BYTE, i, TERMINATE_TAG, comm);
+		}
+	}
+	
+	if(check == 0){
+		output->top_down = img->top_down;
+	}
+	
+	free(regions);
+	free(chunks);
+	if(prev_img != NULL){
+		free(prev_img->data);
+		free(prev_img);
+	}
+	if(img != NULL){
+		free(img->data);
+		free(img);
+	}
+	
+	if(check != 0){ // error message was printed by the called function
+		if(output != NULL){
+			free(output->data);
+			free(output);
+		}
+		return NULL;
+	}
+	
+	return output;
+}
 
-		img = master_process(in_file_name, operation, chunk_size, num_processes, num_threads);
-		if(img == NULL){ // error message was printed by the called function
+
+
+/**
+*	IMAGE PROCESSING REGION OF INTEREST
+*/
+
+Image *edit_region_strip(const char *in_file_name, operation_t operation, region_t strip, int num_threads){
+	/**
+	*	Takes in a file path to the file to edit, an operation_t, a strip of the region of interest and the number of threads to use.
+	*	It reads the strip with its halos, edits it and returns the edited strip, without the columns of its halos.
+	*/
+	
+	int halo_dim = get_kernel_size(operation) / 2;
+	int true_start, true_end, column_start;
+	
+	Image *strip_img = (Image*)malloc(sizeof(Image));
+	if(strip_img == NULL){
+		fprintf(stderr, "Error in edit_region_strip while allocating memory\n");
+		fflush(stderr);
+		return NULL;
+	}
+	strip_img->height = strip.height;
+	strip_img->width = strip.width;
+	strip_img->data = NULL;
+	
+	if(strip.height == 0){ // more processes than rows in the region
+		strip_img->channels = 0;
+		return strip_img;
+	}
+	
+	Image *read_img = read_region(in_file_name, strip, halo_dim, &true_start, &true_end, &column_start);
+	if(read_img == NULL){ // error message was printed by the called function
+		free(strip_img);
+		return NULL;
+	}
+	
+	Image *edited_img = perform_convolution_parallel(read_img, operation, true_start, true_end, num_threads);
+	strip_img->channels = read_img->channels;
+	strip_img->top_down = read_img->top_down;
+	free(read_img->data);
+	free(read_img);
+	if(edited_img == NULL){ // error message was printed by the called function
+		free(strip_img);
+		return NULL;
+	}
+	
+	strip_img->data = (unsigned char*)malloc((size_t)strip.height * strip.width * strip_img->channels);
+	if(strip_img->data == NULL){
+		fprintf(stderr, "Error in edit_region_strip while allocating memory\n");
+		fflush(stderr);
+		free(edited_img->data);
+		free(edited_img);
+		free(strip_img);
+		return NULL;
+	}
+	
+	region_t whole_strip = {0, 0, strip.width, strip.height};
+	patch_region(strip_img, edited_img, whole_strip, column_start);
+	free(edited_img->data);
+	free(edited_img);
+	return strip_img;
+}
+
+Image *image_processing_roi(const char *in_file_name, operation_t operation, region_t roi, int shared_file_tree, int chunk_size, int my_rank, int num_processes, MPI_Comm comm, int num_cores, int num_workstations){
+	/**
+	*	Takes in a file path to the file to edit (a .bmp file or a tiled image), an operation_t, a region of interest
+	*	(rows counted from the top of the picture), 1 if the system has a SFT and 0 otherwise, the size of a chunk, this process's rank,
+	*	the total number of processes, the communicator of the processes editing the region, the number of cores on this workstation
+	*	and the number of workstations.
+	*	Only the region of interest and its halos are read from the file, distributed and edited, so the time depends on the size
+	*	of the region and not on the size of the image. With a SFT, every process reads its own strip of the region and edits it,
+	*	and the edited strips are composed on process 0. Without a SFT, process 0 reads the region and, like the master/worker version,
+	*	hands out chunks of at most chunk_size rows of it to the workers (with a single process, process 0 edits them itself).
+	*	If rank == 0, it returns the edited region of interest, and if rank != 0, it returns a `dummy` Image.
+	*/
+	
+	int check;
+	int halo_dim = get_kernel_size(operation) / 2;
+	region_t region;
+	
+	if(shared_file_tree){
+		check = picture_region(in_file_name, roi, &region);
+		if(check != 0){ // error message was printed by the called function
+			return NULL;
+		}
+		
+		region_t strip = region;
+		sft_strip_rows(region.height, num_processes, my_rank, &strip.y, &strip.height);
+		strip.y += region.y;
+		
+		Image *edited_strip = edit_region_strip(in_file_name, operation, strip, max(1, num_cores / (num_processes / num_workstations)));
+		if(edited_strip == NULL){ // error message was printed by the called function
 			return NULL;
 		}
 		
-		return img;
+		// processes with an empty strip still take part in composing the region, with the pixel size of the others
+		int channels = edited_strip->channels;
+		check = MPI_Allreduce(MPI_IN_PLACE, &channels, 1, MPI_INT, MPI_MAX, comm);
+		if(check != MPI_SUCCESS){
+			fprintf(stderr, "Rank %d: Error in image_processing_roi while agreeing on the number of channels\n", my_rank);
+			fflush(stderr);
+			return NULL;
+		}
+		edited_strip->channels = channels;
+		
+		Image *composed_img = compose_BMP(edited_strip, my_rank, num_processes, comm);
+		if(composed_img == NULL){ // error message was printed by the called function
+			return NULL;
+		}
+		
+		free(edited_strip->data);
+		if(my_rank != 0){ // compose_BMP returned edited_strip, which becomes a `dummy` Image
+			edited_strip->data = NULL;
+			return edited_strip;
+		}
+		composed_img->top_down = edited_strip->top_down;
+		free(edited_strip);
+		
+		return composed_img;
 	}
-	else{ // WORKER
-		int check = worker_process(my_rank);
-		if(check == -1){
+	
+	if(my_rank != 0){ // WORKER
+		check = worker_process(my_rank, comm, MPI_COMM_NULL);
+		if(check == -1){ // error message was printed by the called function
 			return NULL;
 		}
 		
 		Image *dummy = (Image*)malloc(sizeof(Image));
 		if(dummy == NULL){
-			fprintf(stderr, "Rank %d: Error in image_processing_master while allocating memory\n", my_rank);
+			fprintf(stderr, "Rank %d: Error in image_processing_roi while allocating memory\n", my_rank);
 			fflush(stderr);
 			return NULL;
 		}
@@ -898,6 +1726,206 @@ Image *image_processing_master(const char *in_file_name, operation_t operation,
 		dummy->data = NULL;
 		return dummy;
 	}
+	
+	int true_start, true_end, column_start;
+	Image *read_img = NULL;
+	
+	check = picture_region(in_file_name, roi, &region);
+	if(check == 0){
+		read_img = read_region(in_file_name, region, halo_dim, &true_start, &true_end, &column_start);
+	}
+	if(read_img == NULL){ // error message was printed by the called function
+		for(int i = 1; i < num_processes; ++i){ // the workers are waiting for work
+			MPI_Send(NULL, 0, MPI_BYTE, i, TERMINATE_TAG, comm);
+		}
+		return NULL;
+	}
+	
+	// the chunks and the edited region are placed like in read_img, whose halos stay unused in output
+	chunk_size = min(chunk_size, chunk_message_rows(read_img->width, read_img->channels, halo_dim));
+	int num_chunks = (region.height + chunk_size - 1) / chunk_size;
+	region_t *chunks = (region_t*)malloc(num_chunks * sizeof(region_t));
+	Image output = *read_img;
+	output.data = (unsigned char*)malloc((size_t)read_img->height * read_img->width * read_img->channels);
+	if(chunks == NULL || output.data == NULL){
+		fprintf(stderr, "Rank 0: Error in image_processing_roi while allocating memory\n");
+		fflush(stderr);
+		free(chunks);
+		free(output.data);
+		free(read_img->data);
+		free(read_img);
+		for(int i = 1; i < num_processes; ++i){ // the workers are waiting for work
+			MPI_Send(NULL, 0, MPI_BYTE, i, TERMINATE_TAG, comm);
+		}
+		return NULL;
+	}
+	
+	for(int i = 0; i < num_chunks; ++i){
+		chunks[i].x = column_start;
+		chunks[i].y = true_start + i * chunk_size;
+		chunks[i].width = region.width;
+		chunks[i].height = min(chunk_size, region.height - i * chunk_size);
+	}
+	
+	if(num_processes == 1){
+		int num_threads = num_cores;
+		check = 0;
+		for(int i = 0; i < num_chunks && check == 0; ++i){
+			check = update_region(&output, read_img, chunks[i], operation, num_threads);
+		}
+	}
+	else{
+		int num_threads = max(1, num_cores / (num_processes / num_workstations));
+		chunk_protocol_t protocol;
+		check = open_chunk_protocol(&protocol, comm);
+		if(check == 0){ // otherwise, the error message was printed by the called function
+			check = dispatch_regions(&output, read_img, chunks, num_chunks, operation, &protocol, num_threads, 1);
+			close_chunk_protocol(&protocol);
+		}
+	}
+	
+	Image *roi_img = NULL;
+	if(check == 0){
+		region_t edited_region = {column_start, true_start, region.width, region.height};
+		roi_img = crop_region(&output, edited_region, 0, &true_start, &true_end, &column_start); // NULL on failure, the error message was printed by the called function
+	}
+	
+	free(chunks);
+	free(output.data);
+	free(read_img->data);
+	free(read_img);
+	return roi_img;
+}
+
+
+
+/**
+*	IMAGE PROCESSING STREAMING
+*/
+
+int image_processing_streaming(const char *in_file_name, const char *out_file_name, operation_t operation, int band_size, int num_threads){
+	/**
+	*	Takes in a file path to the file to edit, a file path at which to save the edited image, an operation_t,
+	*	the number of rows in a band and the number of threads to use for the convolution.
+	*	It reads the .bmp file in horizontal bands, in the order they are stored in the file,
+	*	edits each band and writes it straight to the output file, so that the image is never held in memory as a whole.
+	*	The halo rows needed by a band are carried over from the previous band instead of being read again.
+	*	Memory usage is O(band_size * width), regardless of the height of the image.
+	*	It returns 0 on success and -1 otherwise.
+	*/
+	
+	int kernel_size = get_kernel_size(operation);
+	int halo_dim = kernel_size / 2;
+	int check;
+	int height, width, channels, top_down, data_start, padding;
+	
+	FILE *image_file = open_BMP(in_file_name, &height, &width, &channels, &top_down, &data_start, &padding);
+	if(image_file == NULL){ // error message was printed by the called function
+		return -1;
+	}
+	
+	// the output keeps the orientation of the input, so bands can be written in the order they are read
+	FILE *out_file = create_BMP(out_file_name, height, width, channels, top_down);
+	if(out_file == NULL){ // error message was printed by the called function
+		fclose(image_file);
+		return -1;
+	}
+	
+	// a band together with both of its halos
+	int row_size = width * channels;
+	unsigned char *data = (unsigned char*)malloc((size_t)(band_size + 2 * halo_dim) * (row_size + padding)); // rows are read with their padding
+	if(data == NULL){
+		fprintf(stderr, "Error in image_processing_streaming while allocating memory\n");
+		fflush(stderr);
+		fclose(image_file);
+		fclose(out_file);
+		return -1;
+	}
+	
+	fseek(image_file, data_start, SEEK_SET);
+	
+	/**
+	*	Rows are numbered in file order (row 0 is the bottom row of the image, or the top row for top-down files).
+	*	The band [band_start, band_end) needs the input rows [window_start, window_end),
+	*	which are stored in file order in data, so row window_start is data's first row.
+	*/
+	int band_start = 0;
+	int band_end = min(band_size, height);
+	int window_start = 0;
+	int window_end = min(band_end + halo_dim, height);
+	
+	check = read_BMP_rows(image_file, data, window_end, row_size, padding);
+	if(check != 0){ // error message was printed by the called function
+		free(data);
+		fclose(image_file);
+		fclose(out_file);
+		return -1;
+	}
+	
+	Image window;
+	window.width = width;
+	window.channels = channels;
+	window.top_down = top_down;
+	window.data = data;
+	
+	while(band_start < height){
+		window.height = window_end - window_start;
+		
+		int true_start = band_start - window_start;
+		int true_end = band_end - 1 - window_start;
+		
+		Image *edited_band = perform_convolution_parallel(&window, operation, true_start, true_end, num_threads);
+		if(edited_band == NULL){ // error message was printed by the called function
+			free(data);
+			fclose(image_file);
+			fclose(out_file);
+			return -1;
+		}
+		
+		check = write_BMP_rows(out_file, edited_band);
+		free(edited_band->data);
+		free(edited_band);
+		if(check != 0){ // error message was printed by the called function
+			free(data);
+			fclose(image_file);
+			fclose(out_file);
+			return -1;
+		}
+		
+		// moving to the next band
+		band_start = band_end;
+		if(band_start >= height) break;
+		
+		band_end = min(band_start + band_size, height);
+		int next_window_start = max(band_start - halo_dim, 0);
+		int next_window_end = min(band_end + halo_dim, height);
+		int carried_rows = window_end - next_window_start;
+		int new_rows = next_window_end - window_end;
+		
+		// the rows shared with the previous window move from the end of data to the start
+		memmove(data, data + (size_t)(next_window_start - window_start) * row_size, (size_t)carried_rows * row_size);
+		check = read_BMP_rows(image_file, data + (size_t)carried_rows * row_size, new_rows, row_size, padding);
+		if(check != 0){ // error message was printed by the called function
+			free(data);
+			fclose(image_file);
+			fclose(out_file);
+			return -1;
+		}
+		
+		window_start = next_window_start;
+		window_end = next_window_end;
+	}
+	
+	free(data);
+	fclose(image_file);
+	
+	if(fclose(out_file) != 0){
+		fprintf(stderr, "Error in image_processing_streaming while closing file %s\n", out_file_name);
+		fflush(stderr);
+		return -1;
+	}
+	
+	return 0;
 }
 
 
@@ -911,13 +1939,9 @@ int images_are_identical(Image *img1, Image *img2){
 	*	Takes in 2 Images and returns 1 if they are identical and 0 otherwise.
 	*/
 	
-	if(img1->height != img2->height || img1->width != img2->width) return 0;
+	if(img1->height != img2->height || img1->width != img2->width || img1->channels != img2->channels || img1->top_down != img2->top_down) return 0;
 	
-	for(int i = 0; i < img1->height; ++i){
-		for(int j = 0; j < img1->width; ++j){
-			if(equal_RGB((img1->data)[i * img1->width + j], (img2->data)[i * img2->width + j]) == 0) return 0;
-		}
-	}
+	if(memcmp(img1->data, img2->data, (size_t)img1->height * img1->width * img1->channels) != 0) return 0;
 	
 	return 1;
 }
\ No newline at end of file
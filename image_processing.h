@@ -2,10 +2,24 @@
 
 #define IMAGE_PROCESSING
 
-Image *image_processing_serial(const char *in_file_name, operation_t operation);
-Image *image_processing_parallel_sft(const char *in_file_name, operation_t operation, int my_rank, int num_processes, int num_cores);
-Image *image_processing_parallel_no_sft(const char *in_file_name, operation_t operation, int my_rank, int num_processes, int num_cores, int num_workstations);
-Image *image_processing_master(const char *in_file_name, operation_t operation, int chunk_size, int my_rank, int num_processes, int num_cores, int num_workstations);
+#include "tiled.h"
+#include "incremental.h"
+
+#define HYBRID_MASTER 1 // set to 0 to let process 0 of the Master/Worker version only hand out and collect the chunks, without editing any
+#define ADAPTIVE_CHUNK_SIZE 0 // chunk size of image_processing_master which lets the master size every chunk from the rows left and the throughput of the workers
+
+Image *image_processing_serial(const char *in_file_name, operation_t operation, unsigned long long *hash);
+Image *image_processing_parallel_sft(const char *in_file_name, operation_t operation, int my_rank, int num_processes, MPI_Comm comm, int num_cores, unsigned long long *hash);
+Image *image_processing_parallel_no_sft(const char *in_file_name, operation_t operation, int my_rank, int num_processes, MPI_Comm comm, int num_cores, int num_workstations, unsigned long long *hash);
+Image *image_processing_master(const char *in_file_name, operation_t operation, int chunk_size, int my_rank, int num_processes, MPI_Comm comm, int num_cores, int num_workstations, unsigned long long *hash);
+int image_processing_master_sft(const char *in_file_name, const char *out_file_name, operation_t operation, int chunk_size, int my_rank, int num_processes, MPI_Comm comm, int num_cores, int num_workstations, unsigned long long *hash);
+Image *image_processing_incremental(const char *prev_in_file_name, const char *prev_out_file_name, const char *in_file_name, operation_t operation, int chunk_size, int my_rank, int num_processes, MPI_Comm comm, int num_cores, int num_workstations);
+Image *image_processing_roi(const char *in_file_name, operation_t operation, region_t roi, int shared_file_tree, int chunk_size, int my_rank, int num_processes, MPI_Comm comm, int num_cores, int num_workstations);
+int image_processing_streaming(const char *in_file_name, const char *out_file_name, operation_t operation, int band_size, int num_threads);
 int images_are_identical(Image *img1, Image *img2);
+Image *cached_result(Image *cached_img, int my_rank, int num_threads, unsigned long long *hash);
+void sft_strip_rows(int height, int num_processes, int rank, int *first_row, int *num_rows);
+int sft_check_file_size(MPI_File image_file_handler, int data_offset, int offset_stride, int height);
+int sft_read_rows(MPI_File image_file_handler, tiled_image_t *tiled, int data_offset, int offset_stride, int first_row, int end_row, unsigned char *buffer, MPI_Request *request);
 
 #endif
\ No newline at end of file
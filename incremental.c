@@ -0,0 +1,315 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <omp.h>
+#include "incremental.h"
+#include "bmp.h"
+#include "tiled.h"
+
+int find_dirty_regions(const Image *prev_img, const Image *new_img, int halo_dim, int num_threads, region_t **regions){
+	/**
+	*	Takes in the previous and the new input (of the same size), the size of the halo of the operation,
+	*	the number of threads to use and a place to store the dirty regions.
+	*	It compares the inputs in blocks of INCREMENTAL_BLOCK_SIZE x INCREMENTAL_BLOCK_SIZE pixels. Every run of consecutive rows of blocks
+	*	holding a changed block becomes a region, spanning the columns from its leftmost to its rightmost changed block.
+	*	The regions are grown by halo_dim on every side, since the edited pixels up to halo_dim away from a changed pixel change as well,
+	*	so they are exactly the parts of the output to edit again.
+	*	It returns the number of regions (0 if the inputs are identical) and -1 on failure.
+	*/
+	
+	int height = new_img->height;
+	int width = new_img->width;
+	int channels = new_img->channels;
+	int blocks_y = (height + INCREMENTAL_BLOCK_SIZE - 1) / INCREMENTAL_BLOCK_SIZE;
+	int blocks_x = (width + INCREMENTAL_BLOCK_SIZE - 1) / INCREMENTAL_BLOCK_SIZE;
+	
+	// leftmost and rightmost changed block of every row of blocks, -1 if none changed
+	int *first_dirty = (int*)malloc(blocks_y * sizeof(int));
+	int *last_dirty = (int*)malloc(blocks_y * sizeof(int));
+	*regions = (region_t*)malloc(blocks_y * sizeof(region_t));
+	if(first_dirty == NULL || last_dirty == NULL || *regions == NULL){
+		fprintf(stderr, "Error in find_dirty_regions while allocating memory\n");
+		fflush(stderr);
+		free(first_dirty);
+		free(last_dirty);
+		free(*regions);
+		return -1;
+	}
+	
+	#pragma omp parallel for num_threads(num_threads) schedule(dynamic)
+	for(int by = 0; by < blocks_y; ++by){
+		int first = blocks_x, last = -1;
+		int end_row = min((by + 1) * INCREMENTAL_BLOCK_SIZE, height);
+		
+		for(int row = by * INCREMENTAL_BLOCK_SIZE; row < end_row; ++row){
+			const unsigned char *prev_row = prev_img->data + (size_t)row * width * channels;
+			const unsigned char *new_row = new_img->data + (size_t)row * width * channels;
+			
+			// only the blocks outside [first, last] can still move the range
+			for(int bx = 0; bx < first; ++bx){
+				size_t start = (size_t)bx * INCREMENTAL_BLOCK_SIZE * channels;
+				size_t size = (size_t)(min((bx + 1) * INCREMENTAL_BLOCK_SIZE, width) - bx * INCREMENTAL_BLOCK_SIZE) * channels;
+				if(memcmp(prev_row + start, new_row + start, size) != 0){
+					first = bx;
+					if(last < bx) last = bx;
+					break;
+				}
+			}
+			
+			if(first == blocks_x) continue; // nothing changed in this row and the rows before it
+			
+			for(int bx = blocks_x - 1; bx > last; --bx){
+				size_t start = (size_t)bx * INCREMENTAL_BLOCK_SIZE * channels;
+				size_t size = (size_t)(min((bx + 1) * INCREMENTAL_BLOCK_SIZE, width) - bx * INCREMENTAL_BLOCK_SIZE) * channels;
+				if(memcmp(prev_row + start, new_row + start, size) != 0){
+					last = bx;
+					break;
+				}
+			}
+		}
+		
+		first_dirty[by] = (last == -1) ? -1 : first;
+		last_dirty[by] = last;
+	}
+	
+	int num_regions = 0;
+	
+	for(int by = 0; by < blocks_y; ++by){
+		if(first_dirty[by] == -1) continue;
+		
+		int first = first_dirty[by], last = last_dirty[by];
+		int start_block = by;
+		while(by + 1 < blocks_y && first_dirty[by + 1] != -1){
+			++by;
+			first = min(first, first_dirty[by]);
+			last = max(last, last_dirty[by]);
+		}
+		
+		int start_row = max(start_block * INCREMENTAL_BLOCK_SIZE - halo_dim, 0);
+		int end_row = min((by + 1) * INCREMENTAL_BLOCK_SIZE + halo_dim, height);
+		int start_column = max(first * INCREMENTAL_BLOCK_SIZE - halo_dim, 0);
+		int end_column = min((last + 1) * INCREMENTAL_BLOCK_SIZE + halo_dim, width);
+		
+		region_t *region = &(*regions)[num_regions++];
+		region->x = start_column;
+		region->y = start_row;
+		region->width = end_column - start_column;
+		region->height = end_row - start_row;
+	}
+	
+	free(first_dirty);
+	free(last_dirty);
+	return num_regions;
+}
+
+Image *crop_region(const Image *img, region_t region, int halo_dim, int *true_start, int *true_end, int *column_start){
+	/**
+	*	Takes in an Image, a region of it, the size of the halo and places to store the first and last row of the region
+	*	and its first column in the cropped Image.
+	*	It returns a new Image holding the region and up to halo_dim rows and columns around it, which is enough to edit the region
+	*	with perform_convolution_parallel: the pixels of the region near a cut side get their neighbours from the halo,
+	*	and those near a side of img see the same border as in img.
+	*/
+	
+	int start_row = max(region.y - halo_dim, 0);
+	int end_row = min(region.y + region.height + halo_dim, img->height);
+	int start_column = max(region.x - halo_dim, 0);
+	int end_column = min(region.x + region.width + halo_dim, img->width);
+	int channels = img->channels;
+	
+	Image *cropped_img = (Image*)malloc(sizeof(Image));
+	unsigned char *data = (unsigned char*)malloc((size_t)(end_row - start_row) * (end_column - start_column) * channels);
+	if(cropped_img == NULL || data == NULL){
+		fprintf(stderr, "Error in crop_region while allocating memory\n");
+		fflush(stderr);
+		free(cropped_img);
+		free(data);
+		return NULL;
+	}
+	
+	size_t cropped_row_size = (size_t)(end_column - start_column) * channels;
+	for(int row = start_row; row < end_row; ++row){
+		memcpy(data + (row - start_row) * cropped_row_size, img->data + ((size_t)row * img->width + start_column) * channels, cropped_row_size);
+	}
+	
+	cropped_img->height = end_row - start_row;
+	cropped_img->width = end_column - start_column;
+	cropped_img->channels = channels;
+	cropped_img->top_down = img->top_down;
+	cropped_img->data = data;
+	
+	*true_start = region.y - start_row;
+	*true_end = *true_start + region.height - 1;
+	*column_start = region.x - start_column;
+	return cropped_img;
+}
+
+int read_image_header(const char *file_name, int *height, int *width, int *channels, int *top_down){
+	/**
+	*	Takes in a file path to an image (a .bmp file or a tiled image) and places to store its height, width, channels and top_down,
+	*	which it reads from the header of the file.
+	*	It returns 0 on success and -1 on failure.
+	*/
+	
+	if(is_tiled_file(file_name)){
+		tiled_image_t *tiled = open_tiled(file_name);
+		if(tiled == NULL){ // error message was printed by the called function
+			return -1;
+		}
+		
+		*height = tiled->height;
+		*width = tiled->width;
+		*channels = tiled->channels;
+		*top_down = tiled->top_down;
+		close_tiled(tiled);
+		return 0;
+	}
+	
+	int data_start, padding;
+	FILE *image_file = open_BMP(file_name, height, width, channels, top_down, &data_start, &padding);
+	if(image_file == NULL){ // error message was printed by the called function
+		return -1;
+	}
+	
+	fclose(image_file);
+	return 0;
+}
+
+int picture_region(const char *file_name, region_t roi, region_t *region){
+	/**
+	*	Takes in a file path to an image (a .bmp file or a tiled image), a region of interest whose rows are counted
+	*	from the top of the picture, as a user sees it, and a place to store the region.
+	*	It checks that the region of interest lies inside the image and stores it with its rows numbered like in an Image,
+	*	which for a bottom-up image means from the bottom of the picture.
+	*	It returns 0 on success and -1 on failure.
+	*/
+	
+	int height, width, channels, top_down;
+	
+	if(read_image_header(file_name, &height, &width, &channels, &top_down) != 0){ // error message was printed by the called function
+		return -1;
+	}
+	
+	if(roi.x < 0 || roi.y < 0 || roi.width <= 0 || roi.height <= 0 || roi.x + roi.width > width || roi.y + roi.height > height){
+		fprintf(stderr, "Error in picture_region: The region of interest %d,%d,%d,%d is not inside the %dx%d image\n", roi.x, roi.y, roi.width, roi.height, width, height);
+		fflush(stderr);
+		return -1;
+	}
+	
+	*region = roi;
+	if(!top_down){
+		region->y = height - roi.y - roi.height;
+	}
+	
+	return 0;
+}
+
+Image *read_region(const char *file_name, region_t region, int halo_dim, int *true_start, int *true_end, int *column_start){
+	/**
+	*	Takes in a file path to an image (a .bmp file or a tiled image), a region of it, the size of the halo and places to store
+	*	the first and last row of the region and its first column in the read Image.
+	*	It works like crop_region, but reads only the region and its halos from the file, so the reading time
+	*	depends on the size of the region and not on the size of the image.
+	*/
+	
+	int height, width, channels, top_down, data_start, padding;
+	FILE *image_file = NULL;
+	tiled_image_t *tiled = NULL;
+	
+	if(is_tiled_file(file_name)){
+		tiled = open_tiled(file_name);
+		if(tiled == NULL){ // error message was printed by the called function
+			return NULL;
+		}
+		
+		height = tiled->height;
+		width = tiled->width;
+		channels = tiled->channels;
+		top_down = tiled->top_down;
+	}
+	else{
+		image_file = open_BMP(file_name, &height, &width, &channels, &top_down, &data_start, &padding);
+		if(image_file == NULL){ // error message was printed by the called function
+			return NULL;
+		}
+	}
+	
+	int start_row = max(region.y - halo_dim, 0);
+	int end_row = min(region.y + region.height + halo_dim, height);
+	int start_column = max(region.x - halo_dim, 0);
+	int end_column = min(region.x + region.width + halo_dim, width);
+	
+	Image *read_img = (Image*)malloc(sizeof(Image));
+	unsigned char *data = (unsigned char*)malloc((size_t)(end_row - start_row) * (end_column - start_column) * channels);
+	int check = -1;
+	if(read_img == NULL || data == NULL){
+		fprintf(stderr, "Error in read_region while allocating memory\n");
+		fflush(stderr);
+	}
+	else if(tiled != NULL){
+		check = read_tiled_rect(tiled, start_column, start_row, end_column - start_column, end_row - start_row, data);
+	}
+	else{
+		check = read_BMP_rect(image_file, start_column, start_row, end_column - start_column, end_row - start_row, height, width, channels, padding, data_start, data);
+	}
+	
+	if(tiled != NULL) close_tiled(tiled);
+	else fclose(image_file);
+	
+	if(check != 0){ // error message was printed by the called function
+		free(read_img);
+		free(data);
+		return NULL;
+	}
+	
+	read_img->height = end_row - start_row;
+	read_img->width = end_column - start_column;
+	read_img->channels = channels;
+	read_img->top_down = top_down;
+	read_img->data = data;
+	
+	*true_start = region.y - start_row;
+	*true_end = *true_start + region.height - 1;
+	*column_start = region.x - start_column;
+	return read_img;
+}
+
+void patch_region(Image *output, const Image *edited, region_t region, int column_start){
+	/**
+	*	Takes in the Image to patch, the edited rows of a region as returned by perform_convolution_parallel on the cropped region,
+	*	the region and its first column in the edited rows.
+	*	It copies the region from the edited rows into output.
+	*/
+	
+	size_t region_row_size = (size_t)region.width * output->channels;
+	for(int row = 0; row < region.height; ++row){
+		memcpy(output->data + ((size_t)(region.y + row) * output->width + region.x) * output->channels,
+			edited->data + ((size_t)row * edited->width + column_start) * edited->channels, region_row_size);
+	}
+}
+
+int update_region(Image *output, const Image *img, region_t region, operation_t operation, int num_threads){
+	/**
+	*	Takes in the edited Image to update, the Image it is the edit of, a region, an operation_t and the number of threads to use.
+	*	It edits the region of img again and patches it into output.
+	*	It returns 0 on success and -1 on failure.
+	*/
+	
+	int true_start, true_end, column_start;
+	Image *cropped_img = crop_region(img, region, get_kernel_size(operation) / 2, &true_start, &true_end, &column_start);
+	if(cropped_img == NULL){ // error message was printed by the called function
+		return -1;
+	}
+	
+	Image *edited_img = perform_convolution_parallel(cropped_img, operation, true_start, true_end, num_threads);
+	free(cropped_img->data);
+	free(cropped_img);
+	if(edited_img == NULL){ // error message was printed by the called function
+		return -1;
+	}
+	
+	patch_region(output, edited_img, region, column_start);
+	free(edited_img->data);
+	free(edited_img);
+	return 0;
+}
\ No newline at end of file
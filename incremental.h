@@ -0,0 +1,24 @@
+#ifndef INCREMENTAL
+
+#define INCREMENTAL
+
+#include "bmp_common.h"
+#include "convolution.h"
+
+#define INCREMENTAL_BLOCK_SIZE 32 // side of the square blocks compared between the previous and the new input
+#define INCREMENTAL_PRINT_REGIONS 1 // set to 0 to stop printing the dirty regions and the share of the pixels edited again
+
+typedef struct{
+	int x, y; // first column and first row, rows are numbered like in an Image
+	int width, height;
+}region_t; // a rectangle of an Image
+
+int find_dirty_regions(const Image *prev_img, const Image *new_img, int halo_dim, int num_threads, region_t **regions);
+Image *crop_region(const Image *img, region_t region, int halo_dim, int *true_start, int *true_end, int *column_start);
+int read_image_header(const char *file_name, int *height, int *width, int *channels, int *top_down);
+int picture_region(const char *file_name, region_t roi, region_t *region);
+Image *read_region(const char *file_name, region_t region, int halo_dim, int *true_start, int *true_end, int *column_start);
+void patch_region(Image *output, const Image *edited, region_t region, int column_start);
+int update_region(Image *output, const Image *img, region_t region, operation_t operation, int num_threads);
+
+#endif
\ No newline at end of file
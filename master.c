@@ -0,0 +1,1406 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "master.h"
+#include "bmp.h"
+#include "convolution.h"
+#include "tiled.h"
+#include "compression.h"
+#include "verification.h"
+#include "incremental.h"
+#include "image_processing.h"
+#include "blocks.h"
+#include "shared_memory.h"
+
+#define CHUNK_PIXELS_TAG 13
+
+#define CHUNK_MESSAGE_BYTES (4 << 20) // largest message of the Master/Worker version (the header and the pixels of a chunk), larger chunks are cut to fit or, when a single row does not fit, sent in two messages
+#define CHUNK_SCHEDULING 2 // how the master sizes the chunks when given ADAPTIVE_CHUNK_SIZE: 1 = guided, 2 = factoring
+#define CHUNK_MIN_ROWS 16 // smallest chunk handed out by the adaptive chunk sizing
+#define CHUNK_PRINT_SIZES 0 // set to 1 to print the size of every chunk handed out by the adaptive chunk sizing
+#define SPECULATIVE_EXECUTION 1 // set to 0 to stop handing copies of the oldest unfinished chunks to the idle workers of the Master/Worker version once every chunk was handed out
+#define SPECULATIVE_CHECK_ROWS 16 // rows a worker edits between two checks for the order to drop its chunks, with SPECULATIVE_EXECUTION
+#define SPECULATIVE_PRINT_TAIL 0 // set to 1 to print how long the Master/Worker version waited for its last chunks and how many copies of them it handed out
+#define HIERARCHY_CHUNKS_PER_WORKER 4 // chunks a sub-master cuts a super-chunk into, per worker of its node
+
+void close_chunk_protocol(chunk_protocol_t *protocol){
+	/**
+	*	Takes in a chunk_protocol_t, waits for its sends to complete, cancels the receives which will never match
+	*	and frees its requests and buffers.
+	*/
+	
+	for(int i = 0; i < protocol->num_sends && protocol->sends != NULL; ++i){
+		send_slot_t *slot = &protocol->sends[i];
+		if(slot->pixels_request != MPI_REQUEST_NULL) MPI_Wait(&slot->pixels_request, MPI_STATUS_IGNORE);
+		if(slot->request != MPI_REQUEST_NULL){
+			MPI_Wait(&slot->request, MPI_STATUS_IGNORE);
+			MPI_Request_free(&slot->request);
+		}
+		free(slot->buffer);
+	}
+	
+	for(int i = 0; i < protocol->num_receives && protocol->receives != NULL; ++i){
+		if(protocol->receives[i] != MPI_REQUEST_NULL){
+			if(protocol->receiving[i]){
+				MPI_Cancel(&protocol->receives[i]);
+				MPI_Wait(&protocol->receives[i], MPI_STATUS_IGNORE);
+			}
+			MPI_Request_free(&protocol->receives[i]);
+		}
+		if(protocol->receive_buffers != NULL) free(protocol->receive_buffers[i]);
+	}
+	
+	free(protocol->sends);
+	free(protocol->receive_buffers);
+	free(protocol->receives);
+	free(protocol->receiving);
+	free(protocol->received);
+	protocol->sends = NULL;
+	protocol->receive_buffers = NULL;
+	protocol->receives = NULL;
+	protocol->receiving = NULL;
+	protocol->received = NULL;
+}
+
+int open_chunk_protocol(chunk_protocol_t *protocol, MPI_Comm comm){
+	/**
+	*	Takes in a place to store a chunk_protocol_t and the communicator of the master (its process 0) and the workers.
+	*	A chunk travels in a single message: its send_block_t, then its pixels. Every process sets up its messages once per run:
+	*	process 0 gets MASTER_PREFETCH_DEPTH send buffers per worker and one persistent receive from every worker for its edited chunks
+	*	(so the edited chunks of a worker are read in the order they were sent),
+	*	a worker gets MASTER_PREFETCH_DEPTH persistent receives for its queued chunks (and one more for the order to drop them, see find_stop_order)
+	*	and two send buffers for the edited ones, so an edited chunk is sent while the next one is edited.
+	*	The receives are started right away, on buffers of CHUNK_MESSAGE_BYTES (a larger message is split, see start_chunk_message).
+	*	It returns 0 on success and -1 on failure.
+	*/
+	
+	int num_processes, check = MPI_SUCCESS;
+	MPI_Comm_size(comm, &num_processes);
+	MPI_Comm_rank(comm, &protocol->my_rank);
+	
+	int master = (protocol->my_rank == 0);
+	protocol->comm = comm;
+	protocol->num_sends = master ? num_processes * MASTER_PREFETCH_DEPTH : 2;
+	protocol->num_receives = master ? num_processes - 1 : MASTER_PREFETCH_DEPTH + 1;
+	protocol->sends = (send_slot_t*)calloc(protocol->num_sends, sizeof(send_slot_t));
+	protocol->receive_buffers = (unsigned char**)calloc(max(protocol->num_receives, 1), sizeof(unsigned char*));
+	protocol->receives = (MPI_Request*)malloc(max(protocol->num_receives, 1) * sizeof(MPI_Request));
+	protocol->receiving = (int*)calloc(max(protocol->num_receives, 1), sizeof(int));
+	protocol->received = (int*)malloc(max(protocol->num_receives, 1) * sizeof(int));
+	if(protocol->sends == NULL || protocol->receive_buffers == NULL || protocol->receives == NULL || protocol->receiving == NULL || protocol->received == NULL){
+		fprintf(stderr, "Rank %d: Error in open_chunk_protocol while allocating memory\n", protocol->my_rank);
+		fflush(stderr);
+		protocol->num_sends = 0;
+		protocol->num_receives = 0;
+		close_chunk_protocol(protocol);
+		return -1;
+	}
+	
+	for(int i = 0; i < protocol->num_sends; ++i){
+		protocol->sends[i].request = MPI_REQUEST_NULL;
+		protocol->sends[i].pixels_request = MPI_REQUEST_NULL;
+	}
+	for(int i = 0; i < protocol->num_receives; ++i){
+		protocol->receives[i] = MPI_REQUEST_NULL;
+		protocol->received[i] = -1;
+	}
+	
+	// the master grows its send buffers with its chunks, a worker never sends more than it received
+	for(int i = 0; i < protocol->num_sends && !master; ++i){
+		protocol->sends[i].buffer = (unsigned char*)malloc(CHUNK_MESSAGE_BYTES);
+		protocol->sends[i].size = CHUNK_MESSAGE_BYTES;
+		if(protocol->sends[i].buffer == NULL) check = -1;
+	}
+	
+	for(int i = 0; i < protocol->num_receives && check == MPI_SUCCESS; ++i){
+		protocol->receive_buffers[i] = (unsigned char*)malloc(CHUNK_MESSAGE_BYTES);
+		if(protocol->receive_buffers[i] == NULL){
+			check = -1;
+			break;
+		}
+		
+		check = MPI_Recv_init(protocol->receive_buffers[i], CHUNK_MESSAGE_BYTES, MPI_BYTE, master ? i + 1 : 0, master ? WORK_DATA_RECEIVE_TAG : WORK_DATA_SEND_TAG, comm, &protocol->receives[i]);
+		if(check == MPI_SUCCESS) check = MPI_Start(&protocol->receives[i]);
+		if(check == MPI_SUCCESS) protocol->receiving[i] = 1;
+	}
+	
+	if(check != MPI_SUCCESS){
+		fprintf(stderr, "Rank %d: Error in open_chunk_protocol while setting up the messages\n", protocol->my_rank);
+		fflush(stderr);
+		close_chunk_protocol(protocol);
+		return -1;
+	}
+	
+	return 0;
+}
+
+int chunk_message_rows(int width, int channels, int halo_dim){
+	/**
+	*	Takes in the width of the rows of a chunk, their number of channels and the size of the halo
+	*	and returns how many rows a chunk can have, besides its halos, to fit in a message of CHUNK_MESSAGE_BYTES
+	*	(at least 1: a chunk of one row which still does not fit is sent in two messages by start_chunk_message).
+	*/
+	
+	int rows = (CHUNK_MESSAGE_BYTES - (int)sizeof(send_block_t) - PACK_HEADER_SIZE) / (width * channels) - 2 * halo_dim;
+	return max(rows, 1);
+}
+
+unsigned char *reserve_chunk_message(chunk_protocol_t *protocol, send_slot_t *slot, int pixel_bytes){
+	/**
+	*	Takes in a chunk_protocol_t, one of its send slots and the size of the pixels of the next message of the slot.
+	*	It waits for the previous message of the slot to be sent and grows its buffer if needed.
+	*	It returns where the pixels go in the buffer of the slot, or NULL on failure.
+	*/
+	
+	size_t size = sizeof(send_block_t) + (size_t)pixel_bytes;
+	
+	int check = MPI_Wait(&slot->request, MPI_STATUS_IGNORE); // a persistent request stays allocated
+	if(check == MPI_SUCCESS) check = MPI_Wait(&slot->pixels_request, MPI_STATUS_IGNORE);
+	if(check != MPI_SUCCESS){
+		fprintf(stderr, "Rank %d: Error in reserve_chunk_message while sending a chunk\n", protocol->my_rank);
+		fflush(stderr);
+		return NULL;
+	}
+	
+	if(size > (size_t)slot->size){
+		unsigned char *buffer = (unsigned char*)realloc(slot->buffer, size);
+		if(buffer == NULL){
+			fprintf(stderr, "Rank %d: Error in reserve_chunk_message while allocating memory\n", protocol->my_rank);
+			fflush(stderr);
+			return NULL;
+		}
+		
+		// the persistent send is bound to the old buffer
+		if(slot->request != MPI_REQUEST_NULL) MPI_Request_free(&slot->request);
+		slot->buffer = buffer;
+		slot->size = (int)size;
+	}
+	
+	return slot->buffer + sizeof(send_block_t);
+}
+
+int put_chunk_pixels(chunk_protocol_t *protocol, send_slot_t *slot, const unsigned char *data, int pixels, int width, int channels){
+	/**
+	*	Takes in a chunk_protocol_t, one of its send slots, the pixels of a chunk, how many there are,
+	*	the width of the Image they belong to and its number of channels.
+	*	It copies the pixels into the next message of the slot, packed by pack_pixels if TRANSFER_COMPRESSION is set.
+	*	It returns the size of the pixels in the message, or -1 on failure.
+	*/
+	
+	int pixel_bytes = pixels * channels;
+	
+	if(TRANSFER_COMPRESSION == 0){
+		unsigned char *destination = reserve_chunk_message(protocol, slot, pixel_bytes);
+		if(destination == NULL){ // error message was printed by the called function
+			return -1;
+		}
+		
+		memcpy(destination, data, pixel_bytes);
+		return pixel_bytes;
+	}
+	
+	unsigned char *packed = pack_pixels(data, pixels, width, channels, &pixel_bytes);
+	if(packed == NULL){ // error message was printed by the called function
+		return -1;
+	}
+	
+	unsigned char *destination = reserve_chunk_message(protocol, slot, pixel_bytes);
+	if(destination != NULL){ // otherwise, the error message was printed by the called function
+		memcpy(destination, packed, pixel_bytes);
+	}
+	free(packed);
+	return (destination != NULL) ? pixel_bytes : -1;
+}
+
+int start_chunk_message(chunk_protocol_t *protocol, send_slot_t *slot, const send_block_t *block, int pixel_bytes, int destination, int tag){
+	/**
+	*	Takes in a chunk_protocol_t, one of its send slots whose pixels were placed by reserve_chunk_message or put_chunk_pixels,
+	*	the header of the chunk, the size of its pixels in the message, the rank to send it to and the tag of the message.
+	*	It writes the header before the pixels and starts the persistent send of the slot, which is only created again
+	*	when the size of the message or its destination changed, so chunks of a fixed size reuse it.
+	*	A message larger than CHUNK_MESSAGE_BYTES, which the receives are posted for, is split: the persistent send carries the header alone
+	*	and the pixels follow with CHUNK_PIXELS_TAG, for finish_chunk_receive to pick them up.
+	*	It returns 0 on success and -1 on failure.
+	*/
+	
+	int count = (int)sizeof(send_block_t) + pixel_bytes;
+	int split = (count > CHUNK_MESSAGE_BYTES);
+	int check = MPI_SUCCESS;
+	memcpy(slot->buffer, block, sizeof(send_block_t));
+	
+	if(slot->request == MPI_REQUEST_NULL || slot->count != count || slot->peer != destination){
+		if(slot->request != MPI_REQUEST_NULL) MPI_Request_free(&slot->request);
+		check = MPI_Send_init(slot->buffer, split ? (int)sizeof(send_block_t) : count, MPI_BYTE, destination, tag, protocol->comm, &slot->request);
+		slot->count = count;
+		slot->peer = destination;
+	}
+	
+	if(check == MPI_SUCCESS) check = MPI_Start(&slot->request);
+	if(check == MPI_SUCCESS && split){
+		check = MPI_Isend(slot->buffer + sizeof(send_block_t), pixel_bytes, MPI_BYTE, destination, CHUNK_PIXELS_TAG, protocol->comm, &slot->pixels_request);
+	}
+	if(check != MPI_SUCCESS){
+		fprintf(stderr, "Rank %d: Error in start_chunk_message while sending a chunk\n", protocol->my_rank);
+		fflush(stderr);
+		return -1;
+	}
+	
+	return 0;
+}
+
+int read_chunk_pixels(const unsigned char *message, int count, unsigned char *data, int pixels, int width, int channels){
+	/**
+	*	Takes in a received chunk message, its size in bytes, a pixel buffer, the number of pixels of the chunk,
+	*	the width of the Image they belong to and its number of channels, and copies (or unpacks) the pixels of the message into the buffer.
+	*	It returns 0 on success and -1 on failure.
+	*/
+	
+	if(TRANSFER_COMPRESSION == 0){
+		memcpy(data, message + sizeof(send_block_t), (size_t)pixels * channels);
+		return 0;
+	}
+	
+	return unpack_pixels(message + sizeof(send_block_t), count - (int)sizeof(send_block_t), data, pixels, width, channels);
+}
+
+int restart_chunk_receive(chunk_protocol_t *protocol, int index){
+	/**
+	*	Takes in a chunk_protocol_t and the index of one of its receives, whose message was read,
+	*	and starts the receive again for a later message.
+	*	It returns 0 on success and -1 on failure.
+	*/
+	
+	int check = MPI_Start(&protocol->receives[index]);
+	if(check != MPI_SUCCESS){
+		fprintf(stderr, "Rank %d: Error in restart_chunk_receive while posting a receive\n", protocol->my_rank);
+		fflush(stderr);
+		return -1;
+	}
+	
+	protocol->receiving[index] = 1;
+	protocol->received[index] = -1;
+	return 0;
+}
+
+int finish_chunk_receive(chunk_protocol_t *protocol, int index, MPI_Status *status){
+	/**
+	*	Takes in a chunk_protocol_t, one of its receives which completed and the status of its message, and sets the size of the message.
+	*	A message which came with the header alone holds a chunk too large for the receives (see start_chunk_message): its pixels are received
+	*	right after the header, into the buffer of the receive, which is grown for them and gets its persistent receive set up again.
+	*	The pixels of the chunks sent by a process arrive in the order the chunks were sent, so the receives have to be finished in that order.
+	*	It returns 0 on success and -1 on failure.
+	*/
+	
+	MPI_Get_count(status, MPI_BYTE, &protocol->received[index]);
+	if(protocol->received[index] != (int)sizeof(send_block_t)){
+		return 0;
+	}
+	
+	MPI_Message message;
+	MPI_Status pixels_status;
+	int pixel_bytes = 0;
+	
+	int check = MPI_Mprobe(status->MPI_SOURCE, CHUNK_PIXELS_TAG, protocol->comm, &message, &pixels_status);
+	if(check == MPI_SUCCESS){
+		MPI_Get_count(&pixels_status, MPI_BYTE, &pixel_bytes);
+		
+		unsigned char *buffer = (unsigned char*)malloc(sizeof(send_block_t) + (size_t)pixel_bytes);
+		if(buffer == NULL){
+			fprintf(stderr, "Rank %d: Error in finish_chunk_receive while allocating memory\n", protocol->my_rank);
+			fflush(stderr);
+			return -1;
+		}
+		
+		// the persistent receive is bound to the old buffer
+		memcpy(buffer, protocol->receive_buffers[index], sizeof(send_block_t));
+		free(protocol->receive_buffers[index]);
+		protocol->receive_buffers[index] = buffer;
+		MPI_Request_free(&protocol->receives[index]);
+		
+		check = MPI_Mrecv(buffer + sizeof(send_block_t), pixel_bytes, MPI_BYTE, &message, MPI_STATUS_IGNORE);
+		if(check == MPI_SUCCESS) check = MPI_Recv_init(buffer, CHUNK_MESSAGE_BYTES, MPI_BYTE, status->MPI_SOURCE, status->MPI_TAG, protocol->comm, &protocol->receives[index]);
+	}
+	if(check != MPI_SUCCESS){
+		fprintf(stderr, "Rank %d: Error in finish_chunk_receive while receiving the pixels of a chunk\n", protocol->my_rank);
+		fflush(stderr);
+		return -1;
+	}
+	
+	protocol->received[index] += pixel_bytes;
+	return 0;
+}
+
+Image *read_next_chunk(FILE *image_file, tiled_image_t *tiled, int halo_dim, int chunk_size, int height, int width, int channels, int top_down, int padding, int data_start, int *offset, int *true_start, int *true_end){
+	/**
+	*	Takes in the input of master_process (an open .bmp file, or an open tiled image if tiled != NULL), the size of the halo,
+	*	the size of a chunk, the height, width, channels, top_down, padding and data_start of the Image, the offset at which to read
+	*	and places to store the first and last row of the chunk which are not halo rows.
+	*	It reads the next chunk of the Image with its halos and moves offset past it.
+	*	It returns the chunk (whose data is NULL if there are no rows left) or NULL on failure.
+	*/
+	
+	if(tiled != NULL){
+		// tiled images have neither a header before the rows nor padding, so offset counts the bytes of the rows before the chunk
+		int next_row = *offset / (width * channels);
+		Image *chunk_image = read_tiled_chunk(tiled, halo_dim, chunk_size, &next_row, true_start, true_end);
+		*offset = next_row * width * channels;
+		return chunk_image;
+	}
+	
+	return read_BMP_chunk(image_file, halo_dim, chunk_size, height, width, channels, top_down, padding, data_start, offset, true_start, true_end);
+}
+
+int send_work(int worker_process, operation_t operation, int *work_done, FILE *image_file, tiled_image_t *tiled, int halo_dim, int chunk_size, int height, int width, int channels, int top_down, int padding, int data_start, int *offset, int num_threads, chunk_protocol_t *protocol, send_slot_t *slot, int *first_row){
+	/**
+	*	Takes in the rank of the procees which needs to receive work, an operation_t,
+	*	a FILE* coresponding to the open .bmp file (or the open tiled image if tiled != NULL), the size of the halo, the size of a chunk,
+	*	the height, width, channels, top_down, data_start and padding of the Image, the offset at which to read
+	* 	the number of threads the worker process can use, the chunk_protocol_t of the run, a send slot of the worker
+	*	and a place to store the row of the edited Image where the edited chunk goes.
+	*	It reads a chunk of the Image and starts sending it, in one message with the required data, to the worker process.
+	*	The message stays in slot until the slot is used again, so the master never waits for a busy worker to receive it.
+	*	If there is no more work to be done, it sets work_done to 1 and returns without sending any work to the worker process.
+	*/
+	
+	int true_start, true_end;
+	
+	*first_row = (*offset - data_start) / (channels * width + padding);
+	
+	Image *chunk_image = read_next_chunk(image_file, tiled, halo_dim, chunk_size, height, width, channels, top_down, padding, data_start, offset, &true_start, &true_end);
+	if(chunk_image == NULL){ // error message was printed by the called function
+		return -1;
+	}
+	
+	if(chunk_image->data == NULL){ // the file is closed by master_process
+		*work_done = 1;
+		free(chunk_image);
+		return 0;
+	}
+	
+	send_block_t block;
+	block.true_start = true_start;
+	block.true_end = true_end;
+	block.height = chunk_image->height;
+	block.width = width;
+	block.channels = channels;
+	block.operation = operation;
+	block.num_threads = num_threads;
+	block.top_down = chunk_image->top_down;
+	
+	int pixel_bytes = put_chunk_pixels(protocol, slot, chunk_image->data, chunk_image->height * chunk_image->width, width, channels);
+	free(chunk_image->data);
+	free(chunk_image);
+	if(pixel_bytes == -1){ // error message was printed by the called function
+		return -1;
+	}
+	
+	return start_chunk_message(protocol, slot, &block, pixel_bytes, worker_process, WORK_DATA_SEND_TAG);
+}
+
+void close_master_input(FILE *image_file, tiled_image_t *tiled){
+	/**
+	*	Takes in the input of master_process, an open .bmp file or an open tiled image (if tiled != NULL), and closes it.
+	*/
+	
+	if(tiled != NULL) close_tiled(tiled);
+	else fclose(image_file);
+}
+
+void measure_worker_throughput(chunk_schedule_t *schedule, int worker, int rows){
+	/**
+	*	Takes in the chunk_schedule_t of master_process, the rank of a worker and the number of rows of the edited chunk it just sent back.
+	*	The worker always has a queued chunk, so the time since its previous edited chunk (or since the first chunks were sent)
+	*	is the time it took to edit this one; the throughput of the worker is the average of its last measurements.
+	*/
+	
+	double now = MPI_Wtime();
+	double since = (schedule->last_result[worker] > 0) ? schedule->last_result[worker] : schedule->start_time;
+	schedule->last_result[worker] = now;
+	
+	if(now <= since) return;
+	double measured = rows / (now - since);
+	schedule->rows_per_second[worker] = (schedule->rows_per_second[worker] > 0) ? (schedule->rows_per_second[worker] + measured) / 2 : measured;
+}
+
+int adaptive_chunk_size(chunk_schedule_t *schedule, int remaining_rows, int worker){
+	/**
+	*	Takes in the chunk_schedule_t of master_process, the number of rows of the Image which were not handed out yet and the rank of the worker
+	*	which gets the next chunk, and returns the number of rows of that chunk.
+	*	With guided scheduling, a chunk is the remaining rows divided among the queues of all the workers. With factoring, the chunks come
+	*	in batches of one chunk per worker which together hold half of the remaining rows. Either way, the chunks start large and shrink
+	*	towards the end of the Image, so the last chunks are too small to leave the other workers idle for long.
+	*	The size is then scaled by the throughput of the worker relative to the mean throughput of the workers measured so far.
+	*/
+	
+	int chunk_size;
+	
+	if(CHUNK_SCHEDULING == 1){
+		chunk_size = (remaining_rows + schedule->num_workers * MASTER_PREFETCH_DEPTH - 1) / (schedule->num_workers * MASTER_PREFETCH_DEPTH);
+	}
+	else{
+		if(schedule->batch_chunks_left == 0){
+			schedule->batch_chunks_left = schedule->num_workers;
+			schedule->batch_chunk_size = (remaining_rows + 2 * schedule->num_workers - 1) / (2 * schedule->num_workers);
+		}
+		--schedule->batch_chunks_left;
+		chunk_size = schedule->batch_chunk_size;
+	}
+	
+	double total_rate = 0;
+	int measured_workers = 0;
+	for(int i = 0; i < schedule->num_processes; ++i){
+		if(schedule->rows_per_second[i] > 0){
+			total_rate += schedule->rows_per_second[i];
+			++measured_workers;
+		}
+	}
+	
+	if(measured_workers > 0 && schedule->rows_per_second[worker] > 0){
+		chunk_size = (int)(chunk_size * schedule->rows_per_second[worker] / (total_rate / measured_workers) + 0.5);
+	}
+	
+	chunk_size = min(max(chunk_size, CHUNK_MIN_ROWS), remaining_rows);
+	
+	if(CHUNK_PRINT_SIZES && chunk_size > 0){
+		fprintf(stdout, "Chunk of %d rows (%d rows left) to worker %d\n", chunk_size, remaining_rows, worker);
+		fflush(stdout);
+	}
+	
+	return max(chunk_size, 1);
+}
+
+int edit_local_chunk(operation_t operation, int *work_done, FILE *image_file, tiled_image_t *tiled, int halo_dim, int chunk_size, int height, int width, int channels, int top_down, int padding, int data_start, int *offset, int num_threads, unsigned char *new_data, unsigned long long *rows_hash){
+	/**
+	*	Takes in the arguments of send_work (but the worker), the buffer of the edited Image and a place to add the hash of the edited rows to
+	*	(NULL if it is not needed).
+	*	It reads the next chunk of the Image and edits it on process 0, straight into its place in the edited Image.
+	*	If there is no more work to be done, it sets work_done to 1 and returns without editing anything.
+	*	It returns 0 on success and -1 on failure.
+	*/
+	
+	int true_start, true_end;
+	int first_row = (*offset - data_start) / (channels * width + padding);
+	
+	Image *chunk_image = read_next_chunk(image_file, tiled, halo_dim, chunk_size, height, width, channels, top_down, padding, data_start, offset, &true_start, &true_end);
+	if(chunk_image == NULL){ // error message was printed by the called function
+		return -1;
+	}
+	
+	if(chunk_image->data == NULL){ // the file is closed by master_process
+		*work_done = 1;
+		free(chunk_image);
+		return 0;
+	}
+	
+	Image *edited_chunk = perform_convolution_parallel(chunk_image, operation, true_start, true_end, num_threads);
+	free(chunk_image->data);
+	free(chunk_image);
+	if(edited_chunk == NULL){ // error message was printed by the called function
+		return -1;
+	}
+	
+	size_t row_size = (size_t)width * channels;
+	memcpy(new_data + first_row * row_size, edited_chunk->data, edited_chunk->height * row_size);
+	
+	if(rows_hash != NULL){
+		*rows_hash += hash_rows(edited_chunk->data, first_row, edited_chunk->height, width, channels, num_threads);
+	}
+	
+	free(edited_chunk->data);
+	free(edited_chunk);
+	return 0;
+}
+
+typedef struct{
+	int first_row; // row of the edited Image where the edited chunk goes
+	int slot; // send slot of the worker it was first sent to, which keeps its message until the worker sends it back
+	int worker; // worker it was first sent to
+	int copies; // workers it was sent to
+	int done; // 1 once one of its edited copies came back
+	double sent_time; // moment it was first sent
+}chunk_record_t; // a chunk handed out by master_process, in the order they were handed out
+
+int record_chunk(chunk_record_t **records, int *num_records, int *records_size, int first_row, int slot, int worker){
+	/**
+	*	Takes in the chunks handed out by master_process, their number, how many there is room for, the row of the edited Image
+	*	where a chunk which was just sent goes, the send slot holding its message and the worker it was sent to.
+	*	It adds the chunk after the others, with the moment it was sent, and makes room for more if needed.
+	*	It returns the index of the chunk or -1 on failure.
+	*/
+	
+	if(*num_records == *records_size){
+		int size = max(2 * *records_size, 64);
+		chunk_record_t *new_records = (chunk_record_t*)realloc(*records, size * sizeof(chunk_record_t));
+		if(new_records == NULL){
+			fprintf(stderr, "Rank 0: Error in record_chunk while allocating memory\n");
+			fflush(stderr);
+			return -1;
+		}
+		*records = new_records;
+		*records_size = size;
+	}
+	
+	chunk_record_t *record = &(*records)[*num_records];
+	record->first_row = first_row;
+	record->slot = slot;
+	record->worker = worker;
+	record->copies = 1;
+	record->done = 0;
+	record->sent_time = MPI_Wtime();
+	return (*num_records)++;
+}
+
+int oldest_straggler(const chunk_record_t *records, int num_records, int *first_candidate){
+	/**
+	*	Takes in the chunks handed out by master_process, their number and the first of them which may still need a copy
+	*	(the chunks before it are edited or copied already, so they are never looked at again).
+	*	It returns the chunk sent the longest ago among those which were not edited yet and were sent to a single worker,
+	*	or -1 if there is none.
+	*/
+	
+	int oldest = -1;
+	while(*first_candidate < num_records && (records[*first_candidate].done || records[*first_candidate].copies > 1)){
+		++*first_candidate;
+	}
+	
+	for(int i = *first_candidate; i < num_records; ++i){
+		if(!records[i].done && records[i].copies == 1 && (oldest == -1 || records[i].sent_time < records[oldest].sent_time)){
+			oldest = i;
+		}
+	}
+	return oldest;
+}
+
+int send_chunk_copy(chunk_protocol_t *protocol, const send_slot_t *original, send_slot_t *slot, int worker_process){
+	/**
+	*	Takes in the chunk_protocol_t of master_process, the send slot holding the message of a chunk which was sent to a slow worker,
+	*	a free send slot of an idle worker and the rank of the idle worker.
+	*	It copies the message (header and pixels, packed or not) into the free slot and starts sending it to the idle worker,
+	*	which edits the chunk like any other, so whichever worker finishes it first delivers it.
+	*	It returns 0 on success and -1 on failure.
+	*/
+	
+	int pixel_bytes = original->count - (int)sizeof(send_block_t);
+	unsigned char *destination = reserve_chunk_message(protocol, slot, pixel_bytes);
+	if(destination == NULL){ // error message was printed by the called function
+		return -1;
+	}
+	
+	// the message of the original stays untouched until its worker sends the chunk back, so it can be read while it is being sent
+	send_block_t block;
+	memcpy(&block, original->buffer, sizeof(send_block_t));
+	memcpy(destination, original->buffer + sizeof(send_block_t), pixel_bytes);
+	return start_chunk_message(protocol, slot, &block, pixel_bytes, worker_process, WORK_DATA_SEND_TAG);
+}
+
+int stop_workers(const chunk_protocol_t *protocol, const int *queue_length, int *stopping, int num_processes){
+	/**
+	*	Takes in the chunk_protocol_t of master_process, the number of chunks queued on every worker, the workers which were already
+	*	ordered to drop their chunks and the total number of processes.
+	*	Once an edited copy of every chunk came back, the chunks still queued on the workers are copies nobody needs: every worker
+	*	with queued chunks is sent an empty chunk message, the order to drop them (see find_stop_order), which it answers with an empty message.
+	*	It returns 0 on success and -1 on failure.
+	*/
+	
+	for(int i = 1; i < num_processes; ++i){
+		if(queue_length[i] > 0 && !stopping[i]){
+			int check = MPI_Send(NULL, 0, MPI_BYTE, i, WORK_DATA_SEND_TAG, protocol->comm);
+			if(check != MPI_SUCCESS){
+				fprintf(stderr, "Rank 0: Error in stop_workers while sending the order to drop the chunks\n");
+				fflush(stderr);
+				return -1;
+			}
+			stopping[i] = 1;
+		}
+	}
+	return 0;
+}
+
+Image *master_process(const char *in_file_name, operation_t operation, int chunk, int num_processes, MPI_Comm comm, int num_threads, unsigned long long *hash){
+	/**
+	*	Takes in a file path to the file to edit, an operation_t, the size of a chunk (ADAPTIVE_CHUNK_SIZE to size every chunk with adaptive_chunk_size),
+	*	the total number of processes, the communicator of the master and the workers, the number of threads on available to each process
+	*	and a place to store the hash of the edited Image (NULL if it is not needed).
+	*	It opens the file to edit (a .bmp file or a tiled image) and queues MASTER_PREFETCH_DEPTH chunks on each worker process,
+	*	so a worker always has its next chunk at hand when it finishes one. Whenever a worker sends back an edited chunk (they come back
+	*	in the order they were queued), it collects it and tops the queue of the worker up with another chunk,
+	*	until there are no more chunks to process. A worker is terminated once its queue is empty and there is no work left.
+	*	With HYBRID_MASTER, process 0 edits chunks too: whenever no edited chunk is waiting, it edits the next chunk itself
+	*	with num_threads threads, straight into the edited Image, so its cores are not idle while the workers compute.
+	*	Every chunk travels in a single message with its header, on the messages set up once for the run (open_chunk_protocol),
+	*	and is cut to fit in such a message (chunk_message_rows), unless a single row does not fit.
+	*	With SPECULATIVE_EXECUTION, once every chunk was handed out, a worker whose queue empties gets a copy of the oldest chunk
+	*	which is still being edited, so a worker slowed down by other load does not hold up the end of the run: the first edited copy
+	*	of a chunk is kept and the later ones are thrown away, and once every chunk came back the workers drop the copies they still hold.
+	*	It then returns the whole edited Image.
+	*	Every edited chunk is hashed as soon as it is received, while the workers are still editing theirs.
+	*/
+	
+	int kernel_size = get_kernel_size(operation);
+	int halo_dim = kernel_size / 2;
+	
+	int check = 0;
+	int active_workers = 0;
+	int height, width, channels, top_down, data_start, padding;
+	int offset;
+	unsigned long long rows_hash = 0;
+	
+	FILE *image_file = NULL;
+	tiled_image_t *tiled = NULL;
+	
+	if(is_tiled_file(in_file_name)){
+		tiled = open_tiled(in_file_name);
+		if(tiled == NULL){ // error message was printed by the called function
+			return NULL;
+		}
+		
+		height = tiled->height;
+		width = tiled->width;
+		channels = tiled->channels;
+		top_down = tiled->top_down;
+		data_start = 0;
+		padding = 0;
+	}
+	else{
+		image_file = open_BMP(in_file_name, &height, &width, &channels, &top_down, &data_start, &padding);
+		if(image_file == NULL){ // error message was printed by the called function
+			return NULL;
+		}
+	}
+	
+	offset = data_start;
+	
+	// the queue of worker i is protocol.sends[i * MASTER_PREFETCH_DEPTH] to protocol.sends[(i + 1) * MASTER_PREFETCH_DEPTH - 1], used as a ring
+	unsigned char *new_data = (unsigned char*)malloc((size_t)width * height * channels);
+	Image *new_image = (Image*)malloc(sizeof(Image));
+	int *slot_chunks = (int*)calloc((size_t)num_processes * MASTER_PREFETCH_DEPTH, sizeof(int)); // chunk (in records) whose message is in each send slot
+	int *queue_head = (int*)calloc(num_processes, sizeof(int));
+	int *queue_length = (int*)calloc(num_processes, sizeof(int));
+	int *stopping = (int*)calloc(num_processes, sizeof(int)); // 1 once the worker was ordered to drop its chunks, until it answers
+	chunk_schedule_t schedule = {num_processes - 1 + HYBRID_MASTER, num_processes, 0, 0, MPI_Wtime(), NULL, NULL};
+	schedule.rows_per_second = (double*)calloc(num_processes, sizeof(double));
+	schedule.last_result = (double*)calloc(num_processes, sizeof(double));
+	if(new_data == NULL || new_image == NULL || slot_chunks == NULL || queue_head == NULL || queue_length == NULL || stopping == NULL || schedule.rows_per_second == NULL || schedule.last_result == NULL){
+		fprintf(stderr, "Rank 0: Error in master_process while allocating memory\n");
+		fflush(stderr);
+		free(new_data);
+		free(new_image);
+		free(slot_chunks);
+		free(queue_head);
+		free(queue_length);
+		free(stopping);
+		free(schedule.rows_per_second);
+		free(schedule.last_result);
+		close_master_input(image_file, tiled);
+		return NULL;
+	}
+	
+	chunk_protocol_t protocol;
+	check = open_chunk_protocol(&protocol, comm);
+	
+	// a chunk sent to a worker has to fit in a message
+	int max_rows = chunk_message_rows(width, channels, halo_dim);
+	
+	chunk_record_t *records = NULL;
+	int num_records = 0, records_size = 0, done_records = 0, first_candidate = 0;
+	int copies_sent = 0, copies_won = 0;
+	double tail_start = 0, tail_end = 0;
+	
+	// distributing initial work to all the processes, one chunk to each before the second one to any
+	int work_done = 0;
+	for(int depth = 0; depth < MASTER_PREFETCH_DEPTH && work_done == 0 && check == 0; ++depth){
+		for(int i = 1; i < num_processes && work_done == 0 && check == 0; ++i){
+			int index = i * MASTER_PREFETCH_DEPTH + depth;
+			int first_row;
+			int chunk_size = (chunk > 0) ? chunk : adaptive_chunk_size(&schedule, height - (offset - data_start) / (channels * width + padding), i);
+			check = send_work(i, operation, &work_done, image_file, tiled, halo_dim, min(chunk_size, max_rows), height, width, channels, top_down, padding, data_start, &offset, num_threads, &protocol, &protocol.sends[index], &first_row);
+			if(check == 0 && work_done == 0){
+				slot_chunks[index] = record_chunk(&records, &num_records, &records_size, first_row, index, i);
+				check = (slot_chunks[index] == -1) ? -1 : 0;
+				if(queue_length[i] == 0) ++active_workers;
+				++queue_length[i];
+			}
+		}
+	}
+	
+	for(int i = 1; i < num_processes && check == 0; ++i){
+		if(queue_length[i] == 0){
+			check = MPI_Send(NULL, 0, MPI_BYTE, i, TERMINATE_TAG, comm);
+			if(check != MPI_SUCCESS){
+				fprintf(stderr, "Rank 0: Error in master_process while sending terminate order\n");
+				fflush(stderr);
+				check = -1;
+			}
+		}
+	}
+	
+	while((active_workers != 0 || (HYBRID_MASTER && work_done == 0)) && check == 0){
+		int worker_rank, index, completed = 1;
+		send_block_t header;
+		MPI_Status status;
+		
+		if(work_done && tail_start == 0) tail_start = MPI_Wtime();
+		
+		// between dispatches, process 0 edits a chunk itself whenever no edited chunk is waiting
+		if(HYBRID_MASTER && work_done == 0){
+			check = MPI_Testany(protocol.num_receives, protocol.receives, &index, &completed, &status);
+			if(check != MPI_SUCCESS){
+				fprintf(stderr, "Rank 0: Error in master_process while testing for edited chunks\n");
+				fflush(stderr);
+				check = -1;
+				break;
+			}
+			
+			if(!completed || index == MPI_UNDEFINED){
+				int chunk_size = (chunk > 0) ? chunk : adaptive_chunk_size(&schedule, height - (offset - data_start) / (channels * width + padding), 0);
+				int rows_before = (offset - data_start) / (channels * width + padding);
+				schedule.last_result[0] = MPI_Wtime();
+				
+				check = edit_local_chunk(operation, &work_done, image_file, tiled, halo_dim, chunk_size, height, width, channels, top_down, padding, data_start, &offset, num_threads, new_data, (hash != NULL) ? &rows_hash : NULL);
+				if(check != 0){ // error message was printed by the called function
+					break;
+				}
+				
+				if(chunk <= 0 && work_done == 0){
+					measure_worker_throughput(&schedule, 0, (offset - data_start) / (channels * width + padding) - rows_before);
+				}
+				
+				continue;
+			}
+		}
+		else{
+			check = MPI_Waitany(protocol.num_receives, protocol.receives, &index, &status);
+			if(check != MPI_SUCCESS){
+				fprintf(stderr, "Rank 0: Error in master_process while receiving work\n");
+				fflush(stderr);
+				check = -1;
+				break;
+			}
+		}
+		protocol.receiving[index] = 0;
+		check = finish_chunk_receive(&protocol, index, &status);
+		if(check != 0){ // error message was printed by the called function
+			break;
+		}
+		worker_rank = status.MPI_SOURCE;
+		
+		// an empty message answers the order to drop the chunks: the worker has nothing queued any more
+		if(protocol.received[index] == 0){
+			check = restart_chunk_receive(&protocol, index);
+			if(check != 0){ // error message was printed by the called function
+				break;
+			}
+			queue_length[worker_rank] = 0;
+			stopping[worker_rank] = 0;
+		}
+		else{
+			int slot_index = worker_rank * MASTER_PREFETCH_DEPTH + queue_head[worker_rank];
+			chunk_record_t *record = &records[slot_chunks[slot_index]];
+			int data_offset = record->first_row;
+			memcpy(&header, protocol.receive_buffers[index], sizeof(send_block_t));
+			
+			// a chunk edited by two workers is only kept the first time it comes back
+			if(!record->done){
+				check = read_chunk_pixels(protocol.receive_buffers[index], protocol.received[index], new_data + (size_t)data_offset * width * channels, header.height * width, width, channels);
+			}
+			if(check == 0) check = restart_chunk_receive(&protocol, index);
+			if(check != 0){
+				fprintf(stderr, "Rank 0: Error in master_process while receiving work data\n");
+				fflush(stderr);
+				break;
+			}
+			
+			if(!record->done){
+				if(hash != NULL){
+					rows_hash += hash_rows(new_data + (size_t)data_offset * width * channels, data_offset, header.height, width, channels, num_threads);
+				}
+				record->done = 1;
+				++done_records;
+				if(worker_rank != record->worker) ++copies_won;
+				if(work_done && done_records == num_records) tail_end = MPI_Wtime();
+			}
+			
+			if(chunk <= 0){
+				measure_worker_throughput(&schedule, worker_rank, header.height);
+			}
+			
+			// the worker received the chunk of this slot long ago, so it is free for the next one
+			queue_head[worker_rank] = (queue_head[worker_rank] + 1) % MASTER_PREFETCH_DEPTH;
+			--queue_length[worker_rank];
+			
+			if(work_done == 0){
+				int first_row;
+				slot_index = worker_rank * MASTER_PREFETCH_DEPTH + (queue_head[worker_rank] + queue_length[worker_rank]) % MASTER_PREFETCH_DEPTH;
+				int chunk_size = (chunk > 0) ? chunk : adaptive_chunk_size(&schedule, height - (offset - data_start) / (channels * width + padding), worker_rank);
+				check = send_work(worker_rank, operation, &work_done, image_file, tiled, halo_dim, min(chunk_size, max_rows), height, width, channels, top_down, padding, data_start, &offset, num_threads, &protocol, &protocol.sends[slot_index], &first_row);
+				if(check == 0 && work_done == 0){
+					slot_chunks[slot_index] = record_chunk(&records, &num_records, &records_size, first_row, slot_index, worker_rank);
+					check = (slot_chunks[slot_index] == -1) ? -1 : 0;
+					++queue_length[worker_rank];
+				}
+				if(check != 0){ // error message was printed by the called function
+					break;
+				}
+			}
+		}
+		
+		// once every chunk was handed out, an idle worker gets a copy of the oldest chunk still being edited instead of being terminated
+		if(SPECULATIVE_EXECUTION && work_done && queue_length[worker_rank] == 0 && !stopping[worker_rank]){
+			int straggler = oldest_straggler(records, num_records, &first_candidate);
+			if(straggler != -1){
+				int slot_index = worker_rank * MASTER_PREFETCH_DEPTH + queue_head[worker_rank];
+				check = send_chunk_copy(&protocol, &protocol.sends[records[straggler].slot], &protocol.sends[slot_index], worker_rank);
+				if(check != 0){ // error message was printed by the called function
+					break;
+				}
+				slot_chunks[slot_index] = straggler;
+				++records[straggler].copies;
+				++queue_length[worker_rank];
+				++copies_sent;
+			}
+		}
+		
+		// a worker ordered to drop its chunks is only terminated once it answered, so its answer is not left behind
+		if(queue_length[worker_rank] == 0 && !stopping[worker_rank]){ // remove and terminate the current worker
+			--active_workers;
+			
+			check = MPI_Send(NULL, 0, MPI_BYTE, worker_rank, TERMINATE_TAG, comm);
+			if(check != MPI_SUCCESS){
+				fprintf(stderr, "Rank 0: Error in master_process while sending terminate order\n");
+				fflush(stderr);
+				check = -1;
+				break;
+			}
+		}
+		
+		if(SPECULATIVE_EXECUTION && work_done && done_records == num_records){
+			check = stop_workers(&protocol, queue_length, stopping, num_processes);
+		}
+	}
+	
+	if(SPECULATIVE_PRINT_TAIL && check == 0){
+		fprintf(stdout, "Tail: %f s from the last chunk handed out to the last chunk edited, %d copies of slow chunks handed out, %d of them came back first\n",
+			(tail_start > 0 && tail_end > tail_start) ? tail_end - tail_start : 0, copies_sent, copies_won);
+		fflush(stdout);
+	}
+	
+	close_chunk_protocol(&protocol);
+	free(records);
+	free(slot_chunks);
+	free(queue_head);
+	free(queue_length);
+	free(stopping);
+	free(schedule.rows_per_second);
+	free(schedule.last_result);
+	close_master_input(image_file, tiled);
+	
+	if(check != 0){ // error message was printed by the called function
+		free(new_data);
+		free(new_image);
+		return NULL;
+	}
+	
+	if(hash != NULL){
+		*hash = finish_image_hash(rows_hash, height, width, channels);
+	}
+	
+	new_image->height = height;
+	new_image->width = width;
+	new_image->channels = channels;
+	new_image->top_down = top_down;
+	new_image->data = new_data;
+	return new_image;
+}
+
+int send_region(int worker_process, operation_t operation, const Image *img, region_t region, int num_threads, chunk_protocol_t *protocol){
+	/**
+	*	Takes in the rank of the process which needs to receive work, an operation_t, the new input, a region of it to edit,
+	*	the number of threads the worker process can use and the chunk_protocol_t of the master and the workers.
+	*	It crops the region with its halo and sends it to the worker process, which edits it like any other chunk.
+	*	It returns 0 on success and -1 on failure.
+	*/
+	
+	int true_start, true_end, column_start;
+	Image *cropped_img = crop_region(img, region, get_kernel_size(operation) / 2, &true_start, &true_end, &column_start);
+	if(cropped_img == NULL){ // error message was printed by the called function
+		return -1;
+	}
+	
+	send_block_t block;
+	block.true_start = true_start;
+	block.true_end = true_end;
+	block.height = cropped_img->height;
+	block.width = cropped_img->width;
+	block.channels = cropped_img->channels;
+	block.operation = operation;
+	block.num_threads = num_threads;
+	block.top_down = cropped_img->top_down;
+	
+	// a worker edits one region at a time, so only the first slot of its queue is used
+	send_slot_t *slot = &protocol->sends[worker_process * MASTER_PREFETCH_DEPTH];
+	int pixel_bytes = put_chunk_pixels(protocol, slot, cropped_img->data, cropped_img->height * cropped_img->width, cropped_img->width, cropped_img->channels);
+	free(cropped_img->data);
+	free(cropped_img);
+	if(pixel_bytes == -1){ // error message was printed by the called function
+		return -1;
+	}
+	
+	return start_chunk_message(protocol, slot, &block, pixel_bytes, worker_process, WORK_DATA_SEND_TAG);
+}
+
+int dispatch_regions(Image *output, const Image *img, region_t *regions, int num_regions, operation_t operation, chunk_protocol_t *protocol, int num_threads, int terminate){
+	/**
+	*	Takes in the edited Image to update, the new input, the regions to edit again (each at most a chunk high), an operation_t,
+	*	the chunk_protocol_t of the master and the workers (opened by the caller, so it can be used for several calls),
+	*	the number of threads of a worker and 1 to terminate the workers at the end (0 keeps them waiting for more work).
+	*	It hands the regions out to the workers like master_process hands out chunks: a worker which returns an edited region
+	*	gets the next one, and the edited regions are patched into output as they arrive.
+	*	It returns 0 on success and -1 on failure.
+	*/
+	
+	int check = 0;
+	int num_processes;
+	int next_region = 0, active_workers = 0;
+	MPI_Comm_size(protocol->comm, &num_processes);
+	int region_of[num_processes]; // region each worker is editing
+	
+	for(int i = 1; i < num_processes; ++i){
+		if(next_region < num_regions){
+			region_of[i] = next_region;
+			check = send_region(i, operation, img, regions[next_region++], num_threads, protocol);
+			++active_workers;
+		}
+		else if(terminate){
+			check = MPI_Send(NULL, 0, MPI_BYTE, i, TERMINATE_TAG, protocol->comm);
+		}
+		
+		if(check != 0){
+			fprintf(stderr, "Rank 0: Error in dispatch_regions while distributing the initial work\n");
+			fflush(stderr);
+			return -1;
+		}
+	}
+	
+	while(active_workers != 0){
+		send_block_t header;
+		MPI_Status status;
+		int index;
+		
+		check = MPI_Waitany(protocol->num_receives, protocol->receives, &index, &status);
+		if(check != MPI_SUCCESS){
+			fprintf(stderr, "Rank 0: Error in dispatch_regions while receiving work\n");
+			fflush(stderr);
+			return -1;
+		}
+		protocol->receiving[index] = 0;
+		check = finish_chunk_receive(protocol, index, &status);
+		if(check != 0){ // error message was printed by the called function
+			return -1;
+		}
+		
+		int worker_rank = status.MPI_SOURCE;
+		region_t region = regions[region_of[worker_rank]];
+		memcpy(&header, protocol->receive_buffers[index], sizeof(send_block_t));
+		Image edited_region = {header.width, header.height, header.channels, img->top_down, NULL};
+		edited_region.data = (unsigned char*)malloc((size_t)header.height * header.width * header.channels);
+		if(edited_region.data == NULL){
+			fprintf(stderr, "Rank 0: Error in dispatch_regions while allocating memory\n");
+			fflush(stderr);
+			return -1;
+		}
+		
+		check = read_chunk_pixels(protocol->receive_buffers[index], protocol->received[index], edited_region.data, header.height * header.width, header.width, header.channels);
+		if(check == 0) check = restart_chunk_receive(protocol, index);
+		if(check != 0){
+			fprintf(stderr, "Rank 0: Error in dispatch_regions while receiving work data\n");
+			fflush(stderr);
+			free(edited_region.data);
+			return -1;
+		}
+		
+		// the worker edited the region with the columns of its halo
+		patch_region(output, &edited_region, region, region.x - max(region.x - get_kernel_size(operation) / 2, 0));
+		free(edited_region.data);
+		
+		if(next_region < num_regions){
+			region_of[worker_rank] = next_region;
+			check = send_region(worker_rank, operation, img, regions[next_region++], num_threads, protocol);
+		}
+		else{
+			--active_workers;
+			if(terminate) check = MPI_Send(NULL, 0, MPI_BYTE, worker_rank, TERMINATE_TAG, protocol->comm);
+		}
+		
+		if(check != 0){
+			fprintf(stderr, "Rank 0: Error in dispatch_regions while sending work\n");
+			fflush(stderr);
+			return -1;
+		}
+	}
+	
+	return 0;
+}
+
+Image *split_super_chunk(const Image *super_chunk, operation_t operation, int true_start, int true_end, int num_threads, chunk_protocol_t *local){
+	/**
+	*	Takes in a super-chunk received by a sub-master from process 0, an operation_t, its first and last rows which are not halo rows,
+	*	the number of threads of a process and the chunk_protocol_t of the sub-master and the workers of its node.
+	*	It cuts the rows of the super-chunk into HIERARCHY_CHUNKS_PER_WORKER chunks per local worker and hands them out with dispatch_regions,
+	*	which keeps the workers waiting for the chunks of the next super-chunk. A sub-master alone on its node edits the super-chunk itself.
+	*	It returns the edited rows of the super-chunk, like perform_convolution_parallel, or NULL on failure.
+	*/
+	
+	int local_size;
+	MPI_Comm_size(local->comm, &local_size);
+	if(local_size == 1){
+		return perform_convolution_parallel(super_chunk, operation, true_start, true_end, num_threads);
+	}
+	
+	int rows = true_end - true_start + 1;
+	size_t row_size = (size_t)super_chunk->width * super_chunk->channels;
+	int num_chunks = min(rows, (local_size - 1) * HIERARCHY_CHUNKS_PER_WORKER);
+	region_t *regions = (region_t*)malloc(num_chunks * sizeof(region_t));
+	Image *edited_chunk = (Image*)malloc(sizeof(Image));
+	unsigned char *edited_data = (unsigned char*)malloc(super_chunk->height * row_size);
+	if(regions == NULL || edited_chunk == NULL || edited_data == NULL){
+		fprintf(stderr, "Error in split_super_chunk while allocating memory\n");
+		fflush(stderr);
+		free(regions);
+		free(edited_chunk);
+		free(edited_data);
+		return NULL;
+	}
+	
+	// the chunks span the whole width, so they only have halo rows, which the super-chunk holds
+	for(int k = 0; k < num_chunks; ++k){
+		int start, count;
+		block_extent(rows, num_chunks, k, &start, &count);
+		regions[k].x = 0;
+		regions[k].y = true_start + start;
+		regions[k].width = super_chunk->width;
+		regions[k].height = count;
+	}
+	
+	Image output = {super_chunk->width, super_chunk->height, super_chunk->channels, super_chunk->top_down, edited_data};
+	int check = dispatch_regions(&output, super_chunk, regions, num_chunks, operation, local, num_threads, 0);
+	free(regions);
+	if(check != 0){ // error message was printed by the called function
+		free(edited_chunk);
+		free(edited_data);
+		return NULL;
+	}
+	
+	memmove(edited_data, edited_data + true_start * row_size, rows * row_size);
+	edited_chunk->width = super_chunk->width;
+	edited_chunk->height = rows;
+	edited_chunk->channels = super_chunk->channels;
+	edited_chunk->top_down = super_chunk->top_down;
+	edited_chunk->data = edited_data;
+	return edited_chunk;
+}
+
+int find_stop_order(chunk_protocol_t *protocol, int current){
+	/**
+	*	Takes in the chunk_protocol_t of a worker and the receive of the chunk it is editing.
+	*	Once an edited copy of every chunk came back, process 0 orders the workers which still hold chunks to drop them
+	*	with an empty chunk message (see stop_workers). It tests the receives of the worker, in the order of its queue, for that order,
+	*	up to the first one which did not complete (they are finished in the order the chunks were sent, see finish_chunk_receive);
+	*	the chunks which arrive meanwhile are kept for later.
+	*	It returns the receive holding the order, -1 if it did not arrive and -2 on failure.
+	*/
+	
+	for(int k = 0; k < protocol->num_receives; ++k){
+		int index = (current + k) % protocol->num_receives;
+		
+		if(protocol->receiving[index]){
+			MPI_Status status;
+			int arrived;
+			
+			int check = MPI_Test(&protocol->receives[index], &arrived, &status);
+			if(check != MPI_SUCCESS){
+				fprintf(stderr, "Rank %d: Error in find_stop_order while testing for chunks\n", protocol->my_rank);
+				fflush(stderr);
+				return -2;
+			}
+			if(!arrived) break;
+			
+			protocol->receiving[index] = 0;
+			if(finish_chunk_receive(protocol, index, &status) != 0){ // error message was printed by the called function
+				return -2;
+			}
+		}
+		
+		if(protocol->received[index] == 0) return index;
+	}
+	
+	return -1;
+}
+
+int drop_queued_chunks(chunk_protocol_t *protocol, int current, int stop){
+	/**
+	*	Takes in the chunk_protocol_t of a worker, the receive of its current chunk and the receive holding the order to drop its chunks.
+	*	The receives are matched in the order they were started, so every receive from the current one to the order holds a chunk sent
+	*	before the order: it waits for these chunks and starts their receives again without editing them, in the same order.
+	*	It returns the receive of the next chunk or -1 on failure.
+	*/
+	
+	for(int index = current; ; index = (index + 1) % protocol->num_receives){
+		if(protocol->receiving[index]){
+			MPI_Status status;
+			int check = MPI_Wait(&protocol->receives[index], &status);
+			if(check != MPI_SUCCESS){
+				fprintf(stderr, "Rank %d: Error in drop_queued_chunks while receiving a chunk\n", protocol->my_rank);
+				fflush(stderr);
+				return -1;
+			}
+			
+			// the pixels of a split chunk have to be taken too
+			protocol->receiving[index] = 0;
+			if(finish_chunk_receive(protocol, index, &status) != 0){ // error message was printed by the called function
+				return -1;
+			}
+		}
+		
+		if(restart_chunk_receive(protocol, index) != 0){ // error message was printed by the called function
+			return -1;
+		}
+		if(index == stop) break;
+	}
+	
+	return (stop + 1) % protocol->num_receives;
+}
+
+int edit_chunk_in_bands(chunk_protocol_t *protocol, int current, const Image *img, const send_block_t *header, unsigned char *edited_data, int *stop){
+	/**
+	*	Takes in the chunk_protocol_t of a worker, the receive of the chunk it edits, the chunk, its header, a buffer for its edited rows
+	*	and a place to store the receive of the order to drop the chunks (-1 if it did not arrive).
+	*	With SPECULATIVE_EXECUTION, the chunk is edited SPECULATIVE_CHECK_ROWS rows at a time and the worker looks for the order
+	*	between two bands, so a copy of a chunk which came back from another worker is abandoned rather than edited to the end.
+	*	It returns 0 on success and -1 on failure.
+	*/
+	
+	int band_rows = SPECULATIVE_EXECUTION ? SPECULATIVE_CHECK_ROWS : header->true_end - header->true_start + 1;
+	size_t row_size = (size_t)header->width * header->channels;
+	*stop = -1;
+	
+	for(int row = header->true_start; row <= header->true_end && *stop == -1; row += band_rows){
+		int check = perform_convolution_into(img, header->operation, row, min(row + band_rows - 1, header->true_end), header->num_threads, edited_data + (row - header->true_start) * row_size);
+		if(check != 0){ // error message was printed by the called function
+			return -1;
+		}
+		
+		if(SPECULATIVE_EXECUTION){
+			*stop = find_stop_order(protocol, current);
+			if(*stop == -2){ // error message was printed by the called function
+				return -1;
+			}
+		}
+	}
+	
+	return 0;
+}
+
+int worker_process(int my_rank, MPI_Comm comm, MPI_Comm local){
+	/**
+	*	Takes in this process's rank, the communicator of the master and the workers and, on a sub-master,
+	*	the communicator of the sub-master and the workers of its node (MPI_COMM_NULL otherwise).
+	*	It receives chunks of an Image from process 0, which it edits (or splits among the workers of its node with split_super_chunk)
+	*	and sends back to process 0, in order.
+	*	Its messages are set up once (open_chunk_protocol): the receives of MASTER_PREFETCH_DEPTH chunks stay posted, so the next chunks
+	*	arrive while the current one is being edited, and a chunk is edited straight into the message which sends it back,
+	*	while the previous edited chunk is still being sent. When process 0 orders it to drop its chunks (SPECULATIVE_EXECUTION),
+	*	it abandons the current chunk and skips the queued ones. It stops when process 0 terminates it.
+	*/
+	
+	chunk_protocol_t protocol, local_protocol;
+	MPI_Request terminate_request = MPI_REQUEST_NULL;
+	int next = 0, next_send = 0;
+	int working = 1;
+	
+	int check = open_chunk_protocol(&protocol, comm);
+	if(check != 0){ // error message was printed by the called function
+		return -1;
+	}
+	
+	if(local != MPI_COMM_NULL){
+		check = open_chunk_protocol(&local_protocol, local);
+		if(check != 0){ // error message was printed by the called function
+			close_chunk_protocol(&protocol);
+			return -1;
+		}
+	}
+	
+	check = MPI_Irecv(NULL, 0, MPI_BYTE, 0, TERMINATE_TAG, comm, &terminate_request);
+	if(check != MPI_SUCCESS){
+		fprintf(stderr, "Rank %d: Error in worker_process while posting receives\n", my_rank);
+		fflush(stderr);
+		working = -1;
+	}
+	
+	while(working == 1){
+		// the next chunk may have arrived while the previous one was edited
+		if(protocol.receiving[next]){
+			// process 0 only terminates a worker which has no queued chunk
+			MPI_Request requests[2] = {protocol.receives[next], terminate_request};
+			MPI_Status status;
+			int completed;
+			
+			check = MPI_Waitany(2, requests, &completed, &status);
+			terminate_request = requests[1]; // a persistent request keeps its handle
+			if(check != MPI_SUCCESS){
+				fprintf(stderr, "Rank %d: Error in worker_process while waiting for work\n", my_rank);
+				fflush(stderr);
+				break;
+			}
+			
+			if(completed == 1){
+				working = 0;
+				break;
+			}
+			protocol.receiving[next] = 0;
+			check = finish_chunk_receive(&protocol, next, &status);
+			if(check != 0){ // error message was printed by the called function
+				break;
+			}
+		}
+		
+		send_block_t header;
+		send_slot_t *slot = &protocol.sends[next_send];
+		int stop = (protocol.received[next] == 0) ? next : -1; // the order to drop the chunks, when no chunk came before it
+		int rows = 0, pixel_bytes = 0;
+		
+		if(stop == -1){
+			memcpy(&header, protocol.receive_buffers[next], sizeof(send_block_t));
+			int pixels = header.height * header.width;
+			unsigned char *data = protocol.receive_buffers[next] + sizeof(send_block_t);
+			
+			if(TRANSFER_COMPRESSION != 0){
+				data = (unsigned char*)malloc((size_t)pixels * header.channels);
+				check = (data == NULL) ? -1 : read_chunk_pixels(protocol.receive_buffers[next], protocol.received[next], data, pixels, header.width, header.channels);
+				if(check != 0){
+					fprintf(stderr, "Rank %d: Error in worker_process while receiving work data\n", my_rank);
+					fflush(stderr);
+					free(data);
+					break;
+				}
+			}
+			
+			Image img = {header.width, header.height, header.channels, header.top_down, data};
+			rows = header.true_end - header.true_start + 1;
+			
+			if(local == MPI_COMM_NULL && TRANSFER_COMPRESSION == 0){
+				unsigned char *edited_data = reserve_chunk_message(&protocol, slot, rows * header.width * header.channels);
+				check = (edited_data == NULL) ? -1 : edit_chunk_in_bands(&protocol, next, &img, &header, edited_data, &stop);
+				pixel_bytes = rows * header.width * header.channels;
+			}
+			else{
+				Image *new_image = (local == MPI_COMM_NULL) ? perform_convolution_parallel(&img, header.operation, header.true_start, header.true_end, header.num_threads)
+					: split_super_chunk(&img, header.operation, header.true_start, header.true_end, header.num_threads, &local_protocol);
+				check = -1;
+				if(new_image != NULL){
+					pixel_bytes = put_chunk_pixels(&protocol, slot, new_image->data, new_image->height * new_image->width, new_image->width, new_image->channels);
+					check = (pixel_bytes == -1) ? -1 : 0;
+					free(new_image->data);
+					free(new_image);
+				}
+				if(check == 0 && SPECULATIVE_EXECUTION){
+					stop = find_stop_order(&protocol, next);
+					check = (stop == -2) ? -1 : 0;
+				}
+			}
+			if(TRANSFER_COMPRESSION != 0) free(data);
+			if(check != 0){ // error message was printed by the called function
+				break;
+			}
+		}
+		
+		if(stop != -1){
+			// process 0 has every edited chunk, so the current chunk is not sent back and the queued ones are dropped
+			next = drop_queued_chunks(&protocol, next, stop);
+			check = (next == -1) ? -1 : MPI_Send(NULL, 0, MPI_BYTE, 0, WORK_DATA_RECEIVE_TAG, comm);
+			if(check != MPI_SUCCESS){
+				fprintf(stderr, "Rank %d: Error in worker_process while dropping the queued chunks\n", my_rank);
+				fflush(stderr);
+				break;
+			}
+			continue;
+		}
+		
+		// the message was read, so its receive waits for a later chunk
+		check = restart_chunk_receive(&protocol, next);
+		if(check != 0){ // error message was printed by the called function
+			break;
+		}
+		next = (next + 1) % protocol.num_receives;
+		
+		header.true_start = 0;
+		header.true_end = rows - 1;
+		header.height = rows;
+		
+		check = start_chunk_message(&protocol, slot, &header, pixel_bytes, 0, WORK_DATA_RECEIVE_TAG);
+		if(check != 0){ // error message was printed by the called function
+			break;
+		}
+		next_send = (next_send + 1) % protocol.num_sends;
+	}
+	
+	if(terminate_request != MPI_REQUEST_NULL){
+		MPI_Cancel(&terminate_request);
+		MPI_Wait(&terminate_request, MPI_STATUS_IGNORE);
+	}
+	
+	// the receives of the chunks which will never come are cancelled
+	close_chunk_protocol(&protocol);
+	if(local != MPI_COMM_NULL) close_chunk_protocol(&local_protocol);
+	
+	return (working == 0) ? 0 : -1;
+}
+
+int split_master_hierarchy(MPI_Comm comm, int my_rank, MPI_Comm *leaders, MPI_Comm *local){
+	/**
+	*	Takes in the communicator of the processes editing the Image, this process's rank
+	*	and places to store the communicator of the masters and the communicator of the node of this process.
+	*	The processes are grouped by node (split_node), without process 0,
+	*	and the first process of every node becomes its sub-master. leaders holds process 0 (rank 0) and the sub-masters,
+	*	local holds a node (its sub-master is rank 0) and is MPI_COMM_NULL on process 0.
+	*	With a single node, there is nothing to gain from a hierarchy: leaders is comm and local is MPI_COMM_NULL.
+	*	It returns 0 on success and -1 on failure.
+	*/
+	
+	MPI_Comm node;
+	int node_rank, num_nodes, check;
+	*leaders = comm;
+	*local = MPI_COMM_NULL;
+	
+	check = split_node(comm, my_rank, &node);
+	if(check == MPI_SUCCESS){
+		MPI_Comm_rank(node, &node_rank);
+		int first_of_node = (node_rank == 0);
+		check = MPI_Allreduce(&first_of_node, &num_nodes, 1, MPI_INT, MPI_SUM, comm);
+	}
+	if(check != MPI_SUCCESS){
+		fprintf(stderr, "Rank %d: Error in split_master_hierarchy while grouping the processes by node\n", my_rank);
+		fflush(stderr);
+		return -1;
+	}
+	
+	if(num_nodes == 1){
+		MPI_Comm_free(&node);
+		return 0;
+	}
+	
+	// process 0 only schedules, so the node of process 0 gets its own sub-master
+	check = MPI_Comm_split(node, (my_rank == 0) ? MPI_UNDEFINED : 0, my_rank, local);
+	MPI_Comm_free(&node);
+	
+	int local_rank = 0;
+	if(check == MPI_SUCCESS && *local != MPI_COMM_NULL) MPI_Comm_rank(*local, &local_rank);
+	if(check == MPI_SUCCESS) check = MPI_Comm_split(comm, (local_rank == 0) ? 0 : MPI_UNDEFINED, my_rank, leaders);
+	if(check != MPI_SUCCESS){
+		fprintf(stderr, "Rank %d: Error in split_master_hierarchy while creating the communicators of the hierarchy\n", my_rank);
+		fflush(stderr);
+		return -1;
+	}
+	
+	return 0;
+}
\ No newline at end of file
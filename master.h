@@ -0,0 +1,57 @@
+#ifndef MASTER
+
+#define MASTER
+
+#include "bmp_common.h"
+#include "convolution.h"
+#include "incremental.h"
+
+#define WORK_HEADER_SEND_TAG 1
+#define WORK_DATA_SEND_TAG 2
+#define WORK_HEADER_RECEIVE_TAG 3
+#define WORK_DATA_RECEIVE_TAG 4
+#define TERMINATE_TAG 5
+
+#define MASTER_PREFETCH_DEPTH 2 // chunks queued on every worker at once in the Master/Worker version (1 = one chunk at a time)
+
+typedef struct{
+	unsigned char *buffer; // a send_block_t followed by the pixels of a chunk (packed by pack_pixels with TRANSFER_COMPRESSION)
+	int size; // bytes allocated for buffer
+	int count; // bytes of the message (header and pixels) the persistent send was created for
+	int peer; // rank the persistent send was created for
+	MPI_Request request; // persistent send on buffer, MPI_REQUEST_NULL until the first message
+	MPI_Request pixels_request; // send of the pixels of a message larger than CHUNK_MESSAGE_BYTES, MPI_REQUEST_NULL otherwise
+}send_slot_t;
+
+typedef struct{
+	MPI_Comm comm;
+	int my_rank;
+	int num_sends, num_receives;
+	send_slot_t *sends; // on process 0, the queue of worker i is sends[i * MASTER_PREFETCH_DEPTH] to sends[(i + 1) * MASTER_PREFETCH_DEPTH - 1]
+	unsigned char **receive_buffers; // CHUNK_MESSAGE_BYTES each, grown by finish_chunk_receive for the chunks which do not fit
+	MPI_Request *receives; // persistent receives on receive_buffers, on process 0 receives[i] is from worker i + 1
+	int *receiving; // 1 while the receive is started
+	int *received; // bytes of the message of a completed receive which was not read yet, -1 otherwise
+}chunk_protocol_t; // the messages of a run of the Master/Worker version, set up once by open_chunk_protocol
+
+typedef struct{
+	int num_workers; // processes editing chunks, process 0 included with HYBRID_MASTER
+	int num_processes;
+	int batch_chunks_left; // chunks left in the current factoring batch
+	int batch_chunk_size; // size of the chunks of the current factoring batch, before the throughput of the worker is accounted for
+	double start_time; // moment the first chunks were sent
+	double *rows_per_second; // throughput measured for every worker, 0 until its first edited chunk came back
+	double *last_result; // moment the last edited chunk of every worker came back
+}chunk_schedule_t; // state of the adaptive chunk sizing of master_process
+
+void close_chunk_protocol(chunk_protocol_t *protocol);
+int open_chunk_protocol(chunk_protocol_t *protocol, MPI_Comm comm);
+int chunk_message_rows(int width, int channels, int halo_dim);
+void measure_worker_throughput(chunk_schedule_t *schedule, int worker, int rows);
+int adaptive_chunk_size(chunk_schedule_t *schedule, int remaining_rows, int worker);
+Image *master_process(const char *in_file_name, operation_t operation, int chunk, int num_processes, MPI_Comm comm, int num_threads, unsigned long long *hash);
+int dispatch_regions(Image *output, const Image *img, region_t *regions, int num_regions, operation_t operation, chunk_protocol_t *protocol, int num_threads, int terminate);
+int worker_process(int my_rank, MPI_Comm comm, MPI_Comm local);
+int split_master_hierarchy(MPI_Comm comm, int my_rank, MPI_Comm *leaders, MPI_Comm *local);
+
+#endif
\ No newline at end of file
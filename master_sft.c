@@ -0,0 +1,496 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "master_sft.h"
+#include "bmp.h"
+#include "convolution.h"
+#include "tiled.h"
+#include "verification.h"
+#include "image_processing.h"
+#include "master.h"
+
+typedef struct{
+	send_block_t block; // rows [true_start, true_end] of the Image, in file order
+	unsigned char *data; // the rows with their halos, as read from the file
+	int window_start; // first row read, halo included
+	MPI_Request request; // the read of the rows
+}file_chunk_t; // a chunk read from the input file by a worker process
+
+void close_shared_files(shared_files_t *files){
+	/**
+	*	Takes in a shared_files_t and closes its files.
+	*/
+	
+	if(files->tiled != NULL) close_tiled(files->tiled);
+	if(files->input != MPI_FILE_NULL) MPI_File_close(&files->input);
+	if(files->output != MPI_FILE_NULL) MPI_File_close(&files->output);
+	files->tiled = NULL;
+}
+
+int open_shared_files(const char *in_file_name, const char *out_file_name, shared_files_t *files, int my_rank, MPI_Comm comm){
+	/**
+	*	Takes in a file path to the file to edit (a .bmp file or a tiled image), a file path to save the edited Image at,
+	*	a place to store the open files, this process's rank and the communicator of the processes editing the Image.
+	*	Every process opens the input and reads its header; the output is created with MPI-IO at its final size
+	*	and process 0 writes its header, so the workers can write their rows anywhere in it.
+	*	It returns 0 on success and -1 on failure.
+	*/
+	
+	int check;
+	files->input = MPI_FILE_NULL;
+	files->output = MPI_FILE_NULL;
+	files->tiled = NULL;
+	files->input_pixels = NULL;
+	files->output_pixels = NULL;
+	files->edited_rows = NULL;
+	
+	if(is_tiled_file(in_file_name)){
+		files->tiled = open_tiled(in_file_name);
+		if(files->tiled == NULL){ // error message was printed by the called function
+			return -1;
+		}
+		
+		files->height = files->tiled->height;
+		files->width = files->tiled->width;
+		files->channels = files->tiled->channels;
+		files->top_down = files->tiled->top_down;
+		files->data_offset = 0;
+		files->padding = 0;
+	}
+	else{
+		check = MPI_File_open(comm, in_file_name, MPI_MODE_RDONLY, MPI_INFO_NULL, &files->input);
+		if(check != MPI_SUCCESS){
+			fprintf(stderr, "Rank %d: Error in open_shared_files while opening file %s\n", my_rank, in_file_name);
+			fflush(stderr);
+			return -1;
+		}
+		
+		unsigned char header[BMP_MAX_HEADER_SIZE];
+		MPI_Status status;
+		int header_size;
+		
+		check = MPI_File_read_at_all(files->input, 0, header, BMP_MAX_HEADER_SIZE, MPI_UNSIGNED_CHAR, &status);
+		if(check != MPI_SUCCESS){
+			fprintf(stderr, "Rank %d: Error in open_shared_files while reading from file %s\n", my_rank, in_file_name);
+			fflush(stderr);
+			close_shared_files(files);
+			return -1;
+		}
+		MPI_Get_count(&status, MPI_UNSIGNED_CHAR, &header_size);
+		
+		check = parse_BMP_header(header, header_size, &files->height, &files->width, &files->channels, &files->top_down, &files->data_offset, &files->padding, my_rank == 0);
+		if(check != 0){ // error message was printed by the called function
+			close_shared_files(files);
+			return -1;
+		}
+		
+		check = sft_check_file_size(files->input, files->data_offset, files->width * files->channels + files->padding, files->height);
+		if(check != 0){
+			fprintf(stderr, "Rank %d: Error in open_shared_files, file %s is shorter than its header says\n", my_rank, in_file_name);
+			fflush(stderr);
+			close_shared_files(files);
+			return -1;
+		}
+	}
+	
+	unsigned char out_header[BMP_MAX_HEADER_SIZE];
+	int row_size = files->width * files->channels;
+	files->out_data_offset = build_BMP_header(out_header, files->height, files->width, files->channels, files->top_down);
+	files->out_padding = ((row_size + 3) & (~3)) - row_size;
+	
+	check = MPI_File_open(comm, out_file_name, MPI_MODE_CREATE | MPI_MODE_WRONLY, MPI_INFO_NULL, &files->output);
+	if(check == MPI_SUCCESS){
+		check = MPI_File_set_size(files->output, files->out_data_offset + (MPI_Offset)files->height * (row_size + files->out_padding));
+	}
+	if(check == MPI_SUCCESS && my_rank == 0){
+		check = MPI_File_write_at(files->output, 0, out_header, files->out_data_offset, MPI_UNSIGNED_CHAR, MPI_STATUS_IGNORE);
+	}
+	if(check != MPI_SUCCESS){
+		fprintf(stderr, "Rank %d: Error in open_shared_files while creating file %s\n", my_rank, out_file_name);
+		fflush(stderr);
+		close_shared_files(files);
+		return -1;
+	}
+	
+	return 0;
+}
+
+int post_file_chunk_read(const shared_files_t *files, file_chunk_t *chunk, int halo_dim, int my_rank){
+	/**
+	*	Takes in the open files, a file_chunk_t whose block was received from process 0, the size of the halo and this process's rank.
+	*	It starts reading the rows of the chunk and their halos from the input file with sft_read_rows
+	*	(a shared Image needs no read).
+	*	It returns 0 on success and -1 on failure.
+	*/
+	
+	int offset_stride = files->width * files->channels + files->padding;
+	int window_end = min(chunk->block.true_end + 1 + halo_dim, files->height);
+	chunk->window_start = max(chunk->block.true_start - halo_dim, 0);
+	chunk->request = MPI_REQUEST_NULL;
+	
+	if(files->input_pixels != NULL){ // the rows are read in place
+		chunk->data = NULL;
+		return 0;
+	}
+	
+	chunk->data = (unsigned char*)malloc((size_t)(window_end - chunk->window_start) * offset_stride);
+	if(chunk->data == NULL){
+		fprintf(stderr, "Rank %d: Error in post_file_chunk_read while allocating memory\n", my_rank);
+		fflush(stderr);
+		chunk->request = MPI_REQUEST_NULL;
+		return -1;
+	}
+	
+	int check = sft_read_rows(files->input, files->tiled, files->data_offset, offset_stride, chunk->window_start, window_end, chunk->data, &chunk->request);
+	if(check != 0){
+		fprintf(stderr, "Rank %d: Error in post_file_chunk_read while reading the input\n", my_rank);
+		fflush(stderr);
+		return -1;
+	}
+	
+	return 0;
+}
+
+int edit_file_chunk(const shared_files_t *files, file_chunk_t *chunk, int halo_dim, int my_rank, unsigned long long *rows_hash){
+	/**
+	*	Takes in the open files, a file_chunk_t whose read was posted, the size of the halo, this process's rank
+	*	and a place to add the hash of the edited rows to (NULL if it is not needed).
+	*	It waits for the rows of the chunk, edits them and writes the edited rows straight into their place in the output file,
+	*	or, with a shared Image, edits them in place from the shared Image into the shared edited Image.
+	*	It returns 0 on success and -1 on failure.
+	*/
+	
+	int row_size = files->width * files->channels;
+	
+	if(files->input_pixels != NULL){
+		Image img = {files->width, files->height, files->channels, files->top_down, files->input_pixels};
+		unsigned char *edited_rows = files->output_pixels + (size_t)chunk->block.true_start * row_size;
+		
+		if(perform_convolution_into(&img, chunk->block.operation, chunk->block.true_start, chunk->block.true_end, chunk->block.num_threads, edited_rows) != 0){ // error message was printed by the called function
+			return -1;
+		}
+		if(files->edited_rows != NULL){
+			memset(files->edited_rows + chunk->block.true_start, 1, chunk->block.height);
+		}
+		if(rows_hash != NULL){
+			*rows_hash += hash_rows(edited_rows, chunk->block.true_start, chunk->block.height, files->width, files->channels, chunk->block.num_threads);
+		}
+		return 0;
+	}
+	
+	int window_rows = min(chunk->block.true_end + 1 + halo_dim, files->height) - chunk->window_start;
+	
+	// a read of a .bmp file truncated since its size was checked is short
+	MPI_Status status;
+	int read_bytes;
+	int check = MPI_Wait(&chunk->request, &status);
+	if(check == MPI_SUCCESS && files->tiled == NULL){
+		MPI_Get_count(&status, MPI_UNSIGNED_CHAR, &read_bytes);
+		if(read_bytes != window_rows * (row_size + files->padding)) check = -1;
+	}
+	if(check != MPI_SUCCESS){
+		fprintf(stderr, "Rank %d: Error in edit_file_chunk while reading the input\n", my_rank);
+		fflush(stderr);
+		return -1;
+	}
+	remove_BMP_padding(chunk->data, window_rows, row_size, files->padding);
+	
+	Image img = {files->width, window_rows, files->channels, files->top_down, chunk->data};
+	Image *edited_chunk = perform_convolution_parallel(&img, chunk->block.operation, chunk->block.true_start - chunk->window_start, chunk->block.true_end - chunk->window_start, chunk->block.num_threads);
+	free(chunk->data);
+	chunk->data = NULL;
+	if(edited_chunk == NULL){ // error message was printed by the called function
+		return -1;
+	}
+	
+	if(rows_hash != NULL){
+		*rows_hash += hash_rows(edited_chunk->data, chunk->block.true_start, edited_chunk->height, files->width, files->channels, chunk->block.num_threads);
+	}
+	
+	// the rows of the output file are padded, the rows of the edited chunk are not
+	unsigned char *rows = edited_chunk->data;
+	if(files->out_padding != 0){
+		rows = (unsigned char*)calloc((size_t)edited_chunk->height, row_size + files->out_padding);
+		if(rows == NULL){
+			fprintf(stderr, "Rank %d: Error in edit_file_chunk while allocating memory\n", my_rank);
+			fflush(stderr);
+			free(edited_chunk->data);
+			free(edited_chunk);
+			return -1;
+		}
+		for(int i = 0; i < edited_chunk->height; ++i){
+			memcpy(rows + (size_t)i * (row_size + files->out_padding), edited_chunk->data + (size_t)i * row_size, row_size);
+		}
+	}
+	
+	check = MPI_File_write_at(files->output, files->out_data_offset + (MPI_Offset)chunk->block.true_start * (row_size + files->out_padding),
+		rows, edited_chunk->height * (row_size + files->out_padding), MPI_UNSIGNED_CHAR, MPI_STATUS_IGNORE);
+	if(rows != edited_chunk->data) free(rows);
+	free(edited_chunk->data);
+	free(edited_chunk);
+	if(check != MPI_SUCCESS){
+		fprintf(stderr, "Rank %d: Error in edit_file_chunk while writing the output\n", my_rank);
+		fflush(stderr);
+		return -1;
+	}
+	
+	return 0;
+}
+
+void next_descriptor(send_block_t *block, operation_t operation, int chunk_size, int *next_row, const shared_files_t *files, int num_threads){
+	/**
+	*	Takes in a place to store the rows of the next chunk, an operation_t, the size of a chunk, the first row not handed out yet,
+	*	the open files and the number of threads of the process editing the chunk.
+	*	It fills block with the next chunk_size rows and moves next_row past them.
+	*/
+	
+	block->true_start = *next_row;
+	block->true_end = min(*next_row + chunk_size, files->height) - 1;
+	block->height = block->true_end - block->true_start + 1;
+	block->width = files->width;
+	block->channels = files->channels;
+	block->operation = operation;
+	block->num_threads = num_threads;
+	block->top_down = files->top_down;
+	*next_row = block->true_end + 1;
+}
+
+int send_descriptor(int worker_process, operation_t operation, int chunk_size, int *next_row, const shared_files_t *files, int num_threads, MPI_Datatype mpi_send_block, MPI_Comm comm){
+	/**
+	*	Takes in the rank of the process which needs to receive work, an operation_t, the size of a chunk, the first row not handed out yet,
+	*	the open files, the number of threads the worker process can use, the MPI_Datatype of a send_block_t
+	*	and the communicator of the master and the workers.
+	*	It sends the worker process the rows of its next chunk, which it reads from the input file itself, and moves next_row past them.
+	*	It returns 0 on success and -1 on failure.
+	*/
+	
+	send_block_t block;
+	next_descriptor(&block, operation, chunk_size, next_row, files, num_threads);
+	
+	int check = MPI_Send(&block, 1, mpi_send_block, worker_process, WORK_HEADER_SEND_TAG, comm);
+	if(check != MPI_SUCCESS){
+		fprintf(stderr, "Rank 0: Error in sft_master_process while sending work header\n");
+		fflush(stderr);
+		return -1;
+	}
+	
+	return 0;
+}
+
+int sft_master_process(const shared_files_t *files, operation_t operation, int chunk, int num_processes, MPI_Comm comm, int num_threads, unsigned long long *rows_hash){
+	/**
+	*	Takes in the open files, an operation_t, the size of a chunk (ADAPTIVE_CHUNK_SIZE to size every chunk with adaptive_chunk_size),
+	*	the total number of processes, the communicator of the master and the workers, the number of threads available to each process
+	*	and a place to add the hash of the rows edited by process 0 to (NULL if it is not needed).
+	*	It schedules the chunks like master_process, but only sends the rows of every chunk: the workers read and write the pixels themselves,
+	*	so process 0 never touches them. Every worker has MASTER_PREFETCH_DEPTH chunks queued, and gets a new one whenever it reports
+	*	an edited chunk, until there are no rows left.
+	*	With a shared Image and HYBRID_MASTER, process 0 edits chunks too whenever no worker is waiting, like master_process.
+	*	It returns 0 on success and -1 on failure.
+	*/
+	
+	int check = 0;
+	int next_row = 0;
+	int active_workers = 0;
+	int hybrid = (HYBRID_MASTER && files->input_pixels != NULL);
+	int *queue_length = (int*)calloc(num_processes, sizeof(int));
+	chunk_schedule_t schedule = {num_processes - 1 + hybrid, num_processes, 0, 0, MPI_Wtime(), NULL, NULL};
+	schedule.rows_per_second = (double*)calloc(num_processes, sizeof(double));
+	schedule.last_result = (double*)calloc(num_processes, sizeof(double));
+	if(queue_length == NULL || schedule.rows_per_second == NULL || schedule.last_result == NULL){
+		fprintf(stderr, "Rank 0: Error in sft_master_process while allocating memory\n");
+		fflush(stderr);
+		free(queue_length);
+		free(schedule.rows_per_second);
+		free(schedule.last_result);
+		return -1;
+	}
+	
+	MPI_Datatype mpi_send_block = create_mpi_datatype_for_send_block_t();
+	
+	// the descriptors are small enough for MPI_Send to return before the worker receives them
+	for(int depth = 0; depth < MASTER_PREFETCH_DEPTH && next_row < files->height && check == 0; ++depth){
+		for(int i = 1; i < num_processes && next_row < files->height && check == 0; ++i){
+			int chunk_size = (chunk > 0) ? chunk : adaptive_chunk_size(&schedule, files->height - next_row, i);
+			check = send_descriptor(i, operation, chunk_size, &next_row, files, num_threads, mpi_send_block, comm);
+			if(check == 0){
+				if(queue_length[i] == 0) ++active_workers;
+				++queue_length[i];
+			}
+		}
+	}
+	
+	for(int i = 1; i < num_processes && check == 0; ++i){
+		if(queue_length[i] == 0){
+			check = MPI_Send(NULL, 0, MPI_BYTE, i, TERMINATE_TAG, comm);
+			if(check != MPI_SUCCESS){
+				fprintf(stderr, "Rank 0: Error in sft_master_process while sending terminate order\n");
+				fflush(stderr);
+				check = -1;
+			}
+		}
+	}
+	
+	while((active_workers != 0 || (hybrid && next_row < files->height)) && check == 0){
+		send_block_t header;
+		MPI_Status status;
+		
+		if(hybrid && next_row < files->height){
+			int waiting;
+			check = MPI_Iprobe(MPI_ANY_SOURCE, WORK_HEADER_RECEIVE_TAG, comm, &waiting, MPI_STATUS_IGNORE);
+			if(check != MPI_SUCCESS){
+				fprintf(stderr, "Rank 0: Error in sft_master_process while probing for edited chunks\n");
+				fflush(stderr);
+				check = -1;
+				break;
+			}
+			
+			if(!waiting){
+				file_chunk_t local_chunk;
+				int chunk_size = (chunk > 0) ? chunk : adaptive_chunk_size(&schedule, files->height - next_row, 0);
+				next_descriptor(&local_chunk.block, operation, chunk_size, &next_row, files, num_threads);
+				schedule.last_result[0] = MPI_Wtime();
+				
+				check = post_file_chunk_read(files, &local_chunk, get_kernel_size(operation) / 2, 0);
+				if(check == 0) check = edit_file_chunk(files, &local_chunk, get_kernel_size(operation) / 2, 0, rows_hash);
+				if(check != 0){ // error message was printed by the called function
+					break;
+				}
+				
+				if(chunk <= 0){
+					measure_worker_throughput(&schedule, 0, local_chunk.block.height);
+				}
+				continue;
+			}
+		}
+		
+		check = MPI_Recv(&header, 1, mpi_send_block, MPI_ANY_SOURCE, WORK_HEADER_RECEIVE_TAG, comm, &status);
+		if(check != MPI_SUCCESS){
+			fprintf(stderr, "Rank 0: Error in sft_master_process while receiving work header\n");
+			fflush(stderr);
+			check = -1;
+			break;
+		}
+		
+		int worker_rank = status.MPI_SOURCE;
+		--queue_length[worker_rank];
+		if(chunk <= 0){
+			measure_worker_throughput(&schedule, worker_rank, header.height);
+		}
+		
+		if(next_row < files->height){
+			int chunk_size = (chunk > 0) ? chunk : adaptive_chunk_size(&schedule, files->height - next_row, worker_rank);
+			check = send_descriptor(worker_rank, operation, chunk_size, &next_row, files, num_threads, mpi_send_block, comm);
+			if(check != 0){ // error message was printed by the called function
+				break;
+			}
+			++queue_length[worker_rank];
+		}
+		
+		if(queue_length[worker_rank] == 0){ // remove and terminate the current worker
+			--active_workers;
+			
+			check = MPI_Send(NULL, 0, MPI_BYTE, worker_rank, TERMINATE_TAG, comm);
+			if(check != MPI_SUCCESS){
+				fprintf(stderr, "Rank 0: Error in sft_master_process while sending terminate order\n");
+				fflush(stderr);
+				check = -1;
+			}
+		}
+	}
+	
+	free(queue_length);
+	free(schedule.rows_per_second);
+	free(schedule.last_result);
+	
+	if(deallocate_MPI_datatype(&mpi_send_block, 0) == -1 || check != 0){ // error message was printed by the called function
+		return -1;
+	}
+	
+	return 0;
+}
+
+int sft_worker_process(const shared_files_t *files, int halo_dim, int my_rank, MPI_Comm comm, unsigned long long *rows_hash){
+	/**
+	*	Takes in the open files, the size of the halo, this process's rank, the communicator of the master and the workers
+	*	and a place to add the hash of the edited rows to (NULL if it is not needed).
+	*	It receives the rows of its chunks from process 0, reads them from the input file, edits them, writes them to the output file
+	*	and reports every edited chunk to process 0, until process 0 terminates it. When the next chunk is already queued,
+	*	its read is posted before the current chunk is edited, so reading overlaps the editing.
+	*	It returns 0 on success and -1 on failure.
+	*/
+	
+	MPI_Datatype mpi_send_block = create_mpi_datatype_for_send_block_t();
+	file_chunk_t chunks[2] = {{.data = NULL, .request = MPI_REQUEST_NULL}, {.data = NULL, .request = MPI_REQUEST_NULL}};
+	int current = 0;
+	int next_posted = 0;
+	int check = 0;
+	
+	while(check == 0){
+		file_chunk_t *chunk = &chunks[current];
+		
+		if(!next_posted){
+			MPI_Status status;
+			check = MPI_Probe(0, MPI_ANY_TAG, comm, &status);
+			if(check == MPI_SUCCESS && status.MPI_TAG == TERMINATE_TAG){
+				check = MPI_Recv(NULL, 0, MPI_BYTE, 0, TERMINATE_TAG, comm, MPI_STATUS_IGNORE);
+				if(check == MPI_SUCCESS) break;
+			}
+			if(check == MPI_SUCCESS) check = MPI_Recv(&chunk->block, 1, mpi_send_block, 0, WORK_HEADER_SEND_TAG, comm, MPI_STATUS_IGNORE);
+			if(check != MPI_SUCCESS){
+				fprintf(stderr, "Rank %d: Error in sft_worker_process while receiving work header\n", my_rank);
+				fflush(stderr);
+				check = -1;
+				break;
+			}
+			
+			check = post_file_chunk_read(files, chunk, halo_dim, my_rank);
+			if(check != 0){ // error message was printed by the called function
+				break;
+			}
+		}
+		
+		// process 0 only terminates a worker which has no queued chunk, so nothing but a chunk can be waiting here
+		int queued;
+		check = MPI_Iprobe(0, WORK_HEADER_SEND_TAG, comm, &queued, MPI_STATUS_IGNORE);
+		if(check == MPI_SUCCESS && queued) check = MPI_Recv(&chunks[1 - current].block, 1, mpi_send_block, 0, WORK_HEADER_SEND_TAG, comm, MPI_STATUS_IGNORE);
+		if(check != MPI_SUCCESS){
+			fprintf(stderr, "Rank %d: Error in sft_worker_process while receiving work header\n", my_rank);
+			fflush(stderr);
+			check = -1;
+			break;
+		}
+		next_posted = queued;
+		if(queued){
+			check = post_file_chunk_read(files, &chunks[1 - current], halo_dim, my_rank);
+			if(check != 0){ // error message was printed by the called function
+				break;
+			}
+		}
+		
+		check = edit_file_chunk(files, chunk, halo_dim, my_rank, rows_hash);
+		if(check != 0){ // error message was printed by the called function
+			break;
+		}
+		
+		check = MPI_Send(&chunk->block, 1, mpi_send_block, 0, WORK_HEADER_RECEIVE_TAG, comm);
+		if(check != MPI_SUCCESS){
+			fprintf(stderr, "Rank %d: Error in sft_worker_process while sending work header\n", my_rank);
+			fflush(stderr);
+			check = -1;
+			break;
+		}
+		current = 1 - current;
+	}
+	
+	for(int k = 0; k < 2; ++k){
+		if(chunks[k].request != MPI_REQUEST_NULL) MPI_Wait(&chunks[k].request, MPI_STATUS_IGNORE);
+		free(chunks[k].data);
+	}
+	
+	if(deallocate_MPI_datatype(&mpi_send_block, my_rank) == -1 || check != 0){ // error message was printed by the called function
+		return -1;
+	}
+	
+	return 0;
+}
\ No newline at end of file
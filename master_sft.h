@@ -0,0 +1,25 @@
+#ifndef MASTER_SFT
+
+#define MASTER_SFT
+
+#include "bmp_common.h"
+#include "convolution.h"
+#include "tiled.h"
+
+typedef struct{
+	MPI_File input; // the input .bmp file, MPI_FILE_NULL for a tiled image
+	tiled_image_t *tiled; // the input tiled image, NULL for a .bmp file
+	MPI_File output; // the output .bmp file, written by the workers
+	int height, width, channels, top_down;
+	int data_offset, padding; // of the input
+	int out_data_offset, out_padding;
+	unsigned char *input_pixels, *output_pixels; // the Image and the edited Image in shared memory windows, used instead of the files if not NULL
+	unsigned char *edited_rows; // with the shared Image on several nodes, set to 1 for every row edited on the node (NULL otherwise)
+}shared_files_t; // the input and output of the Master/Worker versions in which the workers only get the rows of their chunks
+
+void close_shared_files(shared_files_t *files);
+int open_shared_files(const char *in_file_name, const char *out_file_name, shared_files_t *files, int my_rank, MPI_Comm comm);
+int sft_master_process(const shared_files_t *files, operation_t operation, int chunk, int num_processes, MPI_Comm comm, int num_threads, unsigned long long *rows_hash);
+int sft_worker_process(const shared_files_t *files, int halo_dim, int my_rank, MPI_Comm comm, unsigned long long *rows_hash);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,233 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <omp.h>
+#include "sequence.h"
+#include "bmp.h"
+#include "tiled.h"
+
+int compare_latencies(const void *a, const void *b){
+	/**
+	*	Takes in two frame latencies and orders them increasingly.
+	*/
+	
+	double latency_a = *(const double*)a, latency_b = *(const double*)b;
+	return (latency_a > latency_b) - (latency_a < latency_b);
+}
+
+double latency_percentile(const double *latencies, int num_latencies, double percentile){
+	/**
+	*	Takes in increasingly sorted latencies, their number and a percentile (between 0 and 100)
+	*	and returns the latency below which percentile percent of the latencies are (nearest rank).
+	*/
+	
+	int rank = (int)(percentile / 100.0 * num_latencies + 0.999999);
+	return latencies[min(max(rank, 1), num_latencies) - 1];
+}
+
+int check_frame_pattern(const char *pattern){
+	/**
+	*	Takes in a frame pattern and checks it is a printf pattern with exactly one integer conversion
+	*	(such as %d, %5d or %05d) and no other %, so it can be given to snprintf with the number of a frame.
+	*	It returns 0 if the pattern is valid and -1 otherwise.
+	*/
+	
+	int conversions = 0;
+	for(const char *c = strchr(pattern, '%'); c != NULL; c = strchr(c, '%')){
+		++c;
+		if(*c == '0') ++c;
+		while(*c >= '0' && *c <= '9') ++c;
+		if(*c != 'd' && *c != 'i') return -1;
+		++conversions;
+	}
+	
+	return (conversions == 1) ? 0 : -1;
+}
+
+int edit_frames(const char *in_pattern, const char *out_pattern, operation_t operation, int first_frame, int frame_step, int num_frames, int num_threads, double start_time, double *latencies){
+	/**
+	*	Takes in the input and output patterns, an operation_t, the number of the first frame to edit, the step between the frames to edit,
+	*	how many frames to edit, the number of threads to edit a frame with, the moment the sequence started and a place to store
+	*	the latency of every frame (from the start of its read to the end of its write).
+	*	It keeps three frames in flight: while frame t + 2 is being read, frame t + 1 is being edited and frame t is being written,
+	*	each stage in its own section, so reading and writing hide behind the editing.
+	*	It returns 0 on success and -1 on failure.
+	*/
+	
+	Image *read_frames[3] = {NULL, NULL, NULL};
+	Image *edited_frames[3] = {NULL, NULL, NULL};
+	double read_start[3];
+	int failed = 0;
+	
+	omp_set_max_active_levels(2); // the editing section starts its own threads
+	
+	// at step s, frame s is read, frame s - 1 is edited and frame s - 2 is written
+	for(int step = 0; step < num_frames + 2 && !failed; ++step){
+		#pragma omp parallel sections num_threads(3)
+		{
+			#pragma omp section
+			{
+				if(step < num_frames){
+					char file_name[SEQUENCE_PATH_SIZE];
+					snprintf(file_name, sizeof(file_name), in_pattern, first_frame + step * frame_step);
+					
+					read_start[step % 3] = omp_get_wtime();
+					read_frames[step % 3] = is_tiled_file(file_name) ? read_tiled_serial(file_name) : read_BMP_serial(file_name);
+					if(read_frames[step % 3] == NULL){ // error message was printed by the called function
+						#pragma omp atomic write
+						failed = 1;
+					}
+				}
+			}
+			
+			#pragma omp section
+			{
+				int t = step - 1;
+				if(t >= 0 && t < num_frames){
+					Image *frame = read_frames[t % 3];
+					edited_frames[t % 3] = perform_convolution_parallel(frame, operation, 0, frame->height - 1, num_threads);
+					if(edited_frames[t % 3] == NULL){ // error message was printed by the called function
+						#pragma omp atomic write
+						failed = 1;
+					}
+					free(frame->data);
+					free(frame);
+					read_frames[t % 3] = NULL;
+				}
+			}
+			
+			#pragma omp section
+			{
+				int t = step - 2;
+				if(t >= 0 && t < num_frames){
+					char file_name[SEQUENCE_PATH_SIZE];
+					snprintf(file_name, sizeof(file_name), out_pattern, first_frame + t * frame_step);
+					
+					if(save_BMP(file_name, edited_frames[t % 3]) != 0){ // error message was printed by the called function
+						#pragma omp atomic write
+						failed = 1;
+					}
+					latencies[t] = omp_get_wtime() - read_start[t % 3];
+					
+					if(SEQUENCE_PRINT_FRAMES){
+						fprintf(stdout, "Frame %d: latency %f, written at %f\n", first_frame + t * frame_step, latencies[t], omp_get_wtime() - start_time);
+						fflush(stdout);
+					}
+					
+					free(edited_frames[t % 3]->data);
+					free(edited_frames[t % 3]);
+					edited_frames[t % 3] = NULL;
+				}
+			}
+		}
+	}
+	
+	for(int i = 0; i < 3; ++i){
+		if(read_frames[i] != NULL){
+			free(read_frames[i]->data);
+			free(read_frames[i]);
+		}
+		if(edited_frames[i] != NULL){
+			free(edited_frames[i]->data);
+			free(edited_frames[i]);
+		}
+	}
+	
+	return failed ? -1 : 0;
+}
+
+int run_sequence(const char *in_pattern, const char *out_pattern, operation_t operation, int first_frame, int num_frames, int my_rank, int num_processes, int num_cores, int num_workstations){
+	/**
+	*	Takes in the input and output patterns, an operation_t, the number of the first frame, the number of frames,
+	*	this process's rank, the total number of processes, the number of cores on a workstation and the number of workstations.
+	*	Frames of the same camera have the same size, so they are spread statically across the processes: process p edits
+	*	the frames p, p + N, p + 2N, ... of the sequence, pipelined with edit_frames.
+	*	Process 0 then gathers the latencies of all the frames and prints the sustained frames per second
+	*	and the latency percentiles.
+	*	It returns 0 on success and -1 on failure.
+	*/
+	
+	int check;
+	if(check_frame_pattern(in_pattern) != 0 || check_frame_pattern(out_pattern) != 0){
+		if(my_rank == 0){
+			fprintf(stderr, "Rank 0: Error in run_sequence: a frame pattern needs exactly one integer conversion, such as %%05d, and no other %%\n");
+			fflush(stderr);
+		}
+		return -1;
+	}
+	
+	int my_frames = (num_frames - my_rank + num_processes - 1) / num_processes;
+	if(my_frames < 0) my_frames = 0;
+	int num_threads = max(1, num_cores / (num_processes / num_workstations));
+	
+	double *latencies = (double*)malloc((my_frames + 1) * sizeof(double));
+	double *all_latencies = NULL;
+	int *counts = NULL, *displacements = NULL;
+	if(my_rank == 0){
+		all_latencies = (double*)malloc((num_frames + 1) * sizeof(double));
+		counts = (int*)malloc(num_processes * sizeof(int));
+		displacements = (int*)malloc(num_processes * sizeof(int));
+	}
+	if(latencies == NULL || (my_rank == 0 && (all_latencies == NULL || counts == NULL || displacements == NULL))){
+		fprintf(stderr, "Rank %d: Error in run_sequence while allocating memory\n", my_rank);
+		fflush(stderr);
+		free(latencies);
+		free(all_latencies);
+		free(counts);
+		free(displacements);
+		return -1;
+	}
+	
+	MPI_Barrier(MPI_COMM_WORLD);
+	double start_time = MPI_Wtime();
+	
+	check = edit_frames(in_pattern, out_pattern, operation, first_frame + my_rank, num_processes, my_frames, num_threads, omp_get_wtime(), latencies);
+	if(check != 0){ // error message was printed by the called function
+		free(latencies);
+		free(all_latencies);
+		free(counts);
+		free(displacements);
+		return -1;
+	}
+	
+	double elapsed_time = MPI_Wtime() - start_time;
+	double total_time;
+	
+	check = MPI_Reduce(&elapsed_time, &total_time, 1, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+	if(check == MPI_SUCCESS) check = MPI_Gather(&my_frames, 1, MPI_INT, counts, 1, MPI_INT, 0, MPI_COMM_WORLD);
+	if(check == MPI_SUCCESS && my_rank == 0){
+		displacements[0] = 0;
+		for(int i = 1; i < num_processes; ++i){
+			displacements[i] = displacements[i - 1] + counts[i - 1];
+		}
+	}
+	if(check == MPI_SUCCESS) check = MPI_Gatherv(latencies, my_frames, MPI_DOUBLE, all_latencies, counts, displacements, MPI_DOUBLE, 0, MPI_COMM_WORLD);
+	free(latencies);
+	free(counts);
+	free(displacements);
+	if(check != MPI_SUCCESS){
+		fprintf(stderr, "Rank %d: Error in run_sequence while gathering the latencies\n", my_rank);
+		fflush(stderr);
+		free(all_latencies);
+		return -1;
+	}
+	
+	if(my_rank == 0 && num_frames > 0){
+		double latency_sum = 0;
+		for(int i = 0; i < num_frames; ++i){
+			latency_sum += all_latencies[i];
+		}
+		qsort(all_latencies, num_frames, sizeof(double), compare_latencies);
+		
+		fprintf(stdout, "Frames: %d on %d processes (%d threads each)\n", num_frames, num_processes, num_threads);
+		fprintf(stdout, "Total time: %f\n", total_time);
+		fprintf(stdout, "Frames per second: %f\n", num_frames / total_time);
+		fprintf(stdout, "Latency: mean %f, p50 %f, p90 %f, p99 %f, max %f\n\n", latency_sum / num_frames,
+			latency_percentile(all_latencies, num_frames, 50), latency_percentile(all_latencies, num_frames, 90),
+			latency_percentile(all_latencies, num_frames, 99), all_latencies[num_frames - 1]);
+		fflush(stdout);
+	}
+	
+	free(all_latencies);
+	return 0;
+}
\ No newline at end of file
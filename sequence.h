@@ -0,0 +1,19 @@
+#ifndef SEQUENCE
+
+#define SEQUENCE
+
+#include "bmp_common.h"
+#include "convolution.h"
+
+#define SEQUENCE_PATH_SIZE 256
+#define SEQUENCE_PRINT_FRAMES 0 // set to 1 to print the latency of every frame
+
+/**
+*	A frame sequence is given by a printf pattern with one integer conversion and no other `%`, such as `frame_%05d.bmp`,
+*	the number of the first frame and the number of frames. Frame t is edited from the input pattern
+*	and saved at the output pattern, both with the number t.
+*/
+
+int run_sequence(const char *in_pattern, const char *out_pattern, operation_t operation, int first_frame, int num_frames, int my_rank, int num_processes, int num_cores, int num_workstations);
+
+#endif
\ No newline at end of file
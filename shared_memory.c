@@ -0,0 +1,515 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "shared_memory.h"
+#include "bmp.h"
+#include "convolution.h"
+#include "tiled.h"
+#include "verification.h"
+#include "cache.h"
+#include "image_processing.h"
+#include "master_sft.h"
+
+#define SHARED_ROWS_TAG 12
+
+#define HIERARCHY_RANKS_PER_NODE 0 // processes per node of the Master/Worker hierarchy and of the shared windows, 0 = the processes sharing memory (set it to try several nodes on one node)
+#define SHARED_PRINT_COPIES 0 // set to 1 to print the bytes the shared windows copied between the nodes
+#define SHARED_ANY_ROWS -1 // halo_dim given to open_shared_image when a process may edit any row of the Image
+
+typedef struct{
+	MPI_Win input_window, output_window, edited_window;
+	unsigned char *input, *output; // the Image and the edited Image, allocated once per node and mapped by every process of the node
+	unsigned char *edited; // on several nodes, 1 for every row edited on this node (NULL on a single node)
+	int height, width, channels, top_down;
+	MPI_Comm node, leaders; // the processes of this node and the first process of every node (MPI_COMM_NULL on the other processes)
+	int num_nodes;
+	size_t copied_input, copied_output; // bytes of the Image and of the edited Image sent between the nodes, counted on process 0
+}shared_image_t; // an Image shared by the processes of every node
+
+void free_shared_image(shared_image_t *shared){
+	/**
+	*	Takes in a shared_image_t and frees its windows and communicators (a collective call).
+	*/
+	
+	if(shared->input_window != MPI_WIN_NULL) MPI_Win_free(&shared->input_window);
+	if(shared->output_window != MPI_WIN_NULL) MPI_Win_free(&shared->output_window);
+	if(shared->edited_window != MPI_WIN_NULL) MPI_Win_free(&shared->edited_window);
+	if(shared->node != MPI_COMM_NULL) MPI_Comm_free(&shared->node);
+	if(shared->leaders != MPI_COMM_NULL) MPI_Comm_free(&shared->leaders);
+	shared->input = NULL;
+	shared->output = NULL;
+	shared->edited = NULL;
+}
+
+int split_node(MPI_Comm comm, int my_rank, MPI_Comm *node){
+	/**
+	*	Takes in a communicator, this process's rank and a place to store the communicator of the processes of this process's node,
+	*	grouped with MPI_Comm_split_type or, if HIERARCHY_RANKS_PER_NODE is set, by HIERARCHY_RANKS_PER_NODE consecutive ranks.
+	*	The processes keep their order, so process 0 is the first process of its node.
+	*	It returns the error code of the split.
+	*/
+	
+	if(HIERARCHY_RANKS_PER_NODE > 0){
+		return MPI_Comm_split(comm, my_rank / max(HIERARCHY_RANKS_PER_NODE, 1), my_rank, node);
+	}
+	return MPI_Comm_split_type(comm, MPI_COMM_TYPE_SHARED, my_rank, MPI_INFO_NULL, node);
+}
+
+int allocate_shared_window(size_t size, MPI_Comm comm, MPI_Win *window, unsigned char **base){
+	/**
+	*	Takes in a size (only used on process 0), the communicator of processes on the same node and places to store a window and its memory.
+	*	Process 0 allocates size bytes with MPI_Win_allocate_shared and every process maps them.
+	*	It returns 0 on success and -1 on failure.
+	*/
+	
+	int my_rank, disp_unit;
+	MPI_Aint window_size;
+	MPI_Comm_rank(comm, &my_rank);
+	
+	int check = MPI_Win_allocate_shared((my_rank == 0) ? (MPI_Aint)size : 0, 1, MPI_INFO_NULL, comm, base, window);
+	if(check == MPI_SUCCESS) check = MPI_Win_shared_query(*window, 0, &window_size, &disp_unit, base);
+	return (check == MPI_SUCCESS) ? 0 : -1;
+}
+
+int copy_rows_to_nodes(shared_image_t *shared, int my_rank, int num_processes, int halo_dim){
+	/**
+	*	Takes in a shared Image read by process 0 on several nodes, this process's rank, the total number of processes
+	*	and the size of the halo of the strips the processes edit (sft_strip_rows), or SHARED_ANY_ROWS if a process may edit any row.
+	*	The first process of every other node gets from process 0, straight into the shared Image of its node, the rows its node needs:
+	*	the strips of its processes with their halos, or the whole Image with SHARED_ANY_ROWS. No other process sends or receives pixels.
+	*	It returns 0 on success and -1 on failure.
+	*/
+	
+	size_t row_size = (size_t)shared->width * shared->channels;
+	int range[2] = {0, shared->height}; // the rows [range[0], range[1]) are needed on this node
+	int check = MPI_SUCCESS;
+	
+	if(halo_dim != SHARED_ANY_ROWS){
+		int first_row, num_rows;
+		sft_strip_rows(shared->height, num_processes, my_rank, &first_row, &num_rows);
+		
+		// the first row and the negated end of the strips of the node, both reduced with MPI_MIN
+		int strips[2] = {(num_rows > 0) ? first_row : shared->height, (num_rows > 0) ? -(first_row + num_rows) : 0};
+		check = MPI_Allreduce(MPI_IN_PLACE, strips, 2, MPI_INT, MPI_MIN, shared->node);
+		range[0] = max(strips[0] - halo_dim, 0);
+		range[1] = max(min(-strips[1] + halo_dim, shared->height), range[0]);
+	}
+	
+	if(check == MPI_SUCCESS && shared->leaders != MPI_COMM_NULL){
+		MPI_Datatype mpi_pixel = create_mpi_datatype_for_pixel(shared->channels);
+		
+		if(halo_dim == SHARED_ANY_ROWS){
+			check = MPI_Bcast(shared->input, shared->height * shared->width, mpi_pixel, 0, shared->leaders);
+			if(my_rank == 0) shared->copied_input = (size_t)(shared->num_nodes - 1) * shared->height * row_size;
+		}
+		else if(my_rank == 0){
+			for(int i = 1; i < shared->num_nodes && check == MPI_SUCCESS; ++i){
+				int node_range[2];
+				check = MPI_Recv(node_range, 2, MPI_INT, i, SHARED_ROWS_TAG, shared->leaders, MPI_STATUS_IGNORE);
+				if(check == MPI_SUCCESS){
+					check = MPI_Send(shared->input + node_range[0] * row_size, (node_range[1] - node_range[0]) * shared->width, mpi_pixel, i, SHARED_ROWS_TAG, shared->leaders);
+					shared->copied_input += (node_range[1] - node_range[0]) * row_size;
+				}
+			}
+		}
+		else{
+			check = MPI_Send(range, 2, MPI_INT, 0, SHARED_ROWS_TAG, shared->leaders);
+			if(check == MPI_SUCCESS) check = MPI_Recv(shared->input + range[0] * row_size, (range[1] - range[0]) * shared->width, mpi_pixel, 0, SHARED_ROWS_TAG, shared->leaders, MPI_STATUS_IGNORE);
+		}
+		
+		deallocate_MPI_datatype(&mpi_pixel, my_rank);
+	}
+	
+	if(check != MPI_SUCCESS){
+		fprintf(stderr, "Rank %d: Error in copy_rows_to_nodes while sending the rows of the Image to the nodes\n", my_rank);
+		fflush(stderr);
+		return -1;
+	}
+	
+	return 0;
+}
+
+int open_shared_image(const char *in_file_name, MPI_Comm comm, int my_rank, int num_processes, int halo_dim, shared_image_t *shared){
+	/**
+	*	Takes in a file path to the file to edit (a .bmp file or a tiled image), the communicator of the processes editing the Image,
+	*	this process's rank, the total number of processes, the size of the halo of the strips the processes edit
+	*	(or SHARED_ANY_ROWS if a process may edit any row) and a place to store the shared Image.
+	*	The processes are grouped by node (split_node) and every node allocates a shared window for the Image and one for the edited Image,
+	*	so the processes of a node read and write their rows in place. Process 0 reads the file straight into the window of its node
+	*	and, on several nodes, copy_rows_to_nodes sends the other nodes the rows they need; every node then marks the rows it edits
+	*	in a third window, for finish_shared_image to collect them.
+	*	It returns 0 on success and -1 on failure.
+	*/
+	
+	int node_rank = 0, check;
+	shared->input_window = MPI_WIN_NULL;
+	shared->output_window = MPI_WIN_NULL;
+	shared->edited_window = MPI_WIN_NULL;
+	shared->input = NULL;
+	shared->output = NULL;
+	shared->edited = NULL;
+	shared->node = MPI_COMM_NULL;
+	shared->leaders = MPI_COMM_NULL;
+	shared->num_nodes = 1;
+	shared->copied_input = 0;
+	shared->copied_output = 0;
+	
+	check = split_node(comm, my_rank, &shared->node);
+	if(check == MPI_SUCCESS){
+		MPI_Comm_rank(shared->node, &node_rank);
+		int first_of_node = (node_rank == 0);
+		check = MPI_Allreduce(&first_of_node, &shared->num_nodes, 1, MPI_INT, MPI_SUM, comm);
+	}
+	if(check == MPI_SUCCESS) check = MPI_Comm_split(comm, (node_rank == 0) ? 0 : MPI_UNDEFINED, my_rank, &shared->leaders);
+	if(check != MPI_SUCCESS){
+		fprintf(stderr, "Rank %d: Error in open_shared_image while grouping the processes by node\n", my_rank);
+		fflush(stderr);
+		free_shared_image(shared);
+		return -1;
+	}
+	
+	int image_info[5] = {-1, 0, 0, 0, 0}; // height, width, channels, top_down and padding
+	FILE *image_file = NULL;
+	tiled_image_t *tiled = NULL;
+	
+	if(my_rank == 0){
+		int data_start;
+		if(is_tiled_file(in_file_name)){
+			tiled = open_tiled(in_file_name);
+			if(tiled != NULL){
+				image_info[0] = tiled->height;
+				image_info[1] = tiled->width;
+				image_info[2] = tiled->channels;
+				image_info[3] = tiled->top_down;
+			}
+		}
+		else{
+			image_file = open_BMP(in_file_name, &image_info[0], &image_info[1], &image_info[2], &image_info[3], &data_start, &image_info[4]);
+			if(image_file != NULL) fseek(image_file, data_start, SEEK_SET);
+			else image_info[0] = -1;
+		}
+	}
+	
+	check = MPI_Bcast(image_info, 5, MPI_INT, 0, comm);
+	if(check != MPI_SUCCESS || image_info[0] < 0){ // the error message of a file which could not be opened was printed by the called function
+		if(check != MPI_SUCCESS){
+			fprintf(stderr, "Rank %d: Error in open_shared_image while broadcasting the size of the Image\n", my_rank);
+			fflush(stderr);
+		}
+		if(tiled != NULL) close_tiled(tiled);
+		if(image_file != NULL) fclose(image_file);
+		free_shared_image(shared);
+		return -1;
+	}
+	
+	shared->height = image_info[0];
+	shared->width = image_info[1];
+	shared->channels = image_info[2];
+	shared->top_down = image_info[3];
+	size_t row_size = (size_t)shared->width * shared->channels;
+	
+	// the rows of a .bmp file are read with their padding, which is then removed in place
+	check = allocate_shared_window(shared->height * (row_size + image_info[4]), shared->node, &shared->input_window, &shared->input);
+	if(check == 0) check = allocate_shared_window(shared->height * row_size, shared->node, &shared->output_window, &shared->output);
+	if(check == 0 && shared->num_nodes > 1){
+		check = allocate_shared_window(shared->height, shared->node, &shared->edited_window, &shared->edited);
+		if(check == 0 && node_rank == 0) memset(shared->edited, 0, shared->height);
+	}
+	if(check != 0){
+		fprintf(stderr, "Rank %d: Error in open_shared_image while allocating the shared windows\n", my_rank);
+		fflush(stderr);
+		if(tiled != NULL) close_tiled(tiled);
+		if(image_file != NULL) fclose(image_file);
+		free_shared_image(shared);
+		return -1;
+	}
+	
+	if(my_rank == 0){
+		if(tiled != NULL) check = read_tiled_rect(tiled, 0, 0, shared->width, shared->height, shared->input);
+		else check = read_BMP_rows(image_file, shared->input, shared->height, row_size, image_info[4]);
+		
+		if(tiled != NULL) close_tiled(tiled);
+		else fclose(image_file);
+	}
+	
+	int read_failed = (check != 0);
+	check = MPI_Bcast(&read_failed, 1, MPI_INT, 0, comm);
+	if(check == MPI_SUCCESS && !read_failed && shared->num_nodes > 1){
+		read_failed = (copy_rows_to_nodes(shared, my_rank, num_processes, halo_dim) != 0);
+		check = MPI_Allreduce(MPI_IN_PLACE, &read_failed, 1, MPI_INT, MPI_MAX, comm);
+	}
+	
+	// the fences make the rows written by the first process of a node visible to the others
+	if(check == MPI_SUCCESS) check = MPI_Win_fence(0, shared->input_window);
+	if(check == MPI_SUCCESS && shared->edited_window != MPI_WIN_NULL) check = MPI_Win_fence(0, shared->edited_window);
+	if(check != MPI_SUCCESS || read_failed){ // the error message of a failed read was printed by the called function
+		if(check != MPI_SUCCESS){
+			fprintf(stderr, "Rank %d: Error in open_shared_image while sharing the Image\n", my_rank);
+			fflush(stderr);
+		}
+		free_shared_image(shared);
+		return -1;
+	}
+	
+	return 0;
+}
+
+int move_marked_rows(shared_image_t *shared, const unsigned char *edited, int *rows, int peer, int receive){
+	/**
+	*	Takes in a shared Image on several nodes, the marks of the rows edited on a node, room for the index of every row,
+	*	the rank of a process in the communicator of the first processes of the nodes and 1 to receive the marked rows
+	*	of the edited Image from it (0 to send them to it). The rows are described by an indexed datatype, so they move
+	*	straight between the shared edited Images of the two nodes.
+	*	It returns the number of marked rows, or -1 on failure.
+	*/
+	
+	int num_rows = 0;
+	for(int row = 0; row < shared->height; ++row){
+		if(edited[row]) rows[num_rows++] = row;
+	}
+	
+	MPI_Datatype mpi_row, mpi_rows;
+	int check = MPI_Type_contiguous(shared->width * shared->channels, MPI_UNSIGNED_CHAR, &mpi_row);
+	if(check != MPI_SUCCESS){
+		return -1;
+	}
+	
+	check = MPI_Type_create_indexed_block(num_rows, 1, rows, mpi_row, &mpi_rows);
+	if(check == MPI_SUCCESS){
+		check = MPI_Type_commit(&mpi_rows);
+		if(check == MPI_SUCCESS && receive) check = MPI_Recv(shared->output, 1, mpi_rows, peer, SHARED_ROWS_TAG, shared->leaders, MPI_STATUS_IGNORE);
+		else if(check == MPI_SUCCESS) check = MPI_Send(shared->output, 1, mpi_rows, peer, SHARED_ROWS_TAG, shared->leaders);
+		MPI_Type_free(&mpi_rows);
+	}
+	MPI_Type_free(&mpi_row);
+	
+	return (check == MPI_SUCCESS) ? num_rows : -1;
+}
+
+int collect_node_rows(shared_image_t *shared, int my_rank){
+	/**
+	*	Takes in a shared Image edited on several nodes and this process's rank.
+	*	The first process of every other node sends process 0 the marks of the rows edited on its node, then these rows,
+	*	which process 0 receives straight into the edited Image of its node (move_marked_rows). No other process sends or receives pixels.
+	*	It returns 0 on success and -1 on failure.
+	*/
+	
+	if(shared->leaders == MPI_COMM_NULL){
+		return 0;
+	}
+	
+	int *rows = (int*)malloc(shared->height * sizeof(int));
+	unsigned char *edited = (my_rank == 0) ? (unsigned char*)malloc(shared->height) : shared->edited;
+	if(rows == NULL || edited == NULL){
+		fprintf(stderr, "Rank %d: Error in collect_node_rows while allocating memory\n", my_rank);
+		fflush(stderr);
+		free(rows);
+		if(my_rank == 0) free(edited);
+		return -1;
+	}
+	
+	int check = MPI_SUCCESS;
+	if(my_rank == 0){
+		for(int i = 1; i < shared->num_nodes && check == MPI_SUCCESS; ++i){
+			check = MPI_Recv(edited, shared->height, MPI_UNSIGNED_CHAR, i, SHARED_ROWS_TAG, shared->leaders, MPI_STATUS_IGNORE);
+			int num_rows = (check == MPI_SUCCESS) ? move_marked_rows(shared, edited, rows, i, 1) : -1;
+			if(num_rows >= 0) shared->copied_output += (size_t)num_rows * shared->width * shared->channels;
+			else check = -1;
+		}
+		free(edited);
+	}
+	else{
+		check = MPI_Send(shared->edited, shared->height, MPI_UNSIGNED_CHAR, 0, SHARED_ROWS_TAG, shared->leaders);
+		if(check == MPI_SUCCESS && move_marked_rows(shared, shared->edited, rows, 0, 0) == -1) check = -1;
+	}
+	free(rows);
+	
+	if(check != MPI_SUCCESS){
+		fprintf(stderr, "Rank %d: Error in collect_node_rows while collecting the edited rows of the nodes\n", my_rank);
+		fflush(stderr);
+		return -1;
+	}
+	
+	return 0;
+}
+
+Image *finish_shared_image(shared_image_t *shared, int my_rank){
+	/**
+	*	Takes in a shared Image whose rows were all edited and this process's rank.
+	*	Once every process wrote its rows, the rows edited on the other nodes are collected on the node of process 0 (collect_node_rows)
+	*	and process 0 copies the edited Image out of the shared window, which is then freed.
+	*	If rank == 0, it returns the edited Image, and if rank != 0, it returns a `dummy` Image.
+	*/
+	
+	Image *edited_img = (Image*)malloc(sizeof(Image));
+	unsigned char *data = NULL;
+	size_t size = (size_t)shared->height * shared->width * shared->channels;
+	
+	int check = MPI_Win_fence(0, shared->output_window);
+	if(check == MPI_SUCCESS && shared->edited_window != MPI_WIN_NULL){
+		check = MPI_Win_fence(0, shared->edited_window);
+		if(check == MPI_SUCCESS) check = collect_node_rows(shared, my_rank);
+		
+		if(SHARED_PRINT_COPIES && check == MPI_SUCCESS && my_rank == 0){
+			fprintf(stdout, "Rank 0: the shared windows of %d nodes copied %zu bytes of the Image and %zu bytes of the edited Image between the nodes\n",
+				shared->num_nodes, shared->copied_input, shared->copied_output);
+			fflush(stdout);
+		}
+	}
+	if(check == MPI_SUCCESS && my_rank == 0){
+		data = (unsigned char*)malloc(size);
+		if(data != NULL) memcpy(data, shared->output, size);
+	}
+	free_shared_image(shared);
+	
+	if(check != MPI_SUCCESS || edited_img == NULL || (my_rank == 0 && data == NULL)){
+		fprintf(stderr, "Rank %d: Error in finish_shared_image while collecting the edited Image\n", my_rank);
+		fflush(stderr);
+		free(edited_img);
+		free(data);
+		return NULL;
+	}
+	
+	edited_img->width = shared->width;
+	edited_img->height = shared->height;
+	edited_img->channels = shared->channels;
+	edited_img->top_down = shared->top_down;
+	edited_img->data = data;
+	return edited_img;
+}
+
+Image *edit_shared_image(const char *in_file_name, operation_t operation, int my_rank, int num_processes, MPI_Comm comm, int num_threads, unsigned long long *hash){
+	/**
+	*	Takes in the arguments of image_processing_parallel_no_sft and the number of threads of a process.
+	*	The Image is shared on every node (open_shared_image) instead of scattered:
+	*	every process edits the rows of its strip straight from the shared Image of its node into the shared edited Image,
+	*	so within a node neither the scatter, the halo exchange nor the compose copies any pixel. Between nodes, only the first process
+	*	of every node gets the strips of its node with their halos and sends the edited strips back.
+	*	If rank == 0, it returns the whole edited Image, and if rank != 0, it returns a `dummy` Image.
+	*/
+	
+	shared_image_t shared;
+	unsigned long long input_hash;
+	
+	int check = open_shared_image(in_file_name, comm, my_rank, num_processes, get_kernel_size(operation) / 2, &shared);
+	if(check != 0){ // error message was printed by the called function
+		return NULL;
+	}
+	
+	Image img = {shared.width, shared.height, shared.channels, shared.top_down, shared.input};
+	
+	if(RESULT_CACHE){
+		Image *cached_img;
+		check = check_result_cache(in_file_name, (my_rank == 0) ? &img : NULL, operation, my_rank, comm, num_threads, &input_hash, &cached_img);
+		if(check != 0){ // error message was printed by the called function
+			free_shared_image(&shared);
+			if(check == -1) return NULL;
+			return cached_result(cached_img, my_rank, num_threads, hash);
+		}
+	}
+	
+	int first_row, num_rows;
+	size_t row_size = (size_t)shared.width * shared.channels;
+	sft_strip_rows(shared.height, num_processes, my_rank, &first_row, &num_rows);
+	
+	check = 0;
+	if(num_rows > 0){
+		check = perform_convolution_into(&img, operation, first_row, first_row + num_rows - 1, num_threads, shared.output + first_row * row_size);
+		if(shared.edited != NULL) memset(shared.edited + first_row, 1, num_rows);
+	}
+	
+	unsigned long long rows_hash = 0;
+	if(check == 0 && hash != NULL){
+		rows_hash = hash_rows(shared.output + first_row * row_size, first_row, num_rows, shared.width, shared.channels, num_threads);
+	}
+	
+	// a process which failed still takes part in the collective calls, so the others do not wait for it forever
+	Image *edited_img = finish_shared_image(&shared, my_rank);
+	if(check != 0 || edited_img == NULL){ // error message was printed by the called function
+		if(edited_img != NULL){
+			free(edited_img->data);
+			free(edited_img);
+		}
+		return NULL;
+	}
+	
+	if(hash != NULL){
+		check = reduce_image_hash(rows_hash, shared.height, shared.width, shared.channels, hash, my_rank, comm);
+		if(check != 0){ // error message was printed by the called function
+			free(edited_img->data);
+			free(edited_img);
+			return NULL;
+		}
+	}
+	
+	if(RESULT_CACHE && my_rank == 0){
+		store_result_cache(input_hash, operation, edited_img); // a failed store only costs a later hit
+	}
+	
+	return edited_img;
+}
+
+Image *master_shared_image(const char *in_file_name, operation_t operation, int chunk_size, int my_rank, int num_processes, MPI_Comm comm, int num_threads, unsigned long long *hash){
+	/**
+	*	Takes in the arguments of image_processing_master and the number of threads of a process.
+	*	The Image is shared on every node (open_shared_image) instead of being sent in chunks:
+	*	process 0 schedules the chunks like sft_master_process, sending only their rows, and every process edits its chunks
+	*	straight from the shared Image of its node into the shared edited Image, so within a node no pixel is sent.
+	*	As any process may get any chunk, every node gets the whole Image, through its first process, and sends back the rows it edited.
+	*	If rank == 0, it returns the whole edited Image, and if rank != 0, it returns a `dummy` Image.
+	*/
+	
+	shared_image_t shared;
+	unsigned long long input_hash;
+	
+	int check = open_shared_image(in_file_name, comm, my_rank, num_processes, SHARED_ANY_ROWS, &shared);
+	if(check != 0){ // error message was printed by the called function
+		return NULL;
+	}
+	
+	if(RESULT_CACHE){
+		Image img = {shared.width, shared.height, shared.channels, shared.top_down, shared.input};
+		Image *cached_img;
+		check = check_result_cache(in_file_name, (my_rank == 0) ? &img : NULL, operation, my_rank, comm, num_threads, &input_hash, &cached_img);
+		if(check != 0){ // error message was printed by the called function
+			free_shared_image(&shared);
+			if(check == -1) return NULL;
+			return cached_result(cached_img, my_rank, num_threads, hash);
+		}
+	}
+	
+	shared_files_t files = {MPI_FILE_NULL, NULL, MPI_FILE_NULL, shared.height, shared.width, shared.channels, shared.top_down, 0, 0, 0, 0, shared.input, shared.output, shared.edited};
+	unsigned long long rows_hash = 0;
+	
+	if(my_rank == 0){
+		check = sft_master_process(&files, operation, chunk_size, num_processes, comm, num_threads, (hash != NULL) ? &rows_hash : NULL);
+	}
+	else{
+		check = sft_worker_process(&files, get_kernel_size(operation) / 2, my_rank, comm, (hash != NULL) ? &rows_hash : NULL);
+	}
+	
+	// a process which failed still takes part in the collective calls, so the others do not wait for it forever
+	Image *edited_img = finish_shared_image(&shared, my_rank);
+	if(check != 0 || edited_img == NULL){ // error message was printed by the called function
+		if(edited_img != NULL){
+			free(edited_img->data);
+			free(edited_img);
+		}
+		return NULL;
+	}
+	
+	if(hash != NULL){
+		check = reduce_image_hash(rows_hash, shared.height, shared.width, shared.channels, hash, my_rank, comm);
+		if(check != 0){ // error message was printed by the called function
+			free(edited_img->data);
+			free(edited_img);
+			return NULL;
+		}
+	}
+	
+	if(RESULT_CACHE && my_rank == 0){
+		store_result_cache(input_hash, operation, edited_img); // a failed store only costs a later hit
+	}
+	
+	return edited_img;
+}
\ No newline at end of file
@@ -0,0 +1,12 @@
+#ifndef SHARED_MEMORY
+
+#define SHARED_MEMORY
+
+#include "bmp_common.h"
+#include "convolution.h"
+
+int split_node(MPI_Comm comm, int my_rank, MPI_Comm *node);
+Image *edit_shared_image(const char *in_file_name, operation_t operation, int my_rank, int num_processes, MPI_Comm comm, int num_threads, unsigned long long *hash);
+Image *master_shared_image(const char *in_file_name, operation_t operation, int chunk_size, int my_rank, int num_processes, MPI_Comm comm, int num_threads, unsigned long long *hash);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,460 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "tiled.h"
+#include "bmp.h"
+#include "bmp_common.h"
+
+int is_tiled_file(const char *filename){
+	/**
+	*	Takes in a file path and returns 1 if the file starts with the tiled image magic and 0 otherwise.
+	*/
+	
+	FILE *image_file = fopen(filename, "rb");
+	if(image_file == NULL){
+		return 0;
+	}
+	
+	char magic[4];
+	int is_tiled = (fread(magic, sizeof(char), 4, image_file) == 4 && memcmp(magic, TILED_MAGIC, 4) == 0);
+	fclose(image_file);
+	return is_tiled;
+}
+
+int compress_tile_RLE(const unsigned char *src, int size, unsigned char *dst){
+	/**
+	*	Takes in the size bytes of a tile and a buffer with room for size bytes
+	*	and run-length encodes the tile into it: a control byte c < 128 is followed by c + 1 literal bytes
+	*	and a control byte c >= 128 is followed by one byte repeated c - 125 times.
+	*	It returns the size of the encoded tile, or -1 if it would not be smaller than the tile itself.
+	*/
+	
+	int in = 0, out = 0;
+	
+	while(in < size){
+		int run = 1;
+		while(in + run < size && run < 130 && src[in + run] == src[in]){
+			++run;
+		}
+		
+		if(run >= 3){
+			if(out + 2 >= size) return -1;
+			dst[out++] = (unsigned char)(run + 125);
+			dst[out++] = src[in];
+			in += run;
+		}
+		else{
+			// literals up to the next run of at least 3 equal bytes
+			int count = 0;
+			while(in + count < size && count < 128){
+				if(in + count + 2 < size && src[in + count] == src[in + count + 1] && src[in + count] == src[in + count + 2]) break;
+				++count;
+			}
+			
+			if(out + 1 + count >= size) return -1;
+			dst[out++] = (unsigned char)(count - 1);
+			memcpy(dst + out, src + in, count);
+			out += count;
+			in += count;
+		}
+	}
+	
+	return out;
+}
+
+int decompress_tile_RLE(const unsigned char *src, int src_size, unsigned char *dst, int dst_size){
+	/**
+	*	Takes in a tile encoded by compress_tile_RLE, its encoded size, a buffer and the size of the decoded tile
+	*	and decodes the tile into the buffer.
+	*	It returns 0 on success and -1 if the encoded tile is corrupted.
+	*/
+	
+	int in = 0, out = 0;
+	
+	while(in < src_size){
+		int control = src[in++];
+		
+		if(control < 128){
+			int count = control + 1;
+			if(in + count > src_size || out + count > dst_size) return -1;
+			memcpy(dst + out, src + in, count);
+			in += count;
+			out += count;
+		}
+		else{
+			int run = control - 125;
+			if(in >= src_size || out + run > dst_size) return -1;
+			memset(dst + out, src[in++], run);
+			out += run;
+		}
+	}
+	
+	return (out == dst_size) ? 0 : -1;
+}
+
+int convert_BMP_to_tiled(const char *bmp_file_name, const char *tiled_file_name, int tile_width, int tile_height, int compression){
+	/**
+	*	Takes in the file path of a .bmp file, the file path of the tiled image to create, the size of a tile
+	*	and the compression to use (TILED_COMPRESSION_NONE or TILED_COMPRESSION_RLE).
+	*	It writes the header, the tile index and the tiles, row of tiles after row of tiles, each tile holding its rows
+	*	in the order of the .bmp file without padding. A compressed tile is only kept if it is smaller than the tile itself.
+	*	Only one row of tiles is kept in memory, so images larger than the memory can be converted.
+	*	It returns 0 on success and -1 on failure.
+	*/
+	
+	if(tile_width <= 0 || tile_height <= 0 || (compression != TILED_COMPRESSION_NONE && compression != TILED_COMPRESSION_RLE)){
+		fprintf(stderr, "Error in convert_BMP_to_tiled: Invalid tile size or compression\n");
+		fflush(stderr);
+		return -1;
+	}
+	
+	int height, width, channels, top_down, data_start, padding;
+	FILE *bmp_file = open_BMP(bmp_file_name, &height, &width, &channels, &top_down, &data_start, &padding);
+	if(bmp_file == NULL){ // error message was printed by the called function
+		return -1;
+	}
+	fseek(bmp_file, data_start, SEEK_SET);
+	
+	FILE *tiled_file = fopen(tiled_file_name, "wb");
+	if(tiled_file == NULL){
+		fprintf(stderr, "Error in convert_BMP_to_tiled: Could not create file %s\n", tiled_file_name);
+		fflush(stderr);
+		fclose(bmp_file);
+		return -1;
+	}
+	
+	int row_size = width * channels;
+	int tiles_x = (width + tile_width - 1) / tile_width;
+	int tiles_y = (height + tile_height - 1) / tile_height;
+	int num_tiles = tiles_x * tiles_y;
+	int tile_size = tile_width * tile_height * channels;
+	
+	unsigned char *band = (unsigned char*)malloc((size_t)tile_height * (row_size + padding));
+	unsigned char *tile = (unsigned char*)malloc(tile_size);
+	unsigned char *packed = (unsigned char*)malloc(tile_size);
+	long long *tile_offsets = (long long*)malloc((num_tiles + 1) * sizeof(long long));
+	if(band == NULL || tile == NULL || packed == NULL || tile_offsets == NULL){
+		fprintf(stderr, "Error in convert_BMP_to_tiled while allocating memory\n");
+		fflush(stderr);
+		free(band);
+		free(tile);
+		free(packed);
+		free(tile_offsets);
+		fclose(bmp_file);
+		fclose(tiled_file);
+		return -1;
+	}
+	
+	int header[8] = {TILED_VERSION, width, height, channels, top_down, tile_width, tile_height, compression};
+	fwrite(TILED_MAGIC, sizeof(char), 4, tiled_file);
+	fwrite(header, sizeof(int), 8, tiled_file);
+	
+	// the index is written once all the tiles are, when their sizes are known
+	long long position = TILED_HEADER_SIZE + (long long)(num_tiles + 1) * sizeof(long long);
+	fseek(tiled_file, position, SEEK_SET);
+	
+	int check = 0;
+	for(int ty = 0; ty < tiles_y && check == 0; ++ty){
+		int rows = min(tile_height, height - ty * tile_height);
+		
+		check = read_BMP_rows(bmp_file, band, rows, row_size, padding);
+		if(check != 0){ // error message was printed by the called function
+			break;
+		}
+		
+		for(int tx = 0; tx < tiles_x; ++tx){
+			int cols = min(tile_width, width - tx * tile_width);
+			int tile_row_size = cols * channels;
+			int raw_size = rows * tile_row_size;
+			
+			for(int r = 0; r < rows; ++r){
+				memcpy(tile + (size_t)r * tile_row_size, band + (size_t)r * row_size + (size_t)tx * tile_width * channels, tile_row_size);
+			}
+			
+			int packed_size = (compression == TILED_COMPRESSION_RLE) ? compress_tile_RLE(tile, raw_size, packed) : -1;
+			const unsigned char *stored = (packed_size == -1) ? tile : packed;
+			int stored_size = (packed_size == -1) ? raw_size : packed_size;
+			
+			if(fwrite(stored, sizeof(unsigned char), stored_size, tiled_file) != (size_t)stored_size){
+				fprintf(stderr, "Error in convert_BMP_to_tiled while writing to file %s\n", tiled_file_name);
+				fflush(stderr);
+				check = -1;
+				break;
+			}
+			
+			tile_offsets[ty * tiles_x + tx] = position;
+			position += stored_size;
+		}
+	}
+	tile_offsets[num_tiles] = position;
+	
+	if(check == 0){
+		fseek(tiled_file, TILED_HEADER_SIZE, SEEK_SET);
+		if(fwrite(tile_offsets, sizeof(long long), num_tiles + 1, tiled_file) != (size_t)(num_tiles + 1)){
+			fprintf(stderr, "Error in convert_BMP_to_tiled while writing to file %s\n", tiled_file_name);
+			fflush(stderr);
+			check = -1;
+		}
+	}
+	
+	free(band);
+	free(tile);
+	free(packed);
+	free(tile_offsets);
+	fclose(bmp_file);
+	fclose(tiled_file);
+	return check;
+}
+
+tiled_image_t *open_tiled(const char *filename){
+	/**
+	*	Takes in the file path of a tiled image and returns it opened, with its header and tile index loaded.
+	*/
+	
+	FILE *image_file = fopen(filename, "rb");
+	if(image_file == NULL){
+		fprintf(stderr, "Error in open_tiled: Could not open file %s\n", filename);
+		fflush(stderr);
+		return NULL;
+	}
+	
+	char magic[4];
+	int header[8];
+	if(fread(magic, sizeof(char), 4, image_file) != 4 || memcmp(magic, TILED_MAGIC, 4) != 0 || fread(header, sizeof(int), 8, image_file) != 8){
+		fprintf(stderr, "Error in open_tiled: Not a valid tiled image\n");
+		fflush(stderr);
+		fclose(image_file);
+		return NULL;
+	}
+	
+	if(header[0] != TILED_VERSION || header[1] <= 0 || header[2] <= 0 || (header[3] != 1 && header[3] != 3 && header[3] != 4) || header[5] <= 0 || header[6] <= 0){
+		fprintf(stderr, "Error in open_tiled: Unsupported tiled image\n");
+		fflush(stderr);
+		fclose(image_file);
+		return NULL;
+	}
+	
+	tiled_image_t *tiled = (tiled_image_t*)malloc(sizeof(tiled_image_t));
+	if(tiled == NULL){
+		fprintf(stderr, "Error in open_tiled while allocating memory\n");
+		fflush(stderr);
+		fclose(image_file);
+		return NULL;
+	}
+	
+	tiled->file = image_file;
+	tiled->width = header[1];
+	tiled->height = header[2];
+	tiled->channels = header[3];
+	tiled->top_down = header[4];
+	tiled->tile_width = header[5];
+	tiled->tile_height = header[6];
+	tiled->compression = header[7];
+	tiled->tiles_x = (tiled->width + tiled->tile_width - 1) / tiled->tile_width;
+	tiled->tiles_y = (tiled->height + tiled->tile_height - 1) / tiled->tile_height;
+	
+	int num_tiles = tiled->tiles_x * tiled->tiles_y;
+	tiled->tile_offsets = (long long*)malloc((num_tiles + 1) * sizeof(long long));
+	if(tiled->tile_offsets == NULL){
+		fprintf(stderr, "Error in open_tiled while allocating memory\n");
+		fflush(stderr);
+		free(tiled);
+		fclose(image_file);
+		return NULL;
+	}
+	
+	if(fread(tiled->tile_offsets, sizeof(long long), num_tiles + 1, image_file) != (size_t)(num_tiles + 1)){
+		fprintf(stderr, "Error in open_tiled: Invalid tile index in file %s\n", filename);
+		fflush(stderr);
+		close_tiled(tiled);
+		return NULL;
+	}
+	
+	return tiled;
+}
+
+void close_tiled(tiled_image_t *tiled){
+	/**
+	*	Takes in a tiled image opened by open_tiled, closes its file and frees it.
+	*/
+	
+	fclose(tiled->file);
+	free(tiled->tile_offsets);
+	free(tiled);
+}
+
+int read_tiled_rect(tiled_image_t *tiled, int x, int y, int rect_width, int rect_height, unsigned char *data){
+	/**
+	*	Takes in an open tiled image, the first column and row of a rectangle (rows are numbered like in an Image),
+	*	its size and a pixel buffer with room for rect_width * rect_height pixels.
+	*	It stores the rectangle in data, one row after the other. The tiles of a row of tiles are stored
+	*	next to each other, so every row of tiles the rectangle touches is fetched with a single read.
+	*	It returns 0 on success and -1 on failure.
+	*/
+	
+	if(x < 0 || y < 0 || rect_width <= 0 || rect_height <= 0 || x + rect_width > tiled->width || y + rect_height > tiled->height){
+		fprintf(stderr, "Error in read_tiled_rect: Rectangle out of the image\n");
+		fflush(stderr);
+		return -1;
+	}
+	
+	int channels = tiled->channels;
+	int first_tx = x / tiled->tile_width;
+	int last_tx = (x + rect_width - 1) / tiled->tile_width;
+	int first_ty = y / tiled->tile_height;
+	int last_ty = (y + rect_height - 1) / tiled->tile_height;
+	
+	long long max_run_size = 0;
+	for(int ty = first_ty; ty <= last_ty; ++ty){
+		long long run_size = tiled->tile_offsets[ty * tiled->tiles_x + last_tx + 1] - tiled->tile_offsets[ty * tiled->tiles_x + first_tx];
+		if(run_size > max_run_size) max_run_size = run_size;
+	}
+	
+	unsigned char *run = (unsigned char*)malloc(max_run_size);
+	unsigned char *tile = (unsigned char*)malloc((size_t)tiled->tile_width * tiled->tile_height * channels);
+	if(run == NULL || tile == NULL){
+		fprintf(stderr, "Error in read_tiled_rect while allocating memory\n");
+		fflush(stderr);
+		free(run);
+		free(tile);
+		return -1;
+	}
+	
+	for(int ty = first_ty; ty <= last_ty; ++ty){
+		long long run_start = tiled->tile_offsets[ty * tiled->tiles_x + first_tx];
+		size_t run_size = tiled->tile_offsets[ty * tiled->tiles_x + last_tx + 1] - run_start;
+		
+		fseek(tiled->file, run_start, SEEK_SET);
+		if(fread(run, sizeof(unsigned char), run_size, tiled->file) != run_size){
+			fprintf(stderr, "Error in read_tiled_rect while reading from file\n");
+			fflush(stderr);
+			free(run);
+			free(tile);
+			return -1;
+		}
+		
+		int tile_y = ty * tiled->tile_height;
+		int rows = min(tiled->tile_height, tiled->height - tile_y);
+		int first_row = max(y, tile_y);
+		int end_row = min(y + rect_height, tile_y + rows);
+		
+		for(int tx = first_tx; tx <= last_tx; ++tx){
+			int index = ty * tiled->tiles_x + tx;
+			int tile_x = tx * tiled->tile_width;
+			int cols = min(tiled->tile_width, tiled->width - tile_x);
+			int raw_size = rows * cols * channels;
+			int stored_size = tiled->tile_offsets[index + 1] - tiled->tile_offsets[index];
+			const unsigned char *pixels = run + (tiled->tile_offsets[index] - run_start);
+			
+			// tiles which did not shrink when compressed are stored as they are
+			if(stored_size != raw_size){
+				if(decompress_tile_RLE(pixels, stored_size, tile, raw_size) != 0){
+					fprintf(stderr, "Error in read_tiled_rect: Corrupted tile %d\n", index);
+					fflush(stderr);
+					free(run);
+					free(tile);
+					return -1;
+				}
+				pixels = tile;
+			}
+			
+			int first_col = max(x, tile_x);
+			int end_col = min(x + rect_width, tile_x + cols);
+			
+			for(int r = first_row; r < end_row; ++r){
+				memcpy(data + ((size_t)(r - y) * rect_width + (first_col - x)) * channels,
+					pixels + ((size_t)(r - tile_y) * cols + (first_col - tile_x)) * channels, (size_t)(end_col - first_col) * channels);
+			}
+		}
+	}
+	
+	free(run);
+	free(tile);
+	return 0;
+}
+
+Image *read_tiled_serial(const char *filename){
+	/**
+	*	Takes in the file path of a tiled image and returns the whole image as an Image,
+	*	identical to the one read_BMP_serial returns for the .bmp file it was converted from.
+	*/
+	
+	tiled_image_t *tiled = open_tiled(filename);
+	if(tiled == NULL){ // error message was printed by the called function
+		return NULL;
+	}
+	
+	unsigned char *data = (unsigned char*)malloc((size_t)tiled->width * tiled->height * tiled->channels);
+	Image *img = (Image*)malloc(sizeof(Image));
+	if(data == NULL || img == NULL){
+		fprintf(stderr, "Error in read_tiled_serial while allocating memory\n");
+		fflush(stderr);
+		free(data);
+		free(img);
+		close_tiled(tiled);
+		return NULL;
+	}
+	
+	int check = read_tiled_rect(tiled, 0, 0, tiled->width, tiled->height, data);
+	if(check != 0){ // error message was printed by the called function
+		free(data);
+		free(img);
+		close_tiled(tiled);
+		return NULL;
+	}
+	
+	img->width = tiled->width;
+	img->height = tiled->height;
+	img->channels = tiled->channels;
+	img->top_down = tiled->top_down;
+	img->data = data;
+	close_tiled(tiled);
+	return img;
+}
+
+Image *read_tiled_chunk(tiled_image_t *tiled, int halo_dim, int chunk_size, int *next_row, int *true_start, int *true_end){
+	/**
+	*	Takes in an open tiled image, the size of the halo, the size of a chunk and the first row of the chunk
+	*	and returns the read chunk as an Image, just like read_BMP_chunk, setting true_start and true_end
+	*	to represent the start and end of the image chunk (not including the halos) and moving next_row after the chunk.
+	*	If there are no more rows to read, the returned Image has no data.
+	*/
+	
+	if(*next_row >= tiled->height){ // no more rows to read
+		Image *dummy_image = (Image*)malloc(sizeof(Image));
+		dummy_image->data = NULL;
+		return dummy_image;
+	}
+	
+	// the first chunk has no halo before it and the last one has no halo after it
+	int chunk_rows = min(chunk_size, tiled->height - *next_row);
+	int halo_before = min(halo_dim, *next_row);
+	int halo_after = min(halo_dim, tiled->height - *next_row - chunk_rows);
+	int rows_to_read = halo_before + chunk_rows + halo_after;
+	
+	*true_start = halo_before;
+	*true_end = halo_before + chunk_rows - 1;
+	
+	unsigned char *data = (unsigned char*)malloc((size_t)rows_to_read * tiled->width * tiled->channels);
+	if(data == NULL){
+		fprintf(stderr, "Rank 0: Error in read_tiled_chunk while allocating memory\n");
+		fflush(stderr);
+		return NULL;
+	}
+	
+	int check = read_tiled_rect(tiled, 0, *next_row - halo_before, tiled->width, rows_to_read, data);
+	if(check != 0){ // error message was printed by the called function
+		free(data);
+		return NULL;
+	}
+	
+	*next_row += chunk_rows; // the next chunk starts right after this one
+	
+	Image *image_chunk = (Image*)malloc(sizeof(Image));
+	image_chunk->width = tiled->width;
+	image_chunk->height = rows_to_read;
+	image_chunk->channels = tiled->channels;
+	image_chunk->top_down = tiled->top_down;
+	image_chunk->data = data;
+	return image_chunk;
+}
\ No newline at end of file
@@ -0,0 +1,33 @@
+#ifndef TILED_IMAGE
+
+#define TILED_IMAGE
+
+#include <stdio.h>
+#include "bmp_common.h"
+
+#define TILED_MAGIC "TIMG"
+#define TILED_VERSION 1
+#define TILED_HEADER_SIZE 36 // magic followed by 8 ints: version, width, height, channels, top_down, tile_width, tile_height, compression
+
+#define TILED_COMPRESSION_NONE 0
+#define TILED_COMPRESSION_RLE 1
+
+typedef struct{
+	FILE *file;
+	int width, height, channels, top_down;
+	int tile_width, tile_height, tiles_x, tiles_y;
+	int compression;
+	long long *tile_offsets; // tiles_x * tiles_y + 1 entries, tile i is stored in the bytes [tile_offsets[i], tile_offsets[i + 1])
+}tiled_image_t; // an open tiled image file, with its header and tile index loaded
+
+int is_tiled_file(const char *filename);
+int compress_tile_RLE(const unsigned char *src, int size, unsigned char *dst);
+int decompress_tile_RLE(const unsigned char *src, int src_size, unsigned char *dst, int dst_size);
+int convert_BMP_to_tiled(const char *bmp_file_name, const char *tiled_file_name, int tile_width, int tile_height, int compression);
+tiled_image_t *open_tiled(const char *filename);
+void close_tiled(tiled_image_t *tiled);
+int read_tiled_rect(tiled_image_t *tiled, int x, int y, int rect_width, int rect_height, unsigned char *data);
+Image *read_tiled_serial(const char *filename);
+Image *read_tiled_chunk(tiled_image_t *tiled, int halo_dim, int chunk_size, int *next_row, int *true_start, int *true_end);
+
+#endif
\ No newline at end of file
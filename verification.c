@@ -0,0 +1,203 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <omp.h>
+#include "verification.h"
+
+#define HASH_PRIME_1 0x9E3779B185EBCA87ULL
+#define HASH_PRIME_2 0xC2B2AE3D27D4EB4FULL
+#define HASH_PRIME_3 0x165667B19E3779F9ULL
+
+unsigned long long mix_hash(unsigned long long h){
+	/**
+	*	Takes in a 64-bit value and returns it with its bits mixed, so that every input bit affects every output bit.
+	*/
+	
+	h ^= h >> 30;
+	h *= 0xBF58476D1CE4E5B9ULL;
+	h ^= h >> 27;
+	h *= 0x94D049BB133111EBULL;
+	h ^= h >> 31;
+	return h;
+}
+
+unsigned long long hash_row(const unsigned char *row, int row_size, int row_index){
+	/**
+	*	Takes in a row of pixels, its size and its index in the Image and returns its 64-bit hash,
+	*	reading 8 bytes at a time. The index is part of the hash, so equal rows at different places hash differently.
+	*/
+	
+	unsigned long long h = mix_hash((unsigned long long)(row_index + 1) * HASH_PRIME_1) ^ ((unsigned long long)row_size * HASH_PRIME_2);
+	int i = 0;
+	
+	for(; i + 8 <= row_size; i += 8){
+		unsigned long long word;
+		memcpy(&word, row + i, 8);
+		h ^= mix_hash(word * HASH_PRIME_2);
+		h = ((h << 27) | (h >> 37)) * HASH_PRIME_1 + HASH_PRIME_3;
+	}
+	
+	for(; i < row_size; ++i){
+		h ^= row[i] * HASH_PRIME_3;
+		h = ((h << 11) | (h >> 53)) * HASH_PRIME_1;
+	}
+	
+	return mix_hash(h);
+}
+
+unsigned long long hash_rows(const unsigned char *data, int first_row, int rows, int width, int channels, int num_threads){
+	/**
+	*	Takes in consecutive rows of an Image, the index of the first of them in the Image, their number,
+	*	the width of the Image, its number of channels and the number of threads to use and returns the hash of the rows.
+	*	The hash of some rows is the sum of the hashes of each row, so the hashes of the strips of an Image,
+	*	computed by different processes, add up to the same value whatever the strips are.
+	*/
+	
+	int row_size = width * channels;
+	unsigned long long sum = 0;
+	
+	#pragma omp parallel for num_threads(num_threads) reduction(+:sum)
+	for(int y = 0; y < rows; ++y){
+		sum += hash_row(data + (size_t)y * row_size, row_size, first_row + y);
+	}
+	
+	return sum;
+}
+
+unsigned long long finish_image_hash(unsigned long long rows_hash, int height, int width, int channels){
+	/**
+	*	Takes in the hash of all the rows of an Image, as returned by hash_rows (or the sum of the hashes of its strips),
+	*	and the height, width and number of channels of the Image and returns the hash of the Image.
+	*/
+	
+	unsigned long long shape = ((unsigned long long)height << 32) ^ ((unsigned long long)width << 4) ^ (unsigned long long)channels;
+	return mix_hash(rows_hash ^ mix_hash(shape * HASH_PRIME_2));
+}
+
+unsigned long long hash_image(const Image *img, int num_threads){
+	/**
+	*	Takes in an Image and the number of threads to use and returns the 64-bit hash of the Image.
+	*/
+	
+	return finish_image_hash(hash_rows(img->data, 0, img->height, img->width, img->channels, num_threads), img->height, img->width, img->channels);
+}
+
+int reduce_image_hash(unsigned long long rows_hash, int height, int width, int channels, unsigned long long *hash, int my_rank, MPI_Comm comm){
+	/**
+	*	Takes in the hash of the rows edited by this process, the height, width and number of channels of the Image
+	*	(only needed by process 0), a place to store the hash of the Image, this process's rank and the communicator of the processes.
+	*	The hashes of all the processes are added together on process 0, which sets hash to the hash of the Image.
+	*/
+	
+	if(HASH_PRINT_STRIPS){
+		fprintf(stdout, "Rank %d: strip hash %016llx\n", my_rank, rows_hash);
+		fflush(stdout);
+	}
+	
+	unsigned long long sum = 0;
+	int check = MPI_Reduce(&rows_hash, &sum, 1, MPI_UNSIGNED_LONG_LONG, MPI_SUM, 0, comm);
+	if(check != MPI_SUCCESS){
+		fprintf(stderr, "Rank %d: Error in reduce_image_hash while comunicating hashes\n", my_rank);
+		fflush(stderr);
+		return -1;
+	}
+	
+	if(my_rank == 0){
+		*hash = finish_image_hash(sum, height, width, channels);
+	}
+	return 0;
+}
+
+int load_golden_hash(const char *golden_file_name, const char *in_file_name, operation_t operation, unsigned long long *hash){
+	/**
+	*	Takes in the file holding the golden hashes, the file path of an input image and an operation_t
+	*	and sets hash to the golden hash of the input edited with the operation.
+	*	Each line of the file holds a hash, an operation and an input file path; the last matching line wins.
+	*	It returns 1 if a golden hash was found and 0 otherwise.
+	*/
+	
+	FILE *golden_file = fopen(golden_file_name, "r");
+	if(golden_file == NULL){ // no golden hashes yet
+		return 0;
+	}
+	
+	char line[1024];
+	int found = 0;
+	
+	while(fgets(line, sizeof(line), golden_file) != NULL){
+		unsigned long long line_hash;
+		int line_operation, path_start;
+		
+		line[strcspn(line, "\r\n")] = '\0';
+		if(sscanf(line, "%llx %d %n", &line_hash, &line_operation, &path_start) != 2) continue;
+		
+		if(line_operation == (int)operation && strcmp(line + path_start, in_file_name) == 0){
+			*hash = line_hash;
+			found = 1;
+		}
+	}
+	
+	fclose(golden_file);
+	return found;
+}
+
+int store_golden_hash(const char *golden_file_name, const char *in_file_name, operation_t operation, unsigned long long hash){
+	/**
+	*	Takes in the file holding the golden hashes, the file path of an input image, an operation_t
+	*	and the hash of the input edited with the operation and appends it to the file.
+	*	It returns 0 on success and -1 on failure.
+	*/
+	
+	FILE *golden_file = fopen(golden_file_name, "a");
+	if(golden_file == NULL){
+		fprintf(stderr, "Error in store_golden_hash: Could not open file %s\n", golden_file_name);
+		fflush(stderr);
+		return -1;
+	}
+	
+	fprintf(golden_file, "%016llx %d %s\n", hash, (int)operation, in_file_name);
+	fclose(golden_file);
+	return 0;
+}
+
+int max_pixel_difference(const Image *img1, const Image *img2){
+	/**
+	*	Takes in 2 Images and returns the largest absolute difference between two of their corresponding bytes,
+	*	or -1 if they do not have the same size.
+	*/
+	
+	if(img1->height != img2->height || img1->width != img2->width || img1->channels != img2->channels) return -1;
+	
+	long long size = (long long)img1->height * img1->width * img1->channels;
+	int max_difference = 0;
+	
+	#pragma omp parallel for reduction(max:max_difference)
+	for(long long i = 0; i < size; ++i){
+		int difference = abs((int)img1->data[i] - (int)img2->data[i]);
+		if(difference > max_difference) max_difference = difference;
+	}
+	
+	return max_difference;
+}
+
+double image_psnr(const Image *img1, const Image *img2){
+	/**
+	*	Takes in 2 Images and returns their peak signal-to-noise ratio in dB (INFINITY if they are identical),
+	*	or -1 if they do not have the same size.
+	*/
+	
+	if(img1->height != img2->height || img1->width != img2->width || img1->channels != img2->channels) return -1;
+	
+	long long size = (long long)img1->height * img1->width * img1->channels;
+	double squared_error = 0;
+	
+	#pragma omp parallel for reduction(+:squared_error)
+	for(long long i = 0; i < size; ++i){
+		double difference = (double)img1->data[i] - (double)img2->data[i];
+		squared_error += difference * difference;
+	}
+	
+	if(squared_error == 0) return INFINITY;
+	return 10.0 * log10(255.0 * 255.0 / (squared_error / size));
+}
\ No newline at end of file
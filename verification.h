@@ -0,0 +1,19 @@
+#ifndef VERIFICATION
+
+#define VERIFICATION
+
+#include "bmp_common.h"
+#include "convolution.h"
+
+#define HASH_PRINT_STRIPS 0 // set to 1 to print the hash of the strip of rows of every process
+
+unsigned long long hash_rows(const unsigned char *data, int first_row, int rows, int width, int channels, int num_threads);
+unsigned long long finish_image_hash(unsigned long long rows_hash, int height, int width, int channels);
+unsigned long long hash_image(const Image *img, int num_threads);
+int reduce_image_hash(unsigned long long rows_hash, int height, int width, int channels, unsigned long long *hash, int my_rank, MPI_Comm comm);
+int load_golden_hash(const char *golden_file_name, const char *in_file_name, operation_t operation, unsigned long long *hash);
+int store_golden_hash(const char *golden_file_name, const char *in_file_name, operation_t operation, unsigned long long hash);
+int max_pixel_difference(const Image *img1, const Image *img2);
+double image_psnr(const Image *img1, const Image *img2);
+
+#endif
\ No newline at end of file